@@ -70,16 +70,79 @@ static NETSTATS network_stats = {0};
 
 static NETSOCKET invalid_socket = {NETTYPE_INVALID, -1, -1};
 
+/* asynchronous logging: a bounded multi-producer queue of pre-formatted
+   lines that is drained by a background thread */
+enum
+{
+	LOG_LINE_SIZE = 1024*4,
+	LOG_QUEUE_SIZE = 256 /* must be a power of two */
+};
+
+typedef struct LOG_RECORD
+{
+	volatile unsigned sequence;
+	char line[LOG_LINE_SIZE];
+} LOG_RECORD;
+
+static LOG_RECORD log_queue[LOG_QUEUE_SIZE];
+static volatile unsigned log_enqueue_pos = 0;
+static unsigned log_dequeue_pos = 0;
+static volatile unsigned log_dropped = 0;
+static volatile int log_async_running = 0;
+static int log_queue_initialized = 0;
+static void *log_thread = 0;
+static LOCK log_drain_lock = 0;
+static SEMAPHORE log_semaphore;
+
+#if defined(__GNUC__)
+static unsigned log_atomic_load(volatile unsigned *p) { unsigned v = *p; __sync_synchronize(); return v; }
+static void log_atomic_store(volatile unsigned *p, unsigned v) { __sync_synchronize(); *p = v; }
+static int log_atomic_compswap(volatile unsigned *p, unsigned comperand, unsigned value) { return __sync_bool_compare_and_swap(p, comperand, value); }
+static unsigned log_atomic_inc(volatile unsigned *p) { return __sync_add_and_fetch(p, 1); }
+static unsigned log_atomic_take(volatile unsigned *p) { return __sync_fetch_and_and(p, 0); }
+#elif defined(_MSC_VER)
+static unsigned log_atomic_load(volatile unsigned *p) { unsigned v = *p; MemoryBarrier(); return v; }
+static void log_atomic_store(volatile unsigned *p, unsigned v) { MemoryBarrier(); *p = v; }
+static int log_atomic_compswap(volatile unsigned *p, unsigned comperand, unsigned value) { return (unsigned)InterlockedCompareExchange((volatile LONG *)p, (LONG)value, (LONG)comperand) == comperand; }
+static unsigned log_atomic_inc(volatile unsigned *p) { return InterlockedIncrement((volatile LONG *)p); }
+static unsigned log_atomic_take(volatile unsigned *p) { return InterlockedExchange((volatile LONG *)p, 0); }
+#else
+	#error missing atomic implementation for this compiler
+#endif
+
 void dbg_logger(DBG_LOGGER logger)
 {
 	loggers[num_loggers++] = logger;
 }
 
+static void log_queue_drain();
+
+/* flushes the logging queue before crashing, gives up if the logging thread
+   does not release the queue, e.g. because the assert happened inside of it */
+static void log_flush_crash()
+{
+	int i;
+	if(!log_queue_initialized)
+		return;
+
+	for(i = 0; i < 100; i++)
+	{
+		if(lock_trylock(log_drain_lock) == 0)
+		{
+			log_queue_drain();
+			lock_unlock(log_drain_lock);
+			return;
+		}
+		thread_sleep(1);
+	}
+}
+
 void dbg_assert_imp(const char *filename, int line, int test, const char *msg)
 {
 	if(!test)
 	{
 		dbg_msg("assert", "%s(%d): %s", filename, line, msg);
+		log_flush_crash();
 		dbg_break();
 	}
 }
@@ -89,31 +152,175 @@ void dbg_break()
 	*((volatile unsigned*)0) = 0x0;
 }
 
-void dbg_msg(const char *sys, const char *fmt, ...)
+static void dbg_format(char *str, int str_size, const char *sys, const char *fmt, va_list args)
 {
-	va_list args;
-	char str[1024*4];
 	char *msg;
-	int i, len;
+	int len;
 
 	char timestr[80];
 	str_timestamp_format(timestr, sizeof(timestr), FORMAT_SPACE);
 
-	str_format(str, sizeof(str), "[%s][%s]: ", timestr, sys);
+	str_format(str, str_size, "[%s][%s]: ", timestr, sys);
 
 	len = strlen(str);
 	msg = (char *)str + len;
 
-	va_start(args, fmt);
 #if defined(CONF_FAMILY_WINDOWS) && !defined(__GNUC__)
-	_vsprintf_p(msg, sizeof(str)-len, fmt, args);
+	_vsprintf_p(msg, str_size-len, fmt, args);
 #else
-	vsnprintf(msg, sizeof(str)-len, fmt, args);
+	vsnprintf(msg, str_size-len, fmt, args);
 #endif
-	va_end(args);
+}
+
+/* claims a free slot in the queue, returns 0 if the queue is full */
+static LOG_RECORD *log_queue_claim(unsigned *pos_out)
+{
+	unsigned pos = log_atomic_load(&log_enqueue_pos);
+	while(1)
+	{
+		LOG_RECORD *record = &log_queue[pos&(LOG_QUEUE_SIZE-1)];
+		int diff = (int)(log_atomic_load(&record->sequence) - pos);
+		if(diff == 0)
+		{
+			if(log_atomic_compswap(&log_enqueue_pos, pos, pos+1))
+			{
+				*pos_out = pos;
+				return record;
+			}
+			pos = log_atomic_load(&log_enqueue_pos);
+		}
+		else if(diff < 0)
+			return 0;
+		else
+			pos = log_atomic_load(&log_enqueue_pos);
+	}
+}
 
+static void log_write_line(const char *line)
+{
+	int i;
 	for(i = 0; i < num_loggers; i++)
-		loggers[i](str);
+		loggers[i](line);
+}
+
+/* writes out all published records, must be called with log_drain_lock held */
+static void log_queue_drain()
+{
+	unsigned dropped;
+	while(1)
+	{
+		unsigned pos = log_dequeue_pos;
+		LOG_RECORD *record = &log_queue[pos&(LOG_QUEUE_SIZE-1)];
+		if((int)(log_atomic_load(&record->sequence) - (pos+1)) < 0)
+			break;
+		log_dequeue_pos = pos+1;
+		log_write_line(record->line);
+		log_atomic_store(&record->sequence, pos+LOG_QUEUE_SIZE);
+	}
+
+	dropped = log_atomic_take(&log_dropped);
+	if(dropped)
+	{
+		char str[256];
+		char timestr[80];
+		str_timestamp_format(timestr, sizeof(timestr), FORMAT_SPACE);
+		str_format(str, sizeof(str), "[%s][dbg/logger]: dropped %u messages, logging queue was full", timestr, dropped);
+		log_write_line(str);
+	}
+}
+
+static void log_thread_func(void *user)
+{
+	while(log_async_running)
+	{
+		semaphore_wait(&log_semaphore);
+		lock_wait(log_drain_lock);
+		log_queue_drain();
+		lock_unlock(log_drain_lock);
+	}
+}
+
+void dbg_msg(const char *sys, const char *fmt, ...)
+{
+	va_list args;
+
+	if(log_async_running)
+	{
+		unsigned pos;
+		LOG_RECORD *record = log_queue_claim(&pos);
+		if(!record)
+		{
+			log_atomic_inc(&log_dropped);
+			return;
+		}
+
+		va_start(args, fmt);
+		dbg_format(record->line, sizeof(record->line), sys, fmt, args);
+		va_end(args);
+
+		log_atomic_store(&record->sequence, pos+1);
+		semaphore_signal(&log_semaphore);
+	}
+	else
+	{
+		char str[LOG_LINE_SIZE];
+
+		va_start(args, fmt);
+		dbg_format(str, sizeof(str), sys, fmt, args);
+		va_end(args);
+
+		log_write_line(str);
+	}
+}
+
+void dbg_logger_async_start()
+{
+	if(log_async_running)
+		return;
+
+	if(!log_queue_initialized)
+	{
+		unsigned i;
+		for(i = 0; i < LOG_QUEUE_SIZE; i++)
+			log_queue[i].sequence = i;
+		log_drain_lock = lock_create();
+		log_queue_initialized = 1;
+		atexit(dbg_logger_flush);
+	}
+
+	semaphore_init(&log_semaphore);
+	log_async_running = 1;
+	log_thread = thread_init(log_thread_func, 0);
+	if(!log_thread)
+	{
+		log_async_running = 0;
+		semaphore_destroy(&log_semaphore);
+		dbg_msg("dbg/logger", "failed to start logging thread, logging synchronously");
+	}
+}
+
+void dbg_logger_async_stop()
+{
+	if(!log_async_running)
+		return;
+
+	log_async_running = 0;
+	semaphore_signal(&log_semaphore);
+	thread_wait(log_thread);
+	log_thread = 0;
+	semaphore_destroy(&log_semaphore);
+
+	dbg_logger_flush();
+}
+
+void dbg_logger_flush()
+{
+	if(!log_queue_initialized)
+		return;
+
+	lock_wait(log_drain_lock);
+	log_queue_drain();
+	lock_unlock(log_drain_lock);
 }
 
 #if defined(CONF_FAMILY_WINDOWS)
@@ -620,20 +827,23 @@ void lock_unlock(LOCK lock)
 #endif
 }
 
-#if !defined(CONF_PLATFORM_MACOSX)
-	#if defined(CONF_FAMILY_UNIX)
-	void semaphore_init(SEMAPHORE *sem) { sem_init(sem, 0, 0); }
-	void semaphore_wait(SEMAPHORE *sem) { sem_wait(sem); }
-	void semaphore_signal(SEMAPHORE *sem) { sem_post(sem); }
-	void semaphore_destroy(SEMAPHORE *sem) { sem_destroy(sem); }
-	#elif defined(CONF_FAMILY_WINDOWS)
-	void semaphore_init(SEMAPHORE *sem) { *sem = CreateSemaphore(0, 0, 10000, 0); }
-	void semaphore_wait(SEMAPHORE *sem) { WaitForSingleObject((HANDLE)*sem, INFINITE); }
-	void semaphore_signal(SEMAPHORE *sem) { ReleaseSemaphore((HANDLE)*sem, 1, NULL); }
-	void semaphore_destroy(SEMAPHORE *sem) { CloseHandle((HANDLE)*sem); }
-	#else
-		#error not implemented on this platform
-	#endif
+#if defined(CONF_PLATFORM_MACOSX)
+void semaphore_init(SEMAPHORE *sem) { *sem = dispatch_semaphore_create(0); }
+void semaphore_wait(SEMAPHORE *sem) { dispatch_semaphore_wait(*sem, DISPATCH_TIME_FOREVER); }
+void semaphore_signal(SEMAPHORE *sem) { dispatch_semaphore_signal(*sem); }
+void semaphore_destroy(SEMAPHORE *sem) { dispatch_release(*sem); }
+#elif defined(CONF_FAMILY_UNIX)
+void semaphore_init(SEMAPHORE *sem) { sem_init(sem, 0, 0); }
+void semaphore_wait(SEMAPHORE *sem) { sem_wait(sem); }
+void semaphore_signal(SEMAPHORE *sem) { sem_post(sem); }
+void semaphore_destroy(SEMAPHORE *sem) { sem_destroy(sem); }
+#elif defined(CONF_FAMILY_WINDOWS)
+void semaphore_init(SEMAPHORE *sem) { *sem = CreateSemaphore(0, 0, 10000, 0); }
+void semaphore_wait(SEMAPHORE *sem) { WaitForSingleObject((HANDLE)*sem, INFINITE); }
+void semaphore_signal(SEMAPHORE *sem) { ReleaseSemaphore((HANDLE)*sem, 1, NULL); }
+void semaphore_destroy(SEMAPHORE *sem) { CloseHandle((HANDLE)*sem); }
+#else
+	#error not implemented on this platform
 #endif
 
 
@@ -975,7 +1185,7 @@ static int priv_net_close_all_sockets(NETSOCKET sock)
 	return 0;
 }
 
-static int priv_net_create_socket(int domain, int type, struct sockaddr *addr, int sockaddrlen, int use_random_port)
+static int priv_net_create_socket(int domain, int type, struct sockaddr *addr, int sockaddrlen, int use_random_port, int reuse_port)
 {
 	int sock, e;
 
@@ -1004,6 +1214,24 @@ static int priv_net_create_socket(int domain, int type, struct sockaddr *addr, i
 	}
 #endif
 
+	/* let other sockets bind the same port, the system spreads the packets over them */
+	if(reuse_port)
+	{
+#if defined(SO_REUSEPORT)
+		int reuse = 1;
+		if(setsockopt(sock, SOL_SOCKET, SO_REUSEPORT, (const char*)&reuse, sizeof(reuse)) != 0)
+		{
+			dbg_msg("net", "failed to set SO_REUSEPORT (%d '%s')", errno, strerror(errno));
+			priv_net_close_socket(sock);
+			return -1;
+		}
+#else
+		dbg_msg("net", "SO_REUSEPORT is not supported on this system");
+		priv_net_close_socket(sock);
+		return -1;
+#endif
+	}
+
 	/* bind the socket */
 	while(1)
 	{
@@ -1044,7 +1272,7 @@ static int priv_net_create_socket(int domain, int type, struct sockaddr *addr, i
 	return sock;
 }
 
-NETSOCKET net_udp_create(NETADDR bindaddr, int use_random_port)
+static NETSOCKET priv_net_udp_create(NETADDR bindaddr, int use_random_port, int reuse_port)
 {
 	NETSOCKET sock = invalid_socket;
 	NETADDR tmpbindaddr = bindaddr;
@@ -1059,7 +1287,7 @@ NETSOCKET net_udp_create(NETADDR bindaddr, int use_random_port)
 		/* bind, we should check for error */
 		tmpbindaddr.type = NETTYPE_IPV4;
 		netaddr_to_sockaddr_in(&tmpbindaddr, &addr);
-		socket = priv_net_create_socket(AF_INET, SOCK_DGRAM, (struct sockaddr *)&addr, sizeof(addr), use_random_port);
+		socket = priv_net_create_socket(AF_INET, SOCK_DGRAM, (struct sockaddr *)&addr, sizeof(addr), use_random_port, reuse_port);
 		if(socket >= 0)
 		{
 			sock.type |= NETTYPE_IPV4;
@@ -1081,7 +1309,7 @@ NETSOCKET net_udp_create(NETADDR bindaddr, int use_random_port)
 		/* bind, we should check for error */
 		tmpbindaddr.type = NETTYPE_IPV6;
 		netaddr_to_sockaddr_in6(&tmpbindaddr, &addr);
-		socket = priv_net_create_socket(AF_INET6, SOCK_DGRAM, (struct sockaddr *)&addr, sizeof(addr), use_random_port);
+		socket = priv_net_create_socket(AF_INET6, SOCK_DGRAM, (struct sockaddr *)&addr, sizeof(addr), use_random_port, reuse_port);
 		if(socket >= 0)
 		{
 			sock.type |= NETTYPE_IPV6;
@@ -1102,6 +1330,16 @@ NETSOCKET net_udp_create(NETADDR bindaddr, int use_random_port)
 	return sock;
 }
 
+NETSOCKET net_udp_create(NETADDR bindaddr, int use_random_port)
+{
+	return priv_net_udp_create(bindaddr, use_random_port, 0);
+}
+
+NETSOCKET net_udp_create_reuseport(NETADDR bindaddr)
+{
+	return priv_net_udp_create(bindaddr, 0, 1);
+}
+
 int net_udp_send(NETSOCKET sock, const NETADDR *addr, const void *data, int size)
 {
 	int d = -1;
@@ -1218,7 +1456,7 @@ NETSOCKET net_tcp_create(NETADDR bindaddr)
 		/* bind, we should check for error */
 		tmpbindaddr.type = NETTYPE_IPV4;
 		netaddr_to_sockaddr_in(&tmpbindaddr, &addr);
-		socket = priv_net_create_socket(AF_INET, SOCK_STREAM, (struct sockaddr *)&addr, sizeof(addr), 0);
+		socket = priv_net_create_socket(AF_INET, SOCK_STREAM, (struct sockaddr *)&addr, sizeof(addr), 0, 0);
 		if(socket >= 0)
 		{
 			sock.type |= NETTYPE_IPV4;
@@ -1234,7 +1472,7 @@ NETSOCKET net_tcp_create(NETADDR bindaddr)
 		/* bind, we should check for error */
 		tmpbindaddr.type = NETTYPE_IPV6;
 		netaddr_to_sockaddr_in6(&tmpbindaddr, &addr);
-		socket = priv_net_create_socket(AF_INET6, SOCK_STREAM, (struct sockaddr *)&addr, sizeof(addr), 0);
+		socket = priv_net_create_socket(AF_INET6, SOCK_STREAM, (struct sockaddr *)&addr, sizeof(addr), 0, 0);
 		if(socket >= 0)
 		{
 			sock.type |= NETTYPE_IPV6;
@@ -2523,6 +2761,20 @@ unsigned str_quickhash(const char *str)
 	return hash;
 }
 
+unsigned str_quickhash_nocase(const char *str)
+{
+	/* same as str_quickhash, for strings compared with str_comp_nocase */
+	unsigned hash = 5381;
+	for(; *str; str++)
+	{
+		unsigned char c = *str;
+		if(c >= 'A' && c <= 'Z')
+			c += 'a' - 'A';
+		hash = ((hash << 5) + hash) + c;
+	}
+	return hash;
+}
+
 struct SECURE_RANDOM_DATA
 {
 	int initialized;
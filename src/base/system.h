@@ -446,22 +446,23 @@ void lock_unlock(LOCK lock);
 
 /* Group: Semaphores */
 
-#if !defined(CONF_PLATFORM_MACOSX)
-	#if defined(CONF_FAMILY_UNIX)
-		#include <semaphore.h>
-		typedef sem_t SEMAPHORE;
-	#elif defined(CONF_FAMILY_WINDOWS)
-		typedef void* SEMAPHORE;
-	#else
-		#error missing sempahore implementation
-	#endif
-
-	void semaphore_init(SEMAPHORE *sem);
-	void semaphore_wait(SEMAPHORE *sem);
-	void semaphore_signal(SEMAPHORE *sem);
-	void semaphore_destroy(SEMAPHORE *sem);
+#if defined(CONF_PLATFORM_MACOSX)
+	#include <dispatch/dispatch.h>
+	typedef dispatch_semaphore_t SEMAPHORE;
+#elif defined(CONF_FAMILY_UNIX)
+	#include <semaphore.h>
+	typedef sem_t SEMAPHORE;
+#elif defined(CONF_FAMILY_WINDOWS)
+	typedef void* SEMAPHORE;
+#else
+	#error missing sempahore implementation
 #endif
 
+void semaphore_init(SEMAPHORE *sem);
+void semaphore_wait(SEMAPHORE *sem);
+void semaphore_signal(SEMAPHORE *sem);
+void semaphore_destroy(SEMAPHORE *sem);
+
 /* Group: Timer */
 #ifdef __GNUC__
 /* if compiled with -pedantic-errors it will complain about long
@@ -654,6 +655,21 @@ int net_addr_from_str(NETADDR *addr, const char *string);
 */
 NETSOCKET net_udp_create(NETADDR bindaddr, int use_random_port);
 
+/*
+	Function: net_udp_create_reuseport
+		Creates a UDP socket that shares its port with other sockets
+		created this way. Incoming packets are spread over them.
+
+	Parameters:
+		bindaddr - Address to bind the socket to.
+
+	Returns:
+		On success it returns an handle to the socket. On failure, or
+		if the system does not support SO_REUSEPORT, it returns
+		NETSOCKET_INVALID.
+*/
+NETSOCKET net_udp_create_reuseport(NETADDR bindaddr);
+
 /*
 	Function: net_udp_send
 		Sends a packet over an UDP socket.
@@ -1398,6 +1414,34 @@ void dbg_logger_stdout();
 void dbg_logger_debugger();
 void dbg_logger_file(const char *filename);
 
+/*
+	Function: dbg_logger_async_start
+		Moves the output of all loggers to a background thread.
+		<dbg_msg> only formats the line and queues it afterwards.
+
+	Remarks:
+		- If the queue is full, messages are dropped and the number
+		of dropped messages is logged once there is room again.
+		- The queue is flushed on failed asserts and at exit.
+
+	See Also:
+		<dbg_logger_async_stop>, <dbg_logger_flush>
+*/
+void dbg_logger_async_start();
+
+/*
+	Function: dbg_logger_async_stop
+		Stops the logging thread, writes out all queued messages and
+		goes back to logging synchronously.
+*/
+void dbg_logger_async_stop();
+
+/*
+	Function: dbg_logger_flush
+		Writes out all queued messages on the calling thread.
+*/
+void dbg_logger_flush();
+
 #if defined(CONF_FAMILY_WINDOWS)
 void dbg_console_init();
 void dbg_console_cleanup();
@@ -1419,6 +1463,7 @@ float str_tofloat(const char *str);
 int str_isspace(char c);
 char str_uppercase(char c);
 unsigned str_quickhash(const char *str);
+unsigned str_quickhash_nocase(const char *str);
 
 struct SKELETON;
 void str_utf8_skeleton_begin(struct SKELETON* skel, const char* str);
@@ -7,6 +7,7 @@
 	atomic_inc - should return the value after increment
 	atomic_dec - should return the value after decrement
 	atomic_compswap - should return the value before the eventual swap
+	atomic_compswap_ptr - same as atomic_compswap but for pointers
 	sync_barrier - creates a full hardware fence
 */
 
@@ -27,6 +28,11 @@
 		return __sync_val_compare_and_swap(pValue, comperand, value);
 	}
 
+	inline void *atomic_compswap_ptr(void * volatile *ppValue, void *comperand, void *value)
+	{
+		return __sync_val_compare_and_swap(ppValue, comperand, value);
+	}
+
 	inline void sync_barrier()
 	{
 		__sync_synchronize();
@@ -55,6 +61,11 @@
 		return _InterlockedCompareExchange((volatile long *)pValue, (long)value, (long)comperand);
 	}
 
+	inline void *atomic_compswap_ptr(void * volatile *ppValue, void *comperand, void *value)
+	{
+		return _InterlockedCompareExchangePointer(ppValue, value, comperand);
+	}
+
 	inline void sync_barrier()
 	{
 		MemoryBarrier();
@@ -63,21 +74,15 @@
 	#error missing atomic implementation for this compiler
 #endif
 
-#if defined(CONF_PLATFORM_MACOSX)
-	/*
-		use semaphore provided by SDL on macosx
-	*/
-#else
-	class semaphore
-	{
-		SEMAPHORE sem;
-	public:
-		semaphore() { semaphore_init(&sem); }
-		~semaphore() { semaphore_destroy(&sem); }
-		void wait() { semaphore_wait(&sem); }
-		void signal() { semaphore_signal(&sem); }
-	};
-#endif
+class semaphore
+{
+	SEMAPHORE sem;
+public:
+	semaphore() { semaphore_init(&sem); }
+	~semaphore() { semaphore_destroy(&sem); }
+	void wait() { semaphore_wait(&sem); }
+	void signal() { semaphore_signal(&sem); }
+};
 
 class lock
 {
@@ -0,0 +1,148 @@
+#include <base/tl/threading.h>
+
+#include "backend_null.h"
+
+enum
+{
+	NULL_SCREEN_WIDTH=1920,
+	NULL_SCREEN_HEIGHT=1080,
+};
+
+CGraphicsBackend_Null::CGraphicsBackend_Null()
+{
+	mem_zero(&m_Counters, sizeof(m_Counters));
+	mem_zero(m_aTextureMemSize, sizeof(m_aTextureMemSize));
+	m_TextureMemoryUsage = 0;
+	m_ScreenWidth = NULL_SCREEN_WIDTH;
+	m_ScreenHeight = NULL_SCREEN_HEIGHT;
+}
+
+int CGraphicsBackend_Null::Init(const char *pName, int *Screen, int *pWindowWidth, int *pWindowHeight, int *pScreenWidth, int *pScreenHeight, int FsaaSamples, int Flags, int *pDesktopWidth, int *pDesktopHeight)
+{
+	*Screen = 0;
+	*pDesktopWidth = NULL_SCREEN_WIDTH;
+	*pDesktopHeight = NULL_SCREEN_HEIGHT;
+	if(*pWindowWidth == 0 || *pWindowHeight == 0)
+	{
+		*pWindowWidth = NULL_SCREEN_WIDTH;
+		*pWindowHeight = NULL_SCREEN_HEIGHT;
+	}
+	*pScreenWidth = m_ScreenWidth = *pWindowWidth;
+	*pScreenHeight = m_ScreenHeight = *pWindowHeight;
+
+	dbg_msg("gfx", "using the null backend, nothing will be rendered (%dx%d)", *pScreenWidth, *pScreenHeight);
+	return 0;
+}
+
+int CGraphicsBackend_Null::Shutdown()
+{
+	dbg_msg("gfx", "null backend: %lld buffers, %lld commands, %lld render commands, %lld quads, %lld lines, %lld swaps",
+		m_Counters.m_Buffers, m_Counters.m_Commands, m_Counters.m_RenderCommands, m_Counters.m_Quads, m_Counters.m_Lines, m_Counters.m_Swaps);
+	dbg_msg("gfx", "null backend: %lld quad buffer renders with %lld quads", m_Counters.m_QuadBufferRenders, m_Counters.m_QuadBufferQuads);
+	dbg_msg("gfx", "null backend: %lld texture creates, %lld texture updates, %lld texture bytes",
+		m_Counters.m_TextureCreates, m_Counters.m_TextureUpdates, m_Counters.m_TextureBytes);
+	return 0;
+}
+
+bool CGraphicsBackend_Null::GetDesktopResolution(int Index, int *pDesktopWidth, int* pDesktopHeight)
+{
+	*pDesktopWidth = NULL_SCREEN_WIDTH;
+	*pDesktopHeight = NULL_SCREEN_HEIGHT;
+	return Index == 0;
+}
+
+void CGraphicsBackend_Null::RunCommand(const CCommandBuffer::SCommand *pBaseCommand)
+{
+	m_Counters.m_Commands++;
+
+	switch(pBaseCommand->m_Cmd)
+	{
+	case CCommandBuffer::CMD_SIGNAL:
+		static_cast<const CCommandBuffer::SCommand_Signal *>(pBaseCommand)->m_pSemaphore->signal();
+		break;
+	case CCommandBuffer::CMD_TEXTURE_CREATE:
+		{
+			const CCommandBuffer::SCommand_Texture_Create *pCommand = static_cast<const CCommandBuffer::SCommand_Texture_Create *>(pBaseCommand);
+			int Size = pCommand->m_Width*pCommand->m_Height*pCommand->m_PixelSize;
+			m_TextureMemoryUsage += Size-m_aTextureMemSize[pCommand->m_Slot];
+			m_aTextureMemSize[pCommand->m_Slot] = Size;
+			m_Counters.m_TextureCreates++;
+			m_Counters.m_TextureBytes += Size;
+			mem_free(pCommand->m_pData);
+		}
+		break;
+	case CCommandBuffer::CMD_TEXTURE_UPDATE:
+		{
+			const CCommandBuffer::SCommand_Texture_Update *pCommand = static_cast<const CCommandBuffer::SCommand_Texture_Update *>(pBaseCommand);
+			m_Counters.m_TextureUpdates++;
+			m_Counters.m_TextureBytes += pCommand->m_Width*pCommand->m_Height*(pCommand->m_Format == CCommandBuffer::TEXFORMAT_ALPHA ? 1 : pCommand->m_Format == CCommandBuffer::TEXFORMAT_RGB ? 3 : 4);
+			mem_free(pCommand->m_pData);
+		}
+		break;
+	case CCommandBuffer::CMD_TEXTURE_DESTROY:
+		{
+			const CCommandBuffer::SCommand_Texture_Destroy *pCommand = static_cast<const CCommandBuffer::SCommand_Texture_Destroy *>(pBaseCommand);
+			m_TextureMemoryUsage -= m_aTextureMemSize[pCommand->m_Slot];
+			m_aTextureMemSize[pCommand->m_Slot] = 0;
+		}
+		break;
+	case CCommandBuffer::CMD_RENDER:
+		{
+			const CCommandBuffer::SCommand_Render *pCommand = static_cast<const CCommandBuffer::SCommand_Render *>(pBaseCommand);
+			m_Counters.m_RenderCommands++;
+			if(pCommand->m_PrimType == CCommandBuffer::PRIMTYPE_QUADS)
+				m_Counters.m_Quads += pCommand->m_PrimCount;
+			else if(pCommand->m_PrimType == CCommandBuffer::PRIMTYPE_LINES)
+				m_Counters.m_Lines += pCommand->m_PrimCount;
+		}
+		break;
+	case CCommandBuffer::CMD_QUADBUFFER_CREATE:
+		mem_free(static_cast<const CCommandBuffer::SCommand_QuadBuffer_Create *>(pBaseCommand)->m_pVertices);
+		break;
+	case CCommandBuffer::CMD_QUADBUFFER_RENDER:
+		m_Counters.m_QuadBufferRenders++;
+		m_Counters.m_QuadBufferQuads += static_cast<const CCommandBuffer::SCommand_QuadBuffer_Render *>(pBaseCommand)->m_NumQuads;
+		break;
+	case CCommandBuffer::CMD_SWAP:
+		m_Counters.m_Swaps++;
+		break;
+	case CCommandBuffer::CMD_VSYNC:
+		*static_cast<const CCommandBuffer::SCommand_VSync *>(pBaseCommand)->m_pRetOk = true;
+		break;
+	case CCommandBuffer::CMD_VIDEOMODES:
+		*static_cast<const CCommandBuffer::SCommand_VideoModes *>(pBaseCommand)->m_pNumModes = 0;
+		break;
+	case CCommandBuffer::CMD_SCREENSHOT:
+		{
+			// a black image, the callers own the data
+			const CCommandBuffer::SCommand_Screenshot *pCommand = static_cast<const CCommandBuffer::SCommand_Screenshot *>(pBaseCommand);
+			int w = pCommand->m_W == -1 ? m_ScreenWidth : pCommand->m_W;
+			int h = pCommand->m_H == -1 ? m_ScreenHeight : pCommand->m_H;
+			pCommand->m_pImage->m_Width = w;
+			pCommand->m_pImage->m_Height = h;
+			pCommand->m_pImage->m_Format = CImageInfo::FORMAT_RGB;
+			pCommand->m_pImage->m_pData = mem_alloc(w*h*3, 1);
+			mem_zero(pCommand->m_pImage->m_pData, w*h*3);
+		}
+		break;
+	default:
+		// clear and the platform commands have nothing to do
+		break;
+	}
+}
+
+void CGraphicsBackend_Null::RunBuffer(CCommandBuffer *pBuffer)
+{
+	m_Counters.m_Buffers++;
+
+	unsigned CmdIndex = 0;
+	while(1)
+	{
+		const CCommandBuffer::SCommand *pBaseCommand = pBuffer->GetCommand(&CmdIndex);
+		if(pBaseCommand == 0x0)
+			break;
+		RunCommand(pBaseCommand);
+	}
+}
+
+IGraphicsBackend *CreateNullGraphicsBackend() { return new CGraphicsBackend_Null; }
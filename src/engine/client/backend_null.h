@@ -0,0 +1,61 @@
+#pragma once
+
+#include "graphics_threaded.h"
+
+// graphics backend that renders nothing, it only counts the commands it gets. used to measure
+// the cpu cost of the client on machines without a display or gpu
+class CGraphicsBackend_Null : public IGraphicsBackend
+{
+public:
+	struct CCounters
+	{
+		int64 m_Buffers;
+		int64 m_Commands;
+		int64 m_RenderCommands;
+		int64 m_Quads;
+		int64 m_Lines;
+		int64 m_QuadBufferRenders;
+		int64 m_QuadBufferQuads;
+		int64 m_TextureCreates;
+		int64 m_TextureUpdates;
+		int64 m_TextureBytes;
+		int64 m_Swaps;
+	};
+
+private:
+	CCounters m_Counters;
+	int m_aTextureMemSize[CCommandBuffer::MAX_TEXTURES];
+	int m_TextureMemoryUsage;
+	int m_ScreenWidth;
+	int m_ScreenHeight;
+
+	void RunCommand(const CCommandBuffer::SCommand *pBaseCommand);
+
+public:
+	CGraphicsBackend_Null();
+
+	virtual int Init(const char *pName, int *Screen, int *pWindowWidth, int *pWindowHeight, int *pScreenWidth, int *pScreenHeight, int FsaaSamples, int Flags, int *pDesktopWidth, int *pDesktopHeight);
+	virtual int Shutdown();
+
+	virtual int MemoryUsage() const { return m_TextureMemoryUsage; }
+	virtual int GetTextureArraySize() const { return 1; }
+
+	virtual int GetNumScreens() const { return 1; }
+
+	virtual void Minimize() {}
+	virtual void Maximize() {}
+	virtual bool Fullscreen(bool State) { return false; }
+	virtual void SetWindowBordered(bool State) {}
+	virtual bool SetWindowScreen(int Index) { return Index == 0; }
+	virtual bool GetDesktopResolution(int Index, int *pDesktopWidth, int* pDesktopHeight);
+	virtual int GetWindowScreen() { return 0; }
+	virtual int WindowActive() { return 1; }
+	virtual int WindowOpen() { return 1; }
+
+	// the commands are handled right away, there is no render thread
+	virtual void RunBuffer(CCommandBuffer *pBuffer);
+	virtual bool IsIdle() const { return true; }
+	virtual void WaitForIdle() {}
+
+	const CCounters *Counters() const { return &m_Counters; }
+};
@@ -461,6 +461,42 @@ void CCommandProcessorFragment_OpenGL::Cmd_Render(const CCommandBuffer::SCommand
 	};
 }
 
+void CCommandProcessorFragment_OpenGL::Cmd_QuadBuffer_Create(const CCommandBuffer::SCommand_QuadBuffer_Create *pCommand)
+{
+	CQuadBuffer *pBuffer = &m_aQuadBuffers[pCommand->m_Slot];
+	if(pBuffer->m_pVertices)
+		mem_free(pBuffer->m_pVertices);
+	pBuffer->m_pVertices = pCommand->m_pVertices;
+	pBuffer->m_NumVertices = pCommand->m_NumVertices;
+}
+
+void CCommandProcessorFragment_OpenGL::Cmd_QuadBuffer_Destroy(const CCommandBuffer::SCommand_QuadBuffer_Destroy *pCommand)
+{
+	CQuadBuffer *pBuffer = &m_aQuadBuffers[pCommand->m_Slot];
+	if(pBuffer->m_pVertices)
+		mem_free(pBuffer->m_pVertices);
+	pBuffer->m_pVertices = 0;
+	pBuffer->m_NumVertices = 0;
+}
+
+void CCommandProcessorFragment_OpenGL::Cmd_QuadBuffer_Render(const CCommandBuffer::SCommand_QuadBuffer_Render *pCommand)
+{
+	const CQuadBuffer *pBuffer = &m_aQuadBuffers[pCommand->m_Slot];
+	if(!pBuffer->m_pVertices)
+		return;
+
+	SetState(pCommand->m_State);
+
+	glVertexPointer(3, GL_FLOAT, sizeof(CCommandBuffer::SBufferVertex), (char*)pBuffer->m_pVertices);
+	glTexCoordPointer(3, GL_FLOAT, sizeof(CCommandBuffer::SBufferVertex), (char*)pBuffer->m_pVertices + sizeof(float)*3);
+	glEnableClientState(GL_VERTEX_ARRAY);
+	glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+	glDisableClientState(GL_COLOR_ARRAY);
+	glColor4f(pCommand->m_Color.r, pCommand->m_Color.g, pCommand->m_Color.b, pCommand->m_Color.a);
+
+	glDrawArrays(GL_QUADS, pCommand->m_Offset*4, pCommand->m_NumQuads*4);
+}
+
 void CCommandProcessorFragment_OpenGL::Cmd_Screenshot(const CCommandBuffer::SCommand_Screenshot *pCommand)
 {
 	// fetch image data
@@ -501,6 +537,7 @@ void CCommandProcessorFragment_OpenGL::Cmd_Screenshot(const CCommandBuffer::SCom
 CCommandProcessorFragment_OpenGL::CCommandProcessorFragment_OpenGL()
 {
 	mem_zero(m_aTextures, sizeof(m_aTextures));
+	mem_zero(m_aQuadBuffers, sizeof(m_aQuadBuffers));
 	m_pTextureMemoryUsage = 0;
 }
 
@@ -514,6 +551,9 @@ bool CCommandProcessorFragment_OpenGL::RunCommand(const CCommandBuffer::SCommand
 	case CCommandBuffer::CMD_TEXTURE_UPDATE: Cmd_Texture_Update(static_cast<const CCommandBuffer::SCommand_Texture_Update *>(pBaseCommand)); break;
 	case CCommandBuffer::CMD_CLEAR: Cmd_Clear(static_cast<const CCommandBuffer::SCommand_Clear *>(pBaseCommand)); break;
 	case CCommandBuffer::CMD_RENDER: Cmd_Render(static_cast<const CCommandBuffer::SCommand_Render *>(pBaseCommand)); break;
+	case CCommandBuffer::CMD_QUADBUFFER_CREATE: Cmd_QuadBuffer_Create(static_cast<const CCommandBuffer::SCommand_QuadBuffer_Create *>(pBaseCommand)); break;
+	case CCommandBuffer::CMD_QUADBUFFER_DESTROY: Cmd_QuadBuffer_Destroy(static_cast<const CCommandBuffer::SCommand_QuadBuffer_Destroy *>(pBaseCommand)); break;
+	case CCommandBuffer::CMD_QUADBUFFER_RENDER: Cmd_QuadBuffer_Render(static_cast<const CCommandBuffer::SCommand_QuadBuffer_Render *>(pBaseCommand)); break;
 	case CCommandBuffer::CMD_SCREENSHOT: Cmd_Screenshot(static_cast<const CCommandBuffer::SCommand_Screenshot *>(pBaseCommand)); break;
 	default: return false;
 	}
@@ -5,16 +5,6 @@
 #if defined(CONF_PLATFORM_MACOSX)
 	#include <objc/objc-runtime.h>
 
-	class semaphore
-	{
-		SDL_sem *sem;
-	public:
-		semaphore() { sem = SDL_CreateSemaphore(0); }
-		~semaphore() { SDL_DestroySemaphore(sem); }
-		void wait() { SDL_SemWait(sem); }
-		void signal() { SDL_SemPost(sem); }
-	};
-
 	class CAutoreleasePool
 	{
 	private:
@@ -103,6 +93,15 @@ class CCommandProcessorFragment_OpenGL
 	};
 	CTexture m_aTextures[CCommandBuffer::MAX_TEXTURES];
 	volatile int *m_pTextureMemoryUsage;
+
+	// kept in client memory, the fixed function pipeline draws them straight from there
+	class CQuadBuffer
+	{
+	public:
+		CCommandBuffer::SBufferVertex *m_pVertices;
+		int m_NumVertices;
+	};
+	CQuadBuffer m_aQuadBuffers[CCommandBuffer::MAX_QUADBUFFERS];
 	int m_MaxTexSize;
 	int m_Max3DTexSize;
 	int m_TextureArraySize;
@@ -133,6 +132,9 @@ private:
 	void Cmd_Texture_Create(const CCommandBuffer::SCommand_Texture_Create *pCommand);
 	void Cmd_Clear(const CCommandBuffer::SCommand_Clear *pCommand);
 	void Cmd_Render(const CCommandBuffer::SCommand_Render *pCommand);
+	void Cmd_QuadBuffer_Create(const CCommandBuffer::SCommand_QuadBuffer_Create *pCommand);
+	void Cmd_QuadBuffer_Destroy(const CCommandBuffer::SCommand_QuadBuffer_Destroy *pCommand);
+	void Cmd_QuadBuffer_Render(const CCommandBuffer::SCommand_QuadBuffer_Render *pCommand);
 	void Cmd_Screenshot(const CCommandBuffer::SCommand_Screenshot *pCommand);
 
 public:
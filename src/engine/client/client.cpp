@@ -35,6 +35,7 @@
 #include <engine/shared/protocol_ex.h>
 #include <engine/shared/ringbuffer.h>
 #include <engine/shared/snapshot.h>
+#include <engine/shared/snapshot_model.h>
 #include <engine/shared/uuid_manager.h>
 
 #include <game/version.h>
@@ -259,6 +260,11 @@ CClient::CClient() : m_DemoPlayer(&m_SnapshotDelta), m_DemoRecorder(&m_SnapshotD
 	m_LastCpuTime = time_get();
 	m_LastAvgCpuFrameTime = 0;
 
+	m_BenchmarkStartTime = 0;
+	m_BenchmarkRenderTime = 0;
+	m_BenchmarkMaxRenderTime = 0;
+	m_BenchmarkFrames = 0;
+
 	m_GameTickSpeed = SERVER_TICK_SPEED;
 
 	m_WindowMustRefocus = 0;
@@ -356,6 +362,14 @@ void CClient::SendEnterGame()
 
 void CClient::SendReady()
 {
+	// has to arrive before NETMSG_READY so the server can answer with its model before any snapshot
+	if(g_Config.m_ClSnapshotModel)
+	{
+		CMsgPacker Msg(NETMSG_SNAPSHOTMODEL_SUPPORT, true);
+		Msg.AddInt(CSnapshotModel::VERSION);
+		SendMsg(&Msg, MSGFLAG_VITAL);
+	}
+
 	CMsgPacker Msg(NETMSG_READY, true);
 	SendMsg(&Msg, MSGFLAG_VITAL|MSGFLAG_FLUSH);
 }
@@ -565,6 +579,7 @@ void CClient::DisconnectWithReason(const char *pReason)
 	m_aSnapshots[SNAP_CURRENT] = 0;
 	m_aSnapshots[SNAP_PREV] = 0;
 	m_RecivedSnapshots = 0;
+	m_SnapshotModel.Reset();
 }
 
 void CClient::Disconnect()
@@ -1083,6 +1098,9 @@ void CClient::ProcessServerPacket(CNetChunk *pPacket)
 			const SHA256_DIGEST *pMapSha256 = (const SHA256_DIGEST *)Unpacker.GetRaw(sizeof(*pMapSha256));
 			const char *pError = 0;
 
+			// the snapshot model is negotiated again for the new map
+			m_SnapshotModel.Reset();
+
 			// check for valid standard map
 			if(!m_MapChecker.IsMapValid(pMap, pMapSha256, MapCrc, MapSize))
 				pError = "invalid standard map";
@@ -1184,6 +1202,11 @@ void CClient::ProcessServerPacket(CNetChunk *pPacket)
 					m_pConsole->Print(IConsole::OUTPUT_LEVEL_DEBUG, "client/network", "requested next chunk package");
 			}
 		}
+		else if((pPacket->m_Flags&NET_CHUNKFLAG_VITAL) != 0 && Msg == NETMSG_SNAPSHOTMODEL)
+		{
+			if(!m_SnapshotModel.Unpack(&Unpacker))
+				DisconnectWithReason("invalid snapshot model");
+		}
 		else if((pPacket->m_Flags&NET_CHUNKFLAG_VITAL) != 0 && Msg == NETMSG_SERVERINFO)
 		{
 			CServerInfo Info = {0};
@@ -1368,7 +1391,17 @@ void CClient::ProcessServerPacket(CNetChunk *pPacket)
 
 					if(CompleteSize)
 					{
-						int IntSize = CVariableInt::Decompress(m_aSnapshotIncommingData, CompleteSize, aTmpBuffer2, sizeof(aTmpBuffer2));
+						const void *pIntData = m_aSnapshotIncommingData;
+						unsigned char aModelBuffer[CSnapshot::MAX_SIZE];
+						if(m_SnapshotModel.IsValid())
+						{
+							CompleteSize = m_SnapshotModel.Decompress(m_aSnapshotIncommingData, CompleteSize, aModelBuffer, sizeof(aModelBuffer));
+							if(CompleteSize < 0)
+								return;
+							pIntData = aModelBuffer;
+						}
+
+						int IntSize = CVariableInt::Decompress(pIntData, CompleteSize, aTmpBuffer2, sizeof(aTmpBuffer2));
 
 						if(IntSize < 0) // failure during decompression, bail
 							return;
@@ -1595,7 +1628,14 @@ void CClient::Update()
 	if(State() == IClient::STATE_DEMOPLAYBACK)
 	{
 		m_DemoPlayer.Update();
-		if(m_DemoPlayer.IsPlaying())
+		if(g_Config.m_DbgBenchmark && m_DemoPlayer.EndOfFile())
+		{
+			// the player pauses at the end of the demo instead of stopping
+			BenchmarkReport();
+			Disconnect();
+			Quit();
+		}
+		else if(m_DemoPlayer.IsPlaying())
 		{
 			// update timers
 			const CDemoPlayer::CPlaybackInfo *pInfo = m_DemoPlayer.Info();
@@ -1607,7 +1647,11 @@ void CClient::Update()
 		else
 		{
 			// disconnect on error
+			if(g_Config.m_DbgBenchmark)
+				BenchmarkReport();
 			Disconnect();
+			if(g_Config.m_DbgBenchmark)
+				Quit();
 		}
 	}
 	else if(State() == IClient::STATE_ONLINE && m_RecivedSnapshots >= 3)
@@ -1788,7 +1832,7 @@ void CClient::InitInterfaces()
 
 bool CClient::LimitFps()
 {
-	if(g_Config.m_GfxVsync || !g_Config.m_GfxLimitFps) return false;
+	if(g_Config.m_GfxVsync || !g_Config.m_GfxLimitFps || g_Config.m_DbgBenchmark) return false;
 
 	/**
 		If desired frame time is not reached:
@@ -1866,6 +1910,19 @@ bool CClient::LimitFps()
 	return SkipFrame;
 }
 
+void CClient::BenchmarkReport()
+{
+	double Elapsed = (time_get()-m_BenchmarkStartTime)/(double)time_freq();
+	int Frames = max(m_BenchmarkFrames, 1);
+
+	char aBuf[256];
+	str_format(aBuf, sizeof(aBuf), "%d frames in %.2f s, %.1f fps", m_BenchmarkFrames, Elapsed, m_BenchmarkFrames/Elapsed);
+	m_pConsole->Print(IConsole::OUTPUT_LEVEL_STANDARD, "benchmark", aBuf);
+	str_format(aBuf, sizeof(aBuf), "render and swap: %.3f ms per frame, %.3f ms at most",
+		m_BenchmarkRenderTime*1000.0/time_freq()/Frames, m_BenchmarkMaxRenderTime*1000.0/time_freq());
+	m_pConsole->Print(IConsole::OUTPUT_LEVEL_STANDARD, "benchmark", aBuf);
+}
+
 void CClient::Run()
 {
 	m_LocalStartTime = time_get();
@@ -2086,6 +2143,14 @@ void CClient::Run()
 						DebugRender();
 					}
 					m_pGraphics->Swap();
+
+					if(g_Config.m_DbgBenchmark && State() == IClient::STATE_DEMOPLAYBACK && !m_DemoPlayer.BaseInfo()->m_Paused)
+					{
+						int64 RenderTime = time_get()-Now;
+						m_BenchmarkFrames++;
+						m_BenchmarkRenderTime += RenderTime;
+						m_BenchmarkMaxRenderTime = max(m_BenchmarkMaxRenderTime, RenderTime);
+					}
 				}
 			}
 		}
@@ -2293,6 +2358,11 @@ const char *CClient::DemoPlayer_Play(const char *pFilename, int StorageType)
 	m_aSnapshots[SNAP_PREV]->m_SnapSize = 0;
 	m_aSnapshots[SNAP_PREV]->m_Tick = -1;
 
+	m_BenchmarkStartTime = time_get();
+	m_BenchmarkRenderTime = 0;
+	m_BenchmarkMaxRenderTime = 0;
+	m_BenchmarkFrames = 0;
+
 	// enter demo playback state
 	SetState(IClient::STATE_DEMOPLAYBACK);
 
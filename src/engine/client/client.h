@@ -94,6 +94,12 @@ class CClient : public IClient, public CDemoPlayer::IListner
 	float m_RenderFrameTimeHigh;
 	int m_RenderFrames;
 
+	// dbg_benchmark, collected while a demo plays
+	int64 m_BenchmarkStartTime;
+	int64 m_BenchmarkRenderTime;
+	int64 m_BenchmarkMaxRenderTime;
+	int m_BenchmarkFrames;
+
 	NETADDR m_ServerAddress;
 	int m_WindowMustRefocus;
 	int m_SnapCrcErrors;
@@ -169,6 +175,7 @@ class CClient : public IClient, public CDemoPlayer::IListner
 	class CSnapshotBuilder m_DemoRecSnapshotBuilder;
 
 	class CSnapshotDelta m_SnapshotDelta;
+	class CSnapshotModel m_SnapshotModel;
 
 	//
 	class CServerInfo m_CurrentServerInfo;
@@ -283,6 +290,7 @@ public:
 	void InitInterfaces();
 
 	bool LimitFps();
+	void BenchmarkReport();
 	void Run();
 
 	void ConnectOnStart(const char *pAddress);
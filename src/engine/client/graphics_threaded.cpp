@@ -97,11 +97,48 @@ void CGraphics_Threaded::FlushVertices()
 
 void CGraphics_Threaded::AddVertices(int Count)
 {
+	if(m_RecordQuadBuffer)
+	{
+		RecordVertices(Count);
+		return;
+	}
+
 	m_NumVertices += Count;
 	if((m_NumVertices + Count) >= MAX_VERTICES)
 		FlushVertices();
 }
 
+void CGraphics_Threaded::RecordVertices(int Count)
+{
+	int NumQuads = Count/4;
+	if(m_NumRecordedQuads+NumQuads > m_RecordedQuadCapacity)
+	{
+		int NewCapacity = max(m_RecordedQuadCapacity*2, m_NumRecordedQuads+NumQuads);
+		CCommandBuffer::SBufferVertex *pNewVertices = (CCommandBuffer::SBufferVertex *)mem_alloc(NewCapacity*4*sizeof(CCommandBuffer::SBufferVertex), 1);
+		unsigned char *pNewIndices = (unsigned char *)mem_alloc(NewCapacity, 1);
+		if(m_pRecordedVertices)
+		{
+			mem_copy(pNewVertices, m_pRecordedVertices, m_NumRecordedQuads*4*sizeof(CCommandBuffer::SBufferVertex));
+			mem_copy(pNewIndices, m_pRecordedTextureArrayIndices, m_NumRecordedQuads);
+			mem_free(m_pRecordedVertices);
+			mem_free(m_pRecordedTextureArrayIndices);
+		}
+		m_pRecordedVertices = pNewVertices;
+		m_pRecordedTextureArrayIndices = pNewIndices;
+		m_RecordedQuadCapacity = NewCapacity;
+	}
+
+	CCommandBuffer::SBufferVertex *pVertices = &m_pRecordedVertices[m_NumRecordedQuads*4];
+	for(int i = 0; i < NumQuads*4; i++)
+	{
+		pVertices[i].m_Pos = m_aVertices[i].m_Pos;
+		pVertices[i].m_Tex = m_aVertices[i].m_Tex;
+	}
+	for(int i = 0; i < NumQuads; i++)
+		m_pRecordedTextureArrayIndices[m_NumRecordedQuads+i] = max(m_TextureArrayIndex, 0);
+	m_NumRecordedQuads += NumQuads;
+}
+
 void CGraphics_Threaded::Rotate4(const CCommandBuffer::SPoint &rCenter, CCommandBuffer::SVertex *pPoints)
 {
 	float c = cosf(m_Rotation);
@@ -149,6 +186,13 @@ CGraphics_Threaded::CGraphics_Threaded()
 
 	m_TextureMemoryUsage = 0;
 
+	m_FirstFreeQuadBuffer = -1;
+	m_RecordQuadBuffer = false;
+	m_pRecordedVertices = 0;
+	m_pRecordedTextureArrayIndices = 0;
+	m_NumRecordedQuads = 0;
+	m_RecordedQuadCapacity = 0;
+
 	m_RenderEnable = true;
 	m_DoScreenshot = false;
 }
@@ -409,8 +453,6 @@ int CGraphics_Threaded::LoadPNG(CImageInfo *pImg, const char *pFilename, int Sto
 	png_t Png; // ignore_convention
 
 	// open file for reading
-	png_init(0,0); // ignore_convention
-
 	IOHANDLE File = m_pStorage->OpenFile(pFilename, IOFLAG_READ, StorageType, aCompleteFilename, sizeof(aCompleteFilename));
 	if(File)
 		io_close(File);
@@ -737,6 +779,127 @@ void CGraphics_Threaded::QuadsText(float x, float y, float Size, const char *pTe
 	}
 }
 
+void CGraphics_Threaded::QuadBufferBegin()
+{
+	QuadsBegin();
+	m_RecordQuadBuffer = true;
+	m_NumRecordedQuads = 0;
+}
+
+IGraphics::CQuadBufferHandle CGraphics_Threaded::QuadBufferEnd()
+{
+	dbg_assert(m_Drawing == DRAWING_QUADS && m_RecordQuadBuffer, "called Graphics()->QuadBufferEnd without begin");
+	m_Drawing = 0;
+	m_RecordQuadBuffer = false;
+
+	int Slot = m_FirstFreeQuadBuffer;
+	if(m_NumRecordedQuads == 0 || Slot == -1)
+	{
+		if(Slot == -1)
+			dbg_msg("graphics", "out of quad buffers");
+		return CQuadBufferHandle();
+	}
+	m_FirstFreeQuadBuffer = m_aQuadBufferIndices[Slot];
+	m_aQuadBufferIndices[Slot] = -1;
+
+	// the backend takes the vertices
+	CCommandBuffer::SCommand_QuadBuffer_Create Cmd;
+	Cmd.m_Slot = Slot;
+	Cmd.m_NumVertices = m_NumRecordedQuads*4;
+	Cmd.m_pVertices = m_pRecordedVertices;
+	m_pCommandBuffer->AddCommand(Cmd);
+
+	CQuadBuffer *pBuffer = &m_aQuadBuffers[Slot];
+	pBuffer->m_NumQuads = m_NumRecordedQuads;
+	pBuffer->m_Dimension = m_State.m_Dimension;
+	if(m_pBackend->GetTextureArraySize() > 1)
+		pBuffer->m_pTextureArrayIndices = m_pRecordedTextureArrayIndices;
+	else
+	{
+		pBuffer->m_pTextureArrayIndices = 0;
+		mem_free(m_pRecordedTextureArrayIndices);
+	}
+
+	m_pRecordedVertices = 0;
+	m_pRecordedTextureArrayIndices = 0;
+	m_NumRecordedQuads = 0;
+	m_RecordedQuadCapacity = 0;
+	return CreateQuadBufferHandle(Slot);
+}
+
+void CGraphics_Threaded::QuadBufferDestroy(CQuadBufferHandle *pHandle)
+{
+	if(!pHandle->IsValid())
+		return;
+
+	CCommandBuffer::SCommand_QuadBuffer_Destroy Cmd;
+	Cmd.m_Slot = pHandle->Id();
+	m_pCommandBuffer->AddCommand(Cmd);
+
+	CQuadBuffer *pBuffer = &m_aQuadBuffers[pHandle->Id()];
+	if(pBuffer->m_pTextureArrayIndices)
+		mem_free(pBuffer->m_pTextureArrayIndices);
+	mem_zero(pBuffer, sizeof(*pBuffer));
+
+	m_aQuadBufferIndices[pHandle->Id()] = m_FirstFreeQuadBuffer;
+	m_FirstFreeQuadBuffer = pHandle->Id();
+
+	pHandle->Invalidate();
+}
+
+void CGraphics_Threaded::AddQuadBufferRender(const CCommandBuffer::SCommand_QuadBuffer_Render &Cmd)
+{
+	if(!m_pCommandBuffer->AddCommand(Cmd))
+	{
+		// kick command buffer and try again
+		KickCommandBuffer();
+		if(!m_pCommandBuffer->AddCommand(Cmd))
+			dbg_msg("graphics", "failed to allocate memory for quad buffer command");
+	}
+}
+
+void CGraphics_Threaded::QuadBufferRender(CQuadBufferHandle Handle, int Offset, int Num, float r, float g, float b, float a)
+{
+	dbg_assert(m_Drawing == 0, "called Graphics()->QuadBufferRender within begin");
+	if(!Handle.IsValid() || Num <= 0)
+		return;
+
+	const CQuadBuffer *pBuffer = &m_aQuadBuffers[Handle.Id()];
+	dbg_assert(Offset >= 0 && Offset+Num <= pBuffer->m_NumQuads, "quad buffer range out of bounds");
+
+	CCommandBuffer::SCommand_QuadBuffer_Render Cmd;
+	Cmd.m_State = m_State;
+	Cmd.m_State.m_Dimension = pBuffer->m_Dimension;
+	Cmd.m_State.m_TextureArrayIndex = 0;
+	Cmd.m_Slot = Handle.Id();
+	Cmd.m_Color.r = r;
+	Cmd.m_Color.g = g;
+	Cmd.m_Color.b = b;
+	Cmd.m_Color.a = a;
+
+	if(!pBuffer->m_pTextureArrayIndices)
+	{
+		Cmd.m_Offset = Offset;
+		Cmd.m_NumQuads = Num;
+		AddQuadBufferRender(Cmd);
+		return;
+	}
+
+	// tileset fallback system, one command for every run of quads from the same texture
+	int End = Offset+Num;
+	while(Offset < End)
+	{
+		int RunEnd = Offset+1;
+		while(RunEnd < End && pBuffer->m_pTextureArrayIndices[RunEnd] == pBuffer->m_pTextureArrayIndices[Offset])
+			RunEnd++;
+		Cmd.m_State.m_TextureArrayIndex = pBuffer->m_pTextureArrayIndices[Offset];
+		Cmd.m_Offset = Offset;
+		Cmd.m_NumQuads = RunEnd-Offset;
+		AddQuadBufferRender(Cmd);
+		Offset = RunEnd;
+	}
+}
+
 int CGraphics_Threaded::IssueInit()
 {
 	int Flags = 0;
@@ -793,6 +956,9 @@ int CGraphics_Threaded::Init()
 	m_pStorage = Kernel()->RequestInterface<IStorage>();
 	m_pConsole = Kernel()->RequestInterface<IConsole>();
 
+	// once here as LoadPNG may run on several threads at once
+	png_init(0,0); // ignore_convention
+
 	// Set all z to -5.0f
 	for(int i = 0; i < MAX_VERTICES; i++)
 		m_aVertices[i].m_Pos.z = -5.0f;
@@ -803,7 +969,14 @@ int CGraphics_Threaded::Init()
 		m_aTextureIndices[i] = i+1;
 	m_aTextureIndices[MAX_TEXTURES-1] = -1;
 
-	m_pBackend = CreateGraphicsBackend();
+	// init quad buffers
+	m_FirstFreeQuadBuffer = 0;
+	for(int i = 0; i < CCommandBuffer::MAX_QUADBUFFERS-1; i++)
+		m_aQuadBufferIndices[i] = i+1;
+	m_aQuadBufferIndices[CCommandBuffer::MAX_QUADBUFFERS-1] = -1;
+	mem_zero(m_aQuadBuffers, sizeof(m_aQuadBuffers));
+
+	m_pBackend = g_Config.m_GfxNull ? CreateNullGraphicsBackend() : CreateGraphicsBackend();
 	if(InitWindow() != 0)
 		return -1;
 
@@ -51,6 +51,7 @@ public:
 	enum
 	{
 		MAX_TEXTURES=1024*4,
+		MAX_QUADBUFFERS=1024*4,
 	};
 
 	enum
@@ -78,6 +79,11 @@ public:
 		CMD_CLEAR,
 		CMD_RENDER,
 
+		// quad buffer commands
+		CMD_QUADBUFFER_CREATE,
+		CMD_QUADBUFFER_DESTROY,
+		CMD_QUADBUFFER_RENDER,
+
 		// swap
 		CMD_SWAP,
 
@@ -129,6 +135,13 @@ public:
 		SColor m_Color;
 	};
 
+	// quad buffers are drawn in one color
+	struct SBufferVertex
+	{
+		SPoint m_Pos;
+		STexCoord m_Tex;
+	};
+
 	struct SCommand
 	{
 	public:
@@ -183,6 +196,33 @@ public:
 		SVertex *m_pVertices; // you should use the command buffer data to allocate vertices for this command
 	};
 
+	struct SCommand_QuadBuffer_Create : public SCommand
+	{
+		SCommand_QuadBuffer_Create() : SCommand(CMD_QUADBUFFER_CREATE) {}
+
+		int m_Slot;
+		int m_NumVertices;
+		SBufferVertex *m_pVertices; // will be freed by the command processor when the buffer is destroyed
+	};
+
+	struct SCommand_QuadBuffer_Destroy : public SCommand
+	{
+		SCommand_QuadBuffer_Destroy() : SCommand(CMD_QUADBUFFER_DESTROY) {}
+
+		int m_Slot;
+	};
+
+	struct SCommand_QuadBuffer_Render : public SCommand
+	{
+		SCommand_QuadBuffer_Render() : SCommand(CMD_QUADBUFFER_RENDER) {}
+
+		SState m_State;
+		int m_Slot;
+		int m_Offset; // in quads
+		int m_NumQuads;
+		SColor m_Color;
+	};
+
 	struct SCommand_Screenshot : public SCommand
 	{
 		SCommand_Screenshot() : SCommand(CMD_SCREENSHOT) {}
@@ -382,8 +422,27 @@ class CGraphics_Threaded : public IEngineGraphics
 	int m_FirstFreeTexture;
 	int m_TextureMemoryUsage;
 
+	struct CQuadBuffer
+	{
+		int m_NumQuads;
+		int m_Dimension;
+		unsigned char *m_pTextureArrayIndices; // per quad, only needed for the tileset fallback system
+	};
+	CQuadBuffer m_aQuadBuffers[CCommandBuffer::MAX_QUADBUFFERS];
+	int m_aQuadBufferIndices[CCommandBuffer::MAX_QUADBUFFERS];
+	int m_FirstFreeQuadBuffer;
+
+	// the quad buffer that is being recorded
+	bool m_RecordQuadBuffer;
+	CCommandBuffer::SBufferVertex *m_pRecordedVertices;
+	unsigned char *m_pRecordedTextureArrayIndices;
+	int m_NumRecordedQuads;
+	int m_RecordedQuadCapacity;
+
 	void FlushVertices();
 	void AddVertices(int Count);
+	void RecordVertices(int Count);
+	void AddQuadBufferRender(const CCommandBuffer::SCommand_QuadBuffer_Render &Cmd);
 	void Rotate4(const CCommandBuffer::SPoint &rCenter, CCommandBuffer::SVertex *pPoints);
 
 	void KickCommandBuffer();
@@ -446,6 +505,11 @@ public:
 	virtual void QuadsDrawFreeform(const CFreeformItem *pArray, int Num);
 	virtual void QuadsText(float x, float y, float Size, const char *pText);
 
+	virtual void QuadBufferBegin();
+	virtual CQuadBufferHandle QuadBufferEnd();
+	virtual void QuadBufferDestroy(CQuadBufferHandle *pHandle);
+	virtual void QuadBufferRender(CQuadBufferHandle Handle, int Offset, int Num, float r, float g, float b, float a);
+
 	virtual int GetNumScreens() const;
 	virtual void Minimize();
 	virtual void Maximize();
@@ -474,3 +538,4 @@ public:
 };
 
 extern IGraphicsBackend *CreateGraphicsBackend();
+extern IGraphicsBackend *CreateNullGraphicsBackend();
@@ -0,0 +1,321 @@
+/* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
+/* If you are missing that file, acquire a complete release at teeworlds.com.                */
+#include <base/math.h>
+#include <base/system.h>
+#include <base/tl/threading.h>
+
+#include <engine/sound.h>
+
+#include "mixer.h"
+
+#include <math.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+	#define MIXER_SSE2 1
+	#include <emmintrin.h>
+
+// adds four stereo frames times the gains to the mix buffer, the products are built from their
+// low and high halves so they come out exactly like the scalar ones
+static inline void MixBlock(int *pOut, __m128i In, __m128i Gain)
+{
+	__m128i Lo = _mm_mullo_epi16(In, Gain);
+	__m128i Hi = _mm_mulhi_epi16(In, Gain);
+	__m128i *pDst = (__m128i *)pOut;
+	_mm_storeu_si128(pDst, _mm_add_epi32(_mm_loadu_si128(pDst), _mm_unpacklo_epi16(Lo, Hi)));
+	_mm_storeu_si128(pDst+1, _mm_add_epi32(_mm_loadu_si128(pDst+1), _mm_unpackhi_epi16(Lo, Hi)));
+}
+#endif
+
+static void MixFrames(int *pOut, const short *pIn, int Channels, int Lvol, int Rvol, unsigned Frames)
+{
+	unsigned i = 0;
+#if defined(MIXER_SSE2)
+	if(Lvol >= 0 && Lvol <= 0x7fff && Rvol >= 0 && Rvol <= 0x7fff)
+	{
+		const __m128i Gain = _mm_set_epi16(Rvol, Lvol, Rvol, Lvol, Rvol, Lvol, Rvol, Lvol);
+		if(Channels == 2)
+		{
+			for(; i+4 <= Frames; i += 4)
+				MixBlock(&pOut[i*2], _mm_loadu_si128((const __m128i *)&pIn[i*2]), Gain);
+		}
+		else
+		{
+			for(; i+4 <= Frames; i += 4)
+			{
+				__m128i In = _mm_loadl_epi64((const __m128i *)&pIn[i]);
+				MixBlock(&pOut[i*2], _mm_unpacklo_epi16(In, In), Gain);
+			}
+		}
+	}
+#endif
+
+	// mono sounds play the same data on both sides
+	const short *pInL = &pIn[i*Channels];
+	const short *pInR = Channels == 1 ? pInL : pInL+1;
+	for(; i < Frames; i++)
+	{
+		pOut[i*2] += (*pInL)*Lvol;
+		pOut[i*2+1] += (*pInR)*Rvol;
+		pInL += Channels;
+		pInR += Channels;
+	}
+}
+
+// TODO: there should be a faster way todo this
+static short Int2Short(int i)
+{
+	if(i > 0x7fff)
+		return 0x7fff;
+	else if(i < -0x7fff)
+		return -0x7fff;
+	return i;
+}
+
+CMixer::CMixer()
+{
+	mem_zero(m_apPlaying, sizeof(m_apPlaying));
+	mem_zero(m_aStarted, sizeof(m_aStarted));
+	m_NextVoice = 0;
+
+	m_CommandWrite = 0;
+	m_CommandRead = 0;
+	for(int i = 0; i < NUM_VOICES; i++)
+	{
+		m_aFinished[i] = 0;
+		m_aStopRequested[i] = 0;
+	}
+	for(int i = 0; i < NUM_CHANNELS; i++)
+		m_aChannelVolumes[i] = 255;
+	m_CenterX = 0;
+	m_CenterY = 0;
+	m_MaxDistance = 1500.0f;
+	m_Volume = 100;
+
+	mem_zero(m_aVoices, sizeof(m_aVoices));
+	mem_zero(m_aPlayed, sizeof(m_aPlayed));
+	m_pMixBuffer = 0;
+	m_MaxFrames = 0;
+}
+
+CMixer::~CMixer()
+{
+	if(m_pMixBuffer)
+		mem_free(m_pMixBuffer);
+}
+
+void CMixer::Init(unsigned MaxFrames)
+{
+	if(m_pMixBuffer)
+		mem_free(m_pMixBuffer);
+	m_MaxFrames = MaxFrames;
+	m_pMixBuffer = (int *)mem_alloc(m_MaxFrames*2*sizeof(int), 1);
+}
+
+bool CMixer::Push(const CCommand *pCommand)
+{
+	unsigned Write = m_CommandWrite;
+	if(Write-m_CommandRead >= MAX_COMMANDS)
+		return false;
+
+	// the command has to be complete before the mixing thread can see it
+	m_aCommands[Write%MAX_COMMANDS] = *pCommand;
+	sync_barrier();
+	m_CommandWrite = Write+1;
+	return true;
+}
+
+int CMixer::Play(CSample *pSample, int Channel, int Flags, int x, int y)
+{
+	// search for voice
+	int VoiceID = -1;
+	for(int i = 0; i < NUM_VOICES; i++)
+	{
+		int id = (m_NextVoice + i) % NUM_VOICES;
+		if(m_aStarted[id] == m_aFinished[id])
+		{
+			VoiceID = id;
+			break;
+		}
+	}
+
+	CCommand Command = {VoiceID, pSample, Channel, Flags, x, y};
+	if(VoiceID == -1 || !Push(&Command))
+		return -1;
+
+	m_NextVoice = VoiceID+1;
+	m_aStarted[VoiceID]++;
+	m_apPlaying[VoiceID] = pSample;
+	return VoiceID;
+}
+
+void CMixer::Stop(const CSample *pSample)
+{
+	for(int i = 0; i < NUM_VOICES; i++)
+	{
+		if(m_apPlaying[i] != pSample || m_aStarted[i] == m_aFinished[i])
+			continue;
+
+		// also covers a play that is still in the queue
+		m_aStopRequested[i] = m_aStarted[i];
+		m_apPlaying[i] = 0;
+	}
+}
+
+void CMixer::StopAll()
+{
+	for(int i = 0; i < NUM_VOICES; i++)
+		m_aStopRequested[i] = m_aStarted[i];
+	mem_zero(m_apPlaying, sizeof(m_apPlaying));
+}
+
+bool CMixer::IsPlaying(const CSample *pSample) const
+{
+	for(int i = 0; i < NUM_VOICES; i++)
+	{
+		if(m_apPlaying[i] == pSample && m_aStarted[i] != m_aFinished[i])
+			return true;
+	}
+	return false;
+}
+
+void CMixer::FinishVoice(int Voice, bool Stopped)
+{
+	CVoice *v = &m_aVoices[Voice];
+	if(Stopped)
+	{
+		if(v->m_Flags&ISound::FLAG_LOOP)
+			v->m_pSample->m_PausedAt = v->m_Tick;
+		else
+			v->m_pSample->m_PausedAt = 0;
+	}
+	v->m_pSample = 0;
+
+	// hand the voice back to the game thread
+	sync_barrier();
+	m_aFinished[Voice]++;
+}
+
+void CMixer::ProcessCommands()
+{
+	// stops do not need room in the queue, so they also work when it is full
+	for(int i = 0; i < NUM_VOICES; i++)
+	{
+		if(m_aVoices[i].m_pSample && StopRequested(i))
+			FinishVoice(i, true);
+	}
+
+	unsigned Write = m_CommandWrite;
+	sync_barrier();
+
+	for(unsigned Read = m_CommandRead; Read != Write; Read++)
+	{
+		const CCommand *pCommand = &m_aCommands[Read%MAX_COMMANDS];
+		CVoice *v = &m_aVoices[pCommand->m_Voice];
+		v->m_pSample = pCommand->m_pSample;
+		v->m_Channel = pCommand->m_Channel;
+		if(pCommand->m_Flags&ISound::FLAG_LOOP)
+			v->m_Tick = pCommand->m_pSample->m_PausedAt;
+		else
+			v->m_Tick = 0;
+		v->m_Flags = pCommand->m_Flags;
+		v->m_X = pCommand->m_X;
+		v->m_Y = pCommand->m_Y;
+
+		// stopped before it was picked up
+		m_aPlayed[pCommand->m_Voice]++;
+		if(StopRequested(pCommand->m_Voice))
+			FinishVoice(pCommand->m_Voice, true);
+	}
+
+	// the slots may be reused only after they were read
+	sync_barrier();
+	m_CommandRead = Write;
+}
+
+void CMixer::Mix(short *pFinalOut, unsigned Frames)
+{
+	Frames = min(Frames, m_MaxFrames);
+	mem_zero(m_pMixBuffer, Frames*2*sizeof(int));
+
+	ProcessCommands();
+
+	const int MasterVol = m_Volume;
+	const int CenterX = m_CenterX;
+	const int CenterY = m_CenterY;
+	const float MaxDistance = m_MaxDistance;
+
+	for(int i = 0; i < NUM_VOICES; i++)
+	{
+		CVoice *v = &m_aVoices[i];
+		if(!v->m_pSample)
+			continue;
+
+		int Rvol = m_aChannelVolumes[v->m_Channel];
+		int Lvol = Rvol;
+
+		// volume calculation
+		if(v->m_Flags&ISound::FLAG_POS)
+		{
+			int dx = v->m_X - CenterX;
+			int dy = v->m_Y - CenterY;
+			float Dist = sqrtf((float)dx*dx+dy*dy);
+			if(Dist >= 0.0f && Dist < MaxDistance)
+			{
+				// linear falloff
+				float Falloff = 1.0f - Dist/MaxDistance;
+
+				// amplitude after falloff
+				float FalloffAmp = Rvol * Falloff;
+
+				// distribute volume to the channels depending on x difference
+				float Lpan = 0.5f - dx/MaxDistance/2.0f;
+				float Rpan = 1.0f - Lpan;
+
+				// apply square root to preserve sound power after panning
+				float LampFactor = sqrt(Lpan);
+				float RampFactor = sqrt(Rpan);
+
+				// volume of the channels
+				Lvol = FalloffAmp*LampFactor;
+				Rvol = FalloffAmp*RampFactor;
+			}
+			else
+			{
+				Lvol = 0;
+				Rvol = 0;
+			}
+		}
+
+		// make sure that we don't go outside the sound data, silent voices only move on
+		CSample *pSample = v->m_pSample;
+		unsigned End = min(Frames, (unsigned)(pSample->m_NumFrames-v->m_Tick));
+		if(Lvol || Rvol)
+			MixFrames(m_pMixBuffer, &pSample->m_pData[v->m_Tick*pSample->m_Channels], pSample->m_Channels, Lvol, Rvol, End);
+		v->m_Tick += End;
+
+		// free voice if not used any more
+		if(v->m_Tick == pSample->m_NumFrames)
+		{
+			if(v->m_Flags&ISound::FLAG_LOOP)
+				v->m_Tick = 0;
+			else
+				FinishVoice(i, false);
+		}
+	}
+
+	// clamp accumulated values
+	// TODO: this seams slow
+	for(unsigned i = 0; i < Frames; i++)
+	{
+		int j = i<<1;
+		int vl = ((m_pMixBuffer[j]*MasterVol)/101)>>8;
+		int vr = ((m_pMixBuffer[j+1]*MasterVol)/101)>>8;
+
+		pFinalOut[j] = Int2Short(vl);
+		pFinalOut[j+1] = Int2Short(vr);
+	}
+
+#if defined(CONF_ARCH_ENDIAN_BIG)
+	swap_endian(pFinalOut, sizeof(short), Frames * 2);
+#endif
+}
@@ -0,0 +1,101 @@
+/* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
+/* If you are missing that file, acquire a complete release at teeworlds.com.                */
+#ifndef ENGINE_CLIENT_MIXER_H
+#define ENGINE_CLIENT_MIXER_H
+
+#include <base/system.h>
+
+struct CSample
+{
+	short *m_pData;
+	int m_NumFrames;
+	int m_Rate;
+	int m_Channels;
+	int m_LoopStart;
+	int m_LoopEnd;
+	int m_PausedAt; // only touched by the mixing thread
+};
+
+// mixes the playing voices into 16 bit stereo. the game thread starts voices through a queue
+// of commands that the mixing thread picks up before every mix, and stops them by marking them,
+// so neither of them ever waits for the other. a voice stays taken until the mixing thread
+// reports it as finished
+class CMixer
+{
+public:
+	enum
+	{
+		NUM_VOICES=64,
+		NUM_CHANNELS=16,
+		MAX_COMMANDS=256,
+	};
+
+private:
+	struct CCommand
+	{
+		int m_Voice;
+		CSample *m_pSample;
+		int m_Channel;
+		int m_Flags;
+		int m_X, m_Y;
+	};
+
+	struct CVoice
+	{
+		CSample *m_pSample;
+		int m_Channel;
+		int m_Tick;
+		int m_Flags;
+		int m_X, m_Y;
+	};
+
+	// game thread
+	CSample *m_apPlaying[NUM_VOICES];
+	unsigned m_aStarted[NUM_VOICES];
+	int m_NextVoice;
+
+	// shared
+	CCommand m_aCommands[MAX_COMMANDS];
+	volatile unsigned m_CommandWrite;
+	volatile unsigned m_CommandRead;
+	volatile unsigned m_aFinished[NUM_VOICES];
+	volatile unsigned m_aStopRequested[NUM_VOICES]; // the plays of a voice up to this one are stopped
+	volatile int m_aChannelVolumes[NUM_CHANNELS]; // 0 - 255
+	volatile int m_CenterX;
+	volatile int m_CenterY;
+	volatile float m_MaxDistance;
+	volatile int m_Volume; // 0 - 100
+
+	// mixing thread
+	CVoice m_aVoices[NUM_VOICES];
+	unsigned m_aPlayed[NUM_VOICES];
+	int *m_pMixBuffer;
+	unsigned m_MaxFrames;
+
+	bool Push(const CCommand *pCommand);
+	bool StopRequested(int Voice) const { return (int)(m_aStopRequested[Voice]-m_aPlayed[Voice]) >= 0; }
+	void ProcessCommands();
+	void FinishVoice(int Voice, bool Pause);
+
+public:
+	CMixer();
+	~CMixer();
+
+	void Init(unsigned MaxFrames);
+
+	// game thread
+	int Play(CSample *pSample, int Channel, int Flags, int x, int y);
+	void Stop(const CSample *pSample);
+	void StopAll();
+	bool IsPlaying(const CSample *pSample) const;
+
+	void SetChannelVolume(int Channel, int Volume) { m_aChannelVolumes[Channel] = Volume; }
+	void SetListenerPos(int x, int y) { m_CenterX = x; m_CenterY = y; }
+	void SetMaxDistance(float Distance) { m_MaxDistance = Distance; }
+	void SetVolume(int Volume) { m_Volume = Volume; }
+
+	// mixing thread
+	void Mix(short *pFinalOut, unsigned Frames);
+};
+
+#endif
@@ -90,6 +90,7 @@ void CServerBrowser::Init(class CNetClient *pNetClient, const char *pNetVersion)
 void CServerBrowser::Set(const NETADDR &Addr, int SetType, int Token, const CServerInfo *pInfo)
 {
 	CServerEntry *pEntry = 0;
+	int Type = IServerBrowser::TYPE_INTERNET;
 	switch(SetType)
 	{
 	case SET_MASTER_ADD:
@@ -120,12 +121,9 @@ void CServerBrowser::Set(const NETADDR &Addr, int SetType, int Token, const CSer
 		break;
 	case SET_TOKEN:
 		{
-			int Type;
-
 			// internet entry
 			if(m_RefreshFlags&IServerBrowser::REFRESHFLAG_INTERNET)
 			{
-				Type = IServerBrowser::TYPE_INTERNET;
 				pEntry = Find(Type, Addr);
 				if(pEntry && (pEntry->m_InfoState != CServerEntry::STATE_PENDING || Token != pEntry->m_CurrentToken))
 					pEntry = 0;
@@ -151,8 +149,9 @@ void CServerBrowser::Set(const NETADDR &Addr, int SetType, int Token, const CSer
 		}
 	}
 
-	if(pEntry)
-		m_ServerBrowserFilter.Sort(m_aServerlist[m_ActServerlistType].m_ppServerlist, m_aServerlist[m_ActServerlistType].m_NumServers, CServerBrowserFilter::RESORT_FLAG_FORCE);
+	// only the changed server needs to be filtered and sorted in
+	if(pEntry && Type == m_ActServerlistType)
+		m_ServerBrowserFilter.Update(m_aServerlist[Type].m_ppServerlist, m_aServerlist[Type].m_NumServers, pEntry->m_Info.m_ServerIndex);
 }
 
 void CServerBrowser::Update(bool ForceResort)
@@ -530,6 +529,7 @@ void CServerBrowser::RequestImpl(const NETADDR &Addr, CServerEntry *pEntry)
 void CServerBrowser::SetInfo(int ServerlistType, CServerEntry *pEntry, const CServerInfo &Info)
 {
 	int Fav = pEntry->m_Info.m_Favorite;
+	int ServerIndex = pEntry->m_Info.m_ServerIndex;
 	pEntry->m_Info = Info;
 	pEntry->m_Info.m_Flags &= FLAG_PASSWORD;
 	if(str_comp(pEntry->m_Info.m_aGameType, "DM") == 0 || str_comp(pEntry->m_Info.m_aGameType, "TDM") == 0 || str_comp(pEntry->m_Info.m_aGameType, "CTF") == 0 ||
@@ -545,6 +545,7 @@ void CServerBrowser::SetInfo(int ServerlistType, CServerEntry *pEntry, const CSe
 		str_comp(pEntry->m_Info.m_aMap, "lms1") == 0)
 		pEntry->m_Info.m_Flags |= FLAG_PUREMAP;
 	pEntry->m_Info.m_Favorite = Fav;
+	pEntry->m_Info.m_ServerIndex = ServerIndex;
 	pEntry->m_Info.m_NetAddr = pEntry->m_Addr;
 
 	m_aServerlist[ServerlistType].m_NumPlayers += pEntry->m_Info.m_NumPlayers;
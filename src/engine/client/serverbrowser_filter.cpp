@@ -15,14 +15,28 @@
 
 class SortWrap
 {
-	typedef bool (CServerBrowserFilter::CServerFilter::*SortFunc)(int, int) const;
-	SortFunc m_pfnSort;
-	CServerBrowserFilter::CServerFilter *m_pThis;
+	const CServerBrowserFilter::CServerFilter *m_pThis;
 public:
-	SortWrap(CServerBrowserFilter::CServerFilter *t, SortFunc f) : m_pfnSort(f), m_pThis(t) {}
-	bool operator()(int a, int b) { return (g_Config.m_BrSortOrder ? (m_pThis->*m_pfnSort)(b, a) : (m_pThis->*m_pfnSort)(a, b)); }
+	SortWrap(const CServerBrowserFilter::CServerFilter *t) : m_pThis(t) {}
+	bool operator()(int a, int b) { return m_pThis->Compare(a, b) < 0; }
 };
 
+// the first characters of a string like str_comp_nocase orders them
+static int64 StringSortKey(const char *pStr)
+{
+	int64 Key = 0;
+	for(int i = 0; i < 7; i++)
+	{
+		unsigned char c = *pStr;
+		if(c >= 'A' && c <= 'Z')
+			c += 'a'-'A';
+		Key = (Key<<8)|c;
+		if(c)
+			pStr++;
+	}
+	return Key;
+}
+
 //	CServerFilter
 CServerBrowserFilter::CServerFilter::CServerFilter()
 {
@@ -41,12 +55,16 @@ CServerBrowserFilter::CServerFilter::CServerFilter()
 	m_SortedServersCapacity = 0;
 
 	m_pSortedServerlist = 0;
+	m_pSortKeys = 0;
+	m_NumSortKeys = 0;
 }
 
 CServerBrowserFilter::CServerFilter::~CServerFilter()
 {
 	if(m_pSortedServerlist)
 		mem_free(m_pSortedServerlist);
+	if(m_pSortKeys)
+		mem_free(m_pSortKeys);
 }
 
 CServerBrowserFilter::CServerFilter& CServerBrowserFilter::CServerFilter::operator=(const CServerBrowserFilter::CServerFilter& Other)
@@ -70,149 +88,189 @@ CServerBrowserFilter::CServerFilter& CServerBrowserFilter::CServerFilter::operat
 		m_NumSortedPlayers = Other.m_NumSortedPlayers;
 		m_NumSortedServers = Other.m_NumSortedServers;
 		m_SortedServersCapacity = Other.m_SortedServersCapacity;
+		m_NumSortKeys = Other.m_NumSortKeys;
 
-		m_pSortedServerlist = (int *)mem_alloc(m_SortedServersCapacity * sizeof(int), 1);
-		for(int i = 0; i < m_SortedServersCapacity; ++i)
-			m_pSortedServerlist[i] = Other.m_pSortedServerlist[i];
+		if(m_pSortedServerlist)
+			mem_free(m_pSortedServerlist);
+		if(m_pSortKeys)
+			mem_free(m_pSortKeys);
+		m_pSortedServerlist = 0;
+		m_pSortKeys = 0;
+		if(m_SortedServersCapacity)
+		{
+			m_pSortedServerlist = (int *)mem_alloc(m_SortedServersCapacity * sizeof(int), 1);
+			mem_copy(m_pSortedServerlist, Other.m_pSortedServerlist, m_SortedServersCapacity * sizeof(int));
+			m_pSortKeys = (CSortKey *)mem_alloc(m_SortedServersCapacity * sizeof(CSortKey), 1);
+			mem_copy(m_pSortKeys, Other.m_pSortKeys, m_SortedServersCapacity * sizeof(CSortKey));
+		}
 	}
 	return *this;
 }
 
-void CServerBrowserFilter::CServerFilter::Filter()
+void CServerBrowserFilter::CServerFilter::Reserve(int NumServers)
 {
-	int NumServers = m_pServerBrowserFilter->m_NumServers;
-	m_NumSortedServers = 0;
-	m_NumSortedPlayers = 0;
+	if(m_SortedServersCapacity >= NumServers)
+		return;
 
-	// allocate the sorted list
-	if(m_SortedServersCapacity < NumServers)
+	// keep what is there, the list grows one server at a time while the infos come in
+	int Capacity = max(1000, NumServers+NumServers/2);
+	int *pSortedServerlist = (int *)mem_alloc(Capacity*sizeof(int), 1);
+	CSortKey *pSortKeys = (CSortKey *)mem_alloc(Capacity*sizeof(CSortKey), 1);
+	if(m_pSortedServerlist)
 	{
-		if(m_pSortedServerlist)
-			mem_free(m_pSortedServerlist);
-		m_SortedServersCapacity = max(1000, NumServers+NumServers/2);
-		m_pSortedServerlist = (int *)mem_alloc(m_SortedServersCapacity*sizeof(int), 1);
+		mem_copy(pSortedServerlist, m_pSortedServerlist, m_NumSortedServers*sizeof(int));
+		mem_copy(pSortKeys, m_pSortKeys, m_NumSortKeys*sizeof(CSortKey));
+		mem_free(m_pSortedServerlist);
+		mem_free(m_pSortKeys);
 	}
+	m_pSortedServerlist = pSortedServerlist;
+	m_pSortKeys = pSortKeys;
+	m_SortedServersCapacity = Capacity;
+}
 
-	// filter the servers
-	for(int i = 0; i < NumServers; i++)
+bool CServerBrowserFilter::CServerFilter::FilterEntry(int Index, int *pNumClients)
+{
+	CServerEntry *pEntry = m_pServerBrowserFilter->m_ppServerlist[Index];
+	CServerInfo *pInfo = &pEntry->m_Info;
+	int Filtered = 0;
+
+	int RelevantClientCount = (m_FilterInfo.m_SortHash&IServerBrowser::FILTER_SPECTATORS) ? pInfo->m_NumPlayers : pInfo->m_NumClients;
+	if(m_FilterInfo.m_SortHash&IServerBrowser::FILTER_BOTS)
 	{
-		int Filtered = 0;
+		RelevantClientCount -= pInfo->m_NumBotPlayers;
+		if(!(m_FilterInfo.m_SortHash&IServerBrowser::FILTER_SPECTATORS))
+			RelevantClientCount -= pInfo->m_NumBotSpectators;
+	}
 
-		int RelevantClientCount = (m_FilterInfo.m_SortHash&IServerBrowser::FILTER_SPECTATORS) ? m_pServerBrowserFilter->m_ppServerlist[i]->m_Info.m_NumPlayers : m_pServerBrowserFilter->m_ppServerlist[i]->m_Info.m_NumClients;
-		if(m_FilterInfo.m_SortHash&IServerBrowser::FILTER_BOTS)
+	if(m_FilterInfo.m_SortHash&IServerBrowser::FILTER_EMPTY && RelevantClientCount == 0)
+		Filtered = 1;
+	else if(m_FilterInfo.m_SortHash&IServerBrowser::FILTER_FULL && ((m_FilterInfo.m_SortHash&IServerBrowser::FILTER_SPECTATORS && pInfo->m_NumPlayers == pInfo->m_MaxPlayers) ||
+			pInfo->m_NumClients == pInfo->m_MaxClients))
+		Filtered = 1;
+	else if(m_FilterInfo.m_SortHash&IServerBrowser::FILTER_PW && pInfo->m_Flags&IServerBrowser::FLAG_PASSWORD)
+		Filtered = 1;
+	else if(m_FilterInfo.m_SortHash&IServerBrowser::FILTER_FAVORITE && !pInfo->m_Favorite)
+		Filtered = 1;
+	else if(m_FilterInfo.m_SortHash&IServerBrowser::FILTER_PURE && !(pInfo->m_Flags&IServerBrowser::FLAG_PURE))
+		Filtered = 1;
+	else if(m_FilterInfo.m_SortHash&IServerBrowser::FILTER_PURE_MAP &&  !(pInfo->m_Flags&IServerBrowser::FLAG_PUREMAP))
+		Filtered = 1;
+	else if(m_FilterInfo.m_Ping < pInfo->m_Latency)
+		Filtered = 1;
+	else if(m_FilterInfo.m_SortHash&IServerBrowser::FILTER_COMPAT_VERSION && str_comp_num(pInfo->m_aVersion, m_pServerBrowserFilter->m_aNetVersion, 3) != 0)
+		Filtered = 1;
+	else if(m_FilterInfo.m_aAddress[0] && !str_find_nocase(pInfo->m_aAddress, m_FilterInfo.m_aAddress))
+		Filtered = 1;
+	else if(m_FilterInfo.m_ServerLevel & (1 << pInfo->m_ServerLevel))
+		Filtered = 1;
+	else
+	{
+		if(m_FilterInfo.m_aGametype[0][0])
 		{
-			RelevantClientCount -= m_pServerBrowserFilter->m_ppServerlist[i]->m_Info.m_NumBotPlayers;
-			if(!(m_FilterInfo.m_SortHash&IServerBrowser::FILTER_SPECTATORS))
-				RelevantClientCount -= m_pServerBrowserFilter->m_ppServerlist[i]->m_Info.m_NumBotSpectators;
-		}
-
-		if(m_FilterInfo.m_SortHash&IServerBrowser::FILTER_EMPTY && RelevantClientCount == 0)
-			Filtered = 1;
-		else if(m_FilterInfo.m_SortHash&IServerBrowser::FILTER_FULL && ((m_FilterInfo.m_SortHash&IServerBrowser::FILTER_SPECTATORS && m_pServerBrowserFilter->m_ppServerlist[i]->m_Info.m_NumPlayers == m_pServerBrowserFilter->m_ppServerlist[i]->m_Info.m_MaxPlayers) ||
-				m_pServerBrowserFilter->m_ppServerlist[i]->m_Info.m_NumClients == m_pServerBrowserFilter->m_ppServerlist[i]->m_Info.m_MaxClients))
-			Filtered = 1;
-		else if(m_FilterInfo.m_SortHash&IServerBrowser::FILTER_PW && m_pServerBrowserFilter->m_ppServerlist[i]->m_Info.m_Flags&IServerBrowser::FLAG_PASSWORD)
-			Filtered = 1;
-		else if(m_FilterInfo.m_SortHash&IServerBrowser::FILTER_FAVORITE && !m_pServerBrowserFilter->m_ppServerlist[i]->m_Info.m_Favorite)
-			Filtered = 1;
-		else if(m_FilterInfo.m_SortHash&IServerBrowser::FILTER_PURE && !(m_pServerBrowserFilter->m_ppServerlist[i]->m_Info.m_Flags&IServerBrowser::FLAG_PURE))
-			Filtered = 1;
-		else if(m_FilterInfo.m_SortHash&IServerBrowser::FILTER_PURE_MAP &&  !(m_pServerBrowserFilter->m_ppServerlist[i]->m_Info.m_Flags&IServerBrowser::FLAG_PUREMAP))
-			Filtered = 1;
-		else if(m_FilterInfo.m_Ping < m_pServerBrowserFilter->m_ppServerlist[i]->m_Info.m_Latency)
-			Filtered = 1;
-		else if(m_FilterInfo.m_SortHash&IServerBrowser::FILTER_COMPAT_VERSION && str_comp_num(m_pServerBrowserFilter->m_ppServerlist[i]->m_Info.m_aVersion, m_pServerBrowserFilter->m_aNetVersion, 3) != 0)
 			Filtered = 1;
-		else if(m_FilterInfo.m_aAddress[0] && !str_find_nocase(m_pServerBrowserFilter->m_ppServerlist[i]->m_Info.m_aAddress, m_FilterInfo.m_aAddress))
-			Filtered = 1;
-		else if(m_FilterInfo.m_ServerLevel & (1 << m_pServerBrowserFilter->m_ppServerlist[i]->m_Info.m_ServerLevel))
-			Filtered = 1;
-		else
-		{
-			if(m_FilterInfo.m_aGametype[0][0])
+			for(int i = 0; i < CServerFilterInfo::MAX_GAMETYPES; ++i)
 			{
-				Filtered = 1;
-				for(int Index = 0; Index < CServerFilterInfo::MAX_GAMETYPES; ++Index)
+				if(!m_FilterInfo.m_aGametype[i][0])
+					break;
+				if(!str_comp_nocase(pInfo->m_aGameType, m_FilterInfo.m_aGametype[i]))
 				{
-					if(!m_FilterInfo.m_aGametype[Index][0])
-						break;
-					if(!str_comp_nocase(m_pServerBrowserFilter->m_ppServerlist[i]->m_Info.m_aGameType, m_FilterInfo.m_aGametype[Index]))
-					{
-						Filtered = 0;
-						break;
-					}
+					Filtered = 0;
+					break;
 				}
 			}
+		}
 
-			if(m_FilterInfo.m_SortHash&IServerBrowser::FILTER_COUNTRY)
+		if(m_FilterInfo.m_SortHash&IServerBrowser::FILTER_COUNTRY)
+		{
+			Filtered = 1;
+			// match against player country
+			for(int p = 0; p < pInfo->m_NumClients; p++)
 			{
-				Filtered = 1;
-				// match against player country
-				for(int p = 0; p < m_pServerBrowserFilter->m_ppServerlist[i]->m_Info.m_NumClients; p++)
+				if(pInfo->m_aClients[p].m_Country == m_FilterInfo.m_Country)
 				{
-					if(m_pServerBrowserFilter->m_ppServerlist[i]->m_Info.m_aClients[p].m_Country == m_FilterInfo.m_Country)
-					{
-						Filtered = 0;
-						break;
-					}
+					Filtered = 0;
+					break;
 				}
 			}
+		}
 
-			if(!Filtered && g_Config.m_BrFilterString[0] != 0)
-			{
-				int MatchFound = 0;
-
-				m_pServerBrowserFilter->m_ppServerlist[i]->m_Info.m_QuickSearchHit = 0;
+		if(!Filtered && g_Config.m_BrFilterString[0] != 0)
+		{
+			int MatchFound = 0;
 
-				// match against server name
-				if(str_find_nocase(m_pServerBrowserFilter->m_ppServerlist[i]->m_Info.m_aName, g_Config.m_BrFilterString))
-				{
-					MatchFound = 1;
-					m_pServerBrowserFilter->m_ppServerlist[i]->m_Info.m_QuickSearchHit |= IServerBrowser::QUICK_SERVERNAME;
-				}
+			pInfo->m_QuickSearchHit = 0;
 
-				// match against players
-				for(int p = 0; p < m_pServerBrowserFilter->m_ppServerlist[i]->m_Info.m_NumClients; p++)
-				{
-					if(str_find_nocase(m_pServerBrowserFilter->m_ppServerlist[i]->m_Info.m_aClients[p].m_aName, g_Config.m_BrFilterString) ||
-						str_find_nocase(m_pServerBrowserFilter->m_ppServerlist[i]->m_Info.m_aClients[p].m_aClan, g_Config.m_BrFilterString))
-					{
-						MatchFound = 1;
-						m_pServerBrowserFilter->m_ppServerlist[i]->m_Info.m_QuickSearchHit |= IServerBrowser::QUICK_PLAYER;
-						break;
-					}
-				}
+			// match against server name
+			if(str_find_nocase(pInfo->m_aName, g_Config.m_BrFilterString))
+			{
+				MatchFound = 1;
+				pInfo->m_QuickSearchHit |= IServerBrowser::QUICK_SERVERNAME;
+			}
 
-				// match against map
-				if(str_find_nocase(m_pServerBrowserFilter->m_ppServerlist[i]->m_Info.m_aMap, g_Config.m_BrFilterString))
+			// match against players
+			for(int p = 0; p < pInfo->m_NumClients; p++)
+			{
+				if(str_find_nocase(pInfo->m_aClients[p].m_aName, g_Config.m_BrFilterString) ||
+					str_find_nocase(pInfo->m_aClients[p].m_aClan, g_Config.m_BrFilterString))
 				{
 					MatchFound = 1;
-					m_pServerBrowserFilter->m_ppServerlist[i]->m_Info.m_QuickSearchHit |= IServerBrowser::QUICK_MAPNAME;
+					pInfo->m_QuickSearchHit |= IServerBrowser::QUICK_PLAYER;
+					break;
 				}
-
-				if(!MatchFound)
-					Filtered = 1;
 			}
-		}
 
-		if(Filtered == 0)
-		{
-			// check for friend
-			m_pServerBrowserFilter->m_ppServerlist[i]->m_Info.m_FriendState = IFriends::FRIEND_NO;
-			for(int p = 0; p < m_pServerBrowserFilter->m_ppServerlist[i]->m_Info.m_NumClients; p++)
+			// match against map
+			if(str_find_nocase(pInfo->m_aMap, g_Config.m_BrFilterString))
 			{
-				m_pServerBrowserFilter->m_ppServerlist[i]->m_Info.m_aClients[p].m_FriendState = m_pServerBrowserFilter->m_pFriends->GetFriendState(m_pServerBrowserFilter->m_ppServerlist[i]->m_Info.m_aClients[p].m_aName,
-					m_pServerBrowserFilter->m_ppServerlist[i]->m_Info.m_aClients[p].m_aClan);
-				m_pServerBrowserFilter->m_ppServerlist[i]->m_Info.m_FriendState = max(m_pServerBrowserFilter->m_ppServerlist[i]->m_Info.m_FriendState, m_pServerBrowserFilter->m_ppServerlist[i]->m_Info.m_aClients[p].m_FriendState);
+				MatchFound = 1;
+				pInfo->m_QuickSearchHit |= IServerBrowser::QUICK_MAPNAME;
 			}
 
-			if(!(m_FilterInfo.m_SortHash&IServerBrowser::FILTER_FRIENDS) || m_pServerBrowserFilter->m_ppServerlist[i]->m_Info.m_FriendState != IFriends::FRIEND_NO)
-			{
-				m_pSortedServerlist[m_NumSortedServers++] = i;
-				m_NumSortedPlayers += RelevantClientCount;
-			}
+			if(!MatchFound)
+				Filtered = 1;
 		}
 	}
+
+	if(Filtered)
+		return false;
+
+	// check for friend
+	pInfo->m_FriendState = IFriends::FRIEND_NO;
+	for(int p = 0; p < pInfo->m_NumClients; p++)
+	{
+		pInfo->m_aClients[p].m_FriendState = m_pServerBrowserFilter->m_pFriends->GetFriendState(pInfo->m_aClients[p].m_aName, pInfo->m_aClients[p].m_aClan);
+		pInfo->m_FriendState = max(pInfo->m_FriendState, pInfo->m_aClients[p].m_FriendState);
+	}
+
+	if((m_FilterInfo.m_SortHash&IServerBrowser::FILTER_FRIENDS) && pInfo->m_FriendState == IFriends::FRIEND_NO)
+		return false;
+	*pNumClients = RelevantClientCount;
+	return true;
+}
+
+void CServerBrowserFilter::CServerFilter::Filter()
+{
+	int NumServers = m_pServerBrowserFilter->m_NumServers;
+	m_NumSortedServers = 0;
+	m_NumSortedPlayers = 0;
+	m_NumSortKeys = 0;
+
+	// allocate the sorted list
+	Reserve(NumServers);
+
+	// filter the servers
+	for(int i = 0; i < NumServers; i++)
+	{
+		UpdateSortKey(i);
+		CSortKey *pKey = &m_pSortKeys[i];
+		pKey->m_Listed = FilterEntry(i, &pKey->m_NumClients);
+		if(pKey->m_Listed)
+		{
+			m_pSortedServerlist[m_NumSortedServers++] = i;
+			m_NumSortedPlayers += pKey->m_NumClients;
+		}
+	}
+	m_NumSortKeys = NumServers;
 }
 
 int CServerBrowserFilter::CServerFilter::GetSortHash() const
@@ -239,94 +297,134 @@ void CServerBrowserFilter::CServerFilter::Sort()
 	Filter();
 
 	// sort
+	std::sort(m_pSortedServerlist, m_pSortedServerlist+m_NumSortedServers, SortWrap(this));
+
+	m_FilterInfo.m_SortHash = GetSortHash();
+}
+
+const char *CServerBrowserFilter::CServerFilter::SortString(int Index) const
+{
+	const CServerInfo *pInfo = &m_pServerBrowserFilter->m_ppServerlist[Index]->m_Info;
+	switch(g_Config.m_BrSort)
+	{
+	case IServerBrowser::SORT_NAME: return pInfo->m_aName;
+	case IServerBrowser::SORT_MAP: return pInfo->m_aMap;
+	case IServerBrowser::SORT_GAMETYPE: return pInfo->m_aGameType;
+	}
+	return 0;
+}
+
+void CServerBrowserFilter::CServerFilter::UpdateSortKey(int Index)
+{
+	const CServerEntry *pEntry = m_pServerBrowserFilter->m_ppServerlist[Index];
+	const CServerInfo *pInfo = &pEntry->m_Info;
+	int Pure = (pInfo->m_Flags&IServerBrowser::FLAG_PURE) ? 1 : 0;
+	CSortKey *pKey = &m_pSortKeys[Index];
+	pKey->m_Key = 0;
+	pKey->m_Tiebreak = 0;
+
 	switch(g_Config.m_BrSort)
 	{
 	case IServerBrowser::SORT_NAME:
-		std::stable_sort(m_pSortedServerlist, m_pSortedServerlist+m_NumSortedServers, SortWrap(this, &CServerBrowserFilter::CServerFilter::SortCompareName));
+		//	make sure empty entries are listed last
+		pKey->m_Key = ((int64)(pEntry->m_InfoState != CServerEntry::STATE_READY)<<56) | StringSortKey(pInfo->m_aName);
 		break;
 	case IServerBrowser::SORT_PING:
-		std::stable_sort(m_pSortedServerlist, m_pSortedServerlist+m_NumSortedServers, SortWrap(this, &CServerBrowserFilter::CServerFilter::SortComparePing));
+		pKey->m_Key = pInfo->m_Latency;
+		pKey->m_Tiebreak = !Pure;
 		break;
 	case IServerBrowser::SORT_MAP:
-		std::stable_sort(m_pSortedServerlist, m_pSortedServerlist+m_NumSortedServers, SortWrap(this, &CServerBrowserFilter::CServerFilter::SortCompareMap));
+		pKey->m_Key = StringSortKey(pInfo->m_aMap);
+		pKey->m_Tiebreak = !Pure;
+		break;
+	case IServerBrowser::SORT_GAMETYPE:
+		pKey->m_Key = StringSortKey(pInfo->m_aGameType);
 		break;
 	case IServerBrowser::SORT_NUMPLAYERS:
-		if(!(m_FilterInfo.m_SortHash&IServerBrowser::FILTER_BOTS))
-			std::stable_sort(m_pSortedServerlist, m_pSortedServerlist+m_NumSortedServers, SortWrap(this,
-						(m_FilterInfo.m_SortHash&IServerBrowser::FILTER_SPECTATORS) ? &CServerBrowserFilter::CServerFilter::SortCompareNumPlayers : &CServerBrowserFilter::CServerFilter::SortCompareNumClients));
+		if(m_FilterInfo.m_SortHash&IServerBrowser::FILTER_SPECTATORS)
+			pKey->m_Key = pInfo->m_NumPlayers - ((m_FilterInfo.m_SortHash&IServerBrowser::FILTER_BOTS) ? pInfo->m_NumBotPlayers : 0);
 		else
-			std::stable_sort(m_pSortedServerlist, m_pSortedServerlist+m_NumSortedServers, SortWrap(this,
-						(m_FilterInfo.m_SortHash&IServerBrowser::FILTER_SPECTATORS) ? &CServerBrowserFilter::CServerFilter::SortCompareNumRealPlayers : &CServerBrowserFilter::CServerFilter::SortCompareNumRealClients));
-		break;
-	case IServerBrowser::SORT_GAMETYPE:
-		std::stable_sort(m_pSortedServerlist, m_pSortedServerlist+m_NumSortedServers, SortWrap(this, &CServerBrowserFilter::CServerFilter::SortCompareGametype));
+			pKey->m_Key = pInfo->m_NumClients - ((m_FilterInfo.m_SortHash&IServerBrowser::FILTER_BOTS) ? pInfo->m_NumBotPlayers+pInfo->m_NumBotSpectators : 0);
+		pKey->m_Tiebreak = Pure;
 	}
-
-	m_FilterInfo.m_SortHash = GetSortHash();
 }
 
-bool CServerBrowserFilter::CServerFilter::SortCompareName(int Index1, int Index2) const
+int CServerBrowserFilter::CServerFilter::Compare(int Index1, int Index2) const
 {
-	CServerEntry *a = m_pServerBrowserFilter->m_ppServerlist[Index1];
-	CServerEntry *b = m_pServerBrowserFilter->m_ppServerlist[Index2];
-	//	make sure empty entries are listed last
-	return (a->m_InfoState == CServerEntry::STATE_READY && b->m_InfoState == CServerEntry::STATE_READY) || (a->m_InfoState != CServerEntry::STATE_READY && b->m_InfoState != CServerEntry::STATE_READY) ? str_comp_nocase(a->m_Info.m_aName, b->m_Info.m_aName) < 0 :
-			a->m_InfoState == CServerEntry::STATE_READY;
-}
-
-bool CServerBrowserFilter::CServerFilter::SortCompareMap(int Index1, int Index2) const
-{
-	CServerEntry *a = m_pServerBrowserFilter->m_ppServerlist[Index1];
-	CServerEntry *b = m_pServerBrowserFilter->m_ppServerlist[Index2];
-	int Result = str_comp_nocase(a->m_Info.m_aMap, b->m_Info.m_aMap);
-	return Result < 0 || (Result == 0 && (a->m_Info.m_Flags&IServerBrowser::FLAG_PURE) && !(b->m_Info.m_Flags&IServerBrowser::FLAG_PURE));
-}
-
-bool CServerBrowserFilter::CServerFilter::SortComparePing(int Index1, int Index2) const
-{
-	CServerEntry *a = m_pServerBrowserFilter->m_ppServerlist[Index1];
-	CServerEntry *b = m_pServerBrowserFilter->m_ppServerlist[Index2];
-	return a->m_Info.m_Latency < b->m_Info.m_Latency ||
-		(a->m_Info.m_Latency == b->m_Info.m_Latency && (a->m_Info.m_Flags&IServerBrowser::FLAG_PURE) && !(b->m_Info.m_Flags&IServerBrowser::FLAG_PURE));
-}
-
-bool CServerBrowserFilter::CServerFilter::SortCompareGametype(int Index1, int Index2) const
-{
-	CServerEntry *a = m_pServerBrowserFilter->m_ppServerlist[Index1];
-	CServerEntry *b = m_pServerBrowserFilter->m_ppServerlist[Index2];
-	return str_comp_nocase(a->m_Info.m_aGameType, b->m_Info.m_aGameType) < 0;
-}
+	const CSortKey *a = &m_pSortKeys[Index1];
+	const CSortKey *b = &m_pSortKeys[Index2];
+	int Result = 0;
+	if(a->m_Key != b->m_Key)
+		Result = a->m_Key < b->m_Key ? -1 : 1;
+	else
+	{
+		const char *pStr1 = SortString(Index1);
+		if(pStr1)
+			Result = str_comp_nocase(pStr1, SortString(Index2));
+		if(!Result)
+			Result = a->m_Tiebreak - b->m_Tiebreak;
+	}
 
-bool CServerBrowserFilter::CServerFilter::SortCompareNumPlayers(int Index1, int Index2) const
-{
-	CServerEntry *a = m_pServerBrowserFilter->m_ppServerlist[Index1];
-	CServerEntry *b = m_pServerBrowserFilter->m_ppServerlist[Index2];
-	return a->m_Info.m_NumPlayers < b->m_Info.m_NumPlayers ||
-		(a->m_Info.m_NumPlayers == b->m_Info.m_NumPlayers && !(a->m_Info.m_Flags&IServerBrowser::FLAG_PURE) && (b->m_Info.m_Flags&IServerBrowser::FLAG_PURE));
+	// servers that compare equal stay in the order of the list
+	if(g_Config.m_BrSortOrder)
+		Result = -Result;
+	return Result ? Result : Index1 - Index2;
 }
 
-bool CServerBrowserFilter::CServerFilter::SortCompareNumRealPlayers(int Index1, int Index2) const
+int CServerBrowserFilter::CServerFilter::FindPos(int Index) const
 {
-	CServerEntry *a = m_pServerBrowserFilter->m_ppServerlist[Index1];
-	CServerEntry *b = m_pServerBrowserFilter->m_ppServerlist[Index2];
-	return (a->m_Info.m_NumPlayers - a->m_Info.m_NumBotPlayers) < (b->m_Info.m_NumPlayers - b->m_Info.m_NumBotPlayers) ||
-		((a->m_Info.m_NumPlayers - a->m_Info.m_NumBotPlayers) == (b->m_Info.m_NumPlayers - b->m_Info.m_NumBotPlayers) && !(a->m_Info.m_Flags&IServerBrowser::FLAG_PURE) && (b->m_Info.m_Flags&IServerBrowser::FLAG_PURE));
+	int Low = 0;
+	int High = m_NumSortedServers;
+	while(Low < High)
+	{
+		int Mid = (Low+High)/2;
+		if(Compare(m_pSortedServerlist[Mid], Index) < 0)
+			Low = Mid+1;
+		else
+			High = Mid;
+	}
+	return Low;
 }
 
-bool CServerBrowserFilter::CServerFilter::SortCompareNumClients(int Index1, int Index2) const
+void CServerBrowserFilter::CServerFilter::Update(int Index)
 {
-	CServerEntry *a = m_pServerBrowserFilter->m_ppServerlist[Index1];
-	CServerEntry *b = m_pServerBrowserFilter->m_ppServerlist[Index2];
-	return a->m_Info.m_NumClients < b->m_Info.m_NumClients ||
-		(a->m_Info.m_NumClients == b->m_Info.m_NumClients && !(a->m_Info.m_Flags&IServerBrowser::FLAG_PURE) && (b->m_Info.m_Flags&IServerBrowser::FLAG_PURE));
-}
+	// servers that are new to the filter are not listed yet
+	Reserve(Index+1);
+	while(m_NumSortKeys <= Index)
+		m_pSortKeys[m_NumSortKeys++].m_Listed = false;
+
+	// take the server out with its old state
+	CSortKey *pKey = &m_pSortKeys[Index];
+	if(pKey->m_Listed)
+	{
+		// the string of the server can have changed already, then it is among the servers
+		// with the same key around the position
+		int Found = FindPos(Index);
+		int Pos = Found;
+		while(Pos < m_NumSortedServers && m_pSortedServerlist[Pos] != Index && m_pSortKeys[m_pSortedServerlist[Pos]].m_Key == pKey->m_Key)
+			Pos++;
+		if(Pos == m_NumSortedServers || m_pSortedServerlist[Pos] != Index)
+		{
+			Pos = Found-1;
+			while(m_pSortedServerlist[Pos] != Index)
+				Pos--;
+		}
+		mem_move(&m_pSortedServerlist[Pos], &m_pSortedServerlist[Pos+1], (m_NumSortedServers-Pos-1)*sizeof(int));
+		m_NumSortedServers--;
+		m_NumSortedPlayers -= pKey->m_NumClients;
+	}
 
-bool CServerBrowserFilter::CServerFilter::SortCompareNumRealClients(int Index1, int Index2) const
-{
-	CServerEntry *a = m_pServerBrowserFilter->m_ppServerlist[Index1];
-	CServerEntry *b = m_pServerBrowserFilter->m_ppServerlist[Index2];
-	return (a->m_Info.m_NumClients - a->m_Info.m_NumBotPlayers - a->m_Info.m_NumBotSpectators) < (b->m_Info.m_NumClients - b->m_Info.m_NumBotPlayers - b->m_Info.m_NumBotSpectators) ||
-		((a->m_Info.m_NumClients - a->m_Info.m_NumBotPlayers - a->m_Info.m_NumBotSpectators) == (b->m_Info.m_NumClients - b->m_Info.m_NumBotPlayers - b->m_Info.m_NumBotSpectators) && !(a->m_Info.m_Flags&IServerBrowser::FLAG_PURE) && (b->m_Info.m_Flags&IServerBrowser::FLAG_PURE));
+	// and put it back where it belongs now
+	UpdateSortKey(Index);
+	pKey->m_Listed = FilterEntry(Index, &pKey->m_NumClients);
+	if(pKey->m_Listed)
+	{
+		int Pos = FindPos(Index);
+		mem_move(&m_pSortedServerlist[Pos+1], &m_pSortedServerlist[Pos], (m_NumSortedServers-Pos)*sizeof(int));
+		m_pSortedServerlist[Pos] = Index;
+		m_NumSortedServers++;
+		m_NumSortedPlayers += pKey->m_NumClients;
+	}
 }
 
 //	CServerBrowserFilter
@@ -342,6 +440,7 @@ void CServerBrowserFilter::Clear()
 	{
 		m_lFilters[i].m_NumSortedServers = 0;
 		m_lFilters[i].m_NumSortedPlayers = 0;
+		m_lFilters[i].m_NumSortKeys = 0;
 	}
 }
 
@@ -358,6 +457,20 @@ void CServerBrowserFilter::Sort(CServerEntry **ppServerlist, int NumServers, int
 	}
 }
 
+void CServerBrowserFilter::Update(CServerEntry **ppServerlist, int NumServers, int Index)
+{
+	m_ppServerlist = ppServerlist;
+	m_NumServers = NumServers;
+	for(int i = 0; i < m_lFilters.size(); i++)
+	{
+		CServerFilter *pFilter = &m_lFilters[i];
+		if(pFilter->m_FilterInfo.m_SortHash != pFilter->GetSortHash())
+			pFilter->Sort();
+		else
+			pFilter->Update(Index);
+	}
+}
+
 int CServerBrowserFilter::AddFilter(const CServerFilterInfo *pFilterInfo)
 {
 	CServerFilter Filter;
@@ -372,6 +485,8 @@ int CServerBrowserFilter::AddFilter(const CServerFilterInfo *pFilterInfo)
 	Filter.m_NumSortedPlayers = 0;
 	Filter.m_NumSortedServers = 0;
 	Filter.m_SortedServersCapacity = 0;
+	Filter.m_pSortKeys = 0;
+	Filter.m_NumSortKeys = 0;
 	Filter.m_pServerBrowserFilter = this;
 	m_lFilters.add(Filter);
 
@@ -17,6 +17,15 @@ public:
 	class CServerFilter
 	{
 	public:
+		// what a server is sorted by, the strings of the entries are only compared if the keys are equal
+		struct CSortKey
+		{
+			int64 m_Key;
+			int m_Tiebreak;
+			int m_NumClients; // counted for the filter
+			bool m_Listed;
+		};
+
 		CServerBrowserFilter *m_pServerBrowserFilter;
 
 		// filter settings
@@ -27,30 +36,38 @@ public:
 		int m_NumSortedServers;
 		int *m_pSortedServerlist;
 		int m_SortedServersCapacity;
+
+		// per server of the list, in the order of the list
+		CSortKey *m_pSortKeys;
+		int m_NumSortKeys;
 		
 		CServerFilter();
 		~CServerFilter();
 		CServerFilter& operator=(const CServerFilter& Other);
 
+		void Reserve(int NumServers);
+		bool FilterEntry(int Index, int *pNumClients);
 		void Filter();
 		int GetSortHash() const;
 		void Sort();
 
 		// sorting criterions
-		bool SortCompareName(int Index1, int Index2) const;
-		bool SortCompareMap(int Index1, int Index2) const;
-		bool SortComparePing(int Index1, int Index2) const;
-		bool SortCompareGametype(int Index1, int Index2) const;
-		bool SortCompareNumPlayers(int Index1, int Index2) const;
-		bool SortCompareNumRealPlayers(int Index1, int Index2) const;
-		bool SortCompareNumClients(int Index1, int Index2) const;
-		bool SortCompareNumRealClients(int Index1, int Index2) const;
+		const char *SortString(int Index) const;
+		void UpdateSortKey(int Index);
+		int Compare(int Index1, int Index2) const;
+		// the first position in the sorted list that does not come before the server
+		int FindPos(int Index) const;
+
+		// moves a single server that changed to where it belongs now
+		void Update(int Index);
 	};
 
 	//
 	void Init(class IFriends *pFriends, const char *pNetVersion);
 	void Clear();
 	void Sort(class CServerEntry **ppServerlist, int NumServers, int ResortFlags);
+	// the server at Index got added or changed, the filters resort fully only if their settings changed
+	void Update(class CServerEntry **ppServerlist, int NumServers, int Index);
 
 	// filter
 	int AddFilter(const class CServerFilterInfo *pFilterInfo);
@@ -19,7 +19,7 @@ public:
 	int Shutdown();
 	int AllocID();
 
-	static void RateConvert(int SampleID);
+	static void RateConvert(struct CSample *pSample);
 
 	virtual bool IsSoundEnabled() { return m_SoundEnabled != 0; }
 
@@ -2,8 +2,10 @@
 /* If you are missing that file, acquire a complete release at teeworlds.com.                */
 #include <base/system.h>
 #include <base/math.h>
+#include <math.h> // floorf
 #include <engine/graphics.h>
 #include <engine/textrender.h>
+#include <engine/shared/config.h>
 
 #ifdef CONF_FAMILY_WINDOWS
 	#include <windows.h>
@@ -13,19 +15,31 @@
 #include <ft2build.h>
 #include FT_FREETYPE_H
 
-// TODO: Refactor: clean this up
 enum
 {
-	MAX_CHARACTERS = 64,
+	// glyphs of every font and size share one atlas, it starts small and grows while it is full of
+	// glyphs that are in use
+	MIN_ATLAS_SIZE=512,
+	MAX_ATLAS_SIZE=2048,
+	MAX_GLYPHS=8192,
+	NUM_GLYPH_BUCKETS=8192,
+	// biggest glyph including the outline, in pixels
+	MAX_GLYPH_SIZE=1024/8,
+	// least recently used glyphs that are checked for space before the atlas starts over
+	MAX_EVICT_CANDIDATES=32,
 };
 
 
 static int aFontSizes[] = {8,9,10,11,12,13,14,15,16,17,18,19,20,36,64};
 #define NUM_FONT_SIZES (sizeof(aFontSizes)/sizeof(int))
 
+class CFont;
+
 struct CFontChar
 {
 	int m_ID;
+	CFont *m_pFont;
+	int m_FontSize;
 
 	// these values are scaled to the pFont size
 	// width * font_size == real_size
@@ -37,26 +51,24 @@ struct CFontChar
 
 	float m_aUvs[4];
 	int64 m_TouchTime;
+
+	// space in the atlas, can be bigger than the glyph if it took over the space of another one
+	int m_AtlasX;
+	int m_AtlasY;
+	int m_AtlasWidth;
+	int m_AtlasHeight;
+	// changes whenever another glyph takes over the slot
+	unsigned m_Generation;
+
+	CFontChar *m_pHashNext;
+	// most recently used first
+	CFontChar *m_pPrev;
+	CFontChar *m_pNext;
 };
 
 struct CFontSizeData
 {
 	int m_FontSize;
-	FT_Face *m_pFace;
-
-	IGraphics::CTextureHandle m_aTextures[2];
-	int m_TextureWidth;
-	int m_TextureHeight;
-
-	int m_NumXChars;
-	int m_NumYChars;
-
-	int m_CharMaxWidth;
-	int m_CharMaxHeight;
-
-	CFontChar m_aCharacters[MAX_CHARACTERS*MAX_CHARACTERS];
-
-	int m_CurrentCharacter;
 };
 
 class CFont
@@ -145,37 +157,6 @@ class CTextRender : public IEngineTextRender
 			}
 	}
 
-	void InitTexture(CFontSizeData *pSizeData, int CharWidth, int CharHeight, int Xchars, int Ychars)
-	{
-		static int FontMemoryUsage = 0;
-		int Width = CharWidth*Xchars;
-		int Height = CharHeight*Ychars;
-		void *pMem = mem_alloc(Width*Height, 1);
-		mem_zero(pMem, Width*Height);
-
-		for(int i = 0; i < 2; i++)
-		{
-			if(pSizeData->m_aTextures[i].IsValid())
-			{
-				Graphics()->UnloadTexture(&(pSizeData->m_aTextures[i]));
-				FontMemoryUsage -= pSizeData->m_TextureWidth*pSizeData->m_TextureHeight;
-			}
-
-			pSizeData->m_aTextures[i] = Graphics()->LoadTextureRaw(Width, Height, CImageInfo::FORMAT_ALPHA, pMem, CImageInfo::FORMAT_ALPHA, IGraphics::TEXLOAD_NOMIPMAPS);
-			FontMemoryUsage += Width*Height;
-		}
-
-		pSizeData->m_NumXChars = Xchars;
-		pSizeData->m_NumYChars = Ychars;
-		pSizeData->m_TextureWidth = Width;
-		pSizeData->m_TextureHeight = Height;
-		pSizeData->m_CurrentCharacter = 0;
-
-		dbg_msg("", "pFont memory usage: %d", FontMemoryUsage);
-
-		mem_free(pMem);
-	}
-
 	int AdjustOutlineThicknessToFontSize(int OutlineThickness, int FontSize)
 	{
 		if(FontSize > 36)
@@ -185,154 +166,330 @@ class CTextRender : public IEngineTextRender
 		return OutlineThickness;
 	}
 
-	void IncreaseTextureSize(CFontSizeData *pSizeData)
+	CFontSizeData *GetSize(CFont *pFont, int Pixelsize)
 	{
-		if(pSizeData->m_TextureWidth < pSizeData->m_TextureHeight)
-			pSizeData->m_NumXChars <<= 1;
-		else
-			pSizeData->m_NumYChars <<= 1;
-		InitTexture(pSizeData, pSizeData->m_CharMaxWidth, pSizeData->m_CharMaxHeight, pSizeData->m_NumXChars, pSizeData->m_NumYChars);
+		int Index = GetFontSizeIndex(Pixelsize);
+		pFont->m_aSizes[Index].m_FontSize = aFontSizes[Index];
+		return &pFont->m_aSizes[Index];
 	}
 
-
-	// TODO: Refactor: move this into a pFont class
-	void InitIndex(CFont *pFont, int Index)
+	// the atlas, the glyphs and the outlines are at the same place in their textures. the glyphs
+	// are packed along a skyline, the top edge of the used space
+	struct CSkylineNode
 	{
-		CFontSizeData *pSizeData = &pFont->m_aSizes[Index];
+		int m_X;
+		int m_Y;
+		int m_Width;
+	};
+
+	int m_AtlasSize;
+	unsigned char *m_apAtlasData[2];
+	IGraphics::CTextureHandle m_aAtlasTextures[2];
+	CSkylineNode m_aSkyline[MAX_ATLAS_SIZE];
+	int m_NumSkylineNodes;
+	// rows that changed since the last upload
+	int m_DirtyStartY;
+	int m_DirtyEndY;
+	// changes when the atlas starts over and all glyphs lose their place
+	unsigned m_AtlasGeneration;
+
+	CFontChar m_aGlyphs[MAX_GLYPHS];
+	int m_NumGlyphs;
+	CFontChar *m_apGlyphBuckets[NUM_GLYPH_BUCKETS];
+	CFontChar *m_pFirstGlyph;
+	CFontChar *m_pLastGlyph;
+
+	// for dbg_text_atlas
+	int64 m_StatsTime;
+	int m_NumRasterized;
+	int m_NumUploads;
+	int m_NumUploadedBytes;
+
+	void InitAtlas(int Size)
+	{
+		for(int i = 0; i < 2; i++)
+		{
+			if(m_aAtlasTextures[i].IsValid())
+				Graphics()->UnloadTexture(&m_aAtlasTextures[i]);
+			if(m_apAtlasData[i])
+				mem_free(m_apAtlasData[i]);
+			m_apAtlasData[i] = (unsigned char *)mem_alloc(Size*Size, 1);
+			mem_zero(m_apAtlasData[i], Size*Size);
+			m_aAtlasTextures[i] = Graphics()->LoadTextureRaw(Size, Size, CImageInfo::FORMAT_ALPHA, m_apAtlasData[i], CImageInfo::FORMAT_ALPHA, IGraphics::TEXLOAD_NOMIPMAPS);
+		}
 
-		pSizeData->m_FontSize = aFontSizes[Index];
-		FT_Set_Pixel_Sizes(pFont->m_FtFace, 0, pSizeData->m_FontSize);
+		m_AtlasSize = Size;
+		m_aSkyline[0].m_X = 0;
+		m_aSkyline[0].m_Y = 0;
+		m_aSkyline[0].m_Width = Size;
+		m_NumSkylineNodes = 1;
+		m_DirtyStartY = Size;
+		m_DirtyEndY = 0;
+		m_AtlasGeneration++;
+
+		m_NumGlyphs = 0;
+		for(int i = 0; i < NUM_GLYPH_BUCKETS; i++)
+			m_apGlyphBuckets[i] = 0;
+		m_pFirstGlyph = 0;
+		m_pLastGlyph = 0;
+
+		dbg_msg("textrender", "glyph atlas %dx%d, memory usage: %d", Size, Size, Size*Size*2);
+	}
 
-		int OutlineThickness = AdjustOutlineThicknessToFontSize(1, pSizeData->m_FontSize);
+	// the lowest the rect fits with its left edge at the node, -1 if it does not fit there
+	int SkylineFit(int Index, int Width, int Height)
+	{
+		if(m_aSkyline[Index].m_X+Width > m_AtlasSize)
+			return -1;
 
+		int y = m_aSkyline[Index].m_Y;
+		for(int Left = Width; Left > 0; Index++)
 		{
-			unsigned GlyphIndex;
-			int MaxH = 0;
-			int MaxW = 0;
+			y = max(y, m_aSkyline[Index].m_Y);
+			if(y+Height > m_AtlasSize)
+				return -1;
+			Left -= m_aSkyline[Index].m_Width;
+		}
+		return y;
+	}
 
-			int Charcode = FT_Get_First_Char(pFont->m_FtFace, &GlyphIndex);
-			while(GlyphIndex != 0)
+	bool SkylineInsert(int Width, int Height, int *pX, int *pY)
+	{
+		int Best = -1;
+		int BestY = 0;
+		int BestWidth = 0;
+		for(int i = 0; i < m_NumSkylineNodes; i++)
+		{
+			int y = SkylineFit(i, Width, Height);
+			if(y < 0)
+				continue;
+			if(Best < 0 || y < BestY || (y == BestY && m_aSkyline[i].m_Width < BestWidth))
 			{
-				// do stuff
-				FT_Load_Glyph(pFont->m_FtFace, GlyphIndex, FT_LOAD_DEFAULT);
-
-				if(pFont->m_FtFace->glyph->metrics.width > MaxW) MaxW = pFont->m_FtFace->glyph->metrics.width; // ignore_convention
-				if(pFont->m_FtFace->glyph->metrics.height > MaxH) MaxH = pFont->m_FtFace->glyph->metrics.height; // ignore_convention
-				Charcode = FT_Get_Next_Char(pFont->m_FtFace, Charcode, &GlyphIndex);
+				Best = i;
+				BestY = y;
+				BestWidth = m_aSkyline[i].m_Width;
 			}
+		}
+		if(Best < 0)
+			return false;
+
+		*pX = m_aSkyline[Best].m_X;
+		*pY = BestY;
 
-			MaxW = (MaxW>>6)+2+OutlineThickness*2;
-			MaxH = (MaxH>>6)+2+OutlineThickness*2;
+		// the rect becomes a node, the ones below it shrink or go away
+		mem_move(&m_aSkyline[Best+1], &m_aSkyline[Best], (m_NumSkylineNodes-Best)*sizeof(CSkylineNode));
+		m_NumSkylineNodes++;
+		m_aSkyline[Best].m_Y = BestY+Height;
+		m_aSkyline[Best].m_Width = Width;
 
-			for(pSizeData->m_CharMaxWidth = 1; pSizeData->m_CharMaxWidth < MaxW; pSizeData->m_CharMaxWidth <<= 1);
-			for(pSizeData->m_CharMaxHeight = 1; pSizeData->m_CharMaxHeight < MaxH; pSizeData->m_CharMaxHeight <<= 1);
+		for(int i = Best+1; i < m_NumSkylineNodes; i++)
+		{
+			int Overlap = m_aSkyline[i-1].m_X+m_aSkyline[i-1].m_Width-m_aSkyline[i].m_X;
+			if(Overlap <= 0)
+				break;
+			m_aSkyline[i].m_X += Overlap;
+			m_aSkyline[i].m_Width -= Overlap;
+			if(m_aSkyline[i].m_Width > 0)
+				break;
+			mem_move(&m_aSkyline[i], &m_aSkyline[i+1], (m_NumSkylineNodes-i-1)*sizeof(CSkylineNode));
+			m_NumSkylineNodes--;
+			i--;
 		}
 
-		//dbg_msg("pFont", "init size %d, texture size %d %d", pFont->sizes[index].font_size, w, h);
-		//FT_New_Face(m_FTLibrary, "data/fonts/vera.ttf", 0, &pFont->ft_face);
-		InitTexture(pSizeData, pSizeData->m_CharMaxWidth, pSizeData->m_CharMaxHeight, 8, 8);
+		for(int i = 0; i < m_NumSkylineNodes-1; i++)
+		{
+			if(m_aSkyline[i].m_Y == m_aSkyline[i+1].m_Y)
+			{
+				m_aSkyline[i].m_Width += m_aSkyline[i+1].m_Width;
+				mem_move(&m_aSkyline[i+1], &m_aSkyline[i+2], (m_NumSkylineNodes-i-2)*sizeof(CSkylineNode));
+				m_NumSkylineNodes--;
+				i--;
+			}
+		}
+		return true;
 	}
 
-	CFontSizeData *GetSize(CFont *pFont, int Pixelsize)
+	static unsigned GlyphHash(CFont *pFont, int FontSize, int Chr)
 	{
-		int Index = GetFontSizeIndex(Pixelsize);
-		if(pFont->m_aSizes[Index].m_FontSize != aFontSizes[Index])
-			InitIndex(pFont, Index);
-		return &pFont->m_aSizes[Index];
+		unsigned Hash = (unsigned)Chr*0x9e3779b1u ^ (unsigned)FontSize*0x85ebca6bu ^ (unsigned)(((size_t)pFont)>>4);
+		return (Hash^(Hash>>16))&(NUM_GLYPH_BUCKETS-1);
 	}
 
-
-	void UploadGlyph(CFontSizeData *pSizeData, int Texnum, int SlotID, int Chr, const void *pData)
+	void UnlinkGlyph(CFontChar *pGlyph)
 	{
-		int x = (SlotID%pSizeData->m_NumXChars) * (pSizeData->m_TextureWidth/pSizeData->m_NumXChars);
-		int y = (SlotID/pSizeData->m_NumXChars) * (pSizeData->m_TextureHeight/pSizeData->m_NumYChars);
+		if(pGlyph->m_pPrev)
+			pGlyph->m_pPrev->m_pNext = pGlyph->m_pNext;
+		else
+			m_pFirstGlyph = pGlyph->m_pNext;
+		if(pGlyph->m_pNext)
+			pGlyph->m_pNext->m_pPrev = pGlyph->m_pPrev;
+		else
+			m_pLastGlyph = pGlyph->m_pPrev;
+	}
 
-		Graphics()->LoadTextureRawSub(pSizeData->m_aTextures[Texnum], x, y,
-			pSizeData->m_TextureWidth/pSizeData->m_NumXChars,
-			pSizeData->m_TextureHeight/pSizeData->m_NumYChars,
-			CImageInfo::FORMAT_ALPHA, pData);
-		/*
-		glBindTexture(GL_TEXTURE_2D, pSizeData->m_aTextures[Texnum]);
-		glTexSubImage2D(GL_TEXTURE_2D, 0, x, y,
-			pSizeData->m_TextureWidth/pSizeData->m_NumXChars,
-			pSizeData->m_TextureHeight/pSizeData->m_NumYChars,
-			m_FontTextureFormat, GL_UNSIGNED_BYTE, pData);*/
+	void PrependGlyph(CFontChar *pGlyph)
+	{
+		pGlyph->m_pPrev = 0;
+		pGlyph->m_pNext = m_pFirstGlyph;
+		if(m_pFirstGlyph)
+			m_pFirstGlyph->m_pPrev = pGlyph;
+		else
+			m_pLastGlyph = pGlyph;
+		m_pFirstGlyph = pGlyph;
 	}
 
-	// 32k of data used for rendering glyphs
-	unsigned char ms_aGlyphData[(1024/8) * (1024/8)];
-	unsigned char ms_aGlyphDataOutlined[(1024/8) * (1024/8)];
+	void TouchGlyph(CFontChar *pGlyph, int64 Now)
+	{
+		pGlyph->m_TouchTime = Now;
+		if(pGlyph != m_pFirstGlyph)
+		{
+			UnlinkGlyph(pGlyph);
+			PrependGlyph(pGlyph);
+		}
+	}
 
-	int GetSlot(CFontSizeData *pSizeData)
+	// finds space for a glyph, it is neither hashed nor linked yet
+	CFontChar *AllocGlyph(int Width, int Height)
 	{
-		int CharCount = pSizeData->m_NumXChars*pSizeData->m_NumYChars;
-		if(pSizeData->m_CurrentCharacter < CharCount)
+		// keep a pixel between the glyphs so they do not bleed into each other when filtered
+		int AtlasWidth = Width+1;
+		int AtlasHeight = Height+1;
+		int x, y;
+
+		if(m_NumGlyphs < MAX_GLYPHS && SkylineInsert(AtlasWidth, AtlasHeight, &x, &y))
 		{
-			int i = pSizeData->m_CurrentCharacter;
-			pSizeData->m_CurrentCharacter++;
-			return i;
+			CFontChar *pGlyph = &m_aGlyphs[m_NumGlyphs++];
+			pGlyph->m_AtlasX = x;
+			pGlyph->m_AtlasY = y;
+			pGlyph->m_AtlasWidth = AtlasWidth;
+			pGlyph->m_AtlasHeight = AtlasHeight;
+			return pGlyph;
 		}
 
-		// kick out the oldest
-		// TODO: remove this linear search
+		// take the place of a glyph that was not used for a while
+		int64 Now = time_get();
+		CFontChar *pOld = m_pLastGlyph;
+		for(int i = 0; pOld && i < MAX_EVICT_CANDIDATES && Now-pOld->m_TouchTime > time_freq(); i++, pOld = pOld->m_pPrev)
 		{
-			int Oldest = 0;
-			for(int i = 1; i < CharCount; i++)
+			if(pOld->m_AtlasWidth < AtlasWidth || pOld->m_AtlasHeight < AtlasHeight)
+				continue;
+
+			CFontChar **ppGlyph = &m_apGlyphBuckets[GlyphHash(pOld->m_pFont, pOld->m_FontSize, pOld->m_ID)];
+			while(*ppGlyph != pOld)
+				ppGlyph = &(*ppGlyph)->m_pHashNext;
+			*ppGlyph = pOld->m_pHashNext;
+			UnlinkGlyph(pOld);
+			pOld->m_Generation++;
+			return pOld;
+		}
+
+		// full of glyphs that are in use, make room for more. otherwise start over
+		if(m_pLastGlyph && Now-m_pLastGlyph->m_TouchTime <= time_freq() && m_AtlasSize < MAX_ATLAS_SIZE)
+			InitAtlas(m_AtlasSize*2);
+		else
+			InitAtlas(m_AtlasSize);
+		return AllocGlyph(Width, Height);
+	}
+
+	void WriteGlyph(int Texnum, const CFontChar *pGlyph, const unsigned char *pData, int Width, int Height)
+	{
+		unsigned char *pAtlas = m_apAtlasData[Texnum];
+		for(int y = 0; y < pGlyph->m_AtlasHeight; y++)
+		{
+			unsigned char *pRow = &pAtlas[(pGlyph->m_AtlasY+y)*m_AtlasSize+pGlyph->m_AtlasX];
+			if(y < Height)
 			{
-				if(pSizeData->m_aCharacters[i].m_TouchTime < pSizeData->m_aCharacters[Oldest].m_TouchTime)
-					Oldest = i;
+				mem_copy(pRow, &pData[y*Width], Width);
+				mem_zero(pRow+Width, pGlyph->m_AtlasWidth-Width);
 			}
+			else
+				mem_zero(pRow, pGlyph->m_AtlasWidth);
+		}
+
+		m_DirtyStartY = min(m_DirtyStartY, pGlyph->m_AtlasY);
+		m_DirtyEndY = max(m_DirtyEndY, pGlyph->m_AtlasY+pGlyph->m_AtlasHeight);
+	}
 
-			if(time_get()-pSizeData->m_aCharacters[Oldest].m_TouchTime < time_freq() &&
-				(pSizeData->m_NumXChars < MAX_CHARACTERS || pSizeData->m_NumYChars < MAX_CHARACTERS))
+	// sends the rows with new glyphs to the textures, once before drawing instead of once per glyph
+	void UploadAtlas()
+	{
+		if(m_DirtyStartY < m_DirtyEndY)
+		{
+			int Rows = m_DirtyEndY-m_DirtyStartY;
+			for(int i = 0; i < 2; i++)
 			{
-				IncreaseTextureSize(pSizeData);
-				return GetSlot(pSizeData);
+				Graphics()->LoadTextureRawSub(m_aAtlasTextures[i], 0, m_DirtyStartY, m_AtlasSize, Rows,
+					CImageInfo::FORMAT_ALPHA, &m_apAtlasData[i][m_DirtyStartY*m_AtlasSize]);
+				m_NumUploads++;
+				m_NumUploadedBytes += m_AtlasSize*Rows;
 			}
+			m_DirtyStartY = m_AtlasSize;
+			m_DirtyEndY = 0;
+		}
 
-			return Oldest;
+		if(g_Config.m_DbgTextAtlas)
+		{
+			int64 Now = time_get();
+			if(Now > m_StatsTime+time_freq())
+			{
+				dbg_msg("textrender", "%d glyphs rasterized, %d uploads, %d bytes uploaded per second, %d glyphs in the %dx%d atlas",
+					m_NumRasterized, m_NumUploads, m_NumUploadedBytes, m_NumGlyphs, m_AtlasSize, m_AtlasSize);
+				m_StatsTime = Now;
+				m_NumRasterized = 0;
+				m_NumUploads = 0;
+				m_NumUploadedBytes = 0;
+			}
 		}
 	}
 
-	int RenderGlyph(CFont *pFont, CFontSizeData *pSizeData, int Chr)
+	// 32k of data used for rendering glyphs
+	unsigned char ms_aGlyphData[MAX_GLYPH_SIZE * MAX_GLYPH_SIZE];
+	unsigned char ms_aGlyphDataOutlined[MAX_GLYPH_SIZE * MAX_GLYPH_SIZE];
+
+	CFontChar *RenderGlyph(CFont *pFont, CFontSizeData *pSizeData, int Chr)
 	{
 		FT_Bitmap *pBitmap;
-		int SlotID = 0;
-		int SlotW = pSizeData->m_TextureWidth / pSizeData->m_NumXChars;
-		int SlotH = pSizeData->m_TextureHeight / pSizeData->m_NumYChars;
-		int SlotSize = SlotW*SlotH;
 		int x = 1;
 		int y = 1;
 		unsigned int px, py;
 
+		// the layout kerns with the size that is set, put it back afterwards
+		int LayoutSize = pFont->m_FtFace->size->metrics.y_ppem; // ignore_convention
 		FT_Set_Pixel_Sizes(pFont->m_FtFace, 0, pSizeData->m_FontSize);
 
 		if(FT_Load_Char(pFont->m_FtFace, Chr, FT_LOAD_RENDER|FT_LOAD_NO_BITMAP))
 		{
 			dbg_msg("pFont", "error loading glyph %d", Chr);
-			return -1;
+			FT_Set_Pixel_Sizes(pFont->m_FtFace, 0, LayoutSize);
+			return 0;
 		}
 
 		pBitmap = &pFont->m_FtFace->glyph->bitmap; // ignore_convention
 
-		// fetch slot
-		SlotID = GetSlot(pSizeData);
-		if(SlotID < 0)
-			return -1;
-
 		// adjust spacing
 		int OutlineThickness = AdjustOutlineThicknessToFontSize(1, pSizeData->m_FontSize);
 		x += OutlineThickness;
 		y += OutlineThickness;
+		int Height = pBitmap->rows + OutlineThickness*2 + 2; // ignore_convention
+		int Width = pBitmap->width + OutlineThickness*2 + 2; // ignore_convention
+		if(Width > MAX_GLYPH_SIZE || Height > MAX_GLYPH_SIZE)
+		{
+			dbg_msg("pFont", "glyph %d is too big", Chr);
+			FT_Set_Pixel_Sizes(pFont->m_FtFace, 0, LayoutSize);
+			return 0;
+		}
+
+		// fetch space
+		CFontChar *pFontchr = AllocGlyph(Width, Height);
 
 		// prepare glyph data
-		mem_zero(ms_aGlyphData, SlotSize);
+		mem_zero(ms_aGlyphData, Width*Height);
 
 		if(pBitmap->pixel_mode == FT_PIXEL_MODE_GRAY) // ignore_convention
 		{
 			for(py = 0; py < pBitmap->rows; py++) // ignore_convention
 				for(px = 0; px < pBitmap->width; px++) // ignore_convention
-					ms_aGlyphData[(py+y)*SlotW+px+x] = pBitmap->buffer[py*pBitmap->pitch+px]; // ignore_convention
+					ms_aGlyphData[(py+y)*Width+px+x] = pBitmap->buffer[py*pBitmap->pitch+px]; // ignore_convention
 		}
 		else if(pBitmap->pixel_mode == FT_PIXEL_MODE_MONO) // ignore_convention
 		{
@@ -340,85 +497,73 @@ class CTextRender : public IEngineTextRender
 				for(px = 0; px < pBitmap->width; px++) // ignore_convention
 				{
 					if(pBitmap->buffer[py*pBitmap->pitch+px/8]&(1<<(7-(px%8)))) // ignore_convention
-						ms_aGlyphData[(py+y)*SlotW+px+x] = 255;
+						ms_aGlyphData[(py+y)*Width+px+x] = 255;
 				}
 		}
 
-		/*for(py = 0; py < SlotW; py++)
-			for(px = 0; px < SlotH; px++)
-				ms_aGlyphData[py*SlotW+px] = 255;*/
-
-		// upload the glyph
-		UploadGlyph(pSizeData, 0, SlotID, Chr, ms_aGlyphData);
+		// put the glyph into the atlas, it is uploaded before the next text is drawn
+		WriteGlyph(0, pFontchr, ms_aGlyphData, Width, Height);
 
 		if(OutlineThickness == 1)
 		{
-			Grow(ms_aGlyphData, ms_aGlyphDataOutlined, SlotW, SlotH);
-			UploadGlyph(pSizeData, 1, SlotID, Chr, ms_aGlyphDataOutlined);
+			Grow(ms_aGlyphData, ms_aGlyphDataOutlined, Width, Height);
+			WriteGlyph(1, pFontchr, ms_aGlyphDataOutlined, Width, Height);
 		}
 		else
 		{
 			for(int i = OutlineThickness; i > 0; i-=2)
 			{
-				Grow(ms_aGlyphData, ms_aGlyphDataOutlined, SlotW, SlotH);
-				Grow(ms_aGlyphDataOutlined, ms_aGlyphData, SlotW, SlotH);
+				Grow(ms_aGlyphData, ms_aGlyphDataOutlined, Width, Height);
+				Grow(ms_aGlyphDataOutlined, ms_aGlyphData, Width, Height);
 			}
-			UploadGlyph(pSizeData, 1, SlotID, Chr, ms_aGlyphData);
+			WriteGlyph(1, pFontchr, ms_aGlyphData, Width, Height);
 		}
+		m_NumRasterized++;
 
 		// set char info
 		{
-			CFontChar *pFontchr = &pSizeData->m_aCharacters[SlotID];
 			float Scale = 1.0f/pSizeData->m_FontSize;
-			float Uscale = 1.0f/pSizeData->m_TextureWidth;
-			float Vscale = 1.0f/pSizeData->m_TextureHeight;
-			int Height = pBitmap->rows + OutlineThickness*2 + 2; // ignore_convention
-			int Width = pBitmap->width + OutlineThickness*2 + 2; // ignore_convention
+			float UVScale = 1.0f/m_AtlasSize;
 
 			pFontchr->m_ID = Chr;
+			pFontchr->m_pFont = pFont;
+			pFontchr->m_FontSize = pSizeData->m_FontSize;
 			pFontchr->m_Height = Height * Scale;
 			pFontchr->m_Width = Width * Scale;
 			pFontchr->m_OffsetX = (pFont->m_FtFace->glyph->bitmap_left-2) * Scale; // ignore_convention
 			pFontchr->m_OffsetY = (pSizeData->m_FontSize - pFont->m_FtFace->glyph->bitmap_top) * Scale; // ignore_convention
 			pFontchr->m_AdvanceX = (pFont->m_FtFace->glyph->advance.x>>6) * Scale; // ignore_convention
 
-			pFontchr->m_aUvs[0] = (SlotID%pSizeData->m_NumXChars) / (float)(pSizeData->m_NumXChars);
-			pFontchr->m_aUvs[1] = (SlotID/pSizeData->m_NumXChars) / (float)(pSizeData->m_NumYChars);
-			pFontchr->m_aUvs[2] = pFontchr->m_aUvs[0] + Width*Uscale;
-			pFontchr->m_aUvs[3] = pFontchr->m_aUvs[1] + Height*Vscale;
+			pFontchr->m_aUvs[0] = pFontchr->m_AtlasX * UVScale;
+			pFontchr->m_aUvs[1] = pFontchr->m_AtlasY * UVScale;
+			pFontchr->m_aUvs[2] = (pFontchr->m_AtlasX+Width) * UVScale;
+			pFontchr->m_aUvs[3] = (pFontchr->m_AtlasY+Height) * UVScale;
 		}
 
-		return SlotID;
+		unsigned Bucket = GlyphHash(pFont, pSizeData->m_FontSize, Chr);
+		pFontchr->m_pHashNext = m_apGlyphBuckets[Bucket];
+		m_apGlyphBuckets[Bucket] = pFontchr;
+		pFontchr->m_TouchTime = 0;
+		PrependGlyph(pFontchr);
+
+		FT_Set_Pixel_Sizes(pFont->m_FtFace, 0, LayoutSize);
+		return pFontchr;
 	}
 
 	CFontChar *GetChar(CFont *pFont, CFontSizeData *pSizeData, int Chr)
 	{
-		CFontChar *pFontchr = NULL;
-
-		// search for the character
-		// TODO: remove this linear search
-		int i;
-		for(i = 0; i < pSizeData->m_CurrentCharacter; i++)
-		{
-			if(pSizeData->m_aCharacters[i].m_ID == Chr)
-			{
-				pFontchr = &pSizeData->m_aCharacters[i];
-				break;
-			}
-		}
+		CFontChar *pFontchr = m_apGlyphBuckets[GlyphHash(pFont, pSizeData->m_FontSize, Chr)];
+		while(pFontchr && (pFontchr->m_ID != Chr || pFontchr->m_pFont != pFont || pFontchr->m_FontSize != pSizeData->m_FontSize))
+			pFontchr = pFontchr->m_pHashNext;
 
 		// check if we need to render the character
 		if(!pFontchr)
-		{
-			int Index = RenderGlyph(pFont, pSizeData, Chr);
-			if(Index >= 0)
-				pFontchr = &pSizeData->m_aCharacters[Index];
-		}
+			pFontchr = RenderGlyph(pFont, pSizeData, Chr);
 
 		// touch the character
 		// TODO: don't call time_get here
 		if(pFontchr)
-			pFontchr->m_TouchTime = time_get();
+			TouchGlyph(pFontchr, time_get());
 
 		return pFontchr;
 	}
@@ -436,6 +581,407 @@ class CTextRender : public IEngineTextRender
 		return (Kerning.x>>6);
 	}
 
+	// strings that were laid out before, so text that is drawn or measured every frame is only
+	// shaped once. the glyph quads of a layout are valid as long as the glyphs keep their slots.
+	// layouts are relative to the screen pixel the cursor is on, so moving text can use them too
+	enum
+	{
+		MAX_LAYOUTS=1024,
+		NUM_LAYOUT_BUCKETS=2048,
+	};
+
+	struct CLayoutGlyph
+	{
+		CFontChar *m_pChr;
+		unsigned m_Generation;
+		float m_aUvs[4];
+		IGraphics::CQuadItem m_QuadItem;
+	};
+
+	struct CLayout
+	{
+		// everything the layout depends on
+		unsigned m_Hash;
+		CFont *m_pFont;
+		float m_FontSize;
+		float m_FakeToScreenX;
+		float m_FakeToScreenY;
+		float m_StartX; // relative to the origin
+		float m_LineWidth;
+		int m_Flags;
+		int m_MaxLines;
+		int m_LineCount;
+		int m_NextCharacter;
+		int m_Length;
+		char *m_pText;
+
+		// what it does to the cursor, relative to the origin
+		float m_EndX;
+		float m_EndY;
+		int m_EndLineCount;
+		int m_GlyphCount;
+		int m_CharCount;
+		bool m_GotNewLine;
+
+		unsigned m_AtlasGeneration;
+		CLayoutGlyph *m_pGlyphs;
+		int m_NumGlyphs;
+
+		CLayout *m_pHashNext;
+		CLayout *m_pPrev;
+		CLayout *m_pNext;
+	};
+
+	CLayout m_aLayouts[MAX_LAYOUTS];
+	CLayout *m_apLayoutBuckets[NUM_LAYOUT_BUCKETS];
+	int m_NumLayouts;
+	// least recently used first
+	CLayout *m_pFirstLayout;
+	CLayout *m_pLastLayout;
+
+	// glyphs of the layout that is being built
+	CLayoutGlyph *m_pLayoutGlyphs;
+	int m_NumLayoutGlyphs;
+	int m_LayoutGlyphCapacity;
+
+	void GetScreenScale(float *pFakeToScreenX, float *pFakeToScreenY)
+	{
+		float ScreenX0, ScreenY0, ScreenX1, ScreenY1;
+		Graphics()->GetScreen(&ScreenX0, &ScreenY0, &ScreenX1, &ScreenY1);
+		*pFakeToScreenX = (Graphics()->ScreenWidth()/(ScreenX1-ScreenX0));
+		*pFakeToScreenY = (Graphics()->ScreenHeight()/(ScreenY1-ScreenY0));
+	}
+
+	void AddLayoutGlyph(CFontChar *pChr, const IGraphics::CQuadItem &QuadItem)
+	{
+		if(m_NumLayoutGlyphs == m_LayoutGlyphCapacity)
+		{
+			int NewCapacity = max(m_LayoutGlyphCapacity*2, 64);
+			CLayoutGlyph *pNewGlyphs = (CLayoutGlyph *)mem_alloc(NewCapacity*sizeof(CLayoutGlyph), 1);
+			if(m_pLayoutGlyphs)
+			{
+				mem_copy(pNewGlyphs, m_pLayoutGlyphs, m_NumLayoutGlyphs*sizeof(CLayoutGlyph));
+				mem_free(m_pLayoutGlyphs);
+			}
+			m_pLayoutGlyphs = pNewGlyphs;
+			m_LayoutGlyphCapacity = NewCapacity;
+		}
+
+		CLayoutGlyph *pGlyph = &m_pLayoutGlyphs[m_NumLayoutGlyphs++];
+		pGlyph->m_pChr = pChr;
+		pGlyph->m_Generation = pChr->m_Generation;
+		mem_copy(pGlyph->m_aUvs, pChr->m_aUvs, sizeof(pGlyph->m_aUvs));
+		pGlyph->m_QuadItem = QuadItem;
+	}
+
+	static unsigned LayoutHash(const CTextCursor *pCursor, const char *pText, int Length)
+	{
+		unsigned Hash = 2166136261u;
+		for(int i = 0; i < Length; i++)
+			Hash = (Hash^(unsigned char)pText[i])*16777619u;
+		Hash ^= (unsigned)(pCursor->m_FontSize*64.0f);
+		Hash ^= (unsigned)(pCursor->m_LineWidth*64.0f)<<8;
+		Hash ^= pCursor->m_Flags<<24;
+		return Hash;
+	}
+
+	void UnlinkLayout(CLayout *pLayout)
+	{
+		if(pLayout->m_pPrev)
+			pLayout->m_pPrev->m_pNext = pLayout->m_pNext;
+		else
+			m_pFirstLayout = pLayout->m_pNext;
+		if(pLayout->m_pNext)
+			pLayout->m_pNext->m_pPrev = pLayout->m_pPrev;
+		else
+			m_pLastLayout = pLayout->m_pPrev;
+	}
+
+	void AppendLayout(CLayout *pLayout)
+	{
+		pLayout->m_pPrev = m_pLastLayout;
+		pLayout->m_pNext = 0;
+		if(m_pLastLayout)
+			m_pLastLayout->m_pNext = pLayout;
+		else
+			m_pFirstLayout = pLayout;
+		m_pLastLayout = pLayout;
+	}
+
+	bool LayoutGlyphsValid(const CLayout *pLayout) const
+	{
+		if(!pLayout->m_NumGlyphs)
+			return true;
+		if(pLayout->m_AtlasGeneration != m_AtlasGeneration)
+			return false;
+		for(int g = 0; g < pLayout->m_NumGlyphs; g++)
+		{
+			if(pLayout->m_pGlyphs[g].m_pChr->m_Generation != pLayout->m_pGlyphs[g].m_Generation)
+				return false;
+		}
+		return true;
+	}
+
+	CLayout *FindLayout(const CTextCursor *pCursor, CFont *pFont, float FakeToScreenX, float FakeToScreenY,
+		const char *pText, int Length, int NextCharacter, unsigned Hash)
+	{
+		for(CLayout *pLayout = m_apLayoutBuckets[Hash%NUM_LAYOUT_BUCKETS]; pLayout; pLayout = pLayout->m_pHashNext)
+		{
+			if(pLayout->m_Hash != Hash || pLayout->m_pFont != pFont || pLayout->m_FontSize != pCursor->m_FontSize ||
+				pLayout->m_FakeToScreenX != FakeToScreenX || pLayout->m_FakeToScreenY != FakeToScreenY ||
+				pLayout->m_StartX != pCursor->m_StartX || pLayout->m_LineWidth != pCursor->m_LineWidth || pLayout->m_Flags != pCursor->m_Flags ||
+				pLayout->m_MaxLines != pCursor->m_MaxLines || pLayout->m_LineCount != pCursor->m_LineCount ||
+				pLayout->m_NextCharacter != NextCharacter || pLayout->m_Length != Length ||
+				mem_comp(pLayout->m_pText, pText, Length) != 0)
+				continue;
+
+			// the glyphs moved in the atlas, lay it out again and let this one be reused first
+			if(!LayoutGlyphsValid(pLayout))
+			{
+				pLayout->m_Length = -1;
+				UnlinkLayout(pLayout);
+				pLayout->m_pPrev = 0;
+				pLayout->m_pNext = m_pFirstLayout;
+				if(m_pFirstLayout)
+					m_pFirstLayout->m_pPrev = pLayout;
+				else
+					m_pLastLayout = pLayout;
+				m_pFirstLayout = pLayout;
+				return 0;
+			}
+
+			UnlinkLayout(pLayout);
+			AppendLayout(pLayout);
+			return pLayout;
+		}
+		return 0;
+	}
+
+	CLayout *NewLayout(unsigned Hash)
+	{
+		CLayout *pLayout;
+		if(m_NumLayouts < MAX_LAYOUTS)
+			pLayout = &m_aLayouts[m_NumLayouts++];
+		else
+		{
+			// reuse the least recently used one
+			pLayout = m_pFirstLayout;
+			UnlinkLayout(pLayout);
+			CLayout **ppLayout = &m_apLayoutBuckets[pLayout->m_Hash%NUM_LAYOUT_BUCKETS];
+			while(*ppLayout != pLayout)
+				ppLayout = &(*ppLayout)->m_pHashNext;
+			*ppLayout = pLayout->m_pHashNext;
+			mem_free(pLayout->m_pText);
+		}
+
+		pLayout->m_Hash = Hash;
+		pLayout->m_pHashNext = m_apLayoutBuckets[Hash%NUM_LAYOUT_BUCKETS];
+		m_apLayoutBuckets[Hash%NUM_LAYOUT_BUCKETS] = pLayout;
+		AppendLayout(pLayout);
+		return pLayout;
+	}
+
+	void ClearLayouts()
+	{
+		for(int i = 0; i < m_NumLayouts; i++)
+			mem_free(m_aLayouts[i].m_pText);
+		m_NumLayouts = 0;
+		m_pFirstLayout = 0;
+		m_pLastLayout = 0;
+		for(int i = 0; i < NUM_LAYOUT_BUCKETS; i++)
+			m_apLayoutBuckets[i] = 0;
+	}
+
+	void RenderLayout(const CLayout *pLayout, float OriginX, float OriginY)
+	{
+		// the glyphs are used, keep them in the atlas
+		int64 Now = time_get();
+		for(int i = 0; i < pLayout->m_NumGlyphs; i++)
+			TouchGlyph(pLayout->m_pGlyphs[i].m_pChr, Now);
+		UploadAtlas();
+
+		// outline first, the text on top
+		for(int i = 0; i < 2; i++)
+		{
+			if(i == 0)
+				Graphics()->TextureSet(m_aAtlasTextures[1]);
+			else
+				Graphics()->TextureSet(m_aAtlasTextures[0]);
+
+			Graphics()->QuadsBegin();
+			if(i == 0)
+				Graphics()->SetColor(m_TextOutlineR, m_TextOutlineG, m_TextOutlineB, m_TextOutlineA*m_TextA);
+			else
+				Graphics()->SetColor(m_TextR, m_TextG, m_TextB, m_TextA);
+
+			for(int g = 0; g < pLayout->m_NumGlyphs; g++)
+			{
+				const CLayoutGlyph *pGlyph = &pLayout->m_pGlyphs[g];
+				IGraphics::CQuadItem QuadItem = pGlyph->m_QuadItem;
+				QuadItem.m_X += OriginX;
+				QuadItem.m_Y += OriginY;
+				Graphics()->QuadsSetSubset(pGlyph->m_aUvs[0], pGlyph->m_aUvs[1], pGlyph->m_aUvs[2], pGlyph->m_aUvs[3]);
+				Graphics()->QuadsDrawTL(&QuadItem, 1);
+			}
+			Graphics()->QuadsEnd();
+		}
+	}
+
+	// lays out the text without drawing it, the glyphs go to m_pLayoutGlyphs if the cursor renders.
+	// returns whether the text started a new line
+	bool LayoutText(CTextCursor *pCursor, const char *pText, int Length)
+	{
+		CFont *pFont = pCursor->m_pFont;
+		CFontSizeData *pSizeData = NULL;
+
+		float FakeToScreenX, FakeToScreenY;
+		int ActualX, ActualY;
+
+		int ActualSize;
+		int GotNewLine = 0;
+		float DrawX = 0.0f, DrawY = 0.0f;
+		int LineCount = 0;
+		float CursorX, CursorY;
+
+		float Size = pCursor->m_FontSize;
+
+		// to correct coords, convert to screen coords, round, and convert back
+		GetScreenScale(&FakeToScreenX, &FakeToScreenY);
+		ActualX = (int)floorf(pCursor->m_X * FakeToScreenX);
+		ActualY = (int)floorf(pCursor->m_Y * FakeToScreenY);
+
+		CursorX = ActualX / FakeToScreenX;
+		CursorY = ActualY / FakeToScreenY;
+
+		// same with size
+		ActualSize = (int)(Size * FakeToScreenY);
+		Size = ActualSize / FakeToScreenY;
+
+		// fetch pFont data
+		if(!pFont)
+			pFont = m_pDefaultFont;
+
+		if(!pFont)
+			return false;
+
+		pSizeData = GetSize(pFont, ActualSize);
+		RenderSetup(pFont, ActualSize);
+
+		float Scale = 1.0f/pSizeData->m_FontSize;
+
+		// set length
+		if(Length < 0)
+			Length = str_length(pText);
+
+		const char *pCurrent = (char *)pText;
+		const char *pEnd = pCurrent+Length;
+		DrawX = CursorX;
+		DrawY = CursorY;
+		LineCount = pCursor->m_LineCount;
+
+		while(pCurrent < pEnd && (pCursor->m_MaxLines < 1 || LineCount <= pCursor->m_MaxLines))
+		{
+			int NewLine = 0;
+			const char *pBatchEnd = pEnd;
+			if(pCursor->m_LineWidth > 0 && !(pCursor->m_Flags&TEXTFLAG_STOP_AT_END))
+			{
+				int Wlen = min(WordLength((char *)pCurrent), (int)(pEnd-pCurrent));
+				CTextCursor Compare = *pCursor;
+				Compare.m_X = DrawX;
+				Compare.m_Y = DrawY;
+				Compare.m_Flags &= ~TEXTFLAG_RENDER;
+				Compare.m_LineWidth = -1;
+				LayoutText(&Compare, pCurrent, Wlen);
+
+				if(Compare.m_X-DrawX > pCursor->m_LineWidth)
+				{
+					// word can't be fitted in one line, cut it
+					CTextCursor Cutter = *pCursor;
+					Cutter.m_GlyphCount = 0;
+					Cutter.m_X = DrawX;
+					Cutter.m_Y = DrawY;
+					Cutter.m_Flags &= ~TEXTFLAG_RENDER;
+					Cutter.m_Flags |= TEXTFLAG_STOP_AT_END;
+
+					LayoutText(&Cutter, (const char *)pCurrent, Wlen);
+					Wlen = Cutter.m_GlyphCount;
+					NewLine = 1;
+
+					if(Wlen <= 3) // if we can't place 3 chars of the word on this line, take the next
+						Wlen = 0;
+				}
+				else if(Compare.m_X-pCursor->m_StartX > pCursor->m_LineWidth)
+				{
+					NewLine = 1;
+					Wlen = 0;
+				}
+
+				pBatchEnd = pCurrent + Wlen;
+			}
+
+			const char *pTmp = pCurrent;
+			int NextCharacter = str_utf8_decode(&pTmp);
+			while(pCurrent < pBatchEnd)
+			{
+				pCursor->m_CharCount += pTmp-pCurrent;
+				int Character = NextCharacter;
+				pCurrent = pTmp;
+				NextCharacter = str_utf8_decode(&pTmp);
+
+				if(Character == '\n')
+				{
+					DrawX = pCursor->m_StartX;
+					DrawY += Size;
+					GotNewLine = 1;
+					DrawX = floorf(DrawX * FakeToScreenX) / FakeToScreenX; // realign
+					DrawY = floorf(DrawY * FakeToScreenY) / FakeToScreenY;
+					++LineCount;
+					if(pCursor->m_MaxLines > 0 && LineCount > pCursor->m_MaxLines)
+						break;
+					continue;
+				}
+
+				CFontChar *pChr = GetChar(pFont, pSizeData, Character);
+				if(pChr)
+				{
+					float Advance = pChr->m_AdvanceX + Kerning(pFont, Character, NextCharacter)*Scale;
+					if(pCursor->m_Flags&TEXTFLAG_STOP_AT_END && DrawX+Advance*Size-pCursor->m_StartX > pCursor->m_LineWidth)
+					{
+						// we hit the end of the line, no more to render or count
+						pCurrent = pEnd;
+						break;
+					}
+
+					if(pCursor->m_Flags&TEXTFLAG_RENDER)
+					{
+						IGraphics::CQuadItem QuadItem(DrawX+pChr->m_OffsetX*Size, DrawY+pChr->m_OffsetY*Size, pChr->m_Width*Size, pChr->m_Height*Size);
+						AddLayoutGlyph(pChr, QuadItem);
+					}
+
+					DrawX += Advance*Size;
+					pCursor->m_GlyphCount++;
+				}
+			}
+
+			if(NewLine)
+			{
+				DrawX = pCursor->m_StartX;
+				DrawY += Size;
+				GotNewLine = 1;
+				DrawX = floorf(DrawX * FakeToScreenX) / FakeToScreenX; // realign
+				DrawY = floorf(DrawY * FakeToScreenY) / FakeToScreenY;
+				++LineCount;
+			}
+		}
+
+		pCursor->m_X = DrawX;
+		pCursor->m_LineCount = LineCount;
+
+		if(GotNewLine)
+			pCursor->m_Y = DrawY;
+		return GotNewLine;
+	}
+
 
 public:
 	CTextRender()
@@ -453,14 +999,55 @@ public:
 
 		m_pDefaultFont = 0;
 
+		m_NumLayouts = 0;
+		m_pFirstLayout = 0;
+		m_pLastLayout = 0;
+		for(int i = 0; i < NUM_LAYOUT_BUCKETS; i++)
+			m_apLayoutBuckets[i] = 0;
+		m_pLayoutGlyphs = 0;
+		m_NumLayoutGlyphs = 0;
+		m_LayoutGlyphCapacity = 0;
+
+		m_AtlasSize = 0;
+		m_apAtlasData[0] = 0;
+		m_apAtlasData[1] = 0;
+		m_NumSkylineNodes = 0;
+		m_DirtyStartY = 0;
+		m_DirtyEndY = 0;
+		m_AtlasGeneration = 0;
+		for(int i = 0; i < MAX_GLYPHS; i++)
+			m_aGlyphs[i].m_Generation = 0;
+		m_NumGlyphs = 0;
+		for(int i = 0; i < NUM_GLYPH_BUCKETS; i++)
+			m_apGlyphBuckets[i] = 0;
+		m_pFirstGlyph = 0;
+		m_pLastGlyph = 0;
+		m_StatsTime = 0;
+		m_NumRasterized = 0;
+		m_NumUploads = 0;
+		m_NumUploadedBytes = 0;
+
 		// GL_LUMINANCE can be good for debugging
 		//m_FontTextureFormat = GL_ALPHA;
 	}
 
+	~CTextRender()
+	{
+		ClearLayouts();
+		if(m_pLayoutGlyphs)
+			mem_free(m_pLayoutGlyphs);
+		for(int i = 0; i < 2; i++)
+		{
+			if(m_apAtlasData[i])
+				mem_free(m_apAtlasData[i]);
+		}
+	}
+
 	virtual void Init()
 	{
 		m_pGraphics = Kernel()->RequestInterface<IGraphics>();
 		FT_Init_FreeType(&m_FTLibrary);
+		InitAtlas(MIN_ATLAS_SIZE);
 	}
 
 
@@ -482,6 +1069,7 @@ public:
 
 		dbg_msg("textrender", "loaded pFont from '%s'", pFilename);
 		m_pDefaultFont = pFont;
+		ClearLayouts();
 
 		return 0;
 	}
@@ -568,6 +1156,7 @@ public:
 		TextDeferredRenderEx(pCursor, pText, Length, aTextQuads, sizeof(aTextQuads)/sizeof(aTextQuads[0]),
 				&TextQuadCount, &FontTexture);
 
+		UploadAtlas();
 		Graphics()->TextureSet(FontTexture);
 
 		Graphics()->QuadsBegin();
@@ -602,6 +1191,26 @@ public:
 	virtual void TextDeferredRenderEx(CTextCursor *pCursor, const char *pText, int Length,
 									  CQuadChar* aQuadChar, int QuadCharMaxCount, int* pQuadCharCount,
 									  IGraphics::CTextureHandle* pFontTexture)
+	{
+		CTextCursor Cursor = *pCursor;
+		int QuadCharCount = *pQuadCharCount;
+		unsigned AtlasGeneration = m_AtlasGeneration;
+		DeferredLayout(&Cursor, pText, Length, aQuadChar, QuadCharMaxCount, pQuadCharCount);
+		if(AtlasGeneration != m_AtlasGeneration)
+		{
+			// glyphs of the text lost their place while it was laid out, now they are all there
+			Cursor = *pCursor;
+			*pQuadCharCount = QuadCharCount;
+			DeferredLayout(&Cursor, pText, Length, aQuadChar, QuadCharMaxCount, pQuadCharCount);
+		}
+		*pCursor = Cursor;
+
+		// the atlas texture changes when it starts over
+		*pFontTexture = m_aAtlasTextures[0];
+	}
+
+	void DeferredLayout(CTextCursor *pCursor, const char *pText, int Length,
+		CQuadChar *aQuadChar, int QuadCharMaxCount, int *pQuadCharCount)
 	{
 		CFont *pFont = pCursor->m_pFont;
 		CFontSizeData *pSizeData = NULL;
@@ -642,7 +1251,6 @@ public:
 
 		pSizeData = GetSize(pFont, ActualSize);
 		RenderSetup(pFont, ActualSize);
-		*pFontTexture = pSizeData->m_aTextures[0];
 
 		float Scale = 1.0f/pSizeData->m_FontSize;
 
@@ -669,8 +1277,7 @@ public:
 				Compare.m_Y = DrawY;
 				Compare.m_Flags &= ~TEXTFLAG_RENDER;
 				Compare.m_LineWidth = -1;
-				TextDeferredRenderEx(&Compare, pCurrent, Wlen, aQuadChar, QuadCharMaxCount, pQuadCharCount,
-									 pFontTexture);
+				DeferredLayout(&Compare, pCurrent, Wlen, aQuadChar, QuadCharMaxCount, pQuadCharCount);
 
 				if(Compare.m_X-DrawX > pCursor->m_LineWidth)
 				{
@@ -682,8 +1289,7 @@ public:
 					Cutter.m_Flags &= ~TEXTFLAG_RENDER;
 					Cutter.m_Flags |= TEXTFLAG_STOP_AT_END;
 
-					TextDeferredRenderEx(&Cutter, (const char *)pCurrent, Wlen, aQuadChar, QuadCharMaxCount,
-										 pQuadCharCount, pFontTexture);
+					DeferredLayout(&Cutter, (const char *)pCurrent, Wlen, aQuadChar, QuadCharMaxCount, pQuadCharCount);
 					Wlen = Cutter.m_GlyphCount;
 					NewLine = 1;
 
@@ -772,187 +1378,94 @@ public:
 	virtual void TextEx(CTextCursor *pCursor, const char *pText, int Length)
 	{
 		CFont *pFont = pCursor->m_pFont;
-		CFontSizeData *pSizeData = NULL;
-
-		//dbg_msg("textrender", "rendering text '%s'", text);
-
-		float ScreenX0, ScreenY0, ScreenX1, ScreenY1;
-		float FakeToScreenX, FakeToScreenY;
-		int ActualX, ActualY;
-
-		int ActualSize;
-		int i;
-		int GotNewLine = 0;
-		float DrawX = 0.0f, DrawY = 0.0f;
-		int LineCount = 0;
-		float CursorX, CursorY;
-
-		float Size = pCursor->m_FontSize;
-
-		// to correct coords, convert to screen coords, round, and convert back
-		Graphics()->GetScreen(&ScreenX0, &ScreenY0, &ScreenX1, &ScreenY1);
-
-		FakeToScreenX = (Graphics()->ScreenWidth()/(ScreenX1-ScreenX0));
-		FakeToScreenY = (Graphics()->ScreenHeight()/(ScreenY1-ScreenY0));
-		ActualX = (int)(pCursor->m_X * FakeToScreenX);
-		ActualY = (int)(pCursor->m_Y * FakeToScreenY);
-
-		CursorX = ActualX / FakeToScreenX;
-		CursorY = ActualY / FakeToScreenY;
-
-		// same with size
-		ActualSize = (int)(Size * FakeToScreenY);
-		Size = ActualSize / FakeToScreenY;
-
-		// fetch pFont data
 		if(!pFont)
 			pFont = m_pDefaultFont;
-
 		if(!pFont)
 			return;
 
-		pSizeData = GetSize(pFont, ActualSize);
-		RenderSetup(pFont, ActualSize);
-
-		float Scale = 1.0f/pSizeData->m_FontSize;
-
-		// set length
 		if(Length < 0)
 			Length = str_length(pText);
 
-		// if we don't want to render, we can just skip the first outline pass
-		i = 1;
-		if(pCursor->m_Flags&TEXTFLAG_RENDER)
-			i = 0;
-
-		for(;i < 2; i++)
+		float FakeToScreenX, FakeToScreenY;
+		GetScreenScale(&FakeToScreenX, &FakeToScreenY);
+
+		// the last glyph is kerned against the character after the text
+		const char *pNext = pText+Length;
+		int NextCharacter = str_utf8_decode(&pNext);
+
+		// lay out from the screen pixel the cursor is on. the glyphs start there anyway, only where
+		// lines start and end depends on the position within the pixel
+		float OriginX = (int)(pCursor->m_X*FakeToScreenX)/FakeToScreenX;
+		float OriginY = (int)(pCursor->m_Y*FakeToScreenY)/FakeToScreenY;
+		CTextCursor Relative = *pCursor;
+		Relative.m_X = 0.0f;
+		Relative.m_Y = 0.0f;
+		Relative.m_StartX = pCursor->m_StartX-OriginX;
+		Relative.m_GlyphCount = 0;
+		Relative.m_CharCount = 0;
+		if(Relative.m_LineWidth <= 0 && !(Relative.m_Flags&TEXTFLAG_STOP_AT_END))
 		{
-			const char *pCurrent = (char *)pText;
-			const char *pEnd = pCurrent+Length;
-			DrawX = CursorX;
-			DrawY = CursorY;
-			LineCount = pCursor->m_LineCount;
-
-			if(pCursor->m_Flags&TEXTFLAG_RENDER)
-			{
-				// TODO: Make this better
-				if (i == 0)
-					Graphics()->TextureSet(pSizeData->m_aTextures[1]);
-				else
-					Graphics()->TextureSet(pSizeData->m_aTextures[0]);
-
-				Graphics()->QuadsBegin();
-				if (i == 0)
-					Graphics()->SetColor(m_TextOutlineR, m_TextOutlineG, m_TextOutlineB, m_TextOutlineA*m_TextA);
-				else
-					Graphics()->SetColor(m_TextR, m_TextG, m_TextB, m_TextA);
-			}
+			// without a line width only the pixel of the line start matters, make it the same for all
+			// positions within it
+			Relative.m_StartX = (floorf(Relative.m_StartX*FakeToScreenX)+0.5f)/FakeToScreenX;
+		}
 
-			while(pCurrent < pEnd && (pCursor->m_MaxLines < 1 || LineCount <= pCursor->m_MaxLines))
+		unsigned Hash = LayoutHash(pCursor, pText, Length);
+		CLayout *pLayout = FindLayout(&Relative, pFont, FakeToScreenX, FakeToScreenY, pText, Length, NextCharacter, Hash);
+		if(!pLayout)
+		{
+			CTextCursor Cursor = Relative;
+			unsigned AtlasGeneration = m_AtlasGeneration;
+			m_NumLayoutGlyphs = 0;
+			bool GotNewLine = LayoutText(&Cursor, pText, Length);
+			if(AtlasGeneration != m_AtlasGeneration)
 			{
-				int NewLine = 0;
-				const char *pBatchEnd = pEnd;
-				if(pCursor->m_LineWidth > 0 && !(pCursor->m_Flags&TEXTFLAG_STOP_AT_END))
-				{
-					int Wlen = min(WordLength((char *)pCurrent), (int)(pEnd-pCurrent));
-					CTextCursor Compare = *pCursor;
-					Compare.m_X = DrawX;
-					Compare.m_Y = DrawY;
-					Compare.m_Flags &= ~TEXTFLAG_RENDER;
-					Compare.m_LineWidth = -1;
-					TextEx(&Compare, pCurrent, Wlen);
-
-					if(Compare.m_X-DrawX > pCursor->m_LineWidth)
-					{
-						// word can't be fitted in one line, cut it
-						CTextCursor Cutter = *pCursor;
-						Cutter.m_GlyphCount = 0;
-						Cutter.m_X = DrawX;
-						Cutter.m_Y = DrawY;
-						Cutter.m_Flags &= ~TEXTFLAG_RENDER;
-						Cutter.m_Flags |= TEXTFLAG_STOP_AT_END;
-
-						TextEx(&Cutter, (const char *)pCurrent, Wlen);
-						Wlen = Cutter.m_GlyphCount;
-						NewLine = 1;
-
-						if(Wlen <= 3) // if we can't place 3 chars of the word on this line, take the next
-							Wlen = 0;
-					}
-					else if(Compare.m_X-pCursor->m_StartX > pCursor->m_LineWidth)
-					{
-						NewLine = 1;
-						Wlen = 0;
-					}
-
-					pBatchEnd = pCurrent + Wlen;
-				}
-
-				const char *pTmp = pCurrent;
-				int NextCharacter = str_utf8_decode(&pTmp);
-				while(pCurrent < pBatchEnd)
-				{
-					pCursor->m_CharCount += pTmp-pCurrent;
-					int Character = NextCharacter;
-					pCurrent = pTmp;
-					NextCharacter = str_utf8_decode(&pTmp);
-
-					if(Character == '\n')
-					{
-						DrawX = pCursor->m_StartX;
-						DrawY += Size;
-						GotNewLine = 1;
-						DrawX = (int)(DrawX * FakeToScreenX) / FakeToScreenX; // realign
-						DrawY = (int)(DrawY * FakeToScreenY) / FakeToScreenY;
-						++LineCount;
-						if(pCursor->m_MaxLines > 0 && LineCount > pCursor->m_MaxLines)
-							break;
-						continue;
-					}
-
-					CFontChar *pChr = GetChar(pFont, pSizeData, Character);
-					if(pChr)
-					{
-						float Advance = pChr->m_AdvanceX + Kerning(pFont, Character, NextCharacter)*Scale;
-						if(pCursor->m_Flags&TEXTFLAG_STOP_AT_END && DrawX+Advance*Size-pCursor->m_StartX > pCursor->m_LineWidth)
-						{
-							// we hit the end of the line, no more to render or count
-							pCurrent = pEnd;
-							break;
-						}
-
-						if(pCursor->m_Flags&TEXTFLAG_RENDER)
-						{
-							Graphics()->QuadsSetSubset(pChr->m_aUvs[0], pChr->m_aUvs[1], pChr->m_aUvs[2], pChr->m_aUvs[3]);
-							IGraphics::CQuadItem QuadItem(DrawX+pChr->m_OffsetX*Size, DrawY+pChr->m_OffsetY*Size, pChr->m_Width*Size, pChr->m_Height*Size);
-							Graphics()->QuadsDrawTL(&QuadItem, 1);
-						}
-
-						DrawX += Advance*Size;
-						pCursor->m_GlyphCount++;
-					}
-				}
-
-				if(NewLine)
-				{
-					DrawX = pCursor->m_StartX;
-					DrawY += Size;
-					GotNewLine = 1;
-					DrawX = (int)(DrawX * FakeToScreenX) / FakeToScreenX; // realign
-					DrawY = (int)(DrawY * FakeToScreenY) / FakeToScreenY;
-					++LineCount;
-				}
+				// glyphs of the text lost their place while it was laid out, now they are all there
+				Cursor = Relative;
+				AtlasGeneration = m_AtlasGeneration;
+				m_NumLayoutGlyphs = 0;
+				GotNewLine = LayoutText(&Cursor, pText, Length);
 			}
 
-			if(pCursor->m_Flags&TEXTFLAG_RENDER)
-				Graphics()->QuadsEnd();
+			pLayout = NewLayout(Hash);
+			pLayout->m_pFont = pFont;
+			pLayout->m_FontSize = pCursor->m_FontSize;
+			pLayout->m_FakeToScreenX = FakeToScreenX;
+			pLayout->m_FakeToScreenY = FakeToScreenY;
+			pLayout->m_StartX = Relative.m_StartX;
+			pLayout->m_LineWidth = pCursor->m_LineWidth;
+			pLayout->m_Flags = pCursor->m_Flags;
+			pLayout->m_MaxLines = pCursor->m_MaxLines;
+			pLayout->m_LineCount = pCursor->m_LineCount;
+			pLayout->m_NextCharacter = NextCharacter;
+			pLayout->m_Length = Length;
+
+			pLayout->m_EndX = Cursor.m_X;
+			pLayout->m_EndY = Cursor.m_Y;
+			pLayout->m_EndLineCount = Cursor.m_LineCount;
+			pLayout->m_GlyphCount = Cursor.m_GlyphCount;
+			pLayout->m_CharCount = Cursor.m_CharCount;
+			pLayout->m_GotNewLine = GotNewLine;
+			pLayout->m_AtlasGeneration = AtlasGeneration;
+			pLayout->m_NumGlyphs = m_NumLayoutGlyphs;
+
+			// text and glyphs share one allocation
+			int GlyphOffset = (Length+7)&~7;
+			pLayout->m_pText = (char *)mem_alloc(GlyphOffset+m_NumLayoutGlyphs*sizeof(CLayoutGlyph), sizeof(void *));
+			pLayout->m_pGlyphs = (CLayoutGlyph *)(pLayout->m_pText+GlyphOffset);
+			mem_copy(pLayout->m_pText, pText, Length);
+			mem_copy(pLayout->m_pGlyphs, m_pLayoutGlyphs, m_NumLayoutGlyphs*sizeof(CLayoutGlyph));
 		}
 
-		pCursor->m_X = DrawX;
-		pCursor->m_LineCount = LineCount;
+		pCursor->m_X = OriginX+pLayout->m_EndX;
+		pCursor->m_LineCount = pLayout->m_EndLineCount;
+		pCursor->m_GlyphCount += pLayout->m_GlyphCount;
+		pCursor->m_CharCount += pLayout->m_CharCount;
+		if(pLayout->m_GotNewLine)
+			pCursor->m_Y = OriginY+pLayout->m_EndY;
 
-		if(GotNewLine)
-			pCursor->m_Y = DrawY;
+		if(pCursor->m_Flags&TEXTFLAG_RENDER)
+			RenderLayout(pLayout, OriginX, OriginY);
 	}
 
 	float TextGetLineBaseY(const CTextCursor *pCursor)
@@ -26,7 +26,9 @@ public:
 	virtual void Init() = 0;
 	virtual void InitLogfile() = 0;
 	virtual void HostLookup(CHostLookup *pLookup, const char *pHostname, int Nettype) = 0;
-	virtual void AddJob(CJob *pJob, JOBFUNC pfnFunc, void *pData) = 0;
+	virtual void AddJob(CJob *pJob, JOBFUNC pfnFunc, void *pData, CJobGroup *pGroup = 0) = 0;
+	virtual void AddDependentJob(CJob *pJob, JOBFUNC pfnFunc, void *pData, CJob **apDependencies, int NumDependencies, CJobGroup *pGroup = 0) = 0;
+	virtual void WaitForJobs(CJobGroup *pGroup) = 0;
 };
 
 extern IEngine *CreateEngine(const char *pAppname);
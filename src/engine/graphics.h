@@ -128,6 +128,28 @@ public:
 	virtual void TextureSet(CTextureHandle Texture) = 0;
 	void TextureClear() { TextureSet(CTextureHandle()); }
 
+	class CQuadBufferHandle
+	{
+		friend class IGraphics;
+		int m_Id;
+	public:
+		CQuadBufferHandle()
+		: m_Id(-1)
+		{}
+
+		bool IsValid() const { return Id() >= 0; }
+		int Id() const { return m_Id; }
+		void Invalidate() { m_Id = -1; }
+	};
+
+	// quads that do not change. they are recorded once with the quad functions between
+	// QuadBufferBegin and QuadBufferEnd and kept by the backend, without their colors.
+	// QuadBufferRender draws a range of them with the current texture and blend mode in one color
+	virtual void QuadBufferBegin() = 0;
+	virtual CQuadBufferHandle QuadBufferEnd() = 0;
+	virtual void QuadBufferDestroy(CQuadBufferHandle *pHandle) = 0;
+	virtual void QuadBufferRender(CQuadBufferHandle Handle, int Offset, int Num, float r, float g, float b, float a) = 0;
+
 	struct CLineItem
 	{
 		float m_X0, m_Y0, m_X1, m_Y1;
@@ -194,6 +216,13 @@ protected:
 		Tex.m_Id = Index;
 		return Tex;
 	}
+
+	inline CQuadBufferHandle CreateQuadBufferHandle(int Index)
+	{
+		CQuadBufferHandle Buffer;
+		Buffer.m_Id = Index;
+		return Buffer;
+	}
 };
 
 class IEngineGraphics : public IGraphics
@@ -25,6 +25,7 @@
 #include <engine/shared/protocol.h>
 #include <engine/shared/protocol_ex.h>
 #include <engine/shared/snapshot.h>
+#include <engine/shared/snapshot_model.h>
 #include <engine/shared/fifo.h>
 
 #include <mastersrv/mastersrv.h>
@@ -209,9 +210,8 @@ int CServerBan::BanExt(T *pBanPool, const typename T::CDataType *pData, int Seco
 
 		if(NetMatch(&Data, Server()->m_NetServer.ClientAddr(i)))
 		{
-			CNetHash NetHash(&Data);
 			char aBuf[256];
-			MakeBanInfo(pBanPool->Find(&Data, &NetHash), aBuf, sizeof(aBuf), MSGTYPE_PLAYER);
+			MakeBanInfo(pBanPool->Find(&Data), aBuf, sizeof(aBuf), MSGTYPE_PLAYER);
 			Server()->m_NetServer.Drop(i, aBuf);
 		}
 	}
@@ -268,6 +268,7 @@ void CServer::CClient::Reset()
 	m_SnapRate = CClient::SNAPRATE_INIT;
 	m_Score = 0;
 	m_MapChunk = 0;
+	m_UseSnapshotModel = false;
 }
 
 CServer::CServer() : m_DemoRecorder(&m_SnapshotDelta)
@@ -296,6 +297,8 @@ CServer::CServer() : m_DemoRecorder(&m_SnapshotDelta)
 	m_RconPasswordSet = 0;
 	m_GeneratedRconPassword = 0;
 
+	m_ServerInfoValid = false;
+
 	Init();
 }
 
@@ -353,6 +356,7 @@ void CServer::SetClientName(int ClientID, const char *pName)
 				break;
 		}
 	}
+	ExpireServerInfo();
 }
 
 void CServer::SetClientClan(int ClientID, const char *pClan)
@@ -361,6 +365,7 @@ void CServer::SetClientClan(int ClientID, const char *pClan)
 		return;
 
 	str_copy(m_aClients[ClientID].m_aClan, pClan, MAX_CLAN_LENGTH);
+	ExpireServerInfo();
 }
 
 void CServer::SetClientCountry(int ClientID, int Country)
@@ -369,13 +374,25 @@ void CServer::SetClientCountry(int ClientID, int Country)
 		return;
 
 	m_aClients[ClientID].m_Country = Country;
+	ExpireServerInfo();
 }
 
 void CServer::SetClientScore(int ClientID, int Score)
 {
 	if(ClientID < 0 || ClientID >= MAX_CLIENTS || m_aClients[ClientID].m_State < CClient::STATE_READY)
 		return;
-	m_aClients[ClientID].m_Score = Score;
+
+	// the game sets it every tick
+	if(m_aClients[ClientID].m_Score != Score)
+	{
+		m_aClients[ClientID].m_Score = Score;
+		ExpireServerInfo();
+	}
+}
+
+void CServer::ExpireServerInfo()
+{
+	m_ServerInfoValid = false;
 }
 
 void CServer::Kick(int ClientID, const char *pReason)
@@ -680,6 +697,18 @@ void CServer::DoSnapshot()
 				int NumPackets;
 
 				SnapshotSize = CVariableInt::Compress(aDeltaData, DeltaSize, aCompData, sizeof(aCompData));
+				if(m_aClients[i].m_UseSnapshotModel)
+				{
+					// second pass with the negotiated model, the client reassembles at most MAX_PARTS packets
+					char aModelData[CSnapshot::MAX_PARTS*MAX_SNAPSHOT_PACKSIZE];
+					SnapshotSize = m_SnapshotModel.Compress(aCompData, SnapshotSize, aModelData, sizeof(aModelData));
+					if(SnapshotSize < 0)
+					{
+						Console()->Print(IConsole::OUTPUT_LEVEL_DEBUG, "server", "snapshot does not fit with the snapshot model");
+						continue;
+					}
+					mem_copy(aCompData, aModelData, SnapshotSize);
+				}
 				NumPackets = (SnapshotSize+MaxSize-1)/MaxSize;
 
 				for(int n = 0, Left = SnapshotSize; Left > 0; n++)
@@ -739,6 +768,7 @@ int CServer::NewClientCallback(int ClientID, void *pUser)
 	pThis->m_aClients[ClientID].m_NoRconNote = false;
 	pThis->m_aClients[ClientID].m_Quitting = false;
 	pThis->m_aClients[ClientID].Reset();
+	pThis->ExpireServerInfo();
 	pThis->GameServer()->OnClientEngineJoin(ClientID);
 	return 0;
 }
@@ -771,6 +801,7 @@ int CServer::DelClientCallback(int ClientID, const char *pReason, void *pUser)
 	pThis->m_aClients[ClientID].m_NoRconNote = false;
 	pThis->m_aClients[ClientID].m_Quitting = false;
 	pThis->m_aClients[ClientID].m_Snapshots.PurgeAll();
+	pThis->ExpireServerInfo();
 
 	pThis->GameServer()->OnClientEngineDrop(ClientID, pReason);
 
@@ -977,6 +1008,21 @@ void CServer::ProcessClientPacket(CNetChunk *pPacket)
 				}
 			}
 		}
+		else if(Msg == NETMSG_SNAPSHOTMODEL_SUPPORT)
+		{
+			// sent right before NETMSG_READY, so the model arrives ahead of the first snapshot
+			if((pPacket->m_Flags&NET_CHUNKFLAG_VITAL) != 0 && (m_aClients[ClientID].m_State == CClient::STATE_CONNECTING || m_aClients[ClientID].m_State == CClient::STATE_CONNECTING_AS_SPEC))
+			{
+				int Version = Unpacker.GetInt();
+				if(!Unpacker.Error() && Version == CSnapshotModel::VERSION && m_SnapshotModel.IsValid() && !m_aClients[ClientID].m_UseSnapshotModel)
+				{
+					CMsgPacker Msg(NETMSG_SNAPSHOTMODEL, true);
+					m_SnapshotModel.Pack(&Msg);
+					SendMsg(&Msg, MSGFLAG_VITAL, ClientID);
+					m_aClients[ClientID].m_UseSnapshotModel = true;
+				}
+			}
+		}
 		else if(Msg == NETMSG_READY)
 		{
 			if((pPacket->m_Flags&NET_CHUNKFLAG_VITAL) != 0 && (m_aClients[ClientID].m_State == CClient::STATE_CONNECTING || m_aClients[ClientID].m_State == CClient::STATE_CONNECTING_AS_SPEC))
@@ -1005,6 +1051,7 @@ void CServer::ProcessClientPacket(CNetChunk *pPacket)
 				str_format(aBuf, sizeof(aBuf), "player has entered the game. ClientID=%d addr=%s", ClientID, aAddrStr);
 				Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "server", aBuf);
 				m_aClients[ClientID].m_State = CClient::STATE_INGAME;
+				ExpireServerInfo();
 				SendServerInfo(ClientID);
 				GameServer()->OnClientEnter(ClientID);
 			}
@@ -1188,6 +1235,27 @@ void CServer::ProcessClientPacket(CNetChunk *pPacket)
 }
 
 void CServer::GenerateServerInfo(CPacker *pPacker, int Token)
+{
+	// the browser asks a lot more often than anything in the info changes
+	if(Token != -1)
+	{
+		if(!m_ServerInfoValid)
+		{
+			m_ServerInfoCache.Reset();
+			PackServerInfo(&m_ServerInfoCache, true);
+			m_ServerInfoValid = true;
+		}
+
+		pPacker->Reset();
+		pPacker->AddRaw(SERVERBROWSE_INFO, sizeof(SERVERBROWSE_INFO));
+		pPacker->AddInt(Token);
+		pPacker->AddRaw(m_ServerInfoCache.Data(), m_ServerInfoCache.Size());
+	}
+	else
+		PackServerInfo(pPacker, false);
+}
+
+void CServer::PackServerInfo(CPacker *pPacker, bool SendClients)
 {
 	// count the players
 	int PlayerCount = 0, ClientCount = 0;
@@ -1202,13 +1270,6 @@ void CServer::GenerateServerInfo(CPacker *pPacker, int Token)
 		}
 	}
 
-	if(Token != -1)
-	{
-		pPacker->Reset();
-		pPacker->AddRaw(SERVERBROWSE_INFO, sizeof(SERVERBROWSE_INFO));
-		pPacker->AddInt(Token);
-	}
-
 	pPacker->AddString(GameServer()->Version(), 32);
 	pPacker->AddString(g_Config.m_SvName, 64);
 	pPacker->AddString(g_Config.m_SvHostname, 128);
@@ -1227,7 +1288,7 @@ void CServer::GenerateServerInfo(CPacker *pPacker, int Token)
 	pPacker->AddInt(ClientCount); // num clients
 	pPacker->AddInt(m_NetServer.MaxClients()); // max clients
 
-	if(Token != -1)
+	if(SendClients)
 	{
 		for(int i = 0; i < MAX_CLIENTS; i++)
 		{
@@ -1335,6 +1396,15 @@ int CServer::LoadMap(const char *pMapName)
 	// stop recording when we change map
 	m_DemoRecorder.Stop();
 
+	// pick up a changed snapshot model, all clients negotiate it again
+	m_SnapshotModel.Reset();
+	if(g_Config.m_SvSnapshotModel[0] && !m_SnapshotModel.Load(Storage(), g_Config.m_SvSnapshotModel, IStorage::TYPE_ALL))
+	{
+		char aBufMsg[256];
+		str_format(aBufMsg, sizeof(aBufMsg), "failed to load snapshot model '%s'", g_Config.m_SvSnapshotModel);
+		Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "server", aBufMsg);
+	}
+
 	// reinit snapshot ids
 	m_IDPool.TimeoutIDs();
 
@@ -1416,6 +1486,7 @@ int CServer::Run()
 	}
 
 	m_NetServer.SetCallbacks(NewClientCallback, DelClientCallback, this);
+	m_NetServer.SetFloodLimits(g_Config.m_SvFloodRate, g_Config.m_SvFloodBurst, g_Config.m_SvFloodSubnetRate, g_Config.m_SvFloodSubnetBurst);
 
 	m_Econ.Init(Console(), &m_ServerBan);
 
@@ -1428,6 +1499,7 @@ int CServer::Run()
 	Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "server", aBuf);
 
 	GameServer()->OnInit();
+	ExpireServerInfo();
 	str_format(aBuf, sizeof(aBuf), "version %s", GameServer()->NetVersion());
 	Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "server", aBuf);
 
@@ -1490,6 +1562,7 @@ int CServer::Run()
 					Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "server", aBuf);
 					str_copy(g_Config.m_SvMap, m_aCurrentMap, sizeof(g_Config.m_SvMap));
 				}
+				ExpireServerInfo();
 			}
 
 			while(t > TickStartTime(m_CurrentGameTick+1))
@@ -1668,6 +1741,17 @@ void CServer::ConStatus(IConsole::IResult *pResult, void *pUser)
 	}
 }
 
+void CServer::ConFloodStats(IConsole::IResult *pResult, void *pUser)
+{
+	CServer *pThis = static_cast<CServer *>(pUser);
+	const CNetFloodStats *pStats = pThis->m_NetServer.FloodStats();
+
+	char aBuf[256];
+	str_format(aBuf, sizeof(aBuf), "received=%lld dropped: rate_limited=%lld subnet_rate_limited=%lld banned=%lld invalid_token=%lld",
+		pStats->m_Received, pStats->m_RateLimited, pStats->m_SubnetRateLimited, pStats->m_Banned, pStats->m_InvalidToken);
+	pThis->Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "server", aBuf);
+}
+
 void CServer::ConShutdown(IConsole::IResult *pResult, void *pUser)
 {
 	((CServer *)pUser)->m_RunServer = 0;
@@ -1750,10 +1834,18 @@ void CServer::ConchainSpecialInfoupdate(IConsole::IResult *pResult, void *pUserD
 	if(pResult->NumArguments())
 	{
 		str_clean_whitespaces(g_Config.m_SvName);
+		((CServer *)pUserData)->ExpireServerInfo();
 		((CServer *)pUserData)->SendServerInfo(-1);
 	}
 }
 
+void CServer::ConchainServerInfoUpdate(IConsole::IResult *pResult, void *pUserData, IConsole::FCommandCallback pfnCallback, void *pCallbackUserData)
+{
+	pfnCallback(pResult, pCallbackUserData);
+	if(pResult->NumArguments())
+		((CServer *)pUserData)->ExpireServerInfo();
+}
+
 void CServer::ConchainMaxclientsperipUpdate(IConsole::IResult *pResult, void *pUserData, IConsole::FCommandCallback pfnCallback, void *pCallbackUserData)
 {
 	pfnCallback(pResult, pCallbackUserData);
@@ -1761,6 +1853,13 @@ void CServer::ConchainMaxclientsperipUpdate(IConsole::IResult *pResult, void *pU
 		((CServer *)pUserData)->m_NetServer.SetMaxClientsPerIP(pResult->GetInteger(0));
 }
 
+void CServer::ConchainFloodLimitsUpdate(IConsole::IResult *pResult, void *pUserData, IConsole::FCommandCallback pfnCallback, void *pCallbackUserData)
+{
+	pfnCallback(pResult, pCallbackUserData);
+	if(pResult->NumArguments())
+		((CServer *)pUserData)->m_NetServer.SetFloodLimits(g_Config.m_SvFloodRate, g_Config.m_SvFloodBurst, g_Config.m_SvFloodSubnetRate, g_Config.m_SvFloodSubnetBurst);
+}
+
 void CServer::ConchainModCommandUpdate(IConsole::IResult *pResult, void *pUserData, IConsole::FCommandCallback pfnCallback, void *pCallbackUserData)
 {
 	if(pResult->NumArguments() == 2)
@@ -1819,6 +1918,7 @@ void CServer::RegisterCommands()
 	// register console commands
 	Console()->Register("kick", "i?r", CFGFLAG_SERVER, ConKick, this, "Kick player with specified id for any reason");
 	Console()->Register("status", "", CFGFLAG_SERVER, ConStatus, this, "List players");
+	Console()->Register("flood_stats", "", CFGFLAG_SERVER, ConFloodStats, this, "Show the number of dropped connectionless and control packets");
 	Console()->Register("shutdown", "", CFGFLAG_SERVER, ConShutdown, this, "Shut down");
 	Console()->Register("logout", "", CFGFLAG_SERVER, ConLogout, this, "Logout of rcon");
 
@@ -1829,8 +1929,15 @@ void CServer::RegisterCommands()
 
 	Console()->Chain("sv_name", ConchainSpecialInfoupdate, this);
 	Console()->Chain("password", ConchainSpecialInfoupdate, this);
+	Console()->Chain("sv_hostname", ConchainServerInfoUpdate, this);
+	Console()->Chain("sv_skill_level", ConchainServerInfoUpdate, this);
+	Console()->Chain("sv_player_slots", ConchainServerInfoUpdate, this);
 
 	Console()->Chain("sv_max_clients_per_ip", ConchainMaxclientsperipUpdate, this);
+	Console()->Chain("sv_flood_rate", ConchainFloodLimitsUpdate, this);
+	Console()->Chain("sv_flood_burst", ConchainFloodLimitsUpdate, this);
+	Console()->Chain("sv_flood_subnet_rate", ConchainFloodLimitsUpdate, this);
+	Console()->Chain("sv_flood_subnet_burst", ConchainFloodLimitsUpdate, this);
 	Console()->Chain("mod_command", ConchainModCommandUpdate, this);
 	Console()->Chain("console_output_level", ConchainConsoleOutputLevelUpdate, this);
 	Console()->Chain("sv_rcon_password", ConchainRconPasswordSet, this);
@@ -4,6 +4,25 @@
 
 #include "compression.h"
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+	#define VARINT_SSE2 1
+	#include <emmintrin.h>
+	#if defined(_MSC_VER)
+		#include <intrin.h>
+	#endif
+
+static inline int CountTrailingZeros(unsigned Mask)
+{
+#if defined(_MSC_VER)
+	unsigned long Index;
+	_BitScanForward(&Index, Mask);
+	return (int)Index;
+#else
+	return __builtin_ctz(Mask);
+#endif
+}
+#endif
+
 // Format: ESDDDDDD EDDDDDDD EDD... Extended, Data, Sign
 unsigned char *CVariableInt::Pack(unsigned char *pDst, int i)
 {
@@ -66,6 +85,44 @@ long CVariableInt::Decompress(const void *pSrc_, int SrcSize, void *pDst_, int D
 	const unsigned char *pEnd = pSrc + SrcSize;
 	int *pDst = (int *)pDst_;
 	int *pDstEnd = pDst + DstSize/4;
+
+#if defined(VARINT_SSE2)
+	// most ints of a delta fit into a single byte. look at 16 bytes at once, unpack the
+	// single byte ints in front of the first extended one together and that one on its own
+	const __m128i DataMask = _mm_set1_epi8(0x3F);
+	const __m128i SignBit = _mm_set1_epi8(0x40);
+	while(pEnd - pSrc >= 16 && pDstEnd - pDst >= 16)
+	{
+		__m128i Block = _mm_loadu_si128((const __m128i *)pSrc);
+		int Extended = _mm_movemask_epi8(Block);
+		int NumSingle = Extended ? CountTrailingZeros(Extended) : 16;
+
+		if(NumSingle)
+		{
+			// data ^ -sign as signed bytes, widened to ints
+			__m128i Sign = _mm_cmpeq_epi8(_mm_and_si128(Block, SignBit), SignBit);
+			__m128i Bytes = _mm_xor_si128(_mm_and_si128(Block, DataMask), Sign);
+			__m128i Low = _mm_srai_epi16(_mm_unpacklo_epi8(Bytes, Bytes), 8);
+			__m128i High = _mm_srai_epi16(_mm_unpackhi_epi8(Bytes, Bytes), 8);
+			_mm_storeu_si128((__m128i *)pDst, _mm_srai_epi32(_mm_unpacklo_epi16(Low, Low), 16));
+			_mm_storeu_si128((__m128i *)pDst+1, _mm_srai_epi32(_mm_unpackhi_epi16(Low, Low), 16));
+			_mm_storeu_si128((__m128i *)pDst+2, _mm_srai_epi32(_mm_unpacklo_epi16(High, High), 16));
+			_mm_storeu_si128((__m128i *)pDst+3, _mm_srai_epi32(_mm_unpackhi_epi16(High, High), 16));
+			pSrc += NumSingle;
+			pDst += NumSingle;
+		}
+
+		if(NumSingle < 16)
+		{
+			// an int takes at most 5 bytes
+			if(pEnd - pSrc < 5)
+				break;
+			pSrc = CVariableInt::Unpack(pSrc, pDst);
+			pDst++;
+		}
+	}
+#endif
+
 	while(pSrc < pEnd)
 	{
 		if(pDst >= pDstEnd)
@@ -82,6 +139,43 @@ long CVariableInt::Compress(const void *pSrc_, int SrcSize, void *pDst_, int Dst
 	unsigned char *pDst = (unsigned char *)pDst_;
 	unsigned char *pDstEnd = pDst + DstSize;
 	SrcSize /= 4;
+
+#if defined(VARINT_SSE2)
+	// same as the decoder: pack the single byte ints in front of the first larger one
+	// together and that one on its own. the room check matches the one done per int below
+	const __m128i Max = _mm_set1_epi32(0x3F);
+	const __m128i SignBit = _mm_set1_epi32(0x40);
+	while(SrcSize >= 16 && pDstEnd - pDst >= 16+5)
+	{
+		__m128i aBytes[4];
+		int Large = 0;
+		for(int i = 0; i < 4; i++)
+		{
+			__m128i Value = _mm_loadu_si128((const __m128i *)pSrc+i);
+			__m128i Sign = _mm_srai_epi32(Value, 31);
+			Value = _mm_xor_si128(Value, Sign); // if(i<0) i = ~i
+			Large |= _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpgt_epi32(Value, Max))) << (i*4);
+			aBytes[i] = _mm_or_si128(Value, _mm_and_si128(Sign, SignBit));
+		}
+		int NumSingle = Large ? CountTrailingZeros(Large) : 16;
+
+		if(NumSingle)
+		{
+			_mm_storeu_si128((__m128i *)pDst, _mm_packus_epi16(_mm_packs_epi32(aBytes[0], aBytes[1]), _mm_packs_epi32(aBytes[2], aBytes[3])));
+			pDst += NumSingle;
+			pSrc += NumSingle;
+			SrcSize -= NumSingle;
+		}
+
+		if(NumSingle < 16)
+		{
+			pDst = CVariableInt::Pack(pDst, *pSrc);
+			pSrc++;
+			SrcSize--;
+		}
+	}
+#endif
+
 	while(SrcSize)
 	{
 		if(pDstEnd - pDst < 6)
@@ -92,4 +186,3 @@ long CVariableInt::Compress(const void *pSrc_, int SrcSize, void *pDst_, int Dst
 	}
 	return (long)(pDst-(unsigned char *)pDst_);
 }
-
@@ -483,7 +483,7 @@ void CConsole::PossibleMaps(const char *pStr, FPossibleCallback pfnCallback, voi
 
 CConsole::CCommand *CConsole::FindCommand(const char *pName, int FlagMask)
 {
-	for(CCommand *pCommand = m_pFirstCommand; pCommand; pCommand = pCommand->m_pNext)
+	for(CCommand *pCommand = m_apCommandBuckets[str_quickhash_nocase(pName)%NUM_COMMAND_BUCKETS]; pCommand; pCommand = pCommand->m_pNextHash)
 	{
 		if(pCommand->m_Flags&FlagMask)
 		{
@@ -802,6 +802,8 @@ CConsole::CConsole(int FlagMask)
 	m_pLastMapEntry = 0;
 	m_ExecutionQueue.Reset();
 	m_pFirstCommand = 0;
+	mem_zero(m_apCommandBuckets, sizeof(m_apCommandBuckets));
+	mem_zero(&m_NameRoot, sizeof(m_NameRoot));
 	m_pFirstExec = 0;
 	mem_zero(m_aPrintCB, sizeof(m_aPrintCB));
 	m_NumPrintCB = 0;
@@ -850,12 +852,18 @@ CConsole::~CConsole()
 	{
 		CCommand *pNext = pCommand->m_pNext;
 
-		if(pCommand->m_pfnCallback == Con_Chain)
-			mem_free(static_cast<CChain *>(pCommand->m_pUserData));
-		mem_free(pCommand);
+		// temp commands live in m_TempCommands
+		if(!pCommand->m_Temp)
+		{
+			if(pCommand->m_pfnCallback == Con_Chain)
+				mem_free(static_cast<CChain *>(pCommand->m_pUserData));
+			mem_free(pCommand);
+		}
 
 		pCommand = pNext;
 	}
+
+	FreeNameNodes(m_NameRoot.m_pFirstChild);
 }
 
 void CConsole::ParseArguments(int NumArgs, const char **ppArguments)
@@ -883,28 +891,119 @@ void CConsole::ParseArguments(int NumArgs, const char **ppArguments)
 	}
 }
 
-void CConsole::AddCommandSorted(CCommand *pCommand)
+CConsole::CCommand *CConsole::LastCommand(CNameNode *pNode)
 {
-	if(!m_pFirstCommand || str_comp(pCommand->m_pName, m_pFirstCommand->m_pName) <= 0)
+	// longer names sort after shorter ones, so this is the last command of the rightmost leaf
+	while(pNode->m_pFirstChild)
 	{
-		if(m_pFirstCommand && m_pFirstCommand->m_pNext)
-			pCommand->m_pNext = m_pFirstCommand;
-		else
-			pCommand->m_pNext = 0;
-		m_pFirstCommand = pCommand;
+		pNode = pNode->m_pFirstChild;
+		while(pNode->m_pNextSibling)
+			pNode = pNode->m_pNextSibling;
 	}
-	else
+	return pNode->m_pLastCommand;
+}
+
+void CConsole::FreeNameNodes(CNameNode *pNode)
+{
+	while(pNode)
+	{
+		CNameNode *pNext = pNode->m_pNextSibling;
+		FreeNameNodes(pNode->m_pFirstChild);
+		mem_free(pNode);
+		pNode = pNext;
+	}
+}
+
+void CConsole::AddCommandSorted(CCommand *pCommand)
+{
+	// walk the name down the trie. the command that sorts right before the new one is the
+	// last one left of the path, the deepest candidate wins
+	CCommand *pPrev = 0;
+	CNameNode *pNode = &m_NameRoot;
+	for(const char *pChar = pCommand->m_pName; *pChar; pChar++)
 	{
-		for(CCommand *p = m_pFirstCommand; p; p = p->m_pNext)
+		unsigned char Char = *pChar;
+		if(pNode->m_pLastCommand)
+			pPrev = pNode->m_pLastCommand;
+
+		CNameNode *pLeft = 0;
+		CNameNode **ppChild = &pNode->m_pFirstChild;
+		while(*ppChild && (*ppChild)->m_Char < Char)
 		{
-			if(!p->m_pNext || str_comp(pCommand->m_pName, p->m_pNext->m_pName) <= 0)
-			{
-				pCommand->m_pNext = p->m_pNext;
-				p->m_pNext = pCommand;
-				break;
-			}
+			pLeft = *ppChild;
+			ppChild = &pLeft->m_pNextSibling;
+		}
+		if(pLeft)
+			pPrev = LastCommand(pLeft);
+
+		if(!*ppChild || (*ppChild)->m_Char != Char)
+		{
+			CNameNode *pChild = static_cast<CNameNode *>(mem_alloc(sizeof(CNameNode), sizeof(void*)));
+			mem_zero(pChild, sizeof(CNameNode));
+			pChild->m_pParent = pNode;
+			pChild->m_pNextSibling = *ppChild;
+			pChild->m_Char = Char;
+			*ppChild = pChild;
 		}
+		pNode = *ppChild;
+	}
+
+	// same names are added in front
+	pCommand->m_pPrev = pPrev;
+	pCommand->m_pNext = pPrev ? pPrev->m_pNext : m_pFirstCommand;
+	if(pCommand->m_pNext)
+		pCommand->m_pNext->m_pPrev = pCommand;
+	if(pPrev)
+		pPrev->m_pNext = pCommand;
+	else
+		m_pFirstCommand = pCommand;
+
+	pCommand->m_pNameNode = pNode;
+	pNode->m_pFirstCommand = pCommand;
+	if(!pNode->m_pLastCommand)
+		pNode->m_pLastCommand = pCommand;
+
+	CCommand **ppBucket = &m_apCommandBuckets[str_quickhash_nocase(pCommand->m_pName)%NUM_COMMAND_BUCKETS];
+	pCommand->m_pNextHash = *ppBucket;
+	*ppBucket = pCommand;
+}
+
+void CConsole::RemoveCommand(CCommand *pCommand)
+{
+	CNameNode *pNode = pCommand->m_pNameNode;
+	if(pNode->m_pFirstCommand == pCommand && pNode->m_pLastCommand == pCommand)
+		pNode->m_pFirstCommand = pNode->m_pLastCommand = 0;
+	else if(pNode->m_pFirstCommand == pCommand)
+		pNode->m_pFirstCommand = pCommand->m_pNext;
+	else if(pNode->m_pLastCommand == pCommand)
+		pNode->m_pLastCommand = pCommand->m_pPrev;
+
+	// drop the nodes that lead to nothing anymore
+	while(pNode != &m_NameRoot && !pNode->m_pFirstCommand && !pNode->m_pFirstChild)
+	{
+		CNameNode *pParent = pNode->m_pParent;
+		CNameNode **ppChild = &pParent->m_pFirstChild;
+		while(*ppChild != pNode)
+			ppChild = &(*ppChild)->m_pNextSibling;
+		*ppChild = pNode->m_pNextSibling;
+		mem_free(pNode);
+		pNode = pParent;
 	}
+
+	if(pCommand->m_pPrev)
+		pCommand->m_pPrev->m_pNext = pCommand->m_pNext;
+	else
+		m_pFirstCommand = pCommand->m_pNext;
+	if(pCommand->m_pNext)
+		pCommand->m_pNext->m_pPrev = pCommand->m_pPrev;
+
+	CCommand **ppBucket = &m_apCommandBuckets[str_quickhash_nocase(pCommand->m_pName)%NUM_COMMAND_BUCKETS];
+	while(*ppBucket != pCommand)
+		ppBucket = &(*ppBucket)->m_pNextHash;
+	*ppBucket = pCommand->m_pNextHash;
+
+	pCommand->m_pNext = pCommand->m_pPrev = pCommand->m_pNextHash = 0;
+	pCommand->m_pNameNode = 0;
 }
 
 void CConsole::Register(const char *pName, const char *pParams,
@@ -970,31 +1069,20 @@ void CConsole::RegisterTemp(const char *pName, const char *pParams,	int Flags, c
 
 void CConsole::DeregisterTemp(const char *pName)
 {
-	if(!m_pFirstCommand)
-		return;
-
 	CCommand *pRemoved = 0;
-
-	// remove temp entry from command list
-	if(m_pFirstCommand->m_Temp && str_comp(m_pFirstCommand->m_pName, pName) == 0)
+	for(CCommand *pCommand = m_apCommandBuckets[str_quickhash_nocase(pName)%NUM_COMMAND_BUCKETS]; pCommand; pCommand = pCommand->m_pNextHash)
 	{
-		pRemoved = m_pFirstCommand;
-		m_pFirstCommand = m_pFirstCommand->m_pNext;
-	}
-	else
-	{
-		for(CCommand *pCommand = m_pFirstCommand; pCommand->m_pNext; pCommand = pCommand->m_pNext)
-			if(pCommand->m_pNext->m_Temp && str_comp(pCommand->m_pNext->m_pName, pName) == 0)
-			{
-				pRemoved = pCommand->m_pNext;
-				pCommand->m_pNext = pCommand->m_pNext->m_pNext;
-				break;
-			}
+		if(pCommand->m_Temp && str_comp(pCommand->m_pName, pName) == 0)
+		{
+			pRemoved = pCommand;
+			break;
+		}
 	}
 
 	// add to recycle list
 	if(pRemoved)
 	{
+		RemoveCommand(pRemoved);
 		pRemoved->m_pNext = m_pRecycleList;
 		m_pRecycleList = pRemoved;
 	}
@@ -1002,18 +1090,13 @@ void CConsole::DeregisterTemp(const char *pName)
 
 void CConsole::DeregisterTempAll()
 {
-	// set non temp as first one
-	for(; m_pFirstCommand && m_pFirstCommand->m_Temp; m_pFirstCommand = m_pFirstCommand->m_pNext);
-
 	// remove temp entries from command list
-	for(CCommand *pCommand = m_pFirstCommand; pCommand && pCommand->m_pNext; pCommand = pCommand->m_pNext)
+	for(CCommand *pCommand = m_pFirstCommand; pCommand;)
 	{
 		CCommand *pNext = pCommand->m_pNext;
-		if(pNext->m_Temp)
-		{
-			for(; pNext && pNext->m_Temp; pNext = pNext->m_pNext);
-			pCommand->m_pNext = pNext;
-		}
+		if(pCommand->m_Temp)
+			RemoveCommand(pCommand);
+		pCommand = pNext;
 	}
 
 	m_TempCommands.Reset();
@@ -1131,7 +1214,7 @@ void CConsole::StoreCommands(bool Store)
 
 const IConsole::CCommandInfo *CConsole::GetCommandInfo(const char *pName, int FlagMask, bool Temp)
 {
-	for(CCommand *pCommand = m_pFirstCommand; pCommand; pCommand = pCommand->m_pNext)
+	for(CCommand *pCommand = m_apCommandBuckets[str_quickhash_nocase(pName)%NUM_COMMAND_BUCKETS]; pCommand; pCommand = pCommand->m_pNextHash)
 	{
 		if(pCommand->m_Flags&FlagMask && pCommand->m_Temp == Temp)
 		{
@@ -8,10 +8,15 @@
 
 class CConsole : public IConsole
 {
+	class CNameNode;
+
 	class CCommand : public CCommandInfo
 	{
 	public:
 		CCommand *m_pNext;
+		CCommand *m_pPrev;
+		CCommand *m_pNextHash;
+		CNameNode *m_pNameNode;
 		int m_Flags;
 		bool m_Temp;
 		FCommandCallback m_pfnCallback;
@@ -32,10 +37,30 @@ class CConsole : public IConsole
 		void *m_pUserData;
 	};
 
+	// prefix trie over the command names, one node per character. it keeps the command list
+	// sorted without walking it: the commands of a node are a contiguous run of the list
+	class CNameNode
+	{
+	public:
+		CNameNode *m_pParent;
+		CNameNode *m_pFirstChild;
+		CNameNode *m_pNextSibling; // siblings are sorted by character
+		CCommand *m_pFirstCommand;
+		CCommand *m_pLastCommand;
+		unsigned char m_Char;
+	};
+
+	enum
+	{
+		NUM_COMMAND_BUCKETS=1024,
+	};
+
 	int m_FlagMask;
 	bool m_StoreCommands;
 	const char *m_paStrokeStr[2];
 	CCommand *m_pFirstCommand;
+	CCommand *m_apCommandBuckets[NUM_COMMAND_BUCKETS]; // case insensitive name hash
+	CNameNode m_NameRoot;
 
 	class CExecFile
 	{
@@ -176,7 +201,10 @@ class CConsole : public IConsole
 		}
 	} m_ExecutionQueue;
 
+	static CCommand *LastCommand(CNameNode *pNode);
+	static void FreeNameNodes(CNameNode *pNode);
 	void AddCommandSorted(CCommand *pCommand);
+	void RemoveCommand(CCommand *pCommand);
 	CCommand *FindCommand(const char *pName, int FlagMask);
 
 	struct CMapListEntryTemp {
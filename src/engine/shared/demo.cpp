@@ -17,12 +17,21 @@ static const unsigned char gs_ActVersion = 4;
 static const int gs_LengthOffset = 152;
 static const int gs_NumMarkersOffset = 176;
 
+// the keyframe index is stored in a trailing chunk that older players skip
+static const unsigned char gs_aIndexMarker[8] = {'T', 'W', 'D', 'E', 'M', 'O', 'I', 'X'};
+static const int gs_IndexVersion = 1;
+static const int gs_IndexFooterSize = 4+4+sizeof(gs_aIndexMarker);
+
 
 CDemoRecorder::CDemoRecorder(class CSnapshotDelta *pSnapshotDelta)
 {
 	m_File = 0;
+	m_MapFile = 0;
 	m_LastTickMarker = -1;
+	m_KeyFrameInterval = SERVER_TICK_SPEED*5;
 	m_pSnapshotDelta = pSnapshotDelta;
+	m_pQueue = 0;
+	m_pWriterThread = 0;
 }
 
 // TODO: fix demo map loading (looks broken)
@@ -104,26 +113,37 @@ int CDemoRecorder::Start(class IStorage *pStorage, class IConsole *pConsole, con
 	// Header.m_aTimelineMarkers - add this on stop
 	io_write(DemoFile, &Header, sizeof(Header));
 
-	// write map data
-	while(1)
-	{
-		unsigned char aChunk[1024*64];
-		int Bytes = io_read(MapFile, &aChunk, sizeof(aChunk));
-		if(Bytes <= 0)
-			break;
-		io_write(DemoFile, &aChunk, Bytes);
-	}
-	io_close(MapFile);
-
 	m_LastKeyFrame = -1;
 	m_LastTickMarker = -1;
 	m_FirstTick = -1;
 	m_NumTimelineMarkers = 0;
 
+	// the map data and all chunks are written by the writer thread
+	m_File = DemoFile;
+	m_MapFile = MapFile;
+	m_WriterFirstTick = -1;
+	m_WriterLastTickMarker = -1;
+	m_lKeyFrames.clear();
+	m_pQueue = (unsigned char *)mem_alloc(QUEUE_SIZE, 1);
+	m_QueueWritePos = 0;
+	m_QueueReadPos = 0;
+	m_StopWriter = false;
+	m_pWriterThread = thread_init(WriterThread, this);
+	if(!m_pWriterThread)
+	{
+		io_close(m_MapFile);
+		io_close(m_File);
+		mem_free(m_pQueue);
+		m_MapFile = 0;
+		m_File = 0;
+		m_pQueue = 0;
+		m_pConsole->Print(IConsole::OUTPUT_LEVEL_STANDARD, "demo_recorder", "Unable to start the demo writer thread");
+		return -1;
+	}
+
 	char aBuf[256];
 	str_format(aBuf, sizeof(aBuf), "Recording to '%s'", pFilename);
 	m_pConsole->Print(IConsole::OUTPUT_LEVEL_STANDARD, "demo_recorder", aBuf);
-	m_File = DemoFile;
 
 	return 0;
 }
@@ -158,7 +178,7 @@ enum
 
 void CDemoRecorder::WriteTickMarker(int Tick, int Keyframe)
 {
-	if(m_LastTickMarker == -1 || Tick-m_LastTickMarker > 63 || Keyframe)
+	if(m_WriterLastTickMarker == -1 || Tick-m_WriterLastTickMarker > 63 || Keyframe)
 	{
 		unsigned char aChunk[5];
 		aChunk[0] = CHUNKTYPEFLAG_TICKMARKER;
@@ -168,30 +188,60 @@ void CDemoRecorder::WriteTickMarker(int Tick, int Keyframe)
 		aChunk[4] = (Tick)&0xff;
 
 		if(Keyframe)
+		{
 			aChunk[0] |= CHUNKTICKFLAG_KEYFRAME;
 
+			CIndexedKeyFrame KeyFrame;
+			KeyFrame.m_Filepos = io_tell(m_File);
+			KeyFrame.m_Tick = Tick;
+			m_lKeyFrames.add(KeyFrame);
+		}
+
 		io_write(m_File, aChunk, sizeof(aChunk));
 	}
 	else
 	{
 		unsigned char aChunk[1];
-		aChunk[0] = CHUNKTYPEFLAG_TICKMARKER | (Tick-m_LastTickMarker);
+		aChunk[0] = CHUNKTYPEFLAG_TICKMARKER | (Tick-m_WriterLastTickMarker);
 		io_write(m_File, aChunk, sizeof(aChunk));
 	}
 
-	m_LastTickMarker = Tick;
-	if(m_FirstTick < 0)
-		m_FirstTick = Tick;
+	m_WriterLastTickMarker = Tick;
+	if(m_WriterFirstTick < 0)
+		m_WriterFirstTick = Tick;
+}
+
+void CDemoRecorder::WriteChunkHeader(int Type, int Size)
+{
+	unsigned char aChunk[3];
+	aChunk[0] = ((Type&0x3)<<5);
+	if(Size < 30)
+	{
+		aChunk[0] |= Size;
+		io_write(m_File, aChunk, 1);
+	}
+	else
+	{
+		if(Size < 256)
+		{
+			aChunk[0] |= 30;
+			aChunk[1] = Size&0xff;
+			io_write(m_File, aChunk, 2);
+		}
+		else
+		{
+			aChunk[0] |= 31;
+			aChunk[1] = Size&0xff;
+			aChunk[2] = Size>>8;
+			io_write(m_File, aChunk, 3);
+		}
+	}
 }
 
 void CDemoRecorder::Write(int Type, const void *pData, int Size)
 {
 	char aBuffer[64*1024];
 	char aBuffer2[64*1024];
-	unsigned char aChunk[3];
-
-	if(!m_File)
-		return;
 
 	/* pad the data with 0 so we get an alignment of 4,
 	else the compression won't work and miss some bytes */
@@ -211,35 +261,76 @@ void CDemoRecorder::Write(int Type, const void *pData, int Size)
 		return;
 	}
 
-	aChunk[0] = ((Type&0x3)<<5);
-	if(Size < 30)
+	WriteChunkHeader(Type, Size);
+	io_write(m_File, aBuffer2, Size);
+}
+
+/*
+	Keyframe index
+		The index is written as a chunk of type 0 at the end of the demo.
+		Its payload starts with an empty compressed buffer, so older
+		players decode it as an empty chunk and ignore it. The raw index
+		follows, the last bytes of the file are the footer:
+
+		index	= version, first tick, last tick, number of keyframes,
+					(tick delta, filepos delta) per keyframe, all variable ints
+		footer	= index size (4), chunk filepos (4), marker (8)
+*/
+void CDemoRecorder::WriteIndex()
+{
+	if(m_WriterFirstTick < 0)
+		return;
+
+	unsigned char aPayload[64*1024-1];
+	int PrefixSize = CNetBase::Compress(0, 0, aPayload, sizeof(aPayload));
+	if(PrefixSize < 0)
+		return;
+
+	// every entry takes at most 2*5 bytes
+	int MaxKeyFrames = (int)(sizeof(aPayload) - PrefixSize - 4*5 - gs_IndexFooterSize) / 10;
+	if(m_lKeyFrames.size() > MaxKeyFrames)
 	{
-		aChunk[0] |= Size;
-		io_write(m_File, aChunk, 1);
+		m_pConsole->Print(IConsole::OUTPUT_LEVEL_ADDINFO, "demo_recorder", "too many keyframes, not writing an index");
+		return;
 	}
-	else
+
+	unsigned char *pIndex = aPayload+PrefixSize;
+	unsigned char *pEnd = pIndex;
+	pEnd = CVariableInt::Pack(pEnd, gs_IndexVersion);
+	pEnd = CVariableInt::Pack(pEnd, m_WriterFirstTick);
+	pEnd = CVariableInt::Pack(pEnd, m_WriterLastTickMarker);
+	pEnd = CVariableInt::Pack(pEnd, m_lKeyFrames.size());
+	int LastTick = 0;
+	int LastFilepos = 0;
+	for(int i = 0; i < m_lKeyFrames.size(); i++)
 	{
-		if(Size < 256)
-		{
-			aChunk[0] |= 30;
-			aChunk[1] = Size&0xff;
-			io_write(m_File, aChunk, 2);
-		}
-		else
-		{
-			aChunk[0] |= 31;
-			aChunk[1] = Size&0xff;
-			aChunk[2] = Size>>8;
-			io_write(m_File, aChunk, 3);
-		}
+		pEnd = CVariableInt::Pack(pEnd, m_lKeyFrames[i].m_Tick-LastTick);
+		pEnd = CVariableInt::Pack(pEnd, m_lKeyFrames[i].m_Filepos-LastFilepos);
+		LastTick = m_lKeyFrames[i].m_Tick;
+		LastFilepos = m_lKeyFrames[i].m_Filepos;
 	}
 
-	io_write(m_File, aBuffer2, Size);
+	int IndexSize = (int)(pEnd-pIndex);
+	int ChunkPos = io_tell(m_File);
+	pEnd[0] = (IndexSize>>24)&0xff;
+	pEnd[1] = (IndexSize>>16)&0xff;
+	pEnd[2] = (IndexSize>>8)&0xff;
+	pEnd[3] = (IndexSize)&0xff;
+	pEnd[4] = (ChunkPos>>24)&0xff;
+	pEnd[5] = (ChunkPos>>16)&0xff;
+	pEnd[6] = (ChunkPos>>8)&0xff;
+	pEnd[7] = (ChunkPos)&0xff;
+	mem_copy(pEnd+8, gs_aIndexMarker, sizeof(gs_aIndexMarker));
+	pEnd += gs_IndexFooterSize;
+
+	int Size = (int)(pEnd-aPayload);
+	WriteChunkHeader(0, Size);
+	io_write(m_File, aPayload, Size);
 }
 
-void CDemoRecorder::RecordSnapshot(int Tick, const void *pData, int Size)
+void CDemoRecorder::WriteSnapshot(int Tick, int Keyframe, const void *pData, int Size)
 {
-	if(m_LastKeyFrame == -1 || (Tick-m_LastKeyFrame) > SERVER_TICK_SPEED*5)
+	if(Keyframe)
 	{
 		// write full tickmarker
 		WriteTickMarker(Tick, 1);
@@ -247,7 +338,6 @@ void CDemoRecorder::RecordSnapshot(int Tick, const void *pData, int Size)
 		// write snapshot
 		Write(CHUNKTYPE_SNAPSHOT, pData, Size);
 
-		m_LastKeyFrame = Tick;
 		mem_copy(m_aLastSnapshotData, pData, Size);
 	}
 	else
@@ -269,9 +359,132 @@ void CDemoRecorder::RecordSnapshot(int Tick, const void *pData, int Size)
 	}
 }
 
+void CDemoRecorder::WriteMap()
+{
+	while(1)
+	{
+		unsigned char aChunk[1024*64];
+		int Bytes = io_read(m_MapFile, &aChunk, sizeof(aChunk));
+		if(Bytes <= 0)
+			break;
+		io_write(m_File, &aChunk, Bytes);
+	}
+	io_close(m_MapFile);
+	m_MapFile = 0;
+}
+
+void CDemoRecorder::WriteQueued()
+{
+	unsigned ReadPos = m_QueueReadPos;
+	unsigned WritePos = m_QueueWritePos;
+	sync_barrier();
+
+	while(ReadPos != WritePos)
+	{
+		unsigned Offset = ReadPos&(QUEUE_SIZE-1);
+		const CQueuedChunk *pChunk = (const CQueuedChunk *)(m_pQueue+Offset);
+		if(QUEUE_SIZE-Offset < sizeof(CQueuedChunk) || pChunk->m_Type == QUEUEDCHUNK_WRAP)
+		{
+			// the chunk didn't fit at the end of the buffer
+			ReadPos += QUEUE_SIZE-Offset;
+			continue;
+		}
+
+		const void *pData = pChunk+1;
+		if(pChunk->m_Type == CHUNKTYPE_SNAPSHOT)
+			WriteSnapshot(pChunk->m_Tick, pChunk->m_Keyframe, pData, pChunk->m_Size);
+		else
+			Write(pChunk->m_Type, pData, pChunk->m_Size);
+
+		ReadPos += sizeof(CQueuedChunk) + ((pChunk->m_Size+3)&~3);
+
+		// hand the space back to the recording thread
+		sync_barrier();
+		m_QueueReadPos = ReadPos;
+	}
+}
+
+void CDemoRecorder::WriterThread(void *pUser)
+{
+	CDemoRecorder *pSelf = (CDemoRecorder *)pUser;
+
+	pSelf->WriteMap();
+
+	while(1)
+	{
+		pSelf->m_QueueActivity.wait();
+		pSelf->WriteQueued();
+		if(pSelf->m_StopWriter)
+		{
+			pSelf->WriteQueued();
+			break;
+		}
+	}
+}
+
+void CDemoRecorder::QueueChunk(int Type, int Tick, int Keyframe, const void *pData, int Size)
+{
+	unsigned Needed = sizeof(CQueuedChunk) + ((Size+3)&~3);
+	if(Size < 0 || Needed > QUEUE_SIZE/2)
+		return;
+
+	unsigned WritePos = m_QueueWritePos;
+	unsigned Offset = WritePos&(QUEUE_SIZE-1);
+	unsigned Contiguous = QUEUE_SIZE-Offset;
+	unsigned Total = Contiguous < Needed ? Contiguous+Needed : Needed;
+
+	// wait for the writer thread if it fell behind
+	while(QUEUE_SIZE - (WritePos-m_QueueReadPos) < Total)
+	{
+		m_QueueActivity.signal();
+		thread_yield();
+	}
+	sync_barrier();
+
+	if(Contiguous < Needed)
+	{
+		// not enough space left at the end of the buffer, wrap around
+		if(Contiguous >= sizeof(CQueuedChunk))
+			((CQueuedChunk *)(m_pQueue+Offset))->m_Type = QUEUEDCHUNK_WRAP;
+		WritePos += Contiguous;
+		Offset = 0;
+	}
+
+	CQueuedChunk *pChunk = (CQueuedChunk *)(m_pQueue+Offset);
+	pChunk->m_Type = Type;
+	pChunk->m_Tick = Tick;
+	pChunk->m_Keyframe = Keyframe;
+	pChunk->m_Size = Size;
+	mem_copy(pChunk+1, pData, Size);
+
+	// publish the chunk
+	sync_barrier();
+	m_QueueWritePos = WritePos+Needed;
+	m_QueueActivity.signal();
+}
+
+void CDemoRecorder::RecordSnapshot(int Tick, const void *pData, int Size)
+{
+	if(!m_File)
+		return;
+
+	int Keyframe = m_LastKeyFrame == -1 || (Tick-m_LastKeyFrame) > m_KeyFrameInterval;
+	if(Keyframe)
+		m_LastKeyFrame = Tick;
+
+	QueueChunk(CHUNKTYPE_SNAPSHOT, Tick, Keyframe, pData, Size);
+
+	m_LastTickMarker = Tick;
+	if(m_FirstTick < 0)
+		m_FirstTick = Tick;
+}
+
 void CDemoRecorder::RecordMessage(const void *pData, int Size)
 {
-	Write(CHUNKTYPE_MESSAGE, pData, Size);
+	if(!m_File)
+		return;
+
+	QueueChunk(CHUNKTYPE_MESSAGE, m_LastTickMarker, 0, pData, Size);
 }
 
 int CDemoRecorder::Stop()
@@ -279,6 +492,17 @@ int CDemoRecorder::Stop()
 	if(!m_File)
 		return -1;
 
+	// let the writer thread finish all queued chunks
+	m_StopWriter = true;
+	m_QueueActivity.signal();
+	thread_wait(m_pWriterThread);
+	m_pWriterThread = 0;
+	mem_free(m_pQueue);
+	m_pQueue = 0;
+
+	WriteIndex();
+	m_lKeyFrames.clear();
+
 	// add the demo length to the header
 	io_seek(m_File, gs_LengthOffset, IOSEEK_START);
 	int DemoLength = Length();
@@ -340,9 +564,30 @@ CDemoPlayer::CDemoPlayer(class CSnapshotDelta *pSnapshotDelta)
 	m_File = 0;
 	m_aErrorMsg[0] = 0;
 	m_pKeyFrames = 0;
+	m_EndOfFile = false;
 
 	m_pSnapshotDelta = pSnapshotDelta;
 	m_LastSnapshotDataSize = -1;
+
+	for(int i = 0; i < SNAPSHOTCACHE_SIZE; i++)
+	{
+		m_aSnapshotCache[i].m_Tick = -1;
+		m_aSnapshotCache[i].m_AllocatedSize = 0;
+		m_aSnapshotCache[i].m_pData = 0;
+	}
+	m_SnapshotCacheTime = 0;
+}
+
+CDemoPlayer::~CDemoPlayer()
+{
+	ClearSnapshotCache();
+	for(int i = 0; i < SNAPSHOTCACHE_SIZE; i++)
+	{
+		if(m_aSnapshotCache[i].m_pData)
+			mem_free(m_aSnapshotCache[i].m_pData);
+		m_aSnapshotCache[i].m_pData = 0;
+		m_aSnapshotCache[i].m_AllocatedSize = 0;
+	}
 }
 
 void CDemoPlayer::SetListner(IListner *pListner)
@@ -406,6 +651,81 @@ int CDemoPlayer::ReadChunkHeader(int *pType, int *pSize, int *pTick)
 	return 0;
 }
 
+bool CDemoPlayer::ReadIndex()
+{
+	long StartPos = io_tell(m_File);
+	long FileSize = io_length(m_File);
+	if(FileSize < StartPos + gs_IndexFooterSize)
+		return false;
+
+	unsigned char aFooter[gs_IndexFooterSize];
+	io_seek(m_File, FileSize-gs_IndexFooterSize, IOSEEK_START);
+	bool Valid = io_read(m_File, aFooter, sizeof(aFooter)) == sizeof(aFooter) &&
+		mem_comp(aFooter+8, gs_aIndexMarker, sizeof(gs_aIndexMarker)) == 0;
+
+	int IndexSize = (aFooter[0]<<24) | (aFooter[1]<<16) | (aFooter[2]<<8) | aFooter[3];
+	long ChunkPos = (aFooter[4]<<24) | (aFooter[5]<<16) | (aFooter[6]<<8) | aFooter[7];
+	long IndexPos = FileSize-gs_IndexFooterSize-IndexSize;
+	Valid = Valid && IndexSize > 0 && IndexSize < 64*1024 && ChunkPos >= StartPos && ChunkPos < IndexPos;
+
+	unsigned char *pIndex = 0;
+	if(Valid)
+	{
+		// pad with zeros so that unpacking can't read past the end
+		pIndex = (unsigned char *)mem_alloc(IndexSize+5, 1);
+		mem_zero(pIndex+IndexSize, 5);
+		io_seek(m_File, IndexPos, IOSEEK_START);
+		Valid = io_read(m_File, pIndex, IndexSize) == (unsigned)IndexSize;
+	}
+
+	int Version = 0, FirstTick = -1, LastTick = -1, NumKeyFrames = 0;
+	const unsigned char *pData = pIndex;
+	const unsigned char *pEnd = pIndex+IndexSize;
+	if(Valid)
+	{
+		pData = CVariableInt::Unpack(pData, &Version);
+		pData = CVariableInt::Unpack(pData, &FirstTick);
+		pData = CVariableInt::Unpack(pData, &LastTick);
+		pData = CVariableInt::Unpack(pData, &NumKeyFrames);
+		Valid = pData <= pEnd && Version == gs_IndexVersion && NumKeyFrames >= 0 && NumKeyFrames <= IndexSize/2;
+	}
+
+	CKeyFrame *pKeyFrames = 0;
+	if(Valid)
+	{
+		pKeyFrames = (CKeyFrame *)mem_alloc(NumKeyFrames*sizeof(CKeyFrame), 1);
+		int Tick = 0, Filepos = 0;
+		for(int i = 0; i < NumKeyFrames && Valid; i++)
+		{
+			int TickDelta, FileposDelta;
+			pData = CVariableInt::Unpack(pData, &TickDelta);
+			pData = CVariableInt::Unpack(pData, &FileposDelta);
+			Tick += TickDelta;
+			Filepos += FileposDelta;
+			pKeyFrames[i].m_Tick = Tick;
+			pKeyFrames[i].m_Filepos = Filepos;
+			Valid = pData <= pEnd && Filepos >= StartPos && Filepos < ChunkPos;
+		}
+	}
+
+	if(pIndex)
+		mem_free(pIndex);
+	io_seek(m_File, StartPos, IOSEEK_START);
+
+	if(!Valid)
+	{
+		if(pKeyFrames)
+			mem_free(pKeyFrames);
+		return false;
+	}
+
+	m_pKeyFrames = pKeyFrames;
+	m_Info.m_SeekablePoints = NumKeyFrames;
+	m_Info.m_Info.m_FirstTick = FirstTick;
+	m_Info.m_Info.m_LastTick = LastTick;
+	return true;
+}
+
 void CDemoPlayer::ScanFile()
 {
 	long StartPos;
@@ -464,6 +784,73 @@ void CDemoPlayer::ScanFile()
 	io_seek(m_File, StartPos, IOSEEK_START);
 }
 
+void CDemoPlayer::CacheSnapshot(bool KeyFrame)
+{
+	int Tick = m_Info.m_Info.m_CurrentTick;
+	if(Tick < 0 || m_LastSnapshotDataSize < 0)
+		return;
+
+	// keep keyframes and one snapshot every few ticks
+	if(FindCachedSnapshot(KeyFrame ? Tick : Tick-SNAPSHOTCACHE_INTERVAL+1, Tick))
+		return;
+
+	// evict the least recently used entry
+	CCachedSnapshot *pEntry = &m_aSnapshotCache[0];
+	for(int i = 1; i < SNAPSHOTCACHE_SIZE && pEntry->m_Tick != -1; i++)
+	{
+		if(m_aSnapshotCache[i].m_Tick == -1 || m_aSnapshotCache[i].m_LastUsed < pEntry->m_LastUsed)
+			pEntry = &m_aSnapshotCache[i];
+	}
+
+	if(pEntry->m_AllocatedSize < m_LastSnapshotDataSize)
+	{
+		if(pEntry->m_pData)
+			mem_free(pEntry->m_pData);
+		pEntry->m_pData = (char *)mem_alloc(m_LastSnapshotDataSize, 1);
+		pEntry->m_AllocatedSize = m_LastSnapshotDataSize;
+	}
+
+	pEntry->m_Tick = Tick;
+	pEntry->m_PreviousTick = m_Info.m_PreviousTick;
+	pEntry->m_NextTick = m_Info.m_NextTick;
+	pEntry->m_Filepos = io_tell(m_File);
+	pEntry->m_LastUsed = ++m_SnapshotCacheTime;
+	pEntry->m_DataSize = m_LastSnapshotDataSize;
+	mem_copy(pEntry->m_pData, m_aLastSnapshotData, m_LastSnapshotDataSize);
+}
+
+const CDemoPlayer::CCachedSnapshot *CDemoPlayer::FindCachedSnapshot(int MinTick, int MaxTick) const
+{
+	const CCachedSnapshot *pBest = 0;
+	for(int i = 0; i < SNAPSHOTCACHE_SIZE; i++)
+	{
+		const CCachedSnapshot *pEntry = &m_aSnapshotCache[i];
+		if(pEntry->m_Tick != -1 && pEntry->m_Tick >= MinTick && pEntry->m_Tick <= MaxTick && (!pBest || pEntry->m_Tick > pBest->m_Tick))
+			pBest = pEntry;
+	}
+	return pBest;
+}
+
+void CDemoPlayer::RestoreCachedSnapshot(const CCachedSnapshot *pCached)
+{
+	io_seek(m_File, pCached->m_Filepos, IOSEEK_START);
+	m_Info.m_PreviousTick = pCached->m_PreviousTick;
+	m_Info.m_Info.m_CurrentTick = pCached->m_Tick;
+	m_Info.m_NextTick = pCached->m_NextTick;
+	m_LastSnapshotDataSize = pCached->m_DataSize;
+	mem_copy(m_aLastSnapshotData, pCached->m_pData, pCached->m_DataSize);
+	m_aSnapshotCache[pCached-m_aSnapshotCache].m_LastUsed = ++m_SnapshotCacheTime;
+
+	if(m_pListner)
+		m_pListner->OnDemoPlayerSnapshot(m_aLastSnapshotData, m_LastSnapshotDataSize);
+}
+
+void CDemoPlayer::ClearSnapshotCache()
+{
+	for(int i = 0; i < SNAPSHOTCACHE_SIZE; i++)
+		m_aSnapshotCache[i].m_Tick = -1;
+}
+
 void CDemoPlayer::DoTick()
 {
 	static char aCompresseddata[CSnapshot::MAX_SIZE];
@@ -472,6 +859,7 @@ void CDemoPlayer::DoTick()
 	int ChunkType, ChunkTick, ChunkSize;
 	int DataSize = 0;
 	int GotSnapshot = 0;
+	bool GotKeyFrame = false;
 
 	// update ticks
 	m_Info.m_PreviousTick = m_Info.m_Info.m_CurrentTick;
@@ -490,7 +878,10 @@ void CDemoPlayer::DoTick()
 				Stop();
 			}
 			else
+			{
 				Pause();
+				m_EndOfFile = true;
+			}
 			break;
 		}
 
@@ -552,6 +943,7 @@ void CDemoPlayer::DoTick()
 		{
 			// process full snapshot
 			GotSnapshot = 1;
+			GotKeyFrame = true;
 
 			m_LastSnapshotDataSize = DataSize;
 			mem_copy(m_aLastSnapshotData, aData, DataSize);
@@ -571,6 +963,7 @@ void CDemoPlayer::DoTick()
 			if(ChunkType&CHUNKTYPEFLAG_TICKMARKER)
 			{
 				m_Info.m_NextTick = ChunkTick;
+				CacheSnapshot(GotKeyFrame);
 				break;
 			}
 			else if(ChunkType == CHUNKTYPE_MESSAGE)
@@ -620,8 +1013,10 @@ const char *CDemoPlayer::Load(class IStorage *pStorage, class IConsole *pConsole
 	m_Info.m_Info.m_CurrentTick = -1;
 	m_Info.m_PreviousTick = -1;
 	m_Info.m_Info.m_Speed = 1;
+	m_EndOfFile = false;
 
 	m_LastSnapshotDataSize = -1;
+	ClearSnapshotCache();
 
 	// read the header
 	io_read(m_File, &m_Info.m_Header, sizeof(m_Info.m_Header));
@@ -683,8 +1078,11 @@ const char *CDemoPlayer::Load(class IStorage *pStorage, class IConsole *pConsole
 
 		// save map
 		MapFile = pStorage->OpenFile(aMapFilename, IOFLAG_WRITE, IStorage::TYPE_SAVE);
-		io_write(MapFile, pMapData, MapSize);
-		io_close(MapFile);
+		if(MapFile)
+		{
+			io_write(MapFile, pMapData, MapSize);
+			io_close(MapFile);
+		}
 
 		// free data
 		mem_free(pMapData);
@@ -701,8 +1099,9 @@ const char *CDemoPlayer::Load(class IStorage *pStorage, class IConsole *pConsole
 												((pTimelineMarker[2]<<8)&0xFF00) | (pTimelineMarker[3]&0xFF);
 	}
 
-	// scan the file for interessting points
-	ScanFile();
+	// use the keyframe index if there is one, scan the file for interessting points otherwise
+	if(!ReadIndex())
+		ScanFile();
 
 	// ready for playback
 	return 0;
@@ -743,6 +1142,8 @@ int CDemoPlayer::SetPos(float Percent)
 	if(Keyframe < 0 || Keyframe >= m_Info.m_SeekablePoints)
 		return -1;
 
+	m_EndOfFile = false;
+
 	// get correct key frame
 	if(m_pKeyFrames[Keyframe].m_Tick < WantedTick)
 		while(Keyframe < m_Info.m_SeekablePoints-1 && m_pKeyFrames[Keyframe].m_Tick < WantedTick)
@@ -751,13 +1152,27 @@ int CDemoPlayer::SetPos(float Percent)
 	while(Keyframe && m_pKeyFrames[Keyframe].m_Tick > WantedTick)
 		Keyframe--;
 
-	// seek to the correct keyframe
-	io_seek(m_File, m_pKeyFrames[Keyframe].m_Filepos, IOSEEK_START);
+	// continue from the current position or the closest cached snapshot
+	// if that needs less ticks than starting at the keyframe
+	int StartTick = m_Info.m_Info.m_CurrentTick;
+	const CCachedSnapshot *pCached = FindCachedSnapshot(m_pKeyFrames[Keyframe].m_Tick, WantedTick);
+	if(StartTick >= 0 && m_Info.m_PreviousTick >= 0 && StartTick <= WantedTick &&
+		StartTick >= m_pKeyFrames[Keyframe].m_Tick && (!pCached || StartTick >= pCached->m_Tick))
+	{
+		// nothing to do
+	}
+	else if(pCached)
+		RestoreCachedSnapshot(pCached);
+	else
+	{
+		// seek to the correct keyframe
+		io_seek(m_File, m_pKeyFrames[Keyframe].m_Filepos, IOSEEK_START);
 
-	//m_Info.start_tick = -1;
-	m_Info.m_NextTick = -1;
-	m_Info.m_Info.m_CurrentTick = -1;
-	m_Info.m_PreviousTick = -1;
+		//m_Info.start_tick = -1;
+		m_Info.m_NextTick = -1;
+		m_Info.m_Info.m_CurrentTick = -1;
+		m_Info.m_PreviousTick = -1;
+	}
 
 	// playback everything until we hit our tick
 	while(m_Info.m_PreviousTick < WantedTick)
@@ -837,6 +1252,7 @@ int CDemoPlayer::Stop()
 	m_File = 0;
 	mem_free(m_pKeyFrames);
 	m_pKeyFrames = 0;
+	ClearSnapshotCache();
 	str_copy(m_aFilename, "", sizeof(m_aFilename));
 	return 0;
 }
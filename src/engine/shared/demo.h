@@ -3,6 +3,9 @@
 #ifndef ENGINE_SHARED_DEMO_H
 #define ENGINE_SHARED_DEMO_H
 
+#include <base/tl/array.h>
+#include <base/tl/threading.h>
+
 #include <engine/demo.h>
 #include <engine/shared/protocol.h>
 
@@ -10,18 +13,63 @@
 
 class CDemoRecorder : public IDemoRecorder
 {
+	enum
+	{
+		QUEUE_SIZE = 2*1024*1024, // must be a power of two
+
+		QUEUEDCHUNK_WRAP = -1,
+	};
+
+	// header of a chunk handed over to the writer thread, followed by the raw data
+	struct CQueuedChunk
+	{
+		int m_Type;
+		int m_Tick;
+		int m_Keyframe;
+		int m_Size;
+	};
+
 	class IConsole *m_pConsole;
 	IOHANDLE m_File;
+	IOHANDLE m_MapFile;
 	int m_LastTickMarker;
 	int m_LastKeyFrame;
+	int m_KeyFrameInterval;
 	int m_FirstTick;
-	unsigned char m_aLastSnapshotData[CSnapshot::MAX_SIZE];
-	class CSnapshotDelta *m_pSnapshotDelta;
 	int m_NumTimelineMarkers;
 	int m_aTimelineMarkers[MAX_TIMELINE_MARKERS];
+	class CSnapshotDelta *m_pSnapshotDelta;
+
+	// queue between the recording thread and the writer thread
+	unsigned char *m_pQueue;
+	volatile unsigned m_QueueWritePos;
+	volatile unsigned m_QueueReadPos;
+	volatile bool m_StopWriter;
+	semaphore m_QueueActivity;
+	void *m_pWriterThread;
+
+	// only touched by the writer thread
+	struct CIndexedKeyFrame
+	{
+		int m_Filepos;
+		int m_Tick;
+	};
 
+	int m_WriterFirstTick;
+	int m_WriterLastTickMarker;
+	unsigned char m_aLastSnapshotData[CSnapshot::MAX_SIZE];
+	array<CIndexedKeyFrame> m_lKeyFrames;
+
+	void QueueChunk(int Type, int Tick, int Keyframe, const void *pData, int Size);
+
+	static void WriterThread(void *pUser);
+	void WriteQueued();
+	void WriteMap();
+	void WriteSnapshot(int Tick, int Keyframe, const void *pData, int Size);
 	void WriteTickMarker(int Tick, int Keyframe);
+	void WriteChunkHeader(int Type, int Size);
 	void Write(int Type, const void *pData, int Size);
+	void WriteIndex();
 public:
 	CDemoRecorder(class CSnapshotDelta *pSnapshotDelta);
 
@@ -31,6 +79,7 @@ public:
 
 	void RecordSnapshot(int Tick, const void *pData, int Size);
 	void RecordMessage(const void *pData, int Size);
+	void SetKeyFrameInterval(int Ticks) { m_KeyFrameInterval = Ticks; }
 
 	bool IsRecording() const { return m_File != 0; }
 
@@ -83,6 +132,25 @@ private:
 		CKeyFrameSearch *m_pNext;
 	};
 
+	// decoded snapshot together with the playback state right after its tick
+	struct CCachedSnapshot
+	{
+		int m_Tick;
+		int m_PreviousTick;
+		int m_NextTick;
+		long m_Filepos;
+		unsigned m_LastUsed;
+		int m_DataSize;
+		int m_AllocatedSize;
+		char *m_pData;
+	};
+
+	enum
+	{
+		SNAPSHOTCACHE_SIZE=64,
+		SNAPSHOTCACHE_INTERVAL=SERVER_TICK_SPEED/2,
+	};
+
 	class IConsole *m_pConsole;
 	IOHANDLE m_File;
 	char m_aFilename[256];
@@ -90,19 +158,29 @@ private:
 	CKeyFrame *m_pKeyFrames;
 
 	CPlaybackInfo m_Info;
+	bool m_EndOfFile;
 	int m_DemoType;
 	unsigned char m_aLastSnapshotData[CSnapshot::MAX_SIZE];
 	int m_LastSnapshotDataSize;
 	class CSnapshotDelta *m_pSnapshotDelta;
 
+	CCachedSnapshot m_aSnapshotCache[SNAPSHOTCACHE_SIZE];
+	unsigned m_SnapshotCacheTime;
+
+	void CacheSnapshot(bool KeyFrame);
+	const CCachedSnapshot *FindCachedSnapshot(int MinTick, int MaxTick) const;
+	void RestoreCachedSnapshot(const CCachedSnapshot *pCached);
+	void ClearSnapshotCache();
+
 	int ReadChunkHeader(int *pType, int *pSize, int *pTick);
 	void DoTick();
+	bool ReadIndex();
 	void ScanFile();
-	int NextFrame();
 
 public:
 
 	CDemoPlayer(class CSnapshotDelta *m_pSnapshotDelta);
+	~CDemoPlayer();
 
 	void SetListner(IListner *pListner);
 
@@ -119,9 +197,12 @@ public:
 	int GetDemoType() const;
 
 	int Update();
+	int NextFrame();
 
 	const CPlaybackInfo *Info() const { return &m_Info; }
 	int IsPlaying() const { return m_File != 0; }
+	// playback paused because it reached the last tick, seeking back clears it
+	bool EndOfFile() const { return m_EndOfFile; }
 };
 
 #endif
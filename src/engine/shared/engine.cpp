@@ -66,11 +66,16 @@ public:
 		net_init();
 		CNetBase::Init();
 
-		m_JobPool.Init(1);
+		m_JobPool.Init(4);
 
 		m_Logging = false;
 	}
 
+	~CEngine()
+	{
+		dbg_logger_async_stop();
+	}
+
 	void Init()
 	{
 		m_pConsole = Kernel()->RequestInterface<IConsole>();
@@ -96,20 +101,35 @@ public:
 			str_format(aLogFilename, sizeof(aLogFilename), "%s%s.txt", g_Config.m_Logfile, aBuf);
 			dbg_logger_file(aLogFilename);
 		}
+
+		if(g_Config.m_LogAsync)
+			dbg_logger_async_start();
 	}
 
 	void HostLookup(CHostLookup *pLookup, const char *pHostname, int Nettype)
 	{
 		str_copy(pLookup->m_aHostname, pHostname, sizeof(pLookup->m_aHostname));
 		pLookup->m_Nettype = Nettype;
-		AddJob(&pLookup->m_Job, HostLookupThread, pLookup);
+		AddJob(&pLookup->m_Job, HostLookupThread, pLookup, 0);
 	}
 
-	void AddJob(CJob *pJob, JOBFUNC pfnFunc, void *pData)
+	void AddJob(CJob *pJob, JOBFUNC pfnFunc, void *pData, CJobGroup *pGroup)
 	{
 		if(g_Config.m_Debug)
 			dbg_msg("engine", "job added");
-		m_JobPool.Add(pJob, pfnFunc, pData);
+		m_JobPool.Add(pJob, pfnFunc, pData, pGroup);
+	}
+
+	void AddDependentJob(CJob *pJob, JOBFUNC pfnFunc, void *pData, CJob **apDependencies, int NumDependencies, CJobGroup *pGroup)
+	{
+		if(g_Config.m_Debug)
+			dbg_msg("engine", "job added with %d dependencies", NumDependencies);
+		m_JobPool.AddDependent(pJob, pfnFunc, pData, apDependencies, NumDependencies, pGroup);
+	}
+
+	void WaitForJobs(CJobGroup *pGroup)
+	{
+		m_JobPool.Wait(pGroup);
 	}
 };
 
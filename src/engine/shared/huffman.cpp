@@ -1,5 +1,6 @@
 /* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
 /* If you are missing that file, acquire a complete release at teeworlds.com.                */
+#include <base/math.h>
 #include <base/system.h>
 #include "huffman.h"
 
@@ -96,106 +97,109 @@ void CHuffman::ConstructTree(const unsigned *pFrequencies)
 
 void CHuffman::Init(const unsigned *pFrequencies)
 {
-	int i;
-
 	// make sure to cleanout every thing
 	mem_zero(this, sizeof(*this));
 
 	// construct the tree
 	ConstructTree(pFrequencies);
 
-	// build decode LUT
-	for(i = 0; i < HUFFMAN_LUTSIZE; i++)
+	// build encode tables
+	for(int i = 0; i < HUFFMAN_MAX_SYMBOLS; i++)
+	{
+		m_aEncodeBits[i] = m_aNodes[i].m_Bits;
+		m_aEncodeNumBits[i] = m_aNodes[i].m_NumBits;
+		if(m_aNodes[i].m_NumBits > m_MaxNumBits)
+			m_MaxNumBits = m_aNodes[i].m_NumBits;
+	}
+
+	// build decode LUT, every entry holds as many whole symbols as fit into its bits
+	for(int i = 0; i < HUFFMAN_LUTSIZE; i++)
 	{
+		CDecodeEntry *pEntry = &m_aDecodeLut[i];
 		unsigned Bits = i;
-		int k;
+		unsigned NumBits = 0;
 		CNode *pNode = m_pStartNode;
-		for(k = 0; k < HUFFMAN_LUTBITS; k++)
+		while(NumBits < HUFFMAN_LUTBITS)
 		{
 			pNode = &m_aNodes[pNode->m_aLeafs[Bits&1]];
 			Bits >>= 1;
+			NumBits++;
 
-			if(!pNode)
-				break;
+			if(!pNode->m_NumBits)
+				continue;
 
-			if(pNode->m_NumBits)
+			pEntry->m_NumBits = NumBits;
+			if(pNode == &m_aNodes[HUFFMAN_EOF_SYMBOL])
 			{
-				m_apDecodeLut[i] = pNode;
+				pEntry->m_Eof = 1;
 				break;
 			}
+			pEntry->m_aSymbols[pEntry->m_NumSymbols++] = pNode->m_Symbol;
+			if(pEntry->m_NumSymbols == HUFFMAN_LUTSYMBOLS)
+				break;
+			pNode = m_pStartNode;
 		}
-
-		if(k == HUFFMAN_LUTBITS)
-			m_apDecodeLut[i] = pNode;
 	}
-
 }
 
 //***************************************************************
 int CHuffman::Compress(const void *pInput, int InputSize, void *pOutput, int OutputSize)
 {
-	// this macro loads a symbol for a byte into bits and bitcount
-#define HUFFMAN_MACRO_LOADSYMBOL(Sym) \
-	Bits |= m_aNodes[Sym].m_Bits << Bitcount; \
-	Bitcount += m_aNodes[Sym].m_NumBits;
-
-	// this macro writes the symbol stored in bits and bitcount to the dst pointer
-#define HUFFMAN_MACRO_WRITE() \
-	while(Bitcount >= 8) \
-	{ \
-		*pDst++ = (unsigned char)(Bits&0xff); \
-		if(pDst == pDstEnd) \
-			return -1; \
-		Bits >>= 8; \
-		Bitcount -= 8; \
-	}
-
 	// setup buffer pointers
 	const unsigned char *pSrc = (const unsigned char *)pInput;
 	const unsigned char *pSrcEnd = pSrc + InputSize;
 	unsigned char *pDst = (unsigned char *)pOutput;
 	unsigned char *pDstEnd = pDst + OutputSize;
 
-	// symbol variables
-	unsigned Bits = 0;
+	// symbol variables, the codes are collected and written out 32 bits at a time
+	unsigned long long Bits = 0;
 	unsigned Bitcount = 0;
 
-	// make sure that we have data that we want to compress
-	if(InputSize)
+	// the last byte is always written, even when empty, so whole bytes have to leave room for it
+	for(; pSrc != pSrcEnd; pSrc++)
 	{
-		// {A} load the first symbol
-		int Symbol = *pSrc++;
+		Bits |= (unsigned long long)m_aEncodeBits[*pSrc] << Bitcount;
+		Bitcount += m_aEncodeNumBits[*pSrc];
 
-		while(pSrc != pSrcEnd)
+		if(Bitcount >= 32)
 		{
-			// {B} load the symbol
-			HUFFMAN_MACRO_LOADSYMBOL(Symbol)
-
-			// {C} fetch next symbol, this is done here because it will reduce dependency in the code
-			Symbol = *pSrc++;
-
-			// {B} write the symbol loaded at
-			HUFFMAN_MACRO_WRITE()
+			if(pDstEnd - pDst <= 4)
+				return -1;
+			pDst[0] = (unsigned char)Bits;
+			pDst[1] = (unsigned char)(Bits>>8);
+			pDst[2] = (unsigned char)(Bits>>16);
+			pDst[3] = (unsigned char)(Bits>>24);
+			pDst += 4;
+			Bits >>= 32;
+			Bitcount -= 32;
 		}
-
-		// write the last symbol loaded from {C} or {A} in the case of only 1 byte input buffer
-		HUFFMAN_MACRO_LOADSYMBOL(Symbol)
-		HUFFMAN_MACRO_WRITE()
 	}
 
 	// write EOF symbol
-	HUFFMAN_MACRO_LOADSYMBOL(HUFFMAN_EOF_SYMBOL)
-	HUFFMAN_MACRO_WRITE()
+	Bits |= (unsigned long long)m_aEncodeBits[HUFFMAN_EOF_SYMBOL] << Bitcount;
+	Bitcount += m_aEncodeNumBits[HUFFMAN_EOF_SYMBOL];
+	while(Bitcount >= 8)
+	{
+		if(pDstEnd - pDst <= 1)
+			return -1;
+		*pDst++ = (unsigned char)Bits;
+		Bits >>= 8;
+		Bitcount -= 8;
+	}
 
 	// write out the last bits
-	*pDst++ = Bits;
+	if(pDst == pDstEnd)
+		return -1;
+	*pDst++ = (unsigned char)Bits;
 
 	// return the size of the output
 	return (int)(pDst - (const unsigned char *)pOutput);
+}
 
-	// remove macros
-#undef HUFFMAN_MACRO_LOADSYMBOL
-#undef HUFFMAN_MACRO_WRITE
+static inline unsigned long long ReadBits64(const unsigned char *pSrc)
+{
+	return (unsigned long long)pSrc[0] | ((unsigned long long)pSrc[1]<<8) | ((unsigned long long)pSrc[2]<<16) | ((unsigned long long)pSrc[3]<<24) |
+		((unsigned long long)pSrc[4]<<32) | ((unsigned long long)pSrc[5]<<40) | ((unsigned long long)pSrc[6]<<48) | ((unsigned long long)pSrc[7]<<56);
 }
 
 //***************************************************************
@@ -203,68 +207,85 @@ int CHuffman::Decompress(const void *pInput, int InputSize, void *pOutput, int O
 {
 	// setup buffer pointers
 	unsigned char *pDst = (unsigned char *)pOutput;
-	unsigned char *pSrc = (unsigned char *)pInput;
+	const unsigned char *pSrc = (const unsigned char *)pInput;
 	unsigned char *pDstEnd = pDst + OutputSize;
-	unsigned char *pSrcEnd = pSrc + InputSize;
+	const unsigned char *pSrcEnd = pSrc + InputSize;
 
-	unsigned Bits = 0;
-	unsigned Bitcount = 0;
+	// Bitcount is the number of input bits left in Bits, negative once decoding ran past the input
+	unsigned long long Bits = 0;
+	int Bitcount = 0;
 
 	CNode *pEof = &m_aNodes[HUFFMAN_EOF_SYMBOL];
-	CNode *pNode = 0;
+	int MinBits = max((int)m_MaxNumBits, (int)HUFFMAN_LUTBITS);
 
-	while(1)
+	// {A} fast path: refill 64 bits at once and decode whole lut entries as long as
+	// every symbol is guaranteed to lie within the input and fit into the output
+	while(pSrcEnd - pSrc >= 8)
 	{
-		// {A} try to load a node now, this will reduce dependency at location {D}
-		pNode = 0;
-		if(Bitcount >= HUFFMAN_LUTBITS)
-			pNode = m_apDecodeLut[Bits&HUFFMAN_LUTMASK];
+		Bits |= ReadBits64(pSrc) << Bitcount;
+		pSrc += (63 - Bitcount) >> 3;
+		Bitcount |= 56;
 
-		// {B} fill with new bits
-		while(Bitcount < 24 && pSrc != pSrcEnd)
+		while(Bitcount >= MinBits)
 		{
-			Bits |= (*pSrc++) << Bitcount;
-			Bitcount += 8;
-		}
-
-		// {C} load symbol now if we didn't that earlier at location {A}
-		if(!pNode)
-			pNode = m_apDecodeLut[Bits&HUFFMAN_LUTMASK];
+			if(pDstEnd - pDst < HUFFMAN_LUTSYMBOLS)
+				goto tail;
 
-		if(!pNode)
-			return -1;
+			const CDecodeEntry *pEntry = &m_aDecodeLut[Bits&HUFFMAN_LUTMASK];
+			if(pEntry->m_NumBits)
+			{
+				for(int i = 0; i < HUFFMAN_LUTSYMBOLS; i++)
+					pDst[i] = pEntry->m_aSymbols[i];
+				pDst += pEntry->m_NumSymbols;
+				Bits >>= pEntry->m_NumBits;
+				Bitcount -= pEntry->m_NumBits;
+
+				if(pEntry->m_Eof)
+					return (int)(pDst - (const unsigned char *)pOutput);
+			}
+			else
+			{
+				// long code, walk the tree bit by bit
+				CNode *pNode = m_pStartNode;
+				do
+				{
+					pNode = &m_aNodes[pNode->m_aLeafs[Bits&1]];
+					Bits >>= 1;
+					Bitcount--;
+				}
+				while(!pNode->m_NumBits);
+
+				if(pNode == pEof)
+					return (int)(pDst - (const unsigned char *)pOutput);
+				*pDst++ = pNode->m_Symbol;
+			}
+		}
+	}
 
-		// {D} check if we hit a symbol already
-		if(pNode->m_NumBits)
+tail:
+	// {B} slow path: decode symbol by symbol. missing input is read as zero bits, except that a
+	// code longer than HUFFMAN_LEGACY_LUTBITS which ends inside its remaining bits is an error
+	while(1)
+	{
+		while(Bitcount <= 56 && pSrc != pSrcEnd)
 		{
-			// remove the bits for that symbol
-			Bits >>= pNode->m_NumBits;
-			Bitcount -= pNode->m_NumBits;
+			Bits |= (unsigned long long)(*pSrc++) << Bitcount;
+			Bitcount += 8;
 		}
-		else
-		{
-			// remove the bits that the lut checked up for us
-			Bits >>= HUFFMAN_LUTBITS;
-			Bitcount -= HUFFMAN_LUTBITS;
 
-			// walk the tree bit by bit
-			while(1)
-			{
-				// traverse tree
-				pNode = &m_aNodes[pNode->m_aLeafs[Bits&1]];
-
-				// remove bit
-				Bitcount--;
-				Bits >>= 1;
+		CNode *pNode = m_pStartNode;
+		for(int Depth = 1; ; Depth++)
+		{
+			pNode = &m_aNodes[pNode->m_aLeafs[Bits&1]];
+			Bits >>= 1;
+			Bitcount--;
 
-				// check if we hit a symbol
-				if(pNode->m_NumBits)
-					break;
+			if(pNode->m_NumBits)
+				break;
 
-				// no more bits, decoding error
-				if(Bitcount == 0)
-					return -1;
-			}
+			// no more bits, decoding error
+			if(Bitcount == 0 && Depth > HUFFMAN_LEGACY_LUTBITS && pSrc == pSrcEnd)
+				return -1;
 		}
 
 		// check for eof
@@ -14,9 +14,13 @@ class CHuffman
 		HUFFMAN_MAX_SYMBOLS=HUFFMAN_EOF_SYMBOL+1,
 		HUFFMAN_MAX_NODES=HUFFMAN_MAX_SYMBOLS*2-1,
 
-		HUFFMAN_LUTBITS = 10,
+		HUFFMAN_LUTBITS = 12,
 		HUFFMAN_LUTSIZE = (1<<HUFFMAN_LUTBITS),
-		HUFFMAN_LUTMASK = (HUFFMAN_LUTSIZE-1)
+		HUFFMAN_LUTMASK = (HUFFMAN_LUTSIZE-1),
+		HUFFMAN_LUTSYMBOLS = 5,
+
+		// table size of the previous decoder, truncated input only fails for codes longer than that
+		HUFFMAN_LEGACY_LUTBITS = 10
 	};
 
 	struct CNode
@@ -32,10 +36,24 @@ class CHuffman
 		unsigned char m_Symbol;
 	};
 
+	// all symbols that fit completely into the next HUFFMAN_LUTBITS bits
+	struct CDecodeEntry
+	{
+		unsigned char m_aSymbols[HUFFMAN_LUTSYMBOLS];
+		unsigned char m_NumSymbols;
+		unsigned char m_NumBits; // 0 if the first symbol is longer than the lut, the tree has to be walked then
+		unsigned char m_Eof; // the symbols are followed by the eof symbol, included in m_NumBits
+	};
+
 	CNode m_aNodes[HUFFMAN_MAX_NODES];
-	CNode *m_apDecodeLut[HUFFMAN_LUTSIZE];
+	CDecodeEntry m_aDecodeLut[HUFFMAN_LUTSIZE];
 	CNode *m_pStartNode;
 	int m_NumNodes;
+	unsigned m_MaxNumBits;
+
+	// codes by symbol, kept apart from the tree so encoding touches less memory
+	unsigned m_aEncodeBits[HUFFMAN_MAX_SYMBOLS];
+	unsigned char m_aEncodeNumBits[HUFFMAN_MAX_SYMBOLS];
 
 	void Setbits_r(CNode *pNode, int Bits, unsigned Depth);
 	void ConstructTree(const unsigned *pFrequencies);
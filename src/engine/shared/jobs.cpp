@@ -8,54 +8,146 @@ CJobPool::CJobPool()
 	// empty the pool
 	m_NumThreads = 0;
 	m_Shutdown = false;
-	m_Lock = lock_create();
-	m_pFirstJob = 0;
-	m_pLastJob = 0;
+	m_NextWorker = 0;
+	for(int i = 0; i < MAX_THREADS; i++)
+	{
+		m_aWorkers[i].m_pPool = this;
+		m_aWorkers[i].m_Index = i;
+		m_aWorkers[i].m_pThread = 0;
+		m_aWorkers[i].m_pFirstJob = 0;
+		m_aWorkers[i].m_pLastJob = 0;
+	}
 }
 
 CJobPool::~CJobPool()
 {
 	m_Shutdown = true;
+	for(int i = 0; i < m_NumThreads; i++)
+		m_Activity.signal();
 	for(int i = 0; i < m_NumThreads; i++)
 	{
-		thread_wait(m_apThreads[i]);
-		thread_destroy(m_apThreads[i]);
+		thread_wait(m_aWorkers[i].m_pThread);
+		thread_destroy(m_aWorkers[i].m_pThread);
 	}
-	lock_destroy(m_Lock);
 }
 
-void CJobPool::WorkerThread(void *pUser)
+CJob *CJobPool::FindJob(int Worker, CJobGroup *pGroup)
 {
-	CJobPool *pPool = (CJobPool *)pUser;
-
-	while(!pPool->m_Shutdown)
+	// take from the front of our own queue first, then steal from the back of the others
+	int NumQueues = m_NumThreads > 0 ? m_NumThreads : 1;
+	int Start = Worker >= 0 ? Worker : 0;
+	for(int i = 0; i < NumQueues; i++)
 	{
-		CJob *pJob = 0;
+		CWorker *pWorker = &m_aWorkers[(Start+i)%NumQueues];
+		if(!pWorker->m_pFirstJob)
+			continue;
+
+		scope_lock Lock(&pWorker->m_Lock);
+		CJob *pJob = (i == 0 && Worker >= 0) ? pWorker->m_pFirstJob : pWorker->m_pLastJob;
+		while(pJob && pGroup && pJob->m_pGroup != pGroup)
+			pJob = pJob->m_pPrev;
+		if(!pJob)
+			continue;
+
+		if(pJob->m_pPrev)
+			pJob->m_pPrev->m_pNext = pJob->m_pNext;
+		else
+			pWorker->m_pFirstJob = pJob->m_pNext;
+		if(pJob->m_pNext)
+			pJob->m_pNext->m_pPrev = pJob->m_pPrev;
+		else
+			pWorker->m_pLastJob = pJob->m_pPrev;
+		return pJob;
+	}
+	return 0;
+}
+
+void CJobPool::Schedule(CJob *pJob, int Worker)
+{
+	// jobs released by a worker run next on that worker, new jobs are spread over all of them
+	int NumQueues = m_NumThreads > 0 ? m_NumThreads : 1;
+	bool Front = Worker >= 0;
+	if(!Front)
+		Worker = atomic_inc(&m_NextWorker)%NumQueues;
 
-		// fetch job from queue
-		lock_wait(pPool->m_Lock);
-		if(pPool->m_pFirstJob)
+	CWorker *pWorker = &m_aWorkers[Worker];
+	{
+		scope_lock Lock(&pWorker->m_Lock);
+		if(Front)
 		{
-			pJob = pPool->m_pFirstJob;
-			pPool->m_pFirstJob = pPool->m_pFirstJob->m_pNext;
-			if(pPool->m_pFirstJob)
-				pPool->m_pFirstJob->m_pPrev = 0;
+			pJob->m_pPrev = 0;
+			pJob->m_pNext = pWorker->m_pFirstJob;
+			if(pWorker->m_pFirstJob)
+				pWorker->m_pFirstJob->m_pPrev = pJob;
 			else
-				pPool->m_pLastJob = 0;
+				pWorker->m_pLastJob = pJob;
+			pWorker->m_pFirstJob = pJob;
 		}
-		lock_unlock(pPool->m_Lock);
-
-		// do the job if we have one
-		if(pJob)
+		else
 		{
-			pJob->m_Status = CJob::STATE_RUNNING;
-			pJob->m_Result = pJob->m_pfnFunc(pJob->m_pFuncData);
-			pJob->m_Status = CJob::STATE_DONE;
+			pJob->m_pNext = 0;
+			pJob->m_pPrev = pWorker->m_pLastJob;
+			if(pWorker->m_pLastJob)
+				pWorker->m_pLastJob->m_pNext = pJob;
+			else
+				pWorker->m_pFirstJob = pJob;
+			pWorker->m_pLastJob = pJob;
 		}
-		else
-			thread_sleep(10);
 	}
 
+	m_Activity.signal();
+}
+
+void CJobPool::Release(CJob *pJob, int Worker)
+{
+	if(atomic_dec(&pJob->m_NumPendingDependencies) == 0)
+		Schedule(pJob, Worker);
+}
+
+void CJobPool::Run(CJob *pJob, int Worker)
+{
+	pJob->m_Status = CJob::STATE_RUNNING;
+	pJob->m_Result = pJob->m_pfnFunc(pJob->m_pFuncData);
+
+	// the job may be reused as soon as it is marked done, so grab everything needed first
+	CJobGroup *pGroup = pJob->m_pGroup;
+	void *pFirstDependent;
+	do
+		pFirstDependent = pJob->m_pFirstDependent;
+	while(atomic_compswap_ptr(&pJob->m_pFirstDependent, pFirstDependent, pJob) != pFirstDependent);
+
+	sync_barrier();
+	pJob->m_Status = CJob::STATE_DONE;
+
+	for(CJob::CDependentLink *pLink = (CJob::CDependentLink *)pFirstDependent; pLink; )
+	{
+		// the link lives in the dependent job, which can start once released
+		CJob::CDependentLink *pNext = pLink->m_pNext;
+		Release(pLink->m_pJob, Worker);
+		pLink = pNext;
+	}
+
+	if(pGroup)
+	{
+		scope_lock Lock(&pGroup->m_Lock);
+		if(atomic_dec(&pGroup->m_NumPending) == 0)
+			pGroup->m_Done.signal();
+	}
+}
+
+void CJobPool::WorkerThread(void *pUser)
+{
+	CWorker *pWorker = (CWorker *)pUser;
+	CJobPool *pPool = pWorker->m_pPool;
+
+	while(!pPool->m_Shutdown)
+	{
+		CJob *pJob = pPool->FindJob(pWorker->m_Index, 0);
+		if(pJob)
+			pPool->Run(pJob, pWorker->m_Index);
+		else
+			pPool->m_Activity.wait();
+	}
 }
 
 int CJobPool::Init(int NumThreads)
@@ -63,27 +155,72 @@ int CJobPool::Init(int NumThreads)
 	// start threads
 	m_NumThreads = NumThreads > MAX_THREADS ? MAX_THREADS : NumThreads;
 	for(int i = 0; i < m_NumThreads; i++)
-		m_apThreads[i] = thread_init(WorkerThread, this);
+		m_aWorkers[i].m_pThread = thread_init(WorkerThread, &m_aWorkers[i]);
 	return 0;
 }
 
-int CJobPool::Add(CJob *pJob, JOBFUNC pfnFunc, void *pData)
+int CJobPool::Add(CJob *pJob, JOBFUNC pfnFunc, void *pData, CJobGroup *pGroup)
+{
+	return AddDependent(pJob, pfnFunc, pData, 0, 0, pGroup);
+}
+
+int CJobPool::AddDependent(CJob *pJob, JOBFUNC pfnFunc, void *pData, CJob **apDependencies, int NumDependencies, CJobGroup *pGroup)
 {
+	if(NumDependencies > CJob::MAX_DEPENDENCIES)
+	{
+		dbg_msg("jobs", "too many dependencies for one job (%d > %d)", NumDependencies, (int)CJob::MAX_DEPENDENCIES);
+		return -1;
+	}
+
 	mem_zero(pJob, sizeof(CJob));
 	pJob->m_pfnFunc = pfnFunc;
 	pJob->m_pFuncData = pData;
+	pJob->m_pGroup = pGroup;
+
+	if(pGroup)
+		atomic_inc(&pGroup->m_NumPending);
 
-	lock_wait(m_Lock);
+	// hold one reference ourselves so the job can't start while the dependencies are registered
+	pJob->m_NumPendingDependencies = NumDependencies+1;
+	for(int i = 0; i < NumDependencies; i++)
+	{
+		CJob *pDependency = apDependencies[i];
+		CJob::CDependentLink *pLink = &pJob->m_aDependentLinks[i];
+		pLink->m_pJob = pJob;
 
-	// add job to queue
-	pJob->m_pPrev = m_pLastJob;
-	if(m_pLastJob)
-		m_pLastJob->m_pNext = pJob;
-	m_pLastJob = pJob;
-	if(!m_pFirstJob)
-		m_pFirstJob = pJob;
+		bool Registered = false;
+		while(true)
+		{
+			void *pFirst = pDependency->m_pFirstDependent;
+			if(pFirst == pDependency)
+				break; // already done
+			pLink->m_pNext = (CJob::CDependentLink *)pFirst;
+			if(atomic_compswap_ptr(&pDependency->m_pFirstDependent, pFirst, pLink) == pFirst)
+			{
+				Registered = true;
+				break;
+			}
+		}
+		if(!Registered)
+			atomic_dec(&pJob->m_NumPendingDependencies);
+	}
 
-	lock_unlock(m_Lock);
+	Release(pJob, -1);
 	return 0;
 }
 
+void CJobPool::Wait(CJobGroup *pGroup)
+{
+	while(!pGroup->Done())
+	{
+		// run jobs of this group on the calling thread rather than only blocking
+		CJob *pJob = FindJob(-1, pGroup);
+		if(pJob)
+			Run(pJob, -1);
+		else
+			pGroup->m_Done.wait();
+	}
+
+	// make sure the thread that finished the last job is done with the group
+	scope_lock Lock(&pGroup->m_Lock);
+}
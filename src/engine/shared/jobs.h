@@ -2,14 +2,48 @@
 /* If you are missing that file, acquire a complete release at teeworlds.com.                */
 #ifndef ENGINE_SHARED_JOBS_H
 #define ENGINE_SHARED_JOBS_H
+#include <base/tl/threading.h>
+
 typedef int (*JOBFUNC)(void *pData);
 
 class CJobPool;
 
+// a set of jobs that can be waited for as a whole, see CJobPool::Wait
+class CJobGroup
+{
+	friend class CJobPool;
+
+	volatile unsigned m_NumPending;
+	lock m_Lock;
+	semaphore m_Done;
+
+public:
+	CJobGroup()
+	{
+		m_NumPending = 0;
+	}
+
+	bool Done() const { return m_NumPending == 0; }
+};
+
 class CJob
 {
 	friend class CJobPool;
 
+public:
+	enum
+	{
+		MAX_DEPENDENCIES=4
+	};
+
+private:
+	// entry in the dependents list of a prerequisite job
+	struct CDependentLink
+	{
+		CJob *m_pJob;
+		CDependentLink *m_pNext;
+	};
+
 	CJob *m_pPrev;
 	CJob *m_pNext;
 
@@ -18,11 +52,20 @@ class CJob
 
 	JOBFUNC m_pfnFunc;
 	void *m_pFuncData;
+
+	CJobGroup *m_pGroup;
+	volatile unsigned m_NumPendingDependencies;
+
+	// first CDependentLink of the jobs waiting for this one, points to the job itself once it is done
+	void * volatile m_pFirstDependent;
+	CDependentLink m_aDependentLinks[MAX_DEPENDENCIES];
+
 public:
 	CJob()
 	{
 		m_Status = STATE_DONE;
 		m_pFuncData = 0;
+		m_pFirstDependent = this;
 	}
 
 	enum
@@ -42,21 +85,43 @@ class CJobPool
 	{
 		MAX_THREADS=32
 	};
+
+	// every worker owns a queue, idle workers steal from the others
+	struct CWorker
+	{
+		CJobPool *m_pPool;
+		int m_Index;
+		void *m_pThread;
+
+		lock m_Lock;
+		CJob *m_pFirstJob;
+		CJob *m_pLastJob;
+	};
+
 	int m_NumThreads;
-	void *m_apThreads[MAX_THREADS];
+	CWorker m_aWorkers[MAX_THREADS];
 	volatile bool m_Shutdown;
-
-	LOCK m_Lock;
-	CJob *m_pFirstJob;
-	CJob *m_pLastJob;
+	volatile unsigned m_NextWorker;
+	semaphore m_Activity;
 
 	static void WorkerThread(void *pUser);
 
+	CJob *FindJob(int Worker, CJobGroup *pGroup);
+	void Schedule(CJob *pJob, int Worker);
+	void Release(CJob *pJob, int Worker);
+	void Run(CJob *pJob, int Worker);
+
 public:
 	CJobPool();
 	~CJobPool();
 
 	int Init(int NumThreads);
-	int Add(CJob *pJob, JOBFUNC pfnFunc, void *pData);
+	int NumThreads() const { return m_NumThreads; }
+
+	int Add(CJob *pJob, JOBFUNC pfnFunc, void *pData, CJobGroup *pGroup = 0);
+	// runs the job once all jobs in apDependencies are done, these must have been added before
+	int AddDependent(CJob *pJob, JOBFUNC pfnFunc, void *pData, CJob **apDependencies, int NumDependencies, CJobGroup *pGroup = 0);
+	// blocks until all jobs of the group are done, helping out with them meanwhile
+	void Wait(CJobGroup *pGroup);
 };
 #endif
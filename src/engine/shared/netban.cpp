@@ -19,101 +19,63 @@ bool CNetBan::StrAllnum(const char *pStr)
 }
 
 
-CNetBan::CNetHash::CNetHash(const NETADDR *pAddr)
+template<class T>
+CNetBan::CBanPool<T>::CBanPool()
 {
-	if(pAddr->type==NETTYPE_IPV4)
-		m_Hash = (pAddr->ip[0]+pAddr->ip[1]+pAddr->ip[2]+pAddr->ip[3])&0xFF;
-	else
-		m_Hash = (pAddr->ip[0]+pAddr->ip[1]+pAddr->ip[2]+pAddr->ip[3]+pAddr->ip[4]+pAddr->ip[5]+pAddr->ip[6]+pAddr->ip[7]+
-			pAddr->ip[8]+pAddr->ip[9]+pAddr->ip[10]+pAddr->ip[11]+pAddr->ip[12]+pAddr->ip[13]+pAddr->ip[14]+pAddr->ip[15])&0xFF;
-	m_HashIndex = 0;
+	m_ppHashList = 0;
+	m_NumBuckets = 0;
+	m_pFirstBlock = 0;
+	Reset();
 }
 
-CNetBan::CNetHash::CNetHash(const CNetRange *pRange)
+template<class T>
+CNetBan::CBanPool<T>::~CBanPool()
 {
-	m_Hash = 0;
-	m_HashIndex = 0;
-	for(int i = 0; pRange->m_LB.ip[i] == pRange->m_UB.ip[i]; ++i)
-	{
-		m_Hash += pRange->m_LB.ip[i];
-		++m_HashIndex;
-	}
-	m_Hash &= 0xFF;
+	Reset();
 }
 
-int CNetBan::CNetHash::MakeHashArray(const NETADDR *pAddr, CNetHash aHash[17])
+template<class T>
+typename CNetBan::CBan<T> *CNetBan::CBanPool<T>::Add(const T *pData, const CBanInfo *pInfo)
 {
-	int Length = pAddr->type==NETTYPE_IPV4 ? 4 : 16;
-	aHash[0].m_Hash = 0;
-	aHash[0].m_HashIndex = 0;
-	for(int i = 1, Sum = 0; i <= Length; ++i)
+	if(!m_pFirstFree)
 	{
-		Sum += pAddr->ip[i-1];
-		aHash[i].m_Hash = Sum&0xFF;
-		aHash[i].m_HashIndex = i%Length;
+		// bans are never moved, so grow by whole blocks
+		CBlock *pBlock = (CBlock *)mem_alloc(sizeof(CBlock), 1);
+		pBlock->m_pNext = m_pFirstBlock;
+		m_pFirstBlock = pBlock;
+		for(int i = 0; i < BLOCK_SIZE; ++i)
+			pBlock->m_aBans[i].m_pNext = i < BLOCK_SIZE-1 ? &pBlock->m_aBans[i+1] : 0;
+		m_pFirstFree = &pBlock->m_aBans[0];
 	}
-	return Length;
-}
-
-
-template<class T, int HashCount>
-typename CNetBan::CBan<T> *CNetBan::CBanPool<T, HashCount>::Add(const T *pData, const CBanInfo *pInfo,  const CNetHash *pNetHash)
-{
-	if(!m_pFirstFree)
-		return 0;
+	if(m_CountUsed >= m_NumBuckets)
+		Rehash(max((int)MIN_BUCKETS, m_NumBuckets*2));
 
 	// create new ban
 	CBan<T> *pBan = m_pFirstFree;
+	m_pFirstFree = pBan->m_pNext;
 	pBan->m_Data = *pData;
 	pBan->m_Info = *pInfo;
-	pBan->m_NetHash = *pNetHash;
-	if(pBan->m_pNext)
-		pBan->m_pNext->m_pPrev = pBan->m_pPrev;
-	if(pBan->m_pPrev)
-		pBan->m_pPrev->m_pNext = pBan->m_pNext;
-	else
-		m_pFirstFree = pBan->m_pNext;
+	pBan->m_paPrefixes = 0;
+	pBan->m_NumPrefixes = 0;
 
 	// add it to the hash list
-	if(m_paaHashList[pNetHash->m_HashIndex][pNetHash->m_Hash])
-		m_paaHashList[pNetHash->m_HashIndex][pNetHash->m_Hash]->m_pHashPrev = pBan;
+	CBan<T> **ppBucket = &m_ppHashList[NetHash(pData)&(m_NumBuckets-1)];
+	if(*ppBucket)
+		(*ppBucket)->m_pHashPrev = pBan;
 	pBan->m_pHashPrev = 0;
-	pBan->m_pHashNext = m_paaHashList[pNetHash->m_HashIndex][pNetHash->m_Hash];
-	m_paaHashList[pNetHash->m_HashIndex][pNetHash->m_Hash] = pBan;
-
-	// insert it into the used list
-	if(m_pFirstUsed)
-	{
-		for(CBan<T> *p = m_pFirstUsed; ; p = p->m_pNext)
-		{
-			if(p->m_Info.m_Expires == CBanInfo::EXPIRES_NEVER || (pInfo->m_Expires != CBanInfo::EXPIRES_NEVER && pInfo->m_Expires <= p->m_Info.m_Expires))
-			{
-				// insert before
-				pBan->m_pNext = p;
-				pBan->m_pPrev = p->m_pPrev;
-				if(p->m_pPrev)
-					p->m_pPrev->m_pNext = pBan;
-				else
-					m_pFirstUsed = pBan;
-				p->m_pPrev = pBan;
-				break;
-			}
-
-			if(!p->m_pNext)
-			{
-				// last entry
-				p->m_pNext = pBan;
-				pBan->m_pPrev = p;
-				pBan->m_pNext = 0;
-				break;
-			}
-		}
-	}
+	pBan->m_pHashNext = *ppBucket;
+	*ppBucket = pBan;
+
+	// append it to the used list
+	pBan->m_pNext = 0;
+	pBan->m_pPrev = m_pLastUsed;
+	if(m_pLastUsed)
+		m_pLastUsed->m_pNext = pBan;
 	else
-	{
 		m_pFirstUsed = pBan;
-		pBan->m_pNext = pBan->m_pPrev = 0;
-	}
+	m_pLastUsed = pBan;
+
+	AddTimer(pBan);
 
 	// update ban count
 	++m_CountUsed;
@@ -121,8 +83,8 @@ typename CNetBan::CBan<T> *CNetBan::CBanPool<T, HashCount>::Add(const T *pData,
 	return pBan;
 }
 
-template<class T, int HashCount>
-int CNetBan::CBanPool<T, HashCount>::Remove(CBan<T> *pBan)
+template<class T>
+int CNetBan::CBanPool<T>::Remove(CBan<T> *pBan)
 {
 	if(pBan == 0)
 		return -1;
@@ -133,20 +95,22 @@ int CNetBan::CBanPool<T, HashCount>::Remove(CBan<T> *pBan)
 	if(pBan->m_pHashPrev)
 		pBan->m_pHashPrev->m_pHashNext = pBan->m_pHashNext;
 	else
-		m_paaHashList[pBan->m_NetHash.m_HashIndex][pBan->m_NetHash.m_Hash] = pBan->m_pHashNext;
+		m_ppHashList[NetHash(&pBan->m_Data)&(m_NumBuckets-1)] = pBan->m_pHashNext;
 	pBan->m_pHashNext = pBan->m_pHashPrev = 0;
 
+	RemoveTimer(pBan);
+
 	// remove from used list
 	if(pBan->m_pNext)
 		pBan->m_pNext->m_pPrev = pBan->m_pPrev;
+	else
+		m_pLastUsed = pBan->m_pPrev;
 	if(pBan->m_pPrev)
 		pBan->m_pPrev->m_pNext = pBan->m_pNext;
 	else
 		m_pFirstUsed = pBan->m_pNext;
 
 	// add to recycle list
-	if(m_pFirstFree)
-		m_pFirstFree->m_pPrev = pBan;
 	pBan->m_pPrev = 0;
 	pBan->m_pNext = m_pFirstFree;
 	m_pFirstFree = pBan;
@@ -157,86 +121,344 @@ int CNetBan::CBanPool<T, HashCount>::Remove(CBan<T> *pBan)
 	return 0;
 }
 
-template<class T, int HashCount>
-void CNetBan::CBanPool<T, HashCount>::Update(CBan<CDataType> *pBan, const CBanInfo *pInfo)
+template<class T>
+void CNetBan::CBanPool<T>::Update(CBan<CDataType> *pBan, const CBanInfo *pInfo)
 {
+	RemoveTimer(pBan);
 	pBan->m_Info = *pInfo;
+	AddTimer(pBan);
+}
 
-	// remove from used list
-	if(pBan->m_pNext)
-		pBan->m_pNext->m_pPrev = pBan->m_pPrev;
-	if(pBan->m_pPrev)
-		pBan->m_pPrev->m_pNext = pBan->m_pNext;
-	else
-		m_pFirstUsed = pBan->m_pNext;
+template<class T>
+void CNetBan::CBanPool<T>::Reset()
+{
+	while(m_pFirstBlock)
+	{
+		CBlock *pNext = m_pFirstBlock->m_pNext;
+		mem_free(m_pFirstBlock);
+		m_pFirstBlock = pNext;
+	}
+	mem_free(m_ppHashList);
+	m_ppHashList = 0;
+	m_NumBuckets = 0;
+	mem_zero(m_apTimerSlots, sizeof(m_apTimerSlots));
+	m_NextExpiryCheck = time_timestamp();
+	m_pFirstFree = 0;
+	m_pFirstUsed = 0;
+	m_pLastUsed = 0;
+	m_CountUsed = 0;
+}
+
+template<class T>
+typename CNetBan::CBan<T> *CNetBan::CBanPool<T>::Get(int Index) const
+{
+	if(Index < 0 || Index >= Num())
+		return 0;
 
-	// insert it into the used list
-	if(m_pFirstUsed)
+	for(CNetBan::CBan<T> *pBan = m_pFirstUsed; pBan; pBan = pBan->m_pNext, --Index)
 	{
-		for(CBan<T> *p = m_pFirstUsed; ; p = p->m_pNext)
+		if(Index == 0)
+			return pBan;
+	}
+
+	return 0;
+}
+
+template<class T>
+typename CNetBan::CBan<T> *CNetBan::CBanPool<T>::NextExpired(int Now)
+{
+	// every slot that got behind is visited once, so bans in it that expire in a later round
+	// are skipped only a few times over their lifetime
+	if(Now-m_NextExpiryCheck > NUM_TIMER_SLOTS)
+		m_NextExpiryCheck = Now-NUM_TIMER_SLOTS;
+	for(; m_NextExpiryCheck < Now; ++m_NextExpiryCheck)
+	{
+		for(CBan<T> *pBan = m_apTimerSlots[m_NextExpiryCheck%NUM_TIMER_SLOTS]; pBan; pBan = pBan->m_pTimerNext)
 		{
-			if(p->m_Info.m_Expires == CBanInfo::EXPIRES_NEVER || (pInfo->m_Expires != CBanInfo::EXPIRES_NEVER && pInfo->m_Expires <= p->m_Info.m_Expires))
-			{
-				// insert before
-				pBan->m_pNext = p;
-				pBan->m_pPrev = p->m_pPrev;
-				if(p->m_pPrev)
-					p->m_pPrev->m_pNext = pBan;
-				else
-					m_pFirstUsed = pBan;
-				p->m_pPrev = pBan;
-				break;
-			}
-
-			if(!p->m_pNext)
-			{
-				// last entry
-				p->m_pNext = pBan;
-				pBan->m_pPrev = p;
-				pBan->m_pNext = 0;
-				break;
-			}
+			if(pBan->m_Info.m_Expires < Now)
+				return pBan;
 		}
 	}
+	return 0;
+}
+
+template<class T>
+void CNetBan::CBanPool<T>::Rehash(int NumBuckets)
+{
+	mem_free(m_ppHashList);
+	m_ppHashList = (CBan<T> **)mem_alloc(NumBuckets*sizeof(CBan<T> *), 1);
+	mem_zero(m_ppHashList, NumBuckets*sizeof(CBan<T> *));
+	m_NumBuckets = NumBuckets;
+
+	for(CBan<T> *pBan = m_pFirstUsed; pBan; pBan = pBan->m_pNext)
+	{
+		CBan<T> **ppBucket = &m_ppHashList[NetHash(&pBan->m_Data)&(m_NumBuckets-1)];
+		if(*ppBucket)
+			(*ppBucket)->m_pHashPrev = pBan;
+		pBan->m_pHashPrev = 0;
+		pBan->m_pHashNext = *ppBucket;
+		*ppBucket = pBan;
+	}
+}
+
+template<class T>
+void CNetBan::CBanPool<T>::AddTimer(CBan<T> *pBan)
+{
+	pBan->m_pTimerPrev = 0;
+	pBan->m_pTimerNext = 0;
+	if(pBan->m_Info.m_Expires == CBanInfo::EXPIRES_NEVER)
+		return;
+
+	CBan<T> **ppSlot = &m_apTimerSlots[pBan->m_Info.m_Expires%NUM_TIMER_SLOTS];
+	if(*ppSlot)
+		(*ppSlot)->m_pTimerPrev = pBan;
+	pBan->m_pTimerNext = *ppSlot;
+	*ppSlot = pBan;
+}
+
+template<class T>
+void CNetBan::CBanPool<T>::RemoveTimer(CBan<T> *pBan)
+{
+	if(pBan->m_Info.m_Expires == CBanInfo::EXPIRES_NEVER)
+		return;
+
+	if(pBan->m_pTimerNext)
+		pBan->m_pTimerNext->m_pTimerPrev = pBan->m_pTimerPrev;
+	if(pBan->m_pTimerPrev)
+		pBan->m_pTimerPrev->m_pTimerNext = pBan->m_pTimerNext;
 	else
+		m_apTimerSlots[pBan->m_Info.m_Expires%NUM_TIMER_SLOTS] = pBan->m_pTimerNext;
+	pBan->m_pTimerNext = pBan->m_pTimerPrev = 0;
+}
+
+
+static inline int AddrBit(const unsigned char *pIp, int Index)
+{
+	return (pIp[Index>>3]>>(7-(Index&7)))&1;
+}
+
+// whether the bits From to To-1 of both addresses are equal
+static bool AddrBitsEqual(const unsigned char *pIp1, const unsigned char *pIp2, int From, int To)
+{
+	for(int i = From; i < To;)
 	{
-		m_pFirstUsed = pBan;
-		pBan->m_pNext = pBan->m_pPrev = 0;
+		int Byte = i>>3;
+		int Diff = pIp1[Byte]^pIp2[Byte];
+		int First = i&7;
+		int Last = min(8, To-(Byte<<3));
+		if(Diff&((0xff>>First)&(0xff<<(8-Last))))
+			return false;
+		i = (Byte+1)<<3;
 	}
+	return true;
 }
 
-template<class T, int HashCount>
-void CNetBan::CBanPool<T, HashCount>::Reset()
+static int AddrCommonBits(const unsigned char *pIp1, const unsigned char *pIp2, int MaxBits)
 {
-	mem_zero(m_paaHashList, sizeof(m_paaHashList));
-	mem_zero(m_aBans, sizeof(m_aBans));
-	m_pFirstUsed = 0;
-	m_CountUsed = 0;
+	int Bits = 0;
+	while(Bits < MaxBits && AddrBit(pIp1, Bits) == AddrBit(pIp2, Bits))
+		Bits++;
+	return Bits;
+}
 
-	for(int i = 1; i < MAX_BANS-1; ++i)
+// sets or clears the lowest Count bits
+static void AddrFillLowBits(unsigned char *pIp, int Bits, int Count, bool Set)
+{
+	for(int i = Bits-Count; i < Bits; i++)
 	{
-		m_aBans[i].m_pNext = &m_aBans[i+1];
-		m_aBans[i].m_pPrev = &m_aBans[i-1];
+		if(Set)
+			pIp[i>>3] |= 0x80>>(i&7);
+		else
+			pIp[i>>3] &= ~(0x80>>(i&7));
 	}
+}
 
-	m_aBans[0].m_pNext = &m_aBans[1];
-	m_aBans[MAX_BANS-1].m_pPrev = &m_aBans[MAX_BANS-2];
-	m_pFirstFree = &m_aBans[0];
+CNetBan::CBanRangePool::CBanRangePool()
+{
+	mem_zero(&m_RootIPV4, sizeof(m_RootIPV4));
+	mem_zero(&m_RootIPV6, sizeof(m_RootIPV6));
 }
 
-template<class T, int HashCount>
-typename CNetBan::CBan<T> *CNetBan::CBanPool<T, HashCount>::Get(int Index) const
+CNetBan::CBanRangePool::~CBanRangePool()
 {
-	if(Index < 0 || Index >= Num())
+	Reset();
+}
+
+CNetBan::CBanRange *CNetBan::CBanRangePool::Add(const CNetRange *pData, const CBanInfo *pInfo)
+{
+	CBanRange *pBan = CBanPool<CNetRange>::Add(pData, pInfo);
+
+	// split the range into the largest aligned blocks, at most two per bit
+	int Bits = pData->m_LB.type==NETTYPE_IPV4 ? 32 : 128;
+	int Bytes = Bits/8;
+	unsigned char aaIps[256][16];
+	int aLengths[256];
+	int NumPrefixes = 0;
+	unsigned char aCur[16];
+	mem_copy(aCur, pData->m_LB.ip, Bytes);
+	while(true)
+	{
+		int Size = 0;
+		while(Size < Bits && !AddrBit(aCur, Bits-1-Size))
+			Size++;
+
+		unsigned char aLast[16];
+		for(;; Size--)
+		{
+			mem_copy(aLast, aCur, Bytes);
+			AddrFillLowBits(aLast, Bits, Size, true);
+			if(mem_comp(aLast, pData->m_UB.ip, Bytes) <= 0)
+				break;
+		}
+
+		mem_copy(aaIps[NumPrefixes], aCur, Bytes);
+		aLengths[NumPrefixes++] = Bits-Size;
+		if(mem_comp(aLast, pData->m_UB.ip, Bytes) == 0)
+			break;
+
+		// continue right after the block
+		mem_copy(aCur, aLast, Bytes);
+		for(int i = Bytes-1; i >= 0 && ++aCur[i] == 0; i--);
+	}
+
+	pBan->m_paPrefixes = (CBanPrefix *)mem_alloc(NumPrefixes*sizeof(CBanPrefix), 1);
+	pBan->m_NumPrefixes = NumPrefixes;
+	for(int i = 0; i < NumPrefixes; i++)
+	{
+		pBan->m_paPrefixes[i].m_pBan = pBan;
+		InsertPrefix(&pBan->m_paPrefixes[i], aaIps[i], aLengths[i], Bits);
+	}
+	return pBan;
+}
+
+int CNetBan::CBanRangePool::Remove(CBanRange *pBan)
+{
+	if(pBan == 0)
+		return -1;
+
+	for(int i = 0; i < pBan->m_NumPrefixes; i++)
+		RemovePrefix(&pBan->m_paPrefixes[i]);
+	mem_free(pBan->m_paPrefixes);
+	pBan->m_paPrefixes = 0;
+	pBan->m_NumPrefixes = 0;
+	return CBanPool<CNetRange>::Remove(pBan);
+}
+
+void CNetBan::CBanRangePool::Reset()
+{
+	for(CBanRange *pBan = First(); pBan; pBan = pBan->m_pNext)
+		mem_free(pBan->m_paPrefixes);
+	FreeNodes(&m_RootIPV4);
+	FreeNodes(&m_RootIPV6);
+	CBanPool<CNetRange>::Reset();
+}
+
+CNetBan::CBanRange *CNetBan::CBanRangePool::Match(const NETADDR *pAddr) const
+{
+	const CTrieNode *pNode;
+	int Bits;
+	if(pAddr->type == NETTYPE_IPV4)
+	{
+		pNode = &m_RootIPV4;
+		Bits = 32;
+	}
+	else if(pAddr->type == NETTYPE_IPV6)
+	{
+		pNode = &m_RootIPV6;
+		Bits = 128;
+	}
+	else
 		return 0;
 
-	for(CNetBan::CBan<T> *pBan = m_pFirstUsed; pBan; pBan = pBan->m_pNext, --Index)
+	const CBanPrefix *pBest = pNode->m_pFirstPrefix;
+	while(pNode->m_Length < Bits)
 	{
-		if(Index == 0)
-			return pBan;
+		const CTrieNode *pChild = pNode->m_apChildren[AddrBit(pAddr->ip, pNode->m_Length)];
+		if(!pChild || !AddrBitsEqual(pChild->m_aPrefix, pAddr->ip, pNode->m_Length+1, pChild->m_Length))
+			break;
+		if(pChild->m_pFirstPrefix)
+			pBest = pChild->m_pFirstPrefix;
+		pNode = pChild;
 	}
+	return pBest ? pBest->m_pBan : 0;
+}
 
-	return 0;
+void CNetBan::CBanRangePool::FreeNodes(CTrieNode *pNode)
+{
+	for(int i = 0; i < 2; i++)
+	{
+		if(pNode->m_apChildren[i])
+		{
+			FreeNodes(pNode->m_apChildren[i]);
+			mem_free(pNode->m_apChildren[i]);
+			pNode->m_apChildren[i] = 0;
+		}
+	}
+	pNode->m_pFirstPrefix = 0;
+}
+
+void CNetBan::CBanRangePool::InsertPrefix(CBanPrefix *pPrefix, const unsigned char *pIp, int Length, int Bits)
+{
+	CTrieNode *pNode = Bits == 32 ? &m_RootIPV4 : &m_RootIPV6;
+	while(pNode->m_Length < Length)
+	{
+		int Side = AddrBit(pIp, pNode->m_Length);
+		CTrieNode *pChild = pNode->m_apChildren[Side];
+		int Common = pChild ? AddrCommonBits(pChild->m_aPrefix, pIp, min(pChild->m_Length, Length)) : 0;
+		if(pChild && Common == pChild->m_Length)
+		{
+			pNode = pChild;
+			continue;
+		}
+
+		// a new leaf, or a node where the path to the existing child branches off
+		CTrieNode *pNew = (CTrieNode *)mem_alloc(sizeof(CTrieNode), 1);
+		mem_zero(pNew, sizeof(CTrieNode));
+		mem_copy(pNew->m_aPrefix, pIp, Bits/8);
+		pNew->m_Length = pChild ? Common : Length;
+		AddrFillLowBits(pNew->m_aPrefix, Bits, Bits-pNew->m_Length, false);
+		pNew->m_pParent = pNode;
+		if(pChild)
+		{
+			pNew->m_apChildren[AddrBit(pChild->m_aPrefix, Common)] = pChild;
+			pChild->m_pParent = pNew;
+		}
+		pNode->m_apChildren[Side] = pNew;
+		pNode = pNew;
+	}
+
+	pPrefix->m_pNode = pNode;
+	pPrefix->m_pPrev = 0;
+	pPrefix->m_pNext = pNode->m_pFirstPrefix;
+	if(pNode->m_pFirstPrefix)
+		pNode->m_pFirstPrefix->m_pPrev = pPrefix;
+	pNode->m_pFirstPrefix = pPrefix;
+}
+
+void CNetBan::CBanRangePool::RemovePrefix(CBanPrefix *pPrefix)
+{
+	CTrieNode *pNode = pPrefix->m_pNode;
+	if(pPrefix->m_pNext)
+		pPrefix->m_pNext->m_pPrev = pPrefix->m_pPrev;
+	if(pPrefix->m_pPrev)
+		pPrefix->m_pPrev->m_pNext = pPrefix->m_pNext;
+	else
+		pNode->m_pFirstPrefix = pPrefix->m_pNext;
+
+	// drop nodes that neither hold prefixes nor branch
+	while(pNode->m_pParent && !pNode->m_pFirstPrefix && !(pNode->m_apChildren[0] && pNode->m_apChildren[1]))
+	{
+		CTrieNode *pParent = pNode->m_pParent;
+		CTrieNode *pChild = pNode->m_apChildren[0] ? pNode->m_apChildren[0] : pNode->m_apChildren[1];
+		pParent->m_apChildren[pParent->m_apChildren[0] == pNode ? 0 : 1] = pChild;
+		mem_free(pNode);
+		if(pChild)
+		{
+			pChild->m_pParent = pParent;
+			break;
+		}
+		pNode = pParent;
+	}
 }
 
 
@@ -310,8 +532,7 @@ int CNetBan::Ban(T *pBanPool, const typename T::CDataType *pData, int Seconds, c
 	str_copy(Info.m_aReason, pReason, sizeof(Info.m_aReason));
 
 	// check if it already exists
-	CNetHash NetHash(pData);
-	CBan<typename T::CDataType> *pBan = pBanPool->Find(pData, &NetHash);
+	CBan<typename T::CDataType> *pBan = pBanPool->Find(pData);
 	if(pBan)
 	{
 		// adjust the ban
@@ -323,24 +544,17 @@ int CNetBan::Ban(T *pBanPool, const typename T::CDataType *pData, int Seconds, c
 	}
 
 	// add ban and print result
-	pBan = pBanPool->Add(pData, &Info, &NetHash);
-	if(pBan)
-	{
-		char aBuf[128];
-		MakeBanInfo(pBan, aBuf, sizeof(aBuf), MSGTYPE_BANADD);
-		Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "net_ban", aBuf);
-		return 0;
-	}
-	else
-		Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "net_ban", "ban failed (full banlist)");
-	return -1;
+	pBan = pBanPool->Add(pData, &Info);
+	char aBuf[128];
+	MakeBanInfo(pBan, aBuf, sizeof(aBuf), MSGTYPE_BANADD);
+	Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "net_ban", aBuf);
+	return 0;
 }
 
 template<class T>
 int CNetBan::Unban(T *pBanPool, const typename T::CDataType *pData)
 {
-	CNetHash NetHash(pData);
-	CBan<typename T::CDataType> *pBan = pBanPool->Find(pData, &NetHash);
+	CBan<typename T::CDataType> *pBan = pBanPool->Find(pData);
 	if(pBan)
 	{
 		char aBuf[256];
@@ -375,21 +589,26 @@ void CNetBan::Init(IConsole *pConsole, IStorage *pStorage)
 
 void CNetBan::Update()
 {
-	int Now = time_timestamp();
+	Update(time_timestamp());
+}
 
+void CNetBan::Update(int Now)
+{
 	// remove expired bans
 	char aBuf[256], aNetStr[256];
-	while(m_BanAddrPool.First() && m_BanAddrPool.First()->m_Info.m_Expires != CBanInfo::EXPIRES_NEVER && m_BanAddrPool.First()->m_Info.m_Expires < Now)
+	CBanAddr *pBanAddr;
+	while((pBanAddr = m_BanAddrPool.NextExpired(Now)))
 	{
-		str_format(aBuf, sizeof(aBuf), "ban %s expired", NetToString(&m_BanAddrPool.First()->m_Data, aNetStr, sizeof(aNetStr)));
+		str_format(aBuf, sizeof(aBuf), "ban %s expired", NetToString(&pBanAddr->m_Data, aNetStr, sizeof(aNetStr)));
 		Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "net_ban", aBuf);
-		m_BanAddrPool.Remove(m_BanAddrPool.First());
+		m_BanAddrPool.Remove(pBanAddr);
 	}
-	while(m_BanRangePool.First() && m_BanRangePool.First()->m_Info.m_Expires != CBanInfo::EXPIRES_NEVER && m_BanRangePool.First()->m_Info.m_Expires < Now)
+	CBanRange *pBanRange;
+	while((pBanRange = m_BanRangePool.NextExpired(Now)))
 	{
-		str_format(aBuf, sizeof(aBuf), "ban %s expired", NetToString(&m_BanRangePool.First()->m_Data, aNetStr, sizeof(aNetStr)));
+		str_format(aBuf, sizeof(aBuf), "ban %s expired", NetToString(&pBanRange->m_Data, aNetStr, sizeof(aNetStr)));
 		Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "net_ban", aBuf);
-		m_BanRangePool.Remove(m_BanRangePool.First());
+		m_BanRangePool.Remove(pBanRange);
 	}
 }
 
@@ -460,11 +679,8 @@ void CNetBan::UnbanAll()
 
 bool CNetBan::IsBanned(const NETADDR *pAddr, char *pBuf, unsigned BufferSize, int *pLastInfoQuery)
 {
-	CNetHash aHash[17];
-	int Length = CNetHash::MakeHashArray(pAddr, aHash);
-
 	// check ban adresses
-	CBanAddr *pBan = m_BanAddrPool.Find(pAddr, &aHash[Length]);
+	CBanAddr *pBan = m_BanAddrPool.Find(pAddr);
 	if(pBan)
 	{
 		MakeBanInfo(pBan, pBuf, BufferSize, MSGTYPE_PLAYER, pLastInfoQuery);
@@ -472,18 +688,13 @@ bool CNetBan::IsBanned(const NETADDR *pAddr, char *pBuf, unsigned BufferSize, in
 	}
 
 	// check ban ranges
-	for(int i = Length-1; i >= 0; --i)
+	CBanRange *pBanRange = m_BanRangePool.Match(pAddr);
+	if(pBanRange)
 	{
-		for(CBanRange *pBan = m_BanRangePool.First(&aHash[i]); pBan; pBan = pBan->m_pHashNext)
-		{
-			if(NetMatch(&pBan->m_Data, pAddr, i, Length))
-			{
-				MakeBanInfo(pBan, pBuf, BufferSize, MSGTYPE_PLAYER, pLastInfoQuery);
-				return true;
-			}
-		}
+		MakeBanInfo(pBanRange, pBuf, BufferSize, MSGTYPE_PLAYER, pLastInfoQuery);
+		return true;
 	}
-	
+
 	return false;
 }
 
@@ -619,7 +830,9 @@ void CNetBan::ConBansSave(IConsole::IResult *pResult, void *pUser)
 }
 
 // explicitly instantiate template for src/engine/server/server.cpp
+template class CNetBan::CBanPool<NETADDR>;
+template class CNetBan::CBanPool<CNetRange>;
 template void CNetBan::MakeBanInfo<CNetRange>(CBan<CNetRange> *pBan, char *pBuf, unsigned BufferSize, int Type, int *pLastInfoQuery);
 template void CNetBan::MakeBanInfo<NETADDR>(CBan<NETADDR> *pBan, char *pBuf, unsigned BufferSize, int Type, int *pLastInfoQuery);
-template int CNetBan::Ban<CNetBan::CBanPool<NETADDR, 1> >(CNetBan::CBanPool<NETADDR, 1> *pBanPool, const NETADDR *pData, int Seconds, const char *pReason);
-template int CNetBan::Ban<CNetBan::CBanPool<CNetRange, 16> >(CNetBan::CBanPool<CNetRange, 16> *pBanPool, const CNetRange *pData, int Seconds, const char *pReason);
+template int CNetBan::Ban<CNetBan::CBanAddrPool>(CNetBan::CBanAddrPool *pBanPool, const NETADDR *pData, int Seconds, const char *pReason);
+template int CNetBan::Ban<CNetBan::CBanRangePool>(CNetBan::CBanRangePool *pBanPool, const CNetRange *pData, int Seconds, const char *pReason);
@@ -63,18 +63,19 @@ protected:
 	// todo: move?
 	static bool StrAllnum(const char *pStr);
 
-	class CNetHash
+	static unsigned NetHash(const NETADDR *pAddr)
 	{
-	public:
-		int m_Hash;
-		int m_HashIndex;	// matching parts for ranges, 0 for addr
-
-		CNetHash() {}	
-		CNetHash(const NETADDR *pAddr);
-		CNetHash(const CNetRange *pRange);
+		// fnv-1a over the bytes NetComp looks at
+		unsigned Hash = 2166136261u^pAddr->type;
+		for(int i = 0; i < (pAddr->type==NETTYPE_IPV4 ? 4 : 16); i++)
+			Hash = (Hash^pAddr->ip[i])*16777619u;
+		return Hash;
+	}
 
-		static int MakeHashArray(const NETADDR *pAddr, CNetHash aHash[17]);
-	};
+	static unsigned NetHash(const CNetRange *pRange)
+	{
+		return NetHash(&pRange->m_LB)*31+NetHash(&pRange->m_UB);
+	}
 
 	struct CBanInfo
 	{
@@ -85,42 +86,54 @@ protected:
 		};
 		int m_Expires;
 		int m_LastInfoQuery;
-		char m_aReason[REASON_LENGTH];		
+		char m_aReason[REASON_LENGTH];
 	};
 
+	struct CBanPrefix;
+
 	template<class T> struct CBan
 	{
 		T m_Data;
 		CBanInfo m_Info;
-		CNetHash m_NetHash;
 
 		// hash list
 		CBan *m_pHashNext;
 		CBan *m_pHashPrev;
 
+		// expiry slot list
+		CBan *m_pTimerNext;
+		CBan *m_pTimerPrev;
+
 		// used or free list
 		CBan *m_pNext;
 		CBan *m_pPrev;
+
+		// prefixes of a range in the range trie
+		CBanPrefix *m_paPrefixes;
+		int m_NumPrefixes;
 	};
 
-	template<class T, int HashCount> class CBanPool
+	template<class T> class CBanPool
 	{
 	public:
 		typedef T CDataType;
 
-		CBan<CDataType> *Add(const CDataType *pData, const CBanInfo *pInfo, const CNetHash *pNetHash);
+		CBanPool();
+		~CBanPool();
+
+		CBan<CDataType> *Add(const CDataType *pData, const CBanInfo *pInfo);
 		int Remove(CBan<CDataType> *pBan);
 		void Update(CBan<CDataType> *pBan, const CBanInfo *pInfo);
 		void Reset();
-	
+
 		int Num() const { return m_CountUsed; }
-		bool IsFull() const { return m_CountUsed == MAX_BANS; }
 
 		CBan<CDataType> *First() const { return m_pFirstUsed; }
-		CBan<CDataType> *First(const CNetHash *pNetHash) const { return m_paaHashList[pNetHash->m_HashIndex][pNetHash->m_Hash]; }
-		CBan<CDataType> *Find(const CDataType *pData, const CNetHash *pNetHash) const
+		CBan<CDataType> *Find(const CDataType *pData) const
 		{
-			for(CBan<CDataType> *pBan = m_paaHashList[pNetHash->m_HashIndex][pNetHash->m_Hash]; pBan; pBan = pBan->m_pHashNext)
+			if(!m_NumBuckets)
+				return 0;
+			for(CBan<CDataType> *pBan = m_ppHashList[NetHash(pData)&(m_NumBuckets-1)]; pBan; pBan = pBan->m_pHashNext)
 			{
 				if(NetComp(&pBan->m_Data, pData) == 0)
 					return pBan;
@@ -130,24 +143,85 @@ protected:
 		}
 		CBan<CDataType> *Get(int Index) const;
 
+		// returns a ban that expired before Now, call Remove on it before asking for the next one
+		CBan<CDataType> *NextExpired(int Now);
+
 	private:
 		enum
 		{
-			MAX_BANS=1024,
+			BLOCK_SIZE=256,
+			MIN_BUCKETS=256,
+			NUM_TIMER_SLOTS=4096, // one per second, bans further in the future stay in their slot for more rounds
+		};
+
+		struct CBlock
+		{
+			CBlock *m_pNext;
+			CBan<CDataType> m_aBans[BLOCK_SIZE];
 		};
 
-		CBan<CDataType> *m_paaHashList[HashCount][256];
-		CBan<CDataType> m_aBans[MAX_BANS];
+		void Rehash(int NumBuckets);
+		void AddTimer(CBan<CDataType> *pBan);
+		void RemoveTimer(CBan<CDataType> *pBan);
+
+		CBan<CDataType> **m_ppHashList;
+		int m_NumBuckets;
+		CBan<CDataType> *m_apTimerSlots[NUM_TIMER_SLOTS];
+		int m_NextExpiryCheck;
+		CBlock *m_pFirstBlock;
 		CBan<CDataType> *m_pFirstFree;
 		CBan<CDataType> *m_pFirstUsed;
+		CBan<CDataType> *m_pLastUsed;
 		int m_CountUsed;
 	};
 
-	typedef CBanPool<NETADDR, 1> CBanAddrPool;
-	typedef CBanPool<CNetRange, 16> CBanRangePool;
 	typedef CBan<NETADDR> CBanAddr;
 	typedef CBan<CNetRange> CBanRange;
-	
+
+	// node of a path compressed binary trie over the address bits
+	struct CTrieNode
+	{
+		unsigned char m_aPrefix[16];
+		int m_Length; // in bits
+		CTrieNode *m_pParent;
+		CTrieNode *m_apChildren[2];
+		CBanPrefix *m_pFirstPrefix;
+	};
+
+	// one of the aligned blocks a range is split up into
+	struct CBanPrefix
+	{
+		CBanRange *m_pBan;
+		CTrieNode *m_pNode;
+		CBanPrefix *m_pNext;
+		CBanPrefix *m_pPrev;
+	};
+
+	typedef CBanPool<NETADDR> CBanAddrPool;
+
+	// additionally keeps the ranges in a trie per address type, so matching an address
+	// only walks down its own bits and the most specific range wins
+	class CBanRangePool : public CBanPool<CNetRange>
+	{
+	public:
+		CBanRangePool();
+		~CBanRangePool();
+
+		CBanRange *Add(const CNetRange *pData, const CBanInfo *pInfo);
+		int Remove(CBanRange *pBan);
+		void Reset();
+
+		CBanRange *Match(const NETADDR *pAddr) const;
+
+	private:
+		void FreeNodes(CTrieNode *pNode);
+		void InsertPrefix(CBanPrefix *pPrefix, const unsigned char *pIp, int Length, int Bits);
+		void RemovePrefix(CBanPrefix *pPrefix);
+
+		CTrieNode m_RootIPV4;
+		CTrieNode m_RootIPV6;
+	};
+
 	template<class T> void MakeBanInfo(CBan<T> *pBan, char *pBuf, unsigned BuffSize, int Type, int *pLastInfoQuery=0);
 	template<class T> int Ban(T *pBanPool, const typename T::CDataType *pData, int Seconds, const char *pReason);
 	template<class T> int Unban(T *pBanPool, const typename T::CDataType *pData);
@@ -173,6 +247,7 @@ public:
 	virtual ~CNetBan() {}
 	void Init(class IConsole *pConsole, class IStorage *pStorage);
 	void Update();
+	void Update(int Now); // removes the bans that expired before the given timestamp
 
 	virtual int BanAddr(const NETADDR *pAddr, int Seconds, const char *pReason);
 	virtual int BanRange(const CNetRange *pRange, int Seconds, const char *pReason);
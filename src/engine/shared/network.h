@@ -61,6 +61,7 @@ enum
 	NETBANTYPE_DROP=2,
 
 	NETCREATE_FLAG_RANDOMPORT=1,
+	NETCREATE_FLAG_REUSEPORT=2,
 };
 
 
@@ -214,6 +215,64 @@ private:
 	int64 m_NextSeedTime;
 };
 
+// stateless rate limiting of the traffic that is not part of a connection. the token buckets
+// per address and per subnet (/24 or /48) are kept in count-min sketches, so the memory use is
+// fixed and collisions can only make the limit kick in early, never late
+class CNetFloodFilter
+{
+public:
+	enum
+	{
+		FLOOD_NONE=0,
+		FLOOD_ADDR,
+		FLOOD_SUBNET,
+	};
+
+	void Init();
+	// a rate of 0 disables the check
+	void SetLimits(int Rate, int Burst, int SubnetRate, int SubnetBurst);
+
+	// counts the packet if it is within both limits, otherwise returns which one it exceeds
+	int Check(const NETADDR *pAddr, int64 Now);
+
+private:
+	enum
+	{
+		SKETCH_DEPTH=4,
+		SKETCH_WIDTH=2048,
+	};
+
+	struct CBucket
+	{
+		float m_Level;
+		int64 m_LastUpdate;
+	};
+
+	struct CSketch
+	{
+		float m_Rate; // per tick of time_get()
+		float m_Burst;
+		CBucket m_aaBuckets[SKETCH_DEPTH][SKETCH_WIDTH];
+
+		bool Allow(unsigned Hash, int64 Now);
+	};
+
+	unsigned Hash(const NETADDR *pAddr, int Length) const;
+
+	unsigned m_Seed;
+	CSketch m_Addr;
+	CSketch m_Subnet;
+};
+
+struct CNetFloodStats
+{
+	int64 m_Received;
+	int64 m_RateLimited;
+	int64 m_SubnetRateLimited;
+	int64 m_Banned;
+	int64 m_InvalidToken;
+};
+
 typedef void(*FSendCallback)(int TrackID, void *pUser);
 struct CSendCBData
 {
@@ -424,6 +483,9 @@ class CNetServer
 	CNetTokenManager m_TokenManager;
 	CNetTokenCache m_TokenCache;
 
+	CNetFloodFilter m_FloodFilter;
+	CNetFloodStats m_FloodStats;
+
 	int m_Flags;
 public:
 	int SetCallbacks(NETFUNC_NEWCLIENT pfnNewClient, NETFUNC_DELCLIENT pfnDelClient, void *pUser);
@@ -448,8 +510,11 @@ public:
 	int NetType() const { return m_Socket.type; }
 	int MaxClients() const { return m_MaxClients; }
 
+	const CNetFloodStats *FloodStats() const { return &m_FloodStats; }
+
 	//
 	void SetMaxClientsPerIP(int Max);
+	void SetFloodLimits(int Rate, int Burst, int SubnetRate, int SubnetBurst) { m_FloodFilter.SetLimits(Rate, Burst, SubnetRate, SubnetBurst); }
 };
 
 class CNetConsole
@@ -7,7 +7,10 @@ bool CNetClient::Open(NETADDR BindAddr, int Flags)
 {
 	// open socket
 	NETSOCKET Socket;
-	Socket = net_udp_create(BindAddr, (Flags&NETCREATE_FLAG_RANDOMPORT) ? 1 : 0);
+	if(Flags&NETCREATE_FLAG_REUSEPORT)
+		Socket = net_udp_create_reuseport(BindAddr);
+	else
+		Socket = net_udp_create(BindAddr, (Flags&NETCREATE_FLAG_RANDOMPORT) ? 1 : 0);
 	if(!Socket.type)
 		return false;
 
@@ -0,0 +1,78 @@
+/* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
+/* If you are missing that file, acquire a complete release at teeworlds.com.                */
+#include <base/math.h>
+#include <base/system.h>
+
+#include "network.h"
+
+void CNetFloodFilter::Init()
+{
+	secure_random_fill(&m_Seed, sizeof(m_Seed));
+	mem_zero(&m_Addr, sizeof(m_Addr));
+	mem_zero(&m_Subnet, sizeof(m_Subnet));
+}
+
+void CNetFloodFilter::SetLimits(int Rate, int Burst, int SubnetRate, int SubnetBurst)
+{
+	m_Addr.m_Rate = Rate/(float)time_freq();
+	m_Addr.m_Burst = max(Burst, 1);
+	m_Subnet.m_Rate = SubnetRate/(float)time_freq();
+	m_Subnet.m_Burst = max(SubnetBurst, 1);
+}
+
+int CNetFloodFilter::Check(const NETADDR *pAddr, int64 Now)
+{
+	// the address first, so a single flooding host does not use up the budget of its subnet
+	bool IPV4 = pAddr->type == NETTYPE_IPV4;
+	if(!m_Addr.Allow(Hash(pAddr, IPV4 ? 4 : 16), Now))
+		return FLOOD_ADDR;
+	if(!m_Subnet.Allow(Hash(pAddr, IPV4 ? 3 : 6), Now))
+		return FLOOD_SUBNET;
+	return FLOOD_NONE;
+}
+
+unsigned CNetFloodFilter::Hash(const NETADDR *pAddr, int Length) const
+{
+	// seeded, so nobody can pick addresses that share the buckets of someone else
+	unsigned Hash = (m_Seed^pAddr->type^Length)*16777619u;
+	for(int i = 0; i < Length; i++)
+		Hash = (Hash^pAddr->ip[i])*16777619u;
+	Hash ^= Hash>>16;
+	Hash *= 0x85ebca6bu;
+	Hash ^= Hash>>13;
+	Hash *= 0xc2b2ae35u;
+	Hash ^= Hash>>16;
+	return Hash;
+}
+
+bool CNetFloodFilter::CSketch::Allow(unsigned Hash, int64 Now)
+{
+	if(m_Rate <= 0.0f)
+		return true;
+
+	// every bucket an address maps to is shared with other ones, so the emptiest is the
+	// closest to its own level
+	CBucket *apBuckets[SKETCH_DEPTH];
+	float aLevels[SKETCH_DEPTH];
+	float Estimate = 0.0f;
+	for(int i = 0; i < SKETCH_DEPTH; i++)
+	{
+		apBuckets[i] = &m_aaBuckets[i][Hash&(SKETCH_WIDTH-1)];
+		Hash = (Hash^(Hash>>15))*0x2c1b3c6du+0x297a2d39u;
+
+		float Drained = (Now-apBuckets[i]->m_LastUpdate)*m_Rate;
+		aLevels[i] = apBuckets[i]->m_Level > Drained ? apBuckets[i]->m_Level-Drained : 0.0f;
+		Estimate = i == 0 ? aLevels[i] : min(Estimate, aLevels[i]);
+	}
+
+	if(Estimate+1.0f > m_Burst)
+		return false;
+
+	// conservative update, only raise the buckets that are below the new estimate
+	for(int i = 0; i < SKETCH_DEPTH; i++)
+	{
+		apBuckets[i]->m_Level = max(aLevels[i], Estimate+1.0f);
+		apBuckets[i]->m_LastUpdate = Now;
+	}
+	return true;
+}
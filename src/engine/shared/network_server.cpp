@@ -20,6 +20,7 @@ bool CNetServer::Open(NETADDR BindAddr, CNetBan *pNetBan, int MaxClients, int Ma
 
 	m_TokenManager.Init(m_Socket);
 	m_TokenCache.Init(m_Socket, &m_TokenManager);
+	m_FloodFilter.Init();
 
 	m_pNetBan = pNetBan;
 
@@ -101,6 +102,7 @@ int CNetServer::Update()
 */
 int CNetServer::Recv(CNetChunk *pChunk, TOKEN *pResponseToken)
 {
+	int64 Now = time_get();
 	while(1)
 	{
 		NETADDR Addr;
@@ -115,6 +117,22 @@ int CNetServer::Recv(CNetChunk *pChunk, TOKEN *pResponseToken)
 		// no more packets for now
 		if(Bytes <= 0)
 			break;
+		m_FloodStats.m_Received++;
+
+		// rate limit connless and control packets before doing any work on them, they are
+		// what floods consist of and connections only send a few of them
+		if((m_RecvUnpacker.m_aBuffer[0]>>2)&(NET_PACKETFLAG_CONNLESS|NET_PACKETFLAG_CONTROL))
+		{
+			int Flood = m_FloodFilter.Check(&Addr, Now);
+			if(Flood != CNetFloodFilter::FLOOD_NONE)
+			{
+				if(Flood == CNetFloodFilter::FLOOD_ADDR)
+					m_FloodStats.m_RateLimited++;
+				else
+					m_FloodStats.m_SubnetRateLimited++;
+				continue;
+			}
+		}
 
 		if(CNetBase::UnpackPacket(m_RecvUnpacker.m_aBuffer, Bytes, &m_RecvUnpacker.m_Data) == 0)
 		{
@@ -129,6 +147,7 @@ int CNetServer::Recv(CNetChunk *pChunk, TOKEN *pResponseToken)
 				{
 					CNetBase::SendControlMsg(m_Socket, &Addr, m_RecvUnpacker.m_Data.m_ResponseToken, 0, NET_CTRLMSG_CLOSE, aBuf, str_length(aBuf) + 1);
 				}
+				m_FloodStats.m_Banned++;
 				continue;
 			}
 
@@ -161,12 +180,17 @@ int CNetServer::Recv(CNetChunk *pChunk, TOKEN *pResponseToken)
 				}
 			}
 
-			if(Found)
+			// connection packets from unknown addresses have nothing to do, not even the token check
+			if(Found || !(m_RecvUnpacker.m_Data.m_Flags&(NET_PACKETFLAG_CONNLESS|NET_PACKETFLAG_CONTROL)))
 				continue;
 
 			int Accept = m_TokenManager.ProcessMessage(&Addr, &m_RecvUnpacker.m_Data);
 			if(Accept <= 0)
+			{
+				if(Accept == 0 && m_RecvUnpacker.m_Data.m_Token != NET_TOKEN_NONE)
+					m_FloodStats.m_InvalidToken++;
 				continue;
+			}
 
 			if(m_RecvUnpacker.m_Data.m_Flags&NET_PACKETFLAG_CONTROL)
 			{
@@ -4,20 +4,54 @@
 #include <base/math.h>
 #include <base/system.h>
 
-#include <engine/external/md5/md5.h>
-
 #include "network.h"
 
-static unsigned int Hash(char *pData, int Size)
+typedef unsigned long long U64;
+
+static inline U64 Rotl(U64 x, int b)
 {
-	md5_state_t State;
-	unsigned int aDigest[4]; // make sure this is 16 byte
+	return (x<<b)|(x>>(64-b));
+}
 
-	md5_init(&State);
-	md5_append(&State, (const md5_byte_t *)pData, Size);
-	md5_finish(&State, (md5_byte_t *)aDigest);
+static inline void SipRound(U64 &v0, U64 &v1, U64 &v2, U64 &v3)
+{
+	v0 += v1; v1 = Rotl(v1, 13); v1 ^= v0; v0 = Rotl(v0, 32);
+	v2 += v3; v3 = Rotl(v3, 16); v3 ^= v2;
+	v0 += v3; v3 = Rotl(v3, 21); v3 ^= v0;
+	v2 += v1; v1 = Rotl(v1, 17); v1 ^= v2; v2 = Rotl(v2, 32);
+}
 
-	return (aDigest[0] ^ aDigest[1] ^ aDigest[2] ^ aDigest[3]);
+// siphash-2-4 of the address, keyed with the seed. it is checked for every packet
+// that claims to have a token, so it has to be cheap without being guessable
+static unsigned int Hash(const NETADDR *pAddr, int64 Seed)
+{
+	U64 aWords[3];
+	aWords[0] = pAddr->type;
+	mem_copy(&aWords[1], pAddr->ip, sizeof(pAddr->ip));
+
+	U64 k0 = (U64)Seed;
+	U64 k1 = ~(U64)Seed;
+	U64 v0 = k0^0x736f6d6570736575ULL;
+	U64 v1 = k1^0x646f72616e646f6dULL;
+	U64 v2 = k0^0x6c7967656e657261ULL;
+	U64 v3 = k1^0x7465646279746573ULL;
+	for(int i = 0; i < 3; i++)
+	{
+		v3 ^= aWords[i];
+		SipRound(v0, v1, v2, v3);
+		SipRound(v0, v1, v2, v3);
+		v0 ^= aWords[i];
+	}
+	U64 Last = (U64)sizeof(aWords)<<56;
+	v3 ^= Last;
+	SipRound(v0, v1, v2, v3);
+	SipRound(v0, v1, v2, v3);
+	v0 ^= Last;
+	v2 ^= 0xff;
+	for(int i = 0; i < 4; i++)
+		SipRound(v0, v1, v2, v3);
+	U64 Result = v0^v1^v2^v3;
+	return (unsigned int)(Result^(Result>>32));
 }
 
 int CNetTokenCache::CConnlessPacketInfo::m_UniqueID = 0;
@@ -93,19 +127,12 @@ TOKEN CNetTokenManager::GenerateToken(const NETADDR *pAddr) const
 TOKEN CNetTokenManager::GenerateToken(const NETADDR *pAddr, int64 Seed)
 {
 	static const NETADDR NullAddr = { 0 };
-	NETADDR Addr;
-	char aBuf[sizeof(NETADDR) + sizeof(int64)];
 	unsigned int Result;
 
 	if(pAddr->type & NETTYPE_LINK_BROADCAST)
 		return GenerateToken(&NullAddr, Seed);
 
-	Addr = *pAddr;
-	Addr.port = 0;
-	mem_copy(aBuf, &Addr, sizeof(NETADDR));
-	mem_copy(aBuf + sizeof(NETADDR), &Seed, sizeof(int64));
-
-	Result = Hash(aBuf, sizeof(aBuf)) & NET_TOKEN_MASK;
+	Result = Hash(pAddr, Seed) & NET_TOKEN_MASK;
 	if(Result == NET_TOKEN_NONE)
 		Result--;
 
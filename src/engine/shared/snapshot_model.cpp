@@ -0,0 +1,123 @@
+/* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
+/* If you are missing that file, acquire a complete release at teeworlds.com.                */
+#include <base/math.h>
+#include <base/system.h>
+
+#include <engine/storage.h>
+
+#include "packer.h"
+#include "snapshot_model.h"
+
+static const unsigned char gs_aModelMarker[8] = {'T', 'W', 'S', 'N', 'A', 'P', 'M', 'D'};
+
+static unsigned ReadUint(const unsigned char *pData)
+{
+	return (pData[0]<<24) | (pData[1]<<16) | (pData[2]<<8) | pData[3];
+}
+
+static void WriteUint(unsigned char *pData, unsigned Value)
+{
+	pData[0] = (Value>>24)&0xff;
+	pData[1] = (Value>>16)&0xff;
+	pData[2] = (Value>>8)&0xff;
+	pData[3] = Value&0xff;
+}
+
+CSnapshotModel::CSnapshotModel()
+{
+	mem_zero(m_aFrequencies, sizeof(m_aFrequencies));
+	m_Valid = false;
+}
+
+void CSnapshotModel::Train(const int64 *pByteCounts)
+{
+	int64 MaxCount = 1;
+	for(int i = 0; i < NUM_SYMBOLS; i++)
+		MaxCount = max(MaxCount, pByteCounts[i]);
+
+	// every byte has to stay encodable
+	unsigned aFrequencies[NUM_SYMBOLS];
+	for(int i = 0; i < NUM_SYMBOLS; i++)
+		aFrequencies[i] = max(1, (int)(pByteCounts[i]*MAX_FREQUENCY/MaxCount));
+	Init(aFrequencies);
+}
+
+bool CSnapshotModel::Init(const unsigned *pFrequencies)
+{
+	for(int i = 0; i < NUM_SYMBOLS; i++)
+	{
+		if(pFrequencies[i] < 1 || pFrequencies[i] > MAX_FREQUENCY)
+		{
+			m_Valid = false;
+			return false;
+		}
+	}
+
+	mem_copy(m_aFrequencies, pFrequencies, sizeof(m_aFrequencies));
+	m_Huffman.Init(m_aFrequencies);
+	m_Valid = true;
+	return true;
+}
+
+bool CSnapshotModel::Load(IStorage *pStorage, const char *pFilename, int StorageType)
+{
+	m_Valid = false;
+	IOHANDLE File = pStorage->OpenFile(pFilename, IOFLAG_READ, StorageType);
+	if(!File)
+		return false;
+
+	unsigned char aData[sizeof(gs_aModelMarker)+4+NUM_SYMBOLS*4];
+	bool Read = io_read(File, aData, sizeof(aData)) == sizeof(aData);
+	io_close(File);
+	if(!Read || mem_comp(aData, gs_aModelMarker, sizeof(gs_aModelMarker)) != 0)
+		return false;
+
+	const unsigned char *pData = aData+sizeof(gs_aModelMarker);
+	if(ReadUint(pData) != VERSION)
+		return false;
+
+	unsigned aFrequencies[NUM_SYMBOLS];
+	for(int i = 0; i < NUM_SYMBOLS; i++)
+		aFrequencies[i] = ReadUint(pData+4+i*4);
+	return Init(aFrequencies);
+}
+
+bool CSnapshotModel::Save(IStorage *pStorage, const char *pFilename) const
+{
+	if(!m_Valid)
+		return false;
+
+	IOHANDLE File = pStorage->OpenFile(pFilename, IOFLAG_WRITE, IStorage::TYPE_SAVE);
+	if(!File)
+		return false;
+
+	unsigned char aData[sizeof(gs_aModelMarker)+4+NUM_SYMBOLS*4];
+	mem_copy(aData, gs_aModelMarker, sizeof(gs_aModelMarker));
+	WriteUint(aData+sizeof(gs_aModelMarker), VERSION);
+	for(int i = 0; i < NUM_SYMBOLS; i++)
+		WriteUint(aData+sizeof(gs_aModelMarker)+4+i*4, m_aFrequencies[i]);
+	bool Written = io_write(File, aData, sizeof(aData)) == sizeof(aData);
+	io_close(File);
+	return Written;
+}
+
+void CSnapshotModel::Pack(CPacker *pPacker) const
+{
+	pPacker->AddInt(VERSION);
+	for(int i = 0; i < NUM_SYMBOLS; i++)
+		pPacker->AddInt(m_aFrequencies[i]);
+}
+
+bool CSnapshotModel::Unpack(CUnpacker *pUnpacker)
+{
+	m_Valid = false;
+	if(pUnpacker->GetInt() != VERSION)
+		return false;
+
+	unsigned aFrequencies[NUM_SYMBOLS];
+	for(int i = 0; i < NUM_SYMBOLS; i++)
+		aFrequencies[i] = pUnpacker->GetInt();
+	if(pUnpacker->Error())
+		return false;
+	return Init(aFrequencies);
+}
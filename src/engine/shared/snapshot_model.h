@@ -0,0 +1,47 @@
+/* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
+/* If you are missing that file, acquire a complete release at teeworlds.com.                */
+#ifndef ENGINE_SHARED_SNAPSHOT_MODEL_H
+#define ENGINE_SHARED_SNAPSHOT_MODEL_H
+
+#include <base/system.h>
+
+#include "huffman.h"
+
+// huffman model trained on the int packed snapshot deltas of a gametype. the server sends
+// it to clients that announced support and compresses their snapshots with it afterwards
+class CSnapshotModel
+{
+public:
+	enum
+	{
+		VERSION=1,
+		NUM_SYMBOLS=256,
+		MAX_FREQUENCY=1<<12, // keeps the codes short enough for CHuffman
+	};
+
+private:
+	unsigned m_aFrequencies[NUM_SYMBOLS];
+	CHuffman m_Huffman;
+	bool m_Valid;
+
+public:
+	CSnapshotModel();
+
+	bool IsValid() const { return m_Valid; }
+	void Reset() { m_Valid = false; }
+
+	// scales down the byte counts of training data and builds the model from them
+	void Train(const int64 *pByteCounts);
+	bool Init(const unsigned *pFrequencies);
+
+	bool Load(class IStorage *pStorage, const char *pFilename, int StorageType);
+	bool Save(class IStorage *pStorage, const char *pFilename) const;
+
+	void Pack(class CPacker *pPacker) const;
+	bool Unpack(class CUnpacker *pUnpacker);
+
+	int Compress(const void *pInput, int InputSize, void *pOutput, int OutputSize) { return m_Huffman.Compress(pInput, InputSize, pOutput, OutputSize); }
+	int Decompress(const void *pInput, int InputSize, void *pOutput, int OutputSize) { return m_Huffman.Decompress(pInput, InputSize, pOutput, OutputSize); }
+};
+
+#endif
@@ -9,6 +9,7 @@
 #include <engine/textrender.h>
 #include <engine/external/json-parser/json.h>
 #include <engine/shared/config.h>
+#include <game/client/imageloader.h>
 
 #include "countryflags.h"
 
@@ -41,7 +42,10 @@ void CCountryFlags::LoadCountryflagsIndexfile()
 		return;
 	}
 
-	// extract data
+	// extract data, the flags are decoded meanwhile
+	CImageLoader ImageLoader(m_pClient->Engine(), Graphics());
+	array<CCountryFlag> aFlags;
+	array<int> aFlagImages;
 	const json_value &rInit = (*pJsonData)["country codes"];
 	if(rInit.type == json_object)
 	{
@@ -73,34 +77,20 @@ void CCountryFlags::LoadCountryflagsIndexfile()
 					CCountryFlag CountryFlag;
 					CountryFlag.m_CountryCode = CountryCode;
 					str_copy(CountryFlag.m_aCountryCodeString, pCountryName, sizeof(CountryFlag.m_aCountryCodeString));
+					int Image = -1;
 					if(g_Config.m_ClLoadCountryFlags)
 					{
 						// load the graphic file
-						CImageInfo Info;
 						str_format(aBuf, sizeof(aBuf), "countryflags/%s.png", pCountryName);
-						if(!Graphics()->LoadPNG(&Info, aBuf, IStorage::TYPE_ALL))
-						{
-							char aMsg[64];
-							str_format(aMsg, sizeof(aMsg), "failed to load '%s'", aBuf);
-							Console()->Print(IConsole::OUTPUT_LEVEL_ADDINFO, "countryflags", aMsg);
-							continue;
-						}
-						CountryFlag.m_Texture = Graphics()->LoadTextureRaw(Info.m_Width, Info.m_Height, Info.m_Format, Info.m_pData, Info.m_Format, 0);
-						mem_free(Info.m_pData);
+						Image = ImageLoader.Add(aBuf, IStorage::TYPE_ALL);
 					}
 					// blocked?
 					CountryFlag.m_Blocked = false;
 					const json_value Check = rStart[i]["blocked"];
 					if(Check.type == json_boolean && Check)
 						CountryFlag.m_Blocked = true;
-					m_aCountryFlags.add_unsorted(CountryFlag);
-
-					// print message
-					if(g_Config.m_Debug)
-					{
-						str_format(aBuf, sizeof(aBuf), "loaded country flag '%s'", pCountryName);
-						Console()->Print(IConsole::OUTPUT_LEVEL_ADDINFO, "countryflags", aBuf);
-					}
+					aFlags.add(CountryFlag);
+					aFlagImages.add(Image);
 				}
 			}
 		}
@@ -108,6 +98,32 @@ void CCountryFlags::LoadCountryflagsIndexfile()
 
 	// clean up
 	json_value_free(pJsonData);
+
+	ImageLoader.Wait();
+	for(int i = 0; i < aFlags.size(); i++)
+	{
+		CCountryFlag &CountryFlag = aFlags[i];
+		if(aFlagImages[i] != -1)
+		{
+			if(!ImageLoader.Get(aFlagImages[i]))
+			{
+				char aMsg[64];
+				str_format(aMsg, sizeof(aMsg), "failed to load '%s'", ImageLoader.Filename(aFlagImages[i]));
+				Console()->Print(IConsole::OUTPUT_LEVEL_ADDINFO, "countryflags", aMsg);
+				continue;
+			}
+			CountryFlag.m_Texture = ImageLoader.LoadTexture(aFlagImages[i], CImageInfo::FORMAT_AUTO, 0);
+		}
+		m_aCountryFlags.add_unsorted(CountryFlag);
+
+		// print message
+		if(g_Config.m_Debug)
+		{
+			char aBuf[64];
+			str_format(aBuf, sizeof(aBuf), "loaded country flag '%s'", CountryFlag.m_aCountryCodeString);
+			Console()->Print(IConsole::OUTPUT_LEVEL_ADDINFO, "countryflags", aBuf);
+		}
+	}
 	m_aCountryFlags.sort_range();
 
 	// find index of default item
@@ -132,8 +148,15 @@ void CCountryFlags::LoadCountryflagsIndexfile()
 void CCountryFlags::OnInit()
 {
 	// load country flags
+	int64 Start = time_get();
 	m_aCountryFlags.clear();
 	LoadCountryflagsIndexfile();
+	if(g_Config.m_Debug)
+	{
+		char aBuf[128];
+		str_format(aBuf, sizeof(aBuf), "loaded %d country flags in %.2fms", m_aCountryFlags.size(), (time_get()-Start)*1000/(float)time_freq());
+		Console()->Print(IConsole::OUTPUT_LEVEL_DEBUG, "countryflags", aBuf);
+	}
 	if(!m_aCountryFlags.size())
 	{
 		Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "countryflags", "failed to load country flags. folder='countryflags/'");
@@ -3,7 +3,9 @@
 #include <engine/graphics.h>
 #include <engine/map.h>
 #include <engine/storage.h>
+#include <engine/shared/config.h>
 #include <game/client/component.h>
+#include <game/client/imageloader.h>
 #include <game/mapitems.h>
 
 #include "mapimages.h"
@@ -26,11 +28,29 @@ void CMapImages::LoadMapImages(IMap *pMap, class CLayers *pLayers, int MapType)
 		Graphics()->UnloadTexture(&(m_Info[MapType].m_aTextures[i]));
 	m_Info[MapType].m_Count = 0;
 
+	int64 LoadStart = time_get();
 	int Start;
 	pMap->GetType(MAPITEMTYPE_IMAGE, &Start, &m_Info[MapType].m_Count);
 	m_Info[MapType].m_Count = clamp(m_Info[MapType].m_Count, 0, int(MAX_TEXTURES));
 
-	// load new textures
+	// external images are decoded on the job pool while the embedded ones are read from the map
+	CImageLoader ImageLoader(m_pClient->Engine(), Graphics());
+	int aExternalImages[MAX_TEXTURES];
+	for(int i = 0; i < m_Info[MapType].m_Count; i++)
+	{
+		aExternalImages[i] = -1;
+		CMapItemImage *pImg = (CMapItemImage *)pMap->GetItem(Start+i, 0, 0);
+		if(pImg->m_External || (pImg->m_Version > 1 && pImg->m_Format != CImageInfo::FORMAT_RGB && pImg->m_Format != CImageInfo::FORMAT_RGBA))
+		{
+			char Buf[256];
+			char *pName = (char *)pMap->GetData(pImg->m_ImageName);
+			str_format(Buf, sizeof(Buf), "mapres/%s.png", pName);
+			aExternalImages[i] = ImageLoader.Add(Buf, IStorage::TYPE_ALL);
+		}
+	}
+
+	// load the embedded textures while the external images are still decoding
+	int aTextureFlags[MAX_TEXTURES];
 	for(int i = 0; i < m_Info[MapType].m_Count; i++)
 	{
 		int TextureFlags = 0;
@@ -46,26 +66,38 @@ void CMapImages::LoadMapImages(IMap *pMap, class CLayers *pLayers, int MapType)
 		}
 		if(FoundTileLayer)
 			TextureFlags = FoundQuadLayer ? IGraphics::TEXLOAD_MULTI_DIMENSION : IGraphics::TEXLOAD_ARRAY_256;
+		aTextureFlags[i] = TextureFlags;
 
-		CMapItemImage *pImg = (CMapItemImage *)pMap->GetItem(Start+i, 0, 0);
-		if(pImg->m_External || (pImg->m_Version > 1 && pImg->m_Format != CImageInfo::FORMAT_RGB && pImg->m_Format != CImageInfo::FORMAT_RGBA))
-		{
-			char Buf[256];
-			char *pName = (char *)pMap->GetData(pImg->m_ImageName);
-			str_format(Buf, sizeof(Buf), "mapres/%s.png", pName);
-			m_Info[MapType].m_aTextures[i] = Graphics()->LoadTexture(Buf, IStorage::TYPE_ALL, CImageInfo::FORMAT_AUTO, TextureFlags);
-		}
-		else
+		if(aExternalImages[i] == -1)
 		{
+			CMapItemImage *pImg = (CMapItemImage *)pMap->GetItem(Start+i, 0, 0);
 			void *pData = pMap->GetData(pImg->m_ImageData);
 			m_Info[MapType].m_aTextures[i] = Graphics()->LoadTextureRaw(pImg->m_Width, pImg->m_Height, pImg->m_Version == 1 ? CImageInfo::FORMAT_RGBA : pImg->m_Format, pData, CImageInfo::FORMAT_RGBA, TextureFlags);
 			pMap->UnloadData(pImg->m_ImageData);
 		}
 	}
 
+	// then the external ones, once all of them are decoded
+	if(ImageLoader.Num())
+	{
+		ImageLoader.Wait();
+		for(int i = 0; i < m_Info[MapType].m_Count; i++)
+		{
+			if(aExternalImages[i] != -1)
+				m_Info[MapType].m_aTextures[i] = ImageLoader.LoadTexture(aExternalImages[i], CImageInfo::FORMAT_AUTO, aTextureFlags[i]);
+		}
+	}
+
 	// easter time, preload easter tileset
 	if(m_pClient->IsEaster())
 		GetEasterTexture();
+
+	if(g_Config.m_Debug)
+	{
+		char aBuf[128];
+		str_format(aBuf, sizeof(aBuf), "loaded %d map images in %.2fms", m_Info[MapType].m_Count, (time_get()-LoadStart)*1000/(float)time_freq());
+		Console()->Print(IConsole::OUTPUT_LEVEL_DEBUG, "mapimages", aBuf);
+	}
 }
 
 void CMapImages::OnMapLoad()
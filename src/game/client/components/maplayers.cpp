@@ -29,6 +29,11 @@ CMapLayers::CMapLayers(int t)
 	m_pMenuMap = 0;
 	m_pMenuLayers = 0;
 	m_OnlineStartTime = 0;
+	m_pBufferedLayers = 0;
+	m_pTileLayerBuffers = 0;
+	m_NumTileLayerBuffers = 0;
+	mem_zero(m_aEnvelopeCache, sizeof(m_aEnvelopeCache));
+	m_EnvelopeFrame = 0;
 }
 
 void CMapLayers::OnStateChange(int NewState, int OldState)
@@ -66,6 +71,7 @@ void CMapLayers::LoadBackgroundMap()
 	str_format(aBuf, sizeof(aBuf), "loaded map '%s'", g_Config.m_ClMenuMap);
 	Console()->Print(IConsole::OUTPUT_LEVEL_ADDINFO, "client", aBuf);
 
+	ClearTileLayerBuffers();
 	m_pMenuLayers->Init(Kernel(), m_pMenuMap);
 	RenderTools()->RenderTilemapGenerateSkip(m_pMenuLayers);
 	m_pClient->m_pMapimages->OnMenuMapLoad(m_pMenuMap);
@@ -139,8 +145,46 @@ static void PlaceEggDoodads(int LayerWidth, int LayerHeight, CTile* aOutTiles, C
 	}
 }
 
+void CMapLayers::ClearTileLayerBuffers()
+{
+	for(int i = 0; i < m_NumTileLayerBuffers; i++)
+	{
+		if(m_pTileLayerBuffers[i].IsBuilt())
+			RenderTools()->DestroyTileLayerBuffer(&m_pTileLayerBuffers[i]);
+	}
+	delete[] m_pTileLayerBuffers;
+	m_pTileLayerBuffers = 0;
+	m_NumTileLayerBuffers = 0;
+	m_pBufferedLayers = 0;
+}
+
+const CTileLayerBuffer *CMapLayers::GetTileLayerBuffer(CLayers *pLayers, int Layer)
+{
+	// switching between the menu map and the game map
+	if(pLayers != m_pBufferedLayers)
+	{
+		ClearTileLayerBuffers();
+		m_pBufferedLayers = pLayers;
+		m_NumTileLayerBuffers = pLayers->NumLayers();
+		m_pTileLayerBuffers = new CTileLayerBuffer[max(m_NumTileLayerBuffers, 1)];
+	}
+
+	CTileLayerBuffer *pBuffer = &m_pTileLayerBuffers[Layer];
+	if(!pBuffer->IsBuilt())
+	{
+		CMapItemLayerTilemap *pTMap = (CMapItemLayerTilemap *)pLayers->GetLayer(Layer);
+		CTile *pTiles = (CTile *)pLayers->Map()->GetData(pTMap->m_Data);
+		RenderTools()->CreateTileLayerBuffer(pBuffer, pTiles, pTMap->m_Width, pTMap->m_Height, 32.0f);
+	}
+	return pBuffer;
+}
+
 void CMapLayers::OnMapLoad()
 {
+	// the layers object is reused for the new map
+	if(m_pBufferedLayers == Layers())
+		ClearTileLayerBuffers();
+
 	if(Layers())
 		LoadEnvPoints(Layers(), m_lEnvPoints);
 
@@ -197,6 +241,8 @@ void CMapLayers::OnMapLoad()
 
 void CMapLayers::OnShutdown()
 {
+	ClearTileLayerBuffers();
+
 	if(m_pEggTiles)
 	{
 		mem_free(m_pEggTiles);
@@ -277,6 +323,43 @@ void CMapLayers::EnvelopeUpdate()
 void CMapLayers::EnvelopeEval(float TimeOffset, int Env, float *pChannels, void *pUser)
 {
 	CMapLayers *pThis = (CMapLayers *)pUser;
+
+	unsigned OffsetBits;
+	mem_copy(&OffsetBits, &TimeOffset, sizeof(OffsetBits));
+	unsigned Hash = ((unsigned)Env*0x9e3779b1u)^(OffsetBits*0x85ebca6bu);
+	Hash ^= Hash>>15;
+
+	CEnvelopeCacheEntry *pFree = 0;
+	for(int i = 0; i < ENVELOPE_CACHE_PROBES; i++)
+	{
+		CEnvelopeCacheEntry *pEntry = &pThis->m_aEnvelopeCache[(Hash+i)&(ENVELOPE_CACHE_SIZE-1)];
+		if(pEntry->m_Frame != pThis->m_EnvelopeFrame)
+		{
+			if(!pFree)
+				pFree = pEntry;
+			continue;
+		}
+		if(pEntry->m_Env == Env && pEntry->m_TimeOffset == TimeOffset)
+		{
+			mem_copy(pChannels, pEntry->m_aChannels, sizeof(pEntry->m_aChannels));
+			return;
+		}
+	}
+
+	pThis->EnvelopeEvalUncached(TimeOffset, Env, pChannels);
+
+	// a full neighbourhood just misses the cache for the rest of the frame
+	if(pFree)
+	{
+		pFree->m_Frame = pThis->m_EnvelopeFrame;
+		pFree->m_Env = Env;
+		pFree->m_TimeOffset = TimeOffset;
+		mem_copy(pFree->m_aChannels, pChannels, sizeof(pFree->m_aChannels));
+	}
+}
+
+void CMapLayers::EnvelopeEvalUncached(float TimeOffset, int Env, float *pChannels)
+{
 	pChannels[0] = 0;
 	pChannels[1] = 0;
 	pChannels[2] = 0;
@@ -285,15 +368,15 @@ void CMapLayers::EnvelopeEval(float TimeOffset, int Env, float *pChannels, void
 	CEnvPoint *pPoints = 0;
 	CLayers *pLayers = 0;
 	{
-		if(pThis->Client()->State() == IClient::STATE_ONLINE || pThis->Client()->State() == IClient::STATE_DEMOPLAYBACK)
+		if(Client()->State() == IClient::STATE_ONLINE || Client()->State() == IClient::STATE_DEMOPLAYBACK)
 		{
-			pLayers = pThis->Layers();
-			pPoints = pThis->m_lEnvPoints.base_ptr();
+			pLayers = Layers();
+			pPoints = m_lEnvPoints.base_ptr();
 		}
 		else
 		{
-			pLayers = pThis->m_pMenuLayers;
-			pPoints = pThis->m_lEnvPointsMenu.base_ptr();
+			pLayers = m_pMenuLayers;
+			pPoints = m_lEnvPointsMenu.base_ptr();
 		}
 	}
 
@@ -306,45 +389,45 @@ void CMapLayers::EnvelopeEval(float TimeOffset, int Env, float *pChannels, void
 	CMapItemEnvelope *pItem = (CMapItemEnvelope *)pLayers->Map()->GetItem(Start+Env, 0, 0);
 
 	float Time = 0.0f;
-	if(pThis->Client()->State() == IClient::STATE_DEMOPLAYBACK)
+	if(Client()->State() == IClient::STATE_DEMOPLAYBACK)
 	{
-		const IDemoPlayer::CInfo *pInfo = pThis->DemoPlayer()->BaseInfo();
+		const IDemoPlayer::CInfo *pInfo = DemoPlayer()->BaseInfo();
 
-		if(!pInfo->m_Paused || pThis->m_EnvelopeUpdate)
+		if(!pInfo->m_Paused || m_EnvelopeUpdate)
 		{
-			if(pThis->m_CurrentLocalTick != pInfo->m_CurrentTick)
+			if(m_CurrentLocalTick != pInfo->m_CurrentTick)
 			{
-				pThis->m_LastLocalTick = pThis->m_CurrentLocalTick;
-				pThis->m_CurrentLocalTick = pInfo->m_CurrentTick;
+				m_LastLocalTick = m_CurrentLocalTick;
+				m_CurrentLocalTick = pInfo->m_CurrentTick;
 			}
 
-			Time = mix(pThis->m_LastLocalTick / (float)pThis->Client()->GameTickSpeed(),
-						pThis->m_CurrentLocalTick / (float)pThis->Client()->GameTickSpeed(),
-						pThis->Client()->IntraGameTick());
+			Time = mix(m_LastLocalTick / (float)Client()->GameTickSpeed(),
+						m_CurrentLocalTick / (float)Client()->GameTickSpeed(),
+						Client()->IntraGameTick());
 		}
 
-		pThis->RenderTools()->RenderEvalEnvelope(pPoints + pItem->m_StartPoint, pItem->m_NumPoints, 4, Time+TimeOffset, pChannels);
+		RenderTools()->RenderEvalEnvelope(pPoints + pItem->m_StartPoint, pItem->m_NumPoints, 4, Time+TimeOffset, pChannels);
 	}
-	else if(pThis->Client()->State() != IClient::STATE_OFFLINE)
+	else if(Client()->State() != IClient::STATE_OFFLINE)
 	{
-		if(pThis->m_pClient->m_Snap.m_pGameData && !(pThis->m_pClient->m_Snap.m_pGameData->m_GameStateFlags&GAMESTATEFLAG_PAUSED))
+		if(m_pClient->m_Snap.m_pGameData && !(m_pClient->m_Snap.m_pGameData->m_GameStateFlags&GAMESTATEFLAG_PAUSED))
 		{
 			if(pItem->m_Version < 2 || pItem->m_Synchronized)
 			{
-				Time = mix((pThis->Client()->PrevGameTick()-pThis->m_pClient->m_Snap.m_pGameData->m_GameStartTick) / (float)pThis->Client()->GameTickSpeed(),
-							(pThis->Client()->GameTick()-pThis->m_pClient->m_Snap.m_pGameData->m_GameStartTick) / (float)pThis->Client()->GameTickSpeed(),
-							pThis->Client()->IntraGameTick());
+				Time = mix((Client()->PrevGameTick()-m_pClient->m_Snap.m_pGameData->m_GameStartTick) / (float)Client()->GameTickSpeed(),
+							(Client()->GameTick()-m_pClient->m_Snap.m_pGameData->m_GameStartTick) / (float)Client()->GameTickSpeed(),
+							Client()->IntraGameTick());
 			}
 			else
-				Time = pThis->Client()->LocalTime()-pThis->m_OnlineStartTime;
+				Time = Client()->LocalTime()-m_OnlineStartTime;
 		}
 
-		pThis->RenderTools()->RenderEvalEnvelope(pPoints + pItem->m_StartPoint, pItem->m_NumPoints, 4, Time+TimeOffset, pChannels);
+		RenderTools()->RenderEvalEnvelope(pPoints + pItem->m_StartPoint, pItem->m_NumPoints, 4, Time+TimeOffset, pChannels);
 	}
 	else
 	{
-		Time = pThis->Client()->LocalTime();
-		pThis->RenderTools()->RenderEvalEnvelope(pPoints + pItem->m_StartPoint, pItem->m_NumPoints, 4, Time+TimeOffset, pChannels);
+		Time = Client()->LocalTime();
+		RenderTools()->RenderEvalEnvelope(pPoints + pItem->m_StartPoint, pItem->m_NumPoints, 4, Time+TimeOffset, pChannels);
 	}
 }
 
@@ -365,6 +448,9 @@ void CMapLayers::OnRender()
 	CUIRect Screen;
 	Graphics()->GetScreen(&Screen.x, &Screen.y, &Screen.w, &Screen.h);
 
+	// new frame, the cached envelopes are stale
+	m_EnvelopeFrame++;
+
 	vec2 Center = *m_pClient->m_pCamera->GetCenter();
 
 	bool PassedGameLayer = false;
@@ -457,13 +543,26 @@ void CMapLayers::OnRender()
 							Graphics()->TextureSet(m_pClient->m_pMapimages->Get(pTMap->m_Image));
 
 						CTile *pTiles = (CTile *)pLayers->Map()->GetData(pTMap->m_Data);
-						Graphics()->BlendNone();
 						vec4 Color = vec4(pTMap->m_Color.r/255.0f, pTMap->m_Color.g/255.0f, pTMap->m_Color.b/255.0f, pTMap->m_Color.a/255.0f);
-						RenderTools()->RenderTilemap(pTiles, pTMap->m_Width, pTMap->m_Height, 32.0f, Color, TILERENDERFLAG_EXTEND|LAYERRENDERFLAG_OPAQUE,
-														EnvelopeEval, this, pTMap->m_ColorEnv, pTMap->m_ColorEnvOffset);
-						Graphics()->BlendNormal();
-						RenderTools()->RenderTilemap(pTiles, pTMap->m_Width, pTMap->m_Height, 32.0f, Color, TILERENDERFLAG_EXTEND|LAYERRENDERFLAG_TRANSPARENT,
-														EnvelopeEval, this, pTMap->m_ColorEnv, pTMap->m_ColorEnvOffset);
+						if(g_Config.m_GfxTileBuffer)
+						{
+							const CTileLayerBuffer *pBuffer = GetTileLayerBuffer(pLayers, pGroup->m_StartLayer+l);
+							Graphics()->BlendNone();
+							RenderTools()->RenderTileLayerBuffer(pBuffer, pTiles, 32.0f, Color, TILERENDERFLAG_EXTEND|LAYERRENDERFLAG_OPAQUE,
+															EnvelopeEval, this, pTMap->m_ColorEnv, pTMap->m_ColorEnvOffset);
+							Graphics()->BlendNormal();
+							RenderTools()->RenderTileLayerBuffer(pBuffer, pTiles, 32.0f, Color, TILERENDERFLAG_EXTEND|LAYERRENDERFLAG_TRANSPARENT,
+															EnvelopeEval, this, pTMap->m_ColorEnv, pTMap->m_ColorEnvOffset);
+						}
+						else
+						{
+							Graphics()->BlendNone();
+							RenderTools()->RenderTilemap(pTiles, pTMap->m_Width, pTMap->m_Height, 32.0f, Color, TILERENDERFLAG_EXTEND|LAYERRENDERFLAG_OPAQUE,
+															EnvelopeEval, this, pTMap->m_ColorEnv, pTMap->m_ColorEnvOffset);
+							Graphics()->BlendNormal();
+							RenderTools()->RenderTilemap(pTiles, pTMap->m_Width, pTMap->m_Height, 32.0f, Color, TILERENDERFLAG_EXTEND|LAYERRENDERFLAG_TRANSPARENT,
+															EnvelopeEval, this, pTMap->m_ColorEnv, pTMap->m_ColorEnvOffset);
+						}
 					}
 					else if(pLayer->m_Type == LAYERTYPE_QUADS)
 					{
@@ -4,6 +4,7 @@
 #define GAME_CLIENT_COMPONENTS_MAPLAYERS_H
 #include <base/tl/array.h>
 #include <game/client/component.h>
+#include <game/client/render.h>
 
 class CMapLayers : public CComponent
 {
@@ -19,14 +20,41 @@ class CMapLayers : public CComponent
 	array<CEnvPoint> m_lEnvPoints;
 	array<CEnvPoint> m_lEnvPointsMenu;
 
+	// geometry of the tile layers, built the first time a layer is rendered
+	CLayers *m_pBufferedLayers;
+	CTileLayerBuffer *m_pTileLayerBuffers;
+	int m_NumTileLayerBuffers;
+
 	CTile* m_pEggTiles;
 	int m_EggLayerWidth;
 	int m_EggLayerHeight;
 
+	// every envelope is evaluated once per frame and time offset, the quads and tile layers
+	// that share one get the cached result
+	enum
+	{
+		ENVELOPE_CACHE_SIZE=1024, // power of two
+		ENVELOPE_CACHE_PROBES=8,
+	};
+
+	struct CEnvelopeCacheEntry
+	{
+		int m_Frame;
+		int m_Env;
+		float m_TimeOffset;
+		float m_aChannels[4];
+	};
+
+	CEnvelopeCacheEntry m_aEnvelopeCache[ENVELOPE_CACHE_SIZE];
+	int m_EnvelopeFrame;
+
 	static void EnvelopeEval(float TimeOffset, int Env, float *pChannels, void *pUser);
+	void EnvelopeEvalUncached(float TimeOffset, int Env, float *pChannels);
 
 	void LoadEnvPoints(const CLayers *pLayers, array<CEnvPoint>& lEnvPoints);
 	void LoadBackgroundMap();
+	void ClearTileLayerBuffers();
+	const CTileLayerBuffer *GetTileLayerBuffer(CLayers *pLayers, int Layer);
 
 public:
 	enum
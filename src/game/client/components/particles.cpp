@@ -3,36 +3,71 @@
 #include <base/math.h>
 #include <engine/graphics.h>
 #include <engine/demo.h>
+#include <engine/shared/config.h>
 
 #include <generated/client_data.h>
 #include <game/client/render.h>
 
 #include "particles.h"
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+	#define PARTICLES_SSE2 1
+	#include <emmintrin.h>
+#endif
+
 CParticles::CParticles()
 {
+	mem_zero(m_aGroups, sizeof(m_aGroups));
 	OnReset();
 	m_RenderTrail.m_pParts = this;
 	m_RenderExplosions.m_pParts = this;
 	m_RenderGeneral.m_pParts = this;
 }
 
+CParticles::~CParticles()
+{
+	for(int g = 0; g < NUM_GROUPS; g++)
+		mem_free(m_aGroups[g].m_pData);
+}
+
 
 void CParticles::OnReset()
 {
-	// reset particles
-	for(int i = 0; i < MAX_PARTICLES; i++)
+	// reset particles, the memory is kept for the next round
+	for(int g = 0; g < NUM_GROUPS; g++)
+		m_aGroups[g].m_Num = 0;
+	m_NumParticles = 0;
+}
+
+void CParticles::Grow(CGroup *pGroup)
+{
+	int Capacity = max((int)MIN_GROUP_CAPACITY, pGroup->m_Capacity*2);
+	float *pData = (float *)mem_alloc(Capacity*(NUM_FIELDS*sizeof(float)+sizeof(int)), 1);
+
+	for(int f = 0; f < NUM_FIELDS; f++)
 	{
-		m_aParticles[i].m_PrevPart = i-1;
-		m_aParticles[i].m_NextPart = i+1;
+		float *pField = pData+f*Capacity;
+		if(pGroup->m_Num)
+			mem_copy(pField, pGroup->m_apFields[f], pGroup->m_Num*sizeof(float));
+		pGroup->m_apFields[f] = pField;
 	}
+	int *pSpr = (int *)(pData+NUM_FIELDS*Capacity);
+	if(pGroup->m_Num)
+		mem_copy(pSpr, pGroup->m_pSpr, pGroup->m_Num*sizeof(int));
+
+	mem_free(pGroup->m_pData);
+	pGroup->m_pData = pData;
+	pGroup->m_pSpr = pSpr;
+	pGroup->m_Capacity = Capacity;
+}
 
-	m_aParticles[0].m_PrevPart = 0;
-	m_aParticles[MAX_PARTICLES-1].m_NextPart = -1;
-	m_FirstFree = 0;
-
-	for(int i = 0; i < NUM_GROUPS; i++)
-		m_aFirstPart[i] = -1;
+void CParticles::Remove(CGroup *pGroup, int Index)
+{
+	int Last = --pGroup->m_Num;
+	for(int f = 0; f < NUM_FIELDS; f++)
+		pGroup->m_apFields[f][Index] = pGroup->m_apFields[f][Last];
+	pGroup->m_pSpr[Index] = pGroup->m_pSpr[Last];
+	m_NumParticles--;
 }
 
 void CParticles::Add(int Group, CParticle *pPart)
@@ -49,27 +84,88 @@ void CParticles::Add(int Group, CParticle *pPart)
 			return;
 	}
 
-	if (m_FirstFree == -1)
+	if(m_NumParticles >= g_Config.m_ClParticlesMax)
 		return;
 
-	// remove from the free list
-	int Id = m_FirstFree;
-	m_FirstFree = m_aParticles[Id].m_NextPart;
-	if(m_FirstFree != -1)
-		m_aParticles[m_FirstFree].m_PrevPart = -1;
+	CGroup *pGroup = &m_aGroups[Group];
+	if(pGroup->m_Num == pGroup->m_Capacity)
+		Grow(pGroup);
 
 	// copy data
-	m_aParticles[Id] = *pPart;
+	int Id = pGroup->m_Num++;
+	float **ppFields = pGroup->m_apFields;
+	ppFields[FIELD_POS_X][Id] = pPart->m_Pos.x;
+	ppFields[FIELD_POS_Y][Id] = pPart->m_Pos.y;
+	ppFields[FIELD_VEL_X][Id] = pPart->m_Vel.x;
+	ppFields[FIELD_VEL_Y][Id] = pPart->m_Vel.y;
+	ppFields[FIELD_LIFE][Id] = 0;
+	ppFields[FIELD_LIFESPAN][Id] = pPart->m_LifeSpan;
+	ppFields[FIELD_ROT][Id] = pPart->m_Rot;
+	ppFields[FIELD_ROTSPEED][Id] = pPart->m_Rotspeed;
+	ppFields[FIELD_GRAVITY][Id] = pPart->m_Gravity;
+	ppFields[FIELD_FRICTION][Id] = pPart->m_Friction;
+	ppFields[FIELD_START_SIZE][Id] = pPart->m_StartSize;
+	ppFields[FIELD_END_SIZE][Id] = pPart->m_EndSize;
+	ppFields[FIELD_COLOR_R][Id] = pPart->m_Color.r;
+	ppFields[FIELD_COLOR_G][Id] = pPart->m_Color.g;
+	ppFields[FIELD_COLOR_B][Id] = pPart->m_Color.b;
+	ppFields[FIELD_COLOR_A][Id] = pPart->m_Color.a;
+	pGroup->m_pSpr[Id] = pPart->m_Spr;
+	m_NumParticles++;
+}
+
+// gravity, friction, aging and rotation of all particles of a group, and the distance they
+// would move. the vector path does the same operations in the same order as the scalar one
+void CParticles::Integrate(CGroup *pGroup, float TimePassed, int FrictionCount)
+{
+	float *pVelX = pGroup->m_apFields[FIELD_VEL_X];
+	float *pVelY = pGroup->m_apFields[FIELD_VEL_Y];
+	float *pMoveX = pGroup->m_apFields[FIELD_MOVE_X];
+	float *pMoveY = pGroup->m_apFields[FIELD_MOVE_Y];
+	float *pLife = pGroup->m_apFields[FIELD_LIFE];
+	float *pRot = pGroup->m_apFields[FIELD_ROT];
+	const float *pRotspeed = pGroup->m_apFields[FIELD_ROTSPEED];
+	const float *pGravity = pGroup->m_apFields[FIELD_GRAVITY];
+	const float *pFriction = pGroup->m_apFields[FIELD_FRICTION];
+
+	int i = 0;
+#if defined(PARTICLES_SSE2)
+	const __m128 Time = _mm_set1_ps(TimePassed);
+	for(; i+4 <= pGroup->m_Num; i += 4)
+	{
+		__m128 VelX = _mm_loadu_ps(&pVelX[i]);
+		__m128 VelY = _mm_add_ps(_mm_loadu_ps(&pVelY[i]), _mm_mul_ps(_mm_loadu_ps(&pGravity[i]), Time));
+		__m128 Friction = _mm_loadu_ps(&pFriction[i]);
+		for(int f = 0; f < FrictionCount; f++)
+		{
+			VelX = _mm_mul_ps(VelX, Friction);
+			VelY = _mm_mul_ps(VelY, Friction);
+		}
+		_mm_storeu_ps(&pVelX[i], VelX);
+		_mm_storeu_ps(&pVelY[i], VelY);
+		_mm_storeu_ps(&pMoveX[i], _mm_mul_ps(VelX, Time));
+		_mm_storeu_ps(&pMoveY[i], _mm_mul_ps(VelY, Time));
+		_mm_storeu_ps(&pLife[i], _mm_add_ps(_mm_loadu_ps(&pLife[i]), Time));
+		_mm_storeu_ps(&pRot[i], _mm_add_ps(_mm_loadu_ps(&pRot[i]), _mm_mul_ps(Time, _mm_loadu_ps(&pRotspeed[i]))));
+	}
+#endif
 
-	// insert to the group list
-	m_aParticles[Id].m_PrevPart = -1;
-	m_aParticles[Id].m_NextPart = m_aFirstPart[Group];
-	if(m_aFirstPart[Group] != -1)
-		m_aParticles[m_aFirstPart[Group]].m_PrevPart = Id;
-	m_aFirstPart[Group] = Id;
+	for(; i < pGroup->m_Num; i++)
+	{
+		//m_aParticles[i].vel += flow_get(m_aParticles[i].pos)*time_passed * m_aParticles[i].flow_affected;
+		pVelY[i] += pGravity[i]*TimePassed;
 
-	// set some parameters
-	m_aParticles[Id].m_Life = 0;
+		for(int f = 0; f < FrictionCount; f++) // apply friction
+		{
+			pVelX[i] *= pFriction[i];
+			pVelY[i] *= pFriction[i];
+		}
+
+		pMoveX[i] = pVelX[i]*TimePassed;
+		pMoveY[i] = pVelY[i]*TimePassed;
+		pLife[i] += TimePassed;
+		pRot[i] += TimePassed * pRotspeed[i];
+	}
 }
 
 void CParticles::Update(float TimePassed)
@@ -89,45 +185,42 @@ void CParticles::Update(float TimePassed)
 
 	for(int g = 0; g < NUM_GROUPS; g++)
 	{
-		int i = m_aFirstPart[g];
-		while(i != -1)
+		CGroup *pGroup = &m_aGroups[g];
+		Integrate(pGroup, TimePassed, FrictionCount);
+
+		float *pPosX = pGroup->m_apFields[FIELD_POS_X];
+		float *pPosY = pGroup->m_apFields[FIELD_POS_Y];
+		float *pVelX = pGroup->m_apFields[FIELD_VEL_X];
+		float *pVelY = pGroup->m_apFields[FIELD_VEL_Y];
+		const float *pMoveX = pGroup->m_apFields[FIELD_MOVE_X];
+		const float *pMoveY = pGroup->m_apFields[FIELD_MOVE_Y];
+		const float *pLife = pGroup->m_apFields[FIELD_LIFE];
+		const float *pLifeSpan = pGroup->m_apFields[FIELD_LIFESPAN];
+
+		for(int i = 0; i < pGroup->m_Num;)
 		{
-			int Next = m_aParticles[i].m_NextPart;
-			//m_aParticles[i].vel += flow_get(m_aParticles[i].pos)*time_passed * m_aParticles[i].flow_affected;
-			m_aParticles[i].m_Vel.y += m_aParticles[i].m_Gravity*TimePassed;
-
-			for(int f = 0; f < FrictionCount; f++) // apply friction
-				m_aParticles[i].m_Vel *= m_aParticles[i].m_Friction;
-
-			// move the point
-			vec2 Vel = m_aParticles[i].m_Vel*TimePassed;
-			Collision()->MovePoint(&m_aParticles[i].m_Pos, &Vel, 0.1f+0.9f*frandom(), NULL);
-			m_aParticles[i].m_Vel = Vel* (1.0f/TimePassed);
-
-			m_aParticles[i].m_Life += TimePassed;
-			m_aParticles[i].m_Rot += TimePassed * m_aParticles[i].m_Rotspeed;
-
-			// check particle death
-			if(m_aParticles[i].m_Life > m_aParticles[i].m_LifeSpan)
+			// check particle death, the last particle takes its place and is looked at next
+			if(pLife[i] > pLifeSpan[i])
 			{
-				// remove it from the group list
-				if(m_aParticles[i].m_PrevPart != -1)
-					m_aParticles[m_aParticles[i].m_PrevPart].m_NextPart = m_aParticles[i].m_NextPart;
-				else
-					m_aFirstPart[g] = m_aParticles[i].m_NextPart;
-
-				if(m_aParticles[i].m_NextPart != -1)
-					m_aParticles[m_aParticles[i].m_NextPart].m_PrevPart = m_aParticles[i].m_PrevPart;
-
-				// insert to the free list
-				if(m_FirstFree != -1)
-					m_aParticles[m_FirstFree].m_PrevPart = i;
-				m_aParticles[i].m_PrevPart = -1;
-				m_aParticles[i].m_NextPart = m_FirstFree;
-				m_FirstFree = i;
+				Remove(pGroup, i);
+				continue;
 			}
 
-			i = Next;
+			// move the point, only the ones that hit something need the whole collision
+			vec2 Pos(pPosX[i], pPosY[i]);
+			vec2 Vel(pMoveX[i], pMoveY[i]);
+			if(Collision()->CheckPoint(Pos+Vel))
+			{
+				Collision()->MovePoint(&Pos, &Vel, 0.1f+0.9f*frandom(), NULL);
+				pVelX[i] = Vel.x*(1.0f/TimePassed);
+				pVelY[i] = Vel.y*(1.0f/TimePassed);
+			}
+			else
+			{
+				pPosX[i] = Pos.x+Vel.x;
+				pPosY[i] = Pos.y+Vel.y;
+			}
+			i++;
 		}
 	}
 }
@@ -162,26 +255,30 @@ void CParticles::RenderGroup(int Group)
 	Graphics()->TextureSet(g_pData->m_aImages[IMAGE_PARTICLES].m_Id);
 	Graphics()->QuadsBegin();
 
-	int i = m_aFirstPart[Group];
-	while(i != -1)
+	// newest first like they were added
+	const CGroup *pGroup = &m_aGroups[Group];
+	const float * const *ppFields = pGroup->m_apFields;
+	int LastSpr = -1;
+	for(int i = pGroup->m_Num-1; i >= 0; i--)
 	{
-		RenderTools()->SelectSprite(m_aParticles[i].m_Spr);
-		float a = m_aParticles[i].m_Life / m_aParticles[i].m_LifeSpan;
-		vec2 p = m_aParticles[i].m_Pos;
-		float Size = mix(m_aParticles[i].m_StartSize, m_aParticles[i].m_EndSize, a);
+		if(pGroup->m_pSpr[i] != LastSpr)
+		{
+			LastSpr = pGroup->m_pSpr[i];
+			RenderTools()->SelectSprite(LastSpr);
+		}
+		float a = ppFields[FIELD_LIFE][i] / ppFields[FIELD_LIFESPAN][i];
+		float Size = mix(ppFields[FIELD_START_SIZE][i], ppFields[FIELD_END_SIZE][i], a);
 
-		Graphics()->QuadsSetRotation(m_aParticles[i].m_Rot);
+		Graphics()->QuadsSetRotation(ppFields[FIELD_ROT][i]);
 
 		Graphics()->SetColor(
-			m_aParticles[i].m_Color.r,
-			m_aParticles[i].m_Color.g,
-			m_aParticles[i].m_Color.b,
-			m_aParticles[i].m_Color.a); // pow(a, 0.75f) *
+			ppFields[FIELD_COLOR_R][i],
+			ppFields[FIELD_COLOR_G][i],
+			ppFields[FIELD_COLOR_B][i],
+			ppFields[FIELD_COLOR_A][i]); // pow(a, 0.75f) *
 
-		IGraphics::CQuadItem QuadItem(p.x, p.y, Size, Size);
+		IGraphics::CQuadItem QuadItem(ppFields[FIELD_POS_X][i], ppFields[FIELD_POS_Y][i], Size, Size);
 		Graphics()->QuadsDraw(&QuadItem, 1);
-
-		i = m_aParticles[i].m_NextPart;
 	}
 	Graphics()->QuadsEnd();
 	Graphics()->BlendNormal();
@@ -41,11 +41,6 @@ struct CParticle
 	float m_Friction;
 
 	vec4 m_Color;
-
-	// set by the particle system
-	float m_Life;
-	int m_PrevPart;
-	int m_NextPart;
 };
 
 class CParticles : public CComponent
@@ -61,6 +56,7 @@ public:
 	};
 
 	CParticles();
+	virtual ~CParticles();
 
 	void Add(int Group, CParticle *pPart);
 
@@ -71,13 +67,49 @@ private:
 
 	enum
 	{
-		MAX_PARTICLES=1024*8,
+		MIN_GROUP_CAPACITY=256,
+	};
+
+	enum
+	{
+		FIELD_POS_X=0,
+		FIELD_POS_Y,
+		FIELD_VEL_X,
+		FIELD_VEL_Y,
+		FIELD_MOVE_X,
+		FIELD_MOVE_Y,
+		FIELD_LIFE,
+		FIELD_LIFESPAN,
+		FIELD_ROT,
+		FIELD_ROTSPEED,
+		FIELD_GRAVITY,
+		FIELD_FRICTION,
+		FIELD_START_SIZE,
+		FIELD_END_SIZE,
+		FIELD_COLOR_R,
+		FIELD_COLOR_G,
+		FIELD_COLOR_B,
+		FIELD_COLOR_A,
+		NUM_FIELDS
+	};
+
+	// the particles of a group as one array per field in a single allocation, a dead particle
+	// is replaced by the last one
+	struct CGroup
+	{
+		int m_Num;
+		int m_Capacity;
+		void *m_pData; // the allocation the fields are in
+		float *m_apFields[NUM_FIELDS];
+		int *m_pSpr;
 	};
 
-	CParticle m_aParticles[MAX_PARTICLES];
-	int m_FirstFree;
-	int m_aFirstPart[NUM_GROUPS];
+	CGroup m_aGroups[NUM_GROUPS];
+	int m_NumParticles;
 
+	void Grow(CGroup *pGroup);
+	void Remove(CGroup *pGroup, int Index);
+	void Integrate(CGroup *pGroup, float TimePassed, int FrictionCount);
 	void RenderGroup(int Group);
 	void Update(float TimePassed);
 
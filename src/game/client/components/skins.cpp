@@ -10,6 +10,7 @@
 #include <engine/storage.h>
 #include <engine/external/json-parser/json.h>
 #include <engine/shared/config.h>
+#include <game/client/imageloader.h>
 
 #include "skins.h"
 
@@ -31,25 +32,42 @@ int CSkins::SkinPartScan(const char *pName, int IsDir, int DirType, void *pUser)
 	if(IsDir || !str_endswith(pName, ".png"))
 		return 0;
 
+	// only start decoding here, the part is added once all are done
+	CSkinPartFile File;
+	File.m_Part = pSelf->m_ScanningPart;
+	File.m_DirType = DirType;
+	str_copy(File.m_aFilename, pName, sizeof(File.m_aFilename));
+
+	char aBuf[512];
+	str_format(aBuf, sizeof(aBuf), "skins/%s/%s", CSkins::ms_apSkinPartNames[File.m_Part], pName);
+	File.m_Image = pSelf->m_pImageLoader->Add(aBuf, DirType);
+	pSelf->m_aSkinPartFiles.add(File);
+	return 0;
+}
+
+void CSkins::LoadSkinPart(const CSkinPartFile *pFile)
+{
+	const char *pName = pFile->m_aFilename;
+	int DirType = pFile->m_DirType;
 	char aBuf[512];
-	str_format(aBuf, sizeof(aBuf), "skins/%s/%s", CSkins::ms_apSkinPartNames[pSelf->m_ScanningPart], pName);
-	CImageInfo Info;
-	if(!pSelf->Graphics()->LoadPNG(&Info, aBuf, DirType))
+	CImageInfo *pInfo = m_pImageLoader->Get(pFile->m_Image);
+	if(!pInfo)
 	{
 		str_format(aBuf, sizeof(aBuf), "failed to load skin part '%s'", pName);
-		pSelf->Console()->Print(IConsole::OUTPUT_LEVEL_ADDINFO, "skins", aBuf);
-		return 0;
+		Console()->Print(IConsole::OUTPUT_LEVEL_ADDINFO, "skins", aBuf);
+		return;
 	}
+	CImageInfo &Info = *pInfo;
 
 	CSkinPart Part;
-	Part.m_OrgTexture = pSelf->Graphics()->LoadTextureRaw(Info.m_Width, Info.m_Height, Info.m_Format, Info.m_pData, Info.m_Format, 0);
+	Part.m_OrgTexture = Graphics()->LoadTextureRaw(Info.m_Width, Info.m_Height, Info.m_Format, Info.m_pData, Info.m_Format, 0);
 	Part.m_BloodColor = vec3(1.0f, 1.0f, 1.0f);
 
 	unsigned char *d = (unsigned char *)Info.m_pData;
 	int Pitch = Info.m_Width*4;
 
 	// dig out blood color
-	if(pSelf->m_ScanningPart == SKINPART_BODY)
+	if(pFile->m_Part == SKINPART_BODY)
 	{
 		int PartX = Info.m_Width/2;
 		int PartY = 0;
@@ -83,8 +101,7 @@ int CSkins::SkinPartScan(const char *pName, int IsDir, int DirType, void *pUser)
 		d[i*Step+2] = v;
 	}
 
-	Part.m_ColorTexture = pSelf->Graphics()->LoadTextureRaw(Info.m_Width, Info.m_Height, Info.m_Format, Info.m_pData, Info.m_Format, 0);
-	mem_free(Info.m_pData);
+	Part.m_ColorTexture = Graphics()->LoadTextureRaw(Info.m_Width, Info.m_Height, Info.m_Format, Info.m_pData, Info.m_Format, 0);
 
 	// set skin part data
 	Part.m_Flags = 0;
@@ -96,11 +113,9 @@ int CSkins::SkinPartScan(const char *pName, int IsDir, int DirType, void *pUser)
 	if(g_Config.m_Debug)
 	{
 		str_format(aBuf, sizeof(aBuf), "load skin part %s", Part.m_aName);
-		pSelf->Console()->Print(IConsole::OUTPUT_LEVEL_ADDINFO, "skins", aBuf);
+		Console()->Print(IConsole::OUTPUT_LEVEL_ADDINFO, "skins", aBuf);
 	}
-	pSelf->m_aaSkinParts[pSelf->m_ScanningPart].add(Part);
-
-	return 0;
+	m_aaSkinParts[pFile->m_Part].add(Part);
 }
 
 int CSkins::SkinScan(const char *pName, int IsDir, int DirType, void *pUser)
@@ -213,6 +228,23 @@ int CSkins::SkinScan(const char *pName, int IsDir, int DirType, void *pUser)
 
 void CSkins::OnInit()
 {
+	int64 Start = time_get();
+	CImageLoader ImageLoader(m_pClient->Engine(), Graphics());
+	m_pImageLoader = &ImageLoader;
+
+	// decode all skin parts at once
+	m_aSkinPartFiles.clear();
+	for(int p = 0; p < NUM_SKINPARTS; p++)
+	{
+		char aBuf[64];
+		str_format(aBuf, sizeof(aBuf), "skins/%s", ms_apSkinPartNames[p]);
+		m_ScanningPart = p;
+		Storage()->ListDirectory(IStorage::TYPE_ALL, aBuf, SkinPartScan, this);
+	}
+	int XmasHatImage = ImageLoader.Add("skins/xmas_hat.png", IStorage::TYPE_ALL);
+	int BotImage = ImageLoader.Add("skins/bot.png", IStorage::TYPE_ALL);
+	ImageLoader.Wait();
+
 	for(int p = 0; p < NUM_SKINPARTS; p++)
 	{
 		m_aaSkinParts[p].clear();
@@ -228,10 +260,11 @@ void CSkins::OnInit()
 		}
 
 		// load skin parts
-		char aBuf[64];
-		str_format(aBuf, sizeof(aBuf), "skins/%s", ms_apSkinPartNames[p]);
-		m_ScanningPart = p;
-		Storage()->ListDirectory(IStorage::TYPE_ALL, aBuf, SkinPartScan, this);
+		for(int i = 0; i < m_aSkinPartFiles.size(); i++)
+		{
+			if(m_aSkinPartFiles[i].m_Part == p)
+				LoadSkinPart(&m_aSkinPartFiles[i]);
+		}
 
 		// add dummy skin part
 		if(!m_aaSkinParts[p].size())
@@ -243,6 +276,8 @@ void CSkins::OnInit()
 			m_aaSkinParts[p].add(DummySkinPart);
 		}
 	}
+	int NumSkinPartFiles = m_aSkinPartFiles.size();
+	m_aSkinPartFiles.clear();
 
 	// create dummy skin
 	m_DummySkin.m_Flags = SKINFLAG_STANDARD;
@@ -271,41 +306,45 @@ void CSkins::OnInit()
 
 	{
 		// add xmas hat
-		const char *pFileName = "skins/xmas_hat.png";
-		CImageInfo Info;
-		if(!Graphics()->LoadPNG(&Info, pFileName, IStorage::TYPE_ALL) || Info.m_Width != 128 || Info.m_Height != 512)
+		const CImageInfo *pInfo = ImageLoader.Get(XmasHatImage);
+		char aBuf[128];
+		if(!pInfo || pInfo->m_Width != 128 || pInfo->m_Height != 512)
 		{
-			char aBuf[128];
-			str_format(aBuf, sizeof(aBuf), "failed to load xmas hat '%s'", pFileName);
+			str_format(aBuf, sizeof(aBuf), "failed to load xmas hat '%s'", ImageLoader.Filename(XmasHatImage));
 			Console()->Print(IConsole::OUTPUT_LEVEL_ADDINFO, "game", aBuf);
 		}
 		else
 		{
-			char aBuf[128];
-			str_format(aBuf, sizeof(aBuf), "loaded xmas hat '%s'", pFileName);
+			str_format(aBuf, sizeof(aBuf), "loaded xmas hat '%s'", ImageLoader.Filename(XmasHatImage));
 			Console()->Print(IConsole::OUTPUT_LEVEL_ADDINFO, "game", aBuf);
-			m_XmasHatTexture = Graphics()->LoadTextureRaw(Info.m_Width, Info.m_Height, Info.m_Format, Info.m_pData, Info.m_Format, 0);
+			m_XmasHatTexture = ImageLoader.LoadTexture(XmasHatImage, CImageInfo::FORMAT_AUTO, 0);
 		}
 	}
 
 	{
 		// add bot decoration
-		const char *pFileName = "skins/bot.png";
-		CImageInfo Info;
-		if(!Graphics()->LoadPNG(&Info, pFileName, IStorage::TYPE_ALL) || Info.m_Width != 384 || Info.m_Height != 160)
+		const CImageInfo *pInfo = ImageLoader.Get(BotImage);
+		char aBuf[128];
+		if(!pInfo || pInfo->m_Width != 384 || pInfo->m_Height != 160)
 		{
-			char aBuf[128];
-			str_format(aBuf, sizeof(aBuf), "failed to load bot '%s'", pFileName);
+			str_format(aBuf, sizeof(aBuf), "failed to load bot '%s'", ImageLoader.Filename(BotImage));
 			Console()->Print(IConsole::OUTPUT_LEVEL_ADDINFO, "game", aBuf);
 		}
 		else
 		{
-			char aBuf[128];
-			str_format(aBuf, sizeof(aBuf), "loaded bot '%s'", pFileName);
+			str_format(aBuf, sizeof(aBuf), "loaded bot '%s'", ImageLoader.Filename(BotImage));
 			Console()->Print(IConsole::OUTPUT_LEVEL_ADDINFO, "game", aBuf);
-			m_BotTexture = Graphics()->LoadTextureRaw(Info.m_Width, Info.m_Height, Info.m_Format, Info.m_pData, Info.m_Format, 0);
+			m_BotTexture = ImageLoader.LoadTexture(BotImage, CImageInfo::FORMAT_AUTO, 0);
 		}
 	}
+	m_pImageLoader = 0;
+
+	if(g_Config.m_Debug)
+	{
+		char aBuf[128];
+		str_format(aBuf, sizeof(aBuf), "loaded %d skin part files and %d skins in %.2fms", NumSkinPartFiles, m_aSkins.size(), (time_get()-Start)*1000/(float)time_freq());
+		Console()->Print(IConsole::OUTPUT_LEVEL_DEBUG, "skins", aBuf);
+	}
 }
 
 void CSkins::AddSkin(const char *pSkinName)
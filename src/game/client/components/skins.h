@@ -3,6 +3,7 @@
 #ifndef GAME_CLIENT_COMPONENTS_SKINS_H
 #define GAME_CLIENT_COMPONENTS_SKINS_H
 #include <base/vmath.h>
+#include <base/tl/array.h>
 #include <base/tl/sorted_array.h>
 #include <game/client/component.h>
 
@@ -73,11 +74,23 @@ public:
 	int GetTeamColor(int UseCustomColors, int PartColor, int Team, int Part) const;
 
 private:
+	// a skin part file that is being decoded while OnInit scans the skin part directories
+	struct CSkinPartFile
+	{
+		int m_Part;
+		int m_DirType;
+		int m_Image;
+		char m_aFilename[64];
+	};
+
 	int m_ScanningPart;
+	class CImageLoader *m_pImageLoader;
+	array<CSkinPartFile> m_aSkinPartFiles;
 	sorted_array<CSkinPart> m_aaSkinParts[NUM_SKINPARTS];
 	sorted_array<CSkin> m_aSkins;
 	CSkin m_DummySkin;
 
+	void LoadSkinPart(const CSkinPartFile *pFile);
 	static int SkinPartScan(const char *pName, int IsDir, int DirType, void *pUser);
 	static int SkinScan(const char *pName, int IsDir, int DirType, void *pUser);
 };
@@ -16,22 +16,52 @@ struct CUserData
 	bool m_Render;
 } g_UserData;
 
+struct CSoundFileJob
+{
+	CJob m_Job;
+	ISound *m_pSound;
+	CDataSound *m_pDataSound;
+};
+
+static int LoadSoundFile(void *pUser)
+{
+	CSoundFileJob *pFileJob = static_cast<CSoundFileJob *>(pUser);
+	pFileJob->m_pDataSound->m_Id = pFileJob->m_pSound->LoadWV(pFileJob->m_pDataSound->m_pFilename);
+	return 0;
+}
+
 static int LoadSoundsThread(void *pUser)
 {
 	CUserData *pData = static_cast<CUserData *>(pUser);
+	int64 Start = time_get();
 
+	// decode every file in its own job
+	int NumFiles = 0;
+	for(int s = 0; s < g_pData->m_NumSounds; s++)
+		NumFiles += g_pData->m_aSounds[s].m_NumSounds;
+	CSoundFileJob *pFileJobs = new CSoundFileJob[NumFiles];
+	CJobGroup Group;
+	int FileJob = 0;
 	for(int s = 0; s < g_pData->m_NumSounds; s++)
 	{
-		for(int i = 0; i < g_pData->m_aSounds[s].m_NumSounds; i++)
+		for(int i = 0; i < g_pData->m_aSounds[s].m_NumSounds; i++, FileJob++)
 		{
-			ISound::CSampleHandle Id = pData->m_pGameClient->Sound()->LoadWV(g_pData->m_aSounds[s].m_aSounds[i].m_pFilename);
-			g_pData->m_aSounds[s].m_aSounds[i].m_Id = Id;
+			pFileJobs[FileJob].m_pSound = pData->m_pGameClient->Sound();
+			pFileJobs[FileJob].m_pDataSound = &g_pData->m_aSounds[s].m_aSounds[i];
+			pData->m_pGameClient->Engine()->AddJob(&pFileJobs[FileJob].m_Job, LoadSoundFile, &pFileJobs[FileJob], &Group);
 		}
+	}
+	pData->m_pGameClient->Engine()->WaitForJobs(&Group);
+	delete[] pFileJobs;
 
-		if(pData->m_Render)
+	if(pData->m_Render)
+	{
+		for(int s = 0; s < g_pData->m_NumSounds; s++)
 			pData->m_pGameClient->m_pMenus->RenderLoading();
 	}
 
+	if(g_Config.m_Debug)
+		dbg_msg("sounds", "loaded %d sound files in %.2fms", NumFiles, (time_get()-Start)*1000/(float)time_freq());
 	return 0;
 }
 
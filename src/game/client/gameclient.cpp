@@ -17,6 +17,7 @@
 #include <generated/client_data.h>
 
 #include <game/version.h>
+#include "imageloader.h"
 #include "localization.h"
 #include "render.h"
 
@@ -87,7 +88,7 @@ static CMapLayers gs_MapLayersBackGround(CMapLayers::TYPE_BACKGROUND);
 static CMapLayers gs_MapLayersForeGround(CMapLayers::TYPE_FOREGROUND);
 
 CGameClient::CStack::CStack() { m_Num = 0; }
-void CGameClient::CStack::Add(class CComponent *pComponent) { m_paComponents[m_Num++] = pComponent; }
+void CGameClient::CStack::Add(class CComponent *pComponent, const char *pName) { m_apNames[m_Num] = pName; m_paComponents[m_Num++] = pComponent; }
 
 const char *CGameClient::Version() const { return GAME_VERSION; }
 const char *CGameClient::NetVersion() const { return GAME_NETVERSION; }
@@ -205,41 +206,42 @@ void CGameClient::OnConsoleInit()
 	m_pStats = &::gs_Stats;
 
 	// make a list of all the systems, make sure to add them in the corrent render order
-	m_All.Add(m_pSkins);
-	m_All.Add(m_pCountryFlags);
-	m_All.Add(m_pMapimages);
-	m_All.Add(m_pEffects); // doesn't render anything, just updates effects
-	m_All.Add(m_pParticles); // doesn't render anything, just updates all the particles
-	m_All.Add(m_pBinds);
-	m_All.Add(&m_pBinds->m_SpecialBinds);
-	m_All.Add(m_pControls);
-	m_All.Add(m_pCamera);
-	m_All.Add(m_pSounds);
-	m_All.Add(m_pVoting);
-
-	m_All.Add(&gs_MapLayersBackGround); // first to render
-	m_All.Add(&m_pParticles->m_RenderTrail);
-	m_All.Add(m_pItems);
-	m_All.Add(&gs_Players);
-	m_All.Add(&gs_MapLayersForeGround);
-	m_All.Add(&m_pParticles->m_RenderExplosions);
-	m_All.Add(&gs_NamePlates);
-	m_All.Add(&m_pParticles->m_RenderGeneral);
-	m_All.Add(m_pDamageind);
-	m_All.Add(&gs_Hud);
-	m_All.Add(&gs_Spectator);
-	m_All.Add(&gs_Emoticon);
-	m_All.Add(&gs_KillMessages);
-	m_All.Add(m_pChat);
-	m_All.Add(&gs_Broadcast);
-	m_All.Add(&gs_DebugHud);
-	m_All.Add(&gs_Notifications);
-	m_All.Add(&gs_Scoreboard);
-	m_All.Add(m_pStats);
-	m_All.Add(m_pMotd);
-	m_All.Add(m_pMenus);
-	m_All.Add(&m_pMenus->m_Binder);
-	m_All.Add(m_pGameConsole);
+	m_All.Add(m_pSkins, "skins");
+	m_All.Add(m_pCountryFlags, "countryflags");
+	m_All.Add(m_pMapimages, "mapimages");
+	m_All.Add(m_pEffects, "effects"); // doesn't render anything, just updates effects
+	m_All.Add(m_pParticles, "particles"); // doesn't render anything, just updates all the particles
+	m_All.Add(m_pBinds, "binds");
+	m_All.Add(&m_pBinds->m_SpecialBinds, "specialbinds");
+	m_All.Add(m_pControls, "controls");
+	m_All.Add(m_pCamera, "camera");
+	m_All.Add(m_pSounds, "sounds");
+	m_All.Add(m_pVoting, "voting");
+
+	m_All.Add(&gs_MapLayersBackGround, "maplayers_background"); // first to render
+	m_All.Add(&m_pParticles->m_RenderTrail, "particles_trail");
+	m_All.Add(m_pItems, "items");
+	m_All.Add(&gs_Players, "players");
+	m_All.Add(&gs_MapLayersForeGround, "maplayers_foreground");
+	m_All.Add(&m_pParticles->m_RenderExplosions, "particles_explosions");
+	m_All.Add(&gs_NamePlates, "nameplates");
+	m_All.Add(&m_pParticles->m_RenderGeneral, "particles_general");
+	m_All.Add(m_pDamageind, "damageind");
+	m_All.Add(&gs_Hud, "hud");
+	m_All.Add(&gs_Spectator, "spectator");
+	m_All.Add(&gs_Emoticon, "emoticon");
+	m_All.Add(&gs_KillMessages, "killmessages");
+	m_All.Add(m_pChat, "chat");
+	m_All.Add(&gs_Broadcast, "broadcast");
+	m_All.Add(&gs_DebugHud, "debughud");
+	m_All.Add(&gs_Notifications, "notifications");
+	m_All.Add(&gs_Scoreboard, "scoreboard");
+	m_All.Add(m_pStats, "stats");
+	m_All.Add(m_pMotd, "motd");
+	m_All.Add(m_pMenus, "menus");
+	m_All.Add(&m_pMenus->m_Binder, "binder");
+	m_All.Add(m_pGameConsole, "gameconsole");
+	BenchmarkReset();
 
 	// build the input stack
 	m_Input.Add(&m_pMenus->m_Binder); // this will take over all input when we want to bind a key
@@ -327,14 +329,22 @@ void CGameClient::OnInit()
 		}
 	}
 
+	// the game images are decoded while the components load
+	int64 ComponentsStart = time_get();
+	CImageLoader ImageLoader(Engine(), Graphics());
+	for(int i = 0; i < g_pData->m_NumImages; i++)
+		ImageLoader.Add(g_pData->m_aImages[i].m_pFilename, IStorage::TYPE_ALL);
+
 	// init all components
 	for(int i = m_All.m_Num-1; i >= 0; --i)
 		m_All.m_paComponents[i]->OnInit();
 
 	// setup load amount// load textures
+	int64 TexturesStart = time_get();
+	ImageLoader.Wait();
 	for(int i = 0; i < g_pData->m_NumImages; i++)
 	{
-		g_pData->m_aImages[i].m_Id = Graphics()->LoadTexture(g_pData->m_aImages[i].m_pFilename, IStorage::TYPE_ALL, CImageInfo::FORMAT_AUTO, g_pData->m_aImages[i].m_Flag ? IGraphics::TEXLOAD_LINEARMIPMAPS : 0);
+		g_pData->m_aImages[i].m_Id = ImageLoader.LoadTexture(i, CImageInfo::FORMAT_AUTO, g_pData->m_aImages[i].m_Flag ? IGraphics::TEXLOAD_LINEARMIPMAPS : 0);
 		m_pMenus->RenderLoading();
 	}
 
@@ -342,7 +352,8 @@ void CGameClient::OnInit()
 
 	int64 End = time_get();
 	char aBuf[256];
-	str_format(aBuf, sizeof(aBuf), "initialisation finished after %.2fms", ((End-Start)*1000)/(float)time_freq());
+	str_format(aBuf, sizeof(aBuf), "initialisation finished after %.2fms (setup %.2fms, components %.2fms, textures %.2fms)", ((End-Start)*1000)/(float)time_freq(),
+		((ComponentsStart-Start)*1000)/(float)time_freq(), ((TexturesStart-ComponentsStart)*1000)/(float)time_freq(), ((End-TexturesStart)*1000)/(float)time_freq());
 	Console()->Print(IConsole::OUTPUT_LEVEL_DEBUG, "gameclient", aBuf);
 
 	m_ServerMode = SERVERMODE_PURE;
@@ -389,6 +400,7 @@ void CGameClient::OnConnected()
 {
 	m_Layers.Init(Kernel());
 	m_Collision.Init(Layers());
+	m_Prediction.Reset();
 
 	RenderTools()->RenderTilemapGenerateSkip(Layers());
 
@@ -408,6 +420,7 @@ void CGameClient::OnReset()
 {
 	// clear out the invalid pointers
 	m_LastNewPredictedTick = -1;
+	m_Prediction.Reset();
 	mem_zero(&m_Snap, sizeof(m_Snap));
 
 	for(int i = 0; i < MAX_CLIENTS; i++)
@@ -502,8 +515,21 @@ void CGameClient::OnRender()
 	UpdatePositions();
 
 	// render all systems
-	for(int i = 0; i < m_All.m_Num; i++)
-		m_All.m_paComponents[i]->OnRender();
+	if(g_Config.m_DbgBenchmark && Client()->State() == IClient::STATE_DEMOPLAYBACK)
+	{
+		m_BenchmarkFrames++;
+		for(int i = 0; i < m_All.m_Num; i++)
+		{
+			int64 Start = time_get();
+			m_All.m_paComponents[i]->OnRender();
+			m_aBenchmarkRenderTime[i] += time_get()-Start;
+		}
+	}
+	else
+	{
+		for(int i = 0; i < m_All.m_Num; i++)
+			m_All.m_paComponents[i]->OnRender();
+	}
 
 	// clear all events/input for this frame
 	Input()->Clear();
@@ -902,8 +928,39 @@ void CGameClient::OnMessage(int MsgId, CUnpacker *pUnpacker)
 	}
 }
 
+void CGameClient::BenchmarkReset()
+{
+	mem_zero(m_aBenchmarkRenderTime, sizeof(m_aBenchmarkRenderTime));
+	m_BenchmarkFrames = 0;
+}
+
+void CGameClient::BenchmarkReport()
+{
+	int64 Total = 0;
+	for(int i = 0; i < m_All.m_Num; i++)
+		Total += m_aBenchmarkRenderTime[i];
+	int Frames = max(m_BenchmarkFrames, 1);
+
+	char aBuf[256];
+	for(int i = 0; i < m_All.m_Num; i++)
+	{
+		if(!m_aBenchmarkRenderTime[i])
+			continue;
+		str_format(aBuf, sizeof(aBuf), "%-22s %8.4f ms per frame, %5.1f%%", m_All.m_apNames[i],
+			m_aBenchmarkRenderTime[i]*1000.0/time_freq()/Frames, m_aBenchmarkRenderTime[i]*100.0/max(Total, (int64)1));
+		Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "benchmark", aBuf);
+	}
+	str_format(aBuf, sizeof(aBuf), "%-22s %8.4f ms per frame over %d frames", "all components", Total*1000.0/time_freq()/Frames, m_BenchmarkFrames);
+	Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "benchmark", aBuf);
+}
+
 void CGameClient::OnStateChange(int NewState, int OldState)
 {
+	if(NewState == IClient::STATE_DEMOPLAYBACK)
+		BenchmarkReset();
+	else if(OldState == IClient::STATE_DEMOPLAYBACK && g_Config.m_DbgBenchmark)
+		BenchmarkReport();
+
 	// reset everything when not already connected (to keep gathered stuff)
 	if(NewState < IClient::STATE_ONLINE)
 		OnReset();
@@ -1360,6 +1417,23 @@ void CGameClient::OnDemoRecSnap()
 	pGameInfo->m_MatchCurrent = m_GameInfo.m_MatchCurrent;
 }
 
+const CNetObj_PlayerInput *CGameClient::PredictionInput(int Tick, void *pUser)
+{
+	CGameClient *pSelf = (CGameClient *)pUser;
+	return (const CNetObj_PlayerInput *)pSelf->Client()->GetInput(Tick);
+}
+
+void CGameClient::PredictionEvents(int Tick, int Events, vec2 Pos, void *pUser)
+{
+	// check if we want to trigger effects
+	CGameClient *pSelf = (CGameClient *)pUser;
+	if(Tick > pSelf->m_LastNewPredictedTick)
+	{
+		pSelf->m_LastNewPredictedTick = Tick;
+		pSelf->ProcessTriggeredEvents(Events, Pos);
+	}
+}
+
 void CGameClient::OnPredict()
 {
 	// store the previous values so we can detect prediction errors
@@ -1381,69 +1455,16 @@ void CGameClient::OnPredict()
 	}
 
 	// repredict character
-	CWorldCore World;
-	World.m_Tuning = m_Tuning;
-
-	// search for players
+	CCharacterCore *apCharacters[MAX_CLIENTS];
+	const CNetObj_CharacterCore *apSnapCharacters[MAX_CLIENTS];
 	for(int i = 0; i < MAX_CLIENTS; i++)
 	{
-		if(!m_Snap.m_aCharacters[i].m_Active)
-			continue;
-
-		m_aClients[i].m_Predicted.Init(&World, Collision(), 0);
-		World.m_apCharacters[i] = &m_aClients[i].m_Predicted;
-		m_aClients[i].m_Predicted.Read(&m_Snap.m_aCharacters[i].m_Cur);
-	}
-
-	// predict
-	for(int Tick = Client()->GameTick()+1; Tick <= Client()->PredGameTick(); Tick++)
-	{
-		// fetch the local
-		if(Tick == Client()->PredGameTick() && World.m_apCharacters[m_LocalClientID])
-			m_PredictedPrevChar = *World.m_apCharacters[m_LocalClientID];
-
-		// first calculate where everyone should move
-		for(int c = 0; c < MAX_CLIENTS; c++)
-		{
-			if(!World.m_apCharacters[c])
-				continue;
-
-			mem_zero(&World.m_apCharacters[c]->m_Input, sizeof(World.m_apCharacters[c]->m_Input));
-			if(m_LocalClientID == c)
-			{
-				// apply player input
-				const int *pInput = Client()->GetInput(Tick);
-				if(pInput)
-					World.m_apCharacters[c]->m_Input = *((const CNetObj_PlayerInput*)pInput);
-				World.m_apCharacters[c]->Tick(true);
-			}
-			else
-				World.m_apCharacters[c]->Tick(false);
-
-		}
-
-		// move all players and quantize their data
-		for(int c = 0; c < MAX_CLIENTS; c++)
-		{
-			if(!World.m_apCharacters[c])
-				continue;
-
-			World.m_apCharacters[c]->Move();
-			World.m_apCharacters[c]->Quantize();
-		}
-
-		// check if we want to trigger effects
-		if(Tick > m_LastNewPredictedTick)
-		{
-			m_LastNewPredictedTick = Tick;
-
-			if(m_LocalClientID != -1 && World.m_apCharacters[m_LocalClientID])
-				ProcessTriggeredEvents(World.m_apCharacters[m_LocalClientID]->m_TriggeredEvents, World.m_apCharacters[m_LocalClientID]->m_Pos);
-		}
-
-		if(Tick == Client()->PredGameTick() && World.m_apCharacters[m_LocalClientID])
-			m_PredictedChar = *World.m_apCharacters[m_LocalClientID];
+		apCharacters[i] = m_Snap.m_aCharacters[i].m_Active ? &m_aClients[i].m_Predicted : 0;
+		apSnapCharacters[i] = &m_Snap.m_aCharacters[i].m_Cur;
 	}
+	m_Prediction.Predict(apCharacters, apSnapCharacters, Collision(), &m_Tuning, m_LocalClientID,
+		Client()->GameTick(), Client()->PredGameTick(), PredictionInput, PredictionEvents, this,
+		&m_PredictedPrevChar, &m_PredictedChar);
 
 	if(g_Config.m_Debug && g_Config.m_ClPredict && m_PredictedTick == Client()->PredGameTick())
 	{
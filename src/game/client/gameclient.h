@@ -8,6 +8,7 @@
 #include <engine/console.h>
 #include <game/layers.h>
 #include <game/gamecore.h>
+#include "prediction.h"
 #include "render.h"
 
 class CGameClient : public IGameClient
@@ -21,9 +22,10 @@ class CGameClient : public IGameClient
 		};
 
 		CStack();
-		void Add(class CComponent *pComponent);
+		void Add(class CComponent *pComponent, const char *pName = "");
 
 		class CComponent *m_paComponents[MAX_COMPONENTS];
+		const char *m_apNames[MAX_COMPONENTS];
 		int m_Num;
 	};
 
@@ -49,6 +51,12 @@ class CGameClient : public IGameClient
 	class CCollision m_Collision;
 	CUI m_UI;
 
+	// dbg_benchmark, render time of every component while a demo plays
+	int64 m_aBenchmarkRenderTime[CStack::MAX_COMPONENTS];
+	int m_BenchmarkFrames;
+	void BenchmarkReset();
+	void BenchmarkReport();
+
 	void ProcessEvents();
 	void ProcessTriggeredEvents(int Events, vec2 Pos);
 	void UpdatePositions();
@@ -56,6 +64,10 @@ class CGameClient : public IGameClient
 	int m_PredictedTick;
 	int m_LastNewPredictedTick;
 
+	CPrediction m_Prediction;
+	static const CNetObj_PlayerInput *PredictionInput(int Tick, void *pUser);
+	static void PredictionEvents(int Tick, int Events, vec2 Pos, void *pUser);
+
 	int m_LastGameStartTick;
 	int m_LastFlagCarrierRed;
 	int m_LastFlagCarrierBlue;
@@ -0,0 +1,58 @@
+/* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
+/* If you are missing that file, acquire a complete release at teeworlds.com.                */
+#include <base/system.h>
+
+#include "imageloader.h"
+
+CImageLoader::CImageLoader(IEngine *pEngine, IGraphics *pGraphics)
+{
+	m_pEngine = pEngine;
+	m_pGraphics = pGraphics;
+}
+
+CImageLoader::~CImageLoader()
+{
+	// the jobs still point to the images
+	Wait();
+	for(int i = 0; i < m_apImages.size(); i++)
+	{
+		if(m_apImages[i]->m_Loaded)
+			mem_free(m_apImages[i]->m_Info.m_pData);
+	}
+	m_apImages.delete_all();
+}
+
+int CImageLoader::DecodeJob(void *pUser)
+{
+	CImage *pImage = (CImage *)pUser;
+	pImage->m_Loaded = pImage->m_pGraphics->LoadPNG(&pImage->m_Info, pImage->m_aFilename, pImage->m_StorageType) != 0;
+	return 0;
+}
+
+int CImageLoader::Add(const char *pFilename, int StorageType)
+{
+	CImage *pImage = new CImage;
+	pImage->m_pGraphics = m_pGraphics;
+	str_copy(pImage->m_aFilename, pFilename, sizeof(pImage->m_aFilename));
+	pImage->m_StorageType = StorageType;
+	pImage->m_Loaded = false;
+	m_pEngine->AddJob(&pImage->m_Job, DecodeJob, pImage, &m_Group);
+	return m_apImages.add(pImage);
+}
+
+void CImageLoader::Wait()
+{
+	m_pEngine->WaitForJobs(&m_Group);
+}
+
+IGraphics::CTextureHandle CImageLoader::LoadTexture(int Index, int StoreFormat, int Flags) const
+{
+	// a file that failed gets the invalid texture like with the direct load
+	const CImageInfo *pInfo = Get(Index);
+	if(!pInfo)
+		return m_pGraphics->LoadTexture(m_apImages[Index]->m_aFilename, m_apImages[Index]->m_StorageType, StoreFormat, Flags);
+
+	if(StoreFormat == CImageInfo::FORMAT_AUTO)
+		StoreFormat = pInfo->m_Format;
+	return m_pGraphics->LoadTextureRaw(pInfo->m_Width, pInfo->m_Height, pInfo->m_Format, pInfo->m_pData, StoreFormat, Flags);
+}
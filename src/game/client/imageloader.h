@@ -0,0 +1,47 @@
+/* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
+/* If you are missing that file, acquire a complete release at teeworlds.com.                */
+#ifndef GAME_CLIENT_IMAGELOADER_H
+#define GAME_CLIENT_IMAGELOADER_H
+
+#include <base/tl/array.h>
+
+#include <engine/engine.h>
+#include <engine/graphics.h>
+
+// decodes png files on the job pool of the engine. the images are fetched in the order they were
+// added once all of them are decoded, so their textures reach the graphics thread in one go
+class CImageLoader
+{
+	struct CImage
+	{
+		CJob m_Job;
+		IGraphics *m_pGraphics;
+		char m_aFilename[512];
+		int m_StorageType;
+		CImageInfo m_Info;
+		bool m_Loaded;
+	};
+
+	IEngine *m_pEngine;
+	IGraphics *m_pGraphics;
+	array<CImage *> m_apImages;
+	CJobGroup m_Group;
+
+	static int DecodeJob(void *pUser);
+
+public:
+	CImageLoader(IEngine *pEngine, IGraphics *pGraphics);
+	~CImageLoader();
+
+	// returns the index to fetch the image with
+	int Add(const char *pFilename, int StorageType);
+	void Wait();
+
+	int Num() const { return m_apImages.size(); }
+	const char *Filename(int Index) const { return m_apImages[Index]->m_aFilename; }
+	// 0 if the file could not be loaded, the data is freed with the loader
+	CImageInfo *Get(int Index) const { return m_apImages[Index]->m_Loaded ? &m_apImages[Index]->m_Info : 0; }
+	IGraphics::CTextureHandle LoadTexture(int Index, int StoreFormat, int Flags) const;
+};
+
+#endif
@@ -0,0 +1,134 @@
+/* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
+/* If you are missing that file, acquire a complete release at teeworlds.com.                */
+#include "prediction.h"
+
+CPrediction::CPrediction()
+{
+	Reset();
+}
+
+void CPrediction::Reset()
+{
+	m_StartTick = -1;
+	m_EndTick = -1;
+	m_LocalID = -1;
+}
+
+void CPrediction::Predict(CCharacterCore *const *apCharacters, const CNetObj_CharacterCore *const *apSnapCharacters,
+	CCollision *pCollision, const CTuningParams *pTuning, int LocalID, int GameTick, int PredTick,
+	PREDICTION_INPUT pfnInput, PREDICTION_EVENTS pfnEvents, void *pUser,
+	CCharacterCore *pPrevChar, CCharacterCore *pChar)
+{
+	// the world keeps the characters of the last prediction. the cached ticks only hold for the
+	// same characters, tuning and input owner
+	CWorldCore *pWorld = &m_World;
+	if(m_LocalID != LocalID || GameTick < m_StartTick || mem_comp(&pWorld->m_Tuning, pTuning, sizeof(*pTuning)) != 0)
+		m_EndTick = -1;
+	m_LocalID = LocalID;
+	pWorld->m_Tuning = *pTuning;
+
+	for(int i = 0; i < MAX_CLIENTS; i++)
+	{
+		CCharacterCore *pCharacter = apCharacters[i];
+		if(pWorld->m_apCharacters[i] != pCharacter)
+			m_EndTick = -1;
+		pWorld->m_apCharacters[i] = pCharacter;
+		if(!pCharacter)
+			continue;
+
+		pCharacter->Init(pWorld, pCollision, 0);
+		pCharacter->Read(apSnapCharacters[i]);
+	}
+
+	// a tick is taken from the cache when the tick before came out the same as last time and the
+	// input did not change, which is why the first tick is always simulated
+	int WorldTick = GameTick;
+	bool Cached = false;
+	for(int Tick = WorldTick+1; Tick <= PredTick; Tick++)
+	{
+		CTick *pCache = &m_aTicks[Tick%MAX_TICKS];
+		CNetObj_PlayerInput Input;
+		mem_zero(&Input, sizeof(Input));
+		const CNetObj_PlayerInput *pInput = pfnInput(Tick, pUser);
+		if(pInput)
+			Input = *pInput;
+		bool Known = Tick <= m_EndTick && pCache->m_Tick == Tick && mem_comp(&pCache->m_Input, &Input, sizeof(Input)) == 0;
+		if(Cached && Known)
+			continue;
+
+		// continue from the last cached tick
+		if(WorldTick != Tick-1)
+		{
+			const CTick *pPrev = &m_aTicks[(Tick-1)%MAX_TICKS];
+			for(int c = 0; c < MAX_CLIENTS; c++)
+				if(pWorld->m_apCharacters[c])
+					mem_copy(pWorld->m_apCharacters[c], &pPrev->m_aCharacters[c], sizeof(CCharacterCore));
+		}
+		WorldTick = Tick;
+
+		// fetch the local
+		if(Tick == PredTick)
+			*pPrevChar = *pWorld->m_apCharacters[LocalID];
+
+		// first calculate where everyone should move
+		for(int c = 0; c < MAX_CLIENTS; c++)
+		{
+			if(!pWorld->m_apCharacters[c])
+				continue;
+
+			mem_zero(&pWorld->m_apCharacters[c]->m_Input, sizeof(pWorld->m_apCharacters[c]->m_Input));
+			if(LocalID == c)
+			{
+				// apply player input
+				pWorld->m_apCharacters[c]->m_Input = Input;
+				pWorld->m_apCharacters[c]->Tick(true);
+			}
+			else
+				pWorld->m_apCharacters[c]->Tick(false);
+
+		}
+
+		// move all players and quantize their data
+		for(int c = 0; c < MAX_CLIENTS; c++)
+		{
+			if(!pWorld->m_apCharacters[c])
+				continue;
+
+			pWorld->m_apCharacters[c]->Move();
+			pWorld->m_apCharacters[c]->Quantize();
+		}
+
+		pfnEvents(Tick, pWorld->m_apCharacters[LocalID]->m_TriggeredEvents, pWorld->m_apCharacters[LocalID]->m_Pos, pUser);
+
+		if(Tick == PredTick)
+			*pChar = *pWorld->m_apCharacters[LocalID];
+
+		// the following ticks in the cache still hold if this one came out the same
+		Cached = Known;
+		for(int c = 0; c < MAX_CLIENTS && Cached; c++)
+			if(pWorld->m_apCharacters[c] && mem_comp(pWorld->m_apCharacters[c], &pCache->m_aCharacters[c], sizeof(CCharacterCore)) != 0)
+				Cached = false;
+		if(!Cached)
+		{
+			if(Tick == GameTick+1)
+				m_StartTick = GameTick;
+			pCache->m_Tick = Tick;
+			pCache->m_Input = Input;
+			for(int c = 0; c < MAX_CLIENTS; c++)
+				if(pWorld->m_apCharacters[c])
+					mem_copy(&pCache->m_aCharacters[c], pWorld->m_apCharacters[c], sizeof(CCharacterCore));
+			m_EndTick = Tick;
+		}
+	}
+
+	// the last ticks came from the cache
+	if(WorldTick < PredTick)
+	{
+		const CTick *pLast = &m_aTicks[PredTick%MAX_TICKS];
+		for(int c = 0; c < MAX_CLIENTS; c++)
+			if(pWorld->m_apCharacters[c])
+				mem_copy(pWorld->m_apCharacters[c], &pLast->m_aCharacters[c], sizeof(CCharacterCore));
+		*pPrevChar = m_aTicks[(PredTick-1)%MAX_TICKS].m_aCharacters[LocalID];
+		*pChar = pLast->m_aCharacters[LocalID];
+	}
+}
@@ -0,0 +1,52 @@
+/* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
+/* If you are missing that file, acquire a complete release at teeworlds.com.                */
+#ifndef GAME_CLIENT_PREDICTION_H
+#define GAME_CLIENT_PREDICTION_H
+
+#include <game/gamecore.h>
+
+// predicts the characters from the snapshot tick to the predicted tick. the predicted characters
+// of every tick are kept, so a new frame only simulates the ticks that were not predicted yet and
+// a new snapshot only the ones that turn out different
+class CPrediction
+{
+public:
+	// the input of the local player for a tick, 0 if there is none
+	typedef const CNetObj_PlayerInput *(*PREDICTION_INPUT)(int Tick, void *pUser);
+	// the events of the local player in a tick that was simulated
+	typedef void (*PREDICTION_EVENTS)(int Tick, int Events, vec2 Pos, void *pUser);
+
+	enum
+	{
+		MAX_TICKS=64,
+	};
+
+	CPrediction();
+
+	void Reset();
+
+	// apCharacters hold the characters to predict, 0 for the ones that are not there, and
+	// apSnapCharacters their snapshot state. the characters end up at the predicted tick.
+	// pPrevChar and pChar get the local character before and at the predicted tick
+	void Predict(CCharacterCore *const *apCharacters, const CNetObj_CharacterCore *const *apSnapCharacters,
+		CCollision *pCollision, const CTuningParams *pTuning, int LocalID, int GameTick, int PredTick,
+		PREDICTION_INPUT pfnInput, PREDICTION_EVENTS pfnEvents, void *pUser,
+		CCharacterCore *pPrevChar, CCharacterCore *pChar);
+
+private:
+	struct CTick
+	{
+		int m_Tick;
+		CNetObj_PlayerInput m_Input;
+		CCharacterCore m_aCharacters[MAX_CLIENTS];
+	};
+
+	// keeps the characters of the last prediction
+	CWorldCore m_World;
+	CTick m_aTicks[MAX_TICKS];
+	int m_StartTick;
+	int m_EndTick;
+	int m_LocalID;
+};
+
+#endif
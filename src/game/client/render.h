@@ -20,6 +20,7 @@ enum
 	LAYERRENDERFLAG_TRANSPARENT = 2,
 
 	TILERENDERFLAG_EXTEND = 4,
+	TILERENDERFLAG_EXTEND_ONLY = 8, // only the tiles outside of the layer
 };
 
 class CTeeRenderInfo
@@ -43,6 +44,33 @@ public:
 	int m_GotAirJump;
 };
 
+// the quads of a tile layer, built once and drawn by chunks so only the visible ones are submitted
+class CTileLayerBuffer
+{
+public:
+	enum
+	{
+		CHUNK_SIZE=32,
+	};
+
+	struct CChunk
+	{
+		int m_Offset;
+		int m_NumOpaque; // the tiles with TILEFLAG_OPAQUE come first
+		int m_NumTransparent;
+	};
+
+	IGraphics::CQuadBufferHandle m_Buffer;
+	int m_Width;
+	int m_Height;
+	int m_NumChunksX;
+	int m_NumChunksY;
+	CChunk *m_pChunks;
+
+	CTileLayerBuffer() : m_Width(0), m_Height(0), m_NumChunksX(0), m_NumChunksY(0), m_pChunks(0) {}
+	bool IsBuilt() const { return m_pChunks != 0; }
+};
+
 typedef void (*ENVELOPE_EVAL)(float TimeOffset, int Env, float *pChannels, void *pUser);
 class CTextCursor;
 
@@ -81,6 +109,9 @@ public:
 	static void RenderEvalEnvelope(CEnvPoint *pPoints, int NumPoints, int Channels, float Time, float *pResult);
 	void RenderQuads(CQuad *pQuads, int NumQuads, int Flags, ENVELOPE_EVAL pfnEval, void *pUser);
 	void RenderTilemap(CTile *pTiles, int w, int h, float Scale, vec4 Color, int RenderFlags, ENVELOPE_EVAL pfnEval, void *pUser, int ColorEnv, int ColorEnvOffset);
+	void CreateTileLayerBuffer(CTileLayerBuffer *pBuffer, const CTile *pTiles, int w, int h, float Scale);
+	void DestroyTileLayerBuffer(CTileLayerBuffer *pBuffer);
+	void RenderTileLayerBuffer(const CTileLayerBuffer *pBuffer, CTile *pTiles, float Scale, vec4 Color, int RenderFlags, ENVELOPE_EVAL pfnEval, void *pUser, int ColorEnv, int ColorEnvOffset);
 
 	// helpers
 	void MapScreenToWorld(float CenterX, float CenterY, float ParallaxX, float ParallaxY,
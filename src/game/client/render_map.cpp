@@ -7,6 +7,11 @@
 
 #include "render.h"
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+	#define QUADS_SSE2 1
+	#include <emmintrin.h>
+#endif
+
 void ValidateFCurve(const vec2& p0, vec2& p1, vec2& p2, const vec2& p3)
 {
 	// validate the bezier curve
@@ -216,120 +221,214 @@ void CRenderTools::RenderEvalEnvelope(CEnvPoint *pPoints, int NumPoints, int Cha
 	return;
 }
 
-static void Rotate(CPoint *pCenter, CPoint *pPoint, float Rotation)
+#if !defined(QUADS_SSE2)
+static void Rotate(const CPoint *pCenter, CPoint *pPoint, float Cos, float Sin)
 {
 	int x = pPoint->x - pCenter->x;
 	int y = pPoint->y - pCenter->y;
-	pPoint->x = (int)(x * cosf(Rotation) - y * sinf(Rotation) + pCenter->x);
-	pPoint->y = (int)(x * sinf(Rotation) + y * cosf(Rotation) + pCenter->y);
+	pPoint->x = (int)(x * Cos - y * Sin + pCenter->x);
+	pPoint->y = (int)(x * Sin + y * Cos + pCenter->y);
+}
+#endif
+
+// corners of a quad, rotated around its center in fixed point and then moved
+static void TransformQuad(const CQuad *q, bool Rotated, float Cos, float Sin, float OffsetX, float OffsetY, float *pX, float *pY)
+{
+#if defined(QUADS_SSE2)
+	// one corner per lane, the steps are the same as in the scalar version so the result is too
+	__m128i Points01 = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i *)&q->m_aPoints[0]), _MM_SHUFFLE(3, 1, 2, 0));
+	__m128i Points23 = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i *)&q->m_aPoints[2]), _MM_SHUFFLE(3, 1, 2, 0));
+	__m128i X = _mm_unpacklo_epi64(Points01, Points23);
+	__m128i Y = _mm_unpackhi_epi64(Points01, Points23);
+	if(Rotated)
+	{
+		const __m128i CenterX = _mm_set1_epi32(q->m_aPoints[4].x);
+		const __m128i CenterY = _mm_set1_epi32(q->m_aPoints[4].y);
+		const __m128 VCos = _mm_set1_ps(Cos);
+		const __m128 VSin = _mm_set1_ps(Sin);
+		__m128 RelX = _mm_cvtepi32_ps(_mm_sub_epi32(X, CenterX));
+		__m128 RelY = _mm_cvtepi32_ps(_mm_sub_epi32(Y, CenterY));
+		X = _mm_cvttps_epi32(_mm_add_ps(_mm_sub_ps(_mm_mul_ps(RelX, VCos), _mm_mul_ps(RelY, VSin)), _mm_cvtepi32_ps(CenterX)));
+		Y = _mm_cvttps_epi32(_mm_add_ps(_mm_add_ps(_mm_mul_ps(RelX, VSin), _mm_mul_ps(RelY, VCos)), _mm_cvtepi32_ps(CenterY)));
+	}
+	const __m128 Scale = _mm_set1_ps(1.0f/(1<<10));
+	_mm_storeu_ps(pX, _mm_add_ps(_mm_mul_ps(_mm_cvtepi32_ps(X), Scale), _mm_set1_ps(OffsetX)));
+	_mm_storeu_ps(pY, _mm_add_ps(_mm_mul_ps(_mm_cvtepi32_ps(Y), Scale), _mm_set1_ps(OffsetY)));
+#else
+	for(int k = 0; k < 4; k++)
+	{
+		CPoint Point = q->m_aPoints[k];
+		if(Rotated)
+			Rotate(&q->m_aPoints[4], &Point, Cos, Sin);
+		pX[k] = fx2f(Point.x)+OffsetX;
+		pY[k] = fx2f(Point.y)+OffsetY;
+	}
+#endif
 }
 
 void CRenderTools::RenderQuads(CQuad *pQuads, int NumQuads, int RenderFlags, ENVELOPE_EVAL pfnEval, void *pUser)
 {
+	enum
+	{
+		QUAD_BATCH=64,
+	};
+	float aX[QUAD_BATCH*4];
+	float aY[QUAD_BATCH*4];
+
 	Graphics()->QuadsBegin();
 	float Conv = 1/255.0f;
-	for(int i = 0; i < NumQuads; i++)
+	for(int Start = 0; Start < NumQuads; Start += QUAD_BATCH)
 	{
-		CQuad *q = &pQuads[i];
+		int Num = min(NumQuads-Start, (int)QUAD_BATCH);
 
-		float r=1, g=1, b=1, a=1;
-
-		if(q->m_ColorEnv >= 0)
+		// the corners of the whole batch first, then the colors and texture coordinates
+		for(int i = 0; i < Num; i++)
 		{
-			float aChannels[4];
-			pfnEval(q->m_ColorEnvOffset/1000.0f, q->m_ColorEnv, aChannels, pUser);
-			r = aChannels[0];
-			g = aChannels[1];
-			b = aChannels[2];
-			a = aChannels[3];
-		}
+			CQuad *q = &pQuads[Start+i];
 
-		/*bool Opaque = false;
-		 TODO: Analyze quadtexture
-		if(a < 0.01f || (q->m_aColors[0].a < 0.01f && q->m_aColors[1].a < 0.01f && q->m_aColors[2].a < 0.01f && q->m_aColors[3].a < 0.01f))
-			Opaque = true;
-
-		if(Opaque && !(RenderFlags&LAYERRENDERFLAG_OPAQUE))
-			continue;
-		if(!Opaque && !(RenderFlags&LAYERRENDERFLAG_TRANSPARENT))
-			continue;
-		*/
-		vec2 aTexCoords[4];
-		for(int k = 0; k < 4; k++)
-		{
-			aTexCoords[k].x = fx2f(q->m_aTexcoords[k].x);
-			aTexCoords[k].y = fx2f(q->m_aTexcoords[k].y);
-		}
+			float OffsetX = 0;
+			float OffsetY = 0;
+			float Rot = 0;
 
-		// Check if we want to repeat the texture
-		// Otherwise clamp to the edge to prevent texture bleeding
-		bool RepeatU = false, RepeatV = false;
-		for(int k = 0; k < 4; k++)
-		{
-			if(aTexCoords[k].x < 0.0f || aTexCoords[k].x > 1.0f)
-				RepeatU = true;
-			if(aTexCoords[k].y < 0.0f || aTexCoords[k].y > 1.0f)
-				RepeatV = true;
+			// TODO: fix this
+			if(q->m_PosEnv >= 0)
+			{
+				float aChannels[4];
+				pfnEval(q->m_PosEnvOffset/1000.0f, q->m_PosEnv, aChannels, pUser);
+				OffsetX = aChannels[0];
+				OffsetY = aChannels[1];
+				Rot = aChannels[2]/360.0f*pi*2;
+			}
+
+			// the same angle for all four corners
+			float Cos = 1.0f;
+			float Sin = 0.0f;
+			if(Rot != 0)
+			{
+				Cos = cosf(Rot);
+				Sin = sinf(Rot);
+			}
+			TransformQuad(q, Rot != 0, Cos, Sin, OffsetX, OffsetY, &aX[i*4], &aY[i*4]);
 		}
-		Graphics()->WrapMode(
-			RepeatU ? IGraphics::WRAP_REPEAT : IGraphics::WRAP_CLAMP,
-			RepeatV ? IGraphics::WRAP_REPEAT : IGraphics::WRAP_CLAMP);
-
-		Graphics()->QuadsSetSubsetFree(
-			aTexCoords[0].x, aTexCoords[0].y,
-			aTexCoords[1].x, aTexCoords[1].y,
-			aTexCoords[2].x, aTexCoords[2].y,
-			aTexCoords[3].x, aTexCoords[3].y);
-
-		float OffsetX = 0;
-		float OffsetY = 0;
-		float Rot = 0;
-
-		// TODO: fix this
-		if(q->m_PosEnv >= 0)
+
+		for(int i = 0; i < Num; i++)
 		{
-			float aChannels[4];
-			pfnEval(q->m_PosEnvOffset/1000.0f, q->m_PosEnv, aChannels, pUser);
-			OffsetX = aChannels[0];
-			OffsetY = aChannels[1];
-			Rot = aChannels[2]/360.0f*pi*2;
-		}
+			CQuad *q = &pQuads[Start+i];
 
-		IGraphics::CColorVertex Array[4] = {
-			IGraphics::CColorVertex(0, q->m_aColors[0].r*Conv*r*q->m_aColors[0].a*Conv*a, q->m_aColors[0].g*Conv*g*q->m_aColors[0].a*Conv*a, q->m_aColors[0].b*Conv*b*q->m_aColors[0].a*Conv*a, q->m_aColors[0].a*Conv*a),
-			IGraphics::CColorVertex(1, q->m_aColors[1].r*Conv*r*q->m_aColors[1].a*Conv*a, q->m_aColors[1].g*Conv*g*q->m_aColors[1].a*Conv*a, q->m_aColors[1].b*Conv*b*q->m_aColors[1].a*Conv*a, q->m_aColors[1].a*Conv*a),
-			IGraphics::CColorVertex(2, q->m_aColors[2].r*Conv*r*q->m_aColors[2].a*Conv*a, q->m_aColors[2].g*Conv*g*q->m_aColors[2].a*Conv*a, q->m_aColors[2].b*Conv*b*q->m_aColors[2].a*Conv*a, q->m_aColors[2].a*Conv*a),
-			IGraphics::CColorVertex(3, q->m_aColors[3].r*Conv*r*q->m_aColors[3].a*Conv*a, q->m_aColors[3].g*Conv*g*q->m_aColors[3].a*Conv*a, q->m_aColors[3].b*Conv*b*q->m_aColors[3].a*Conv*a, q->m_aColors[3].a*Conv*a)};
-		Graphics()->SetColorVertex(Array, 4);
+			float r=1, g=1, b=1, a=1;
 
-		CPoint *pPoints = q->m_aPoints;
+			if(q->m_ColorEnv >= 0)
+			{
+				float aChannels[4];
+				pfnEval(q->m_ColorEnvOffset/1000.0f, q->m_ColorEnv, aChannels, pUser);
+				r = aChannels[0];
+				g = aChannels[1];
+				b = aChannels[2];
+				a = aChannels[3];
+			}
 
-		if(Rot != 0)
-		{
-			static CPoint aRotated[4];
-			aRotated[0] = q->m_aPoints[0];
-			aRotated[1] = q->m_aPoints[1];
-			aRotated[2] = q->m_aPoints[2];
-			aRotated[3] = q->m_aPoints[3];
-			pPoints = aRotated;
-
-			Rotate(&q->m_aPoints[4], &aRotated[0], Rot);
-			Rotate(&q->m_aPoints[4], &aRotated[1], Rot);
-			Rotate(&q->m_aPoints[4], &aRotated[2], Rot);
-			Rotate(&q->m_aPoints[4], &aRotated[3], Rot);
-		}
+			/*bool Opaque = false;
+			 TODO: Analyze quadtexture
+			if(a < 0.01f || (q->m_aColors[0].a < 0.01f && q->m_aColors[1].a < 0.01f && q->m_aColors[2].a < 0.01f && q->m_aColors[3].a < 0.01f))
+				Opaque = true;
+
+			if(Opaque && !(RenderFlags&LAYERRENDERFLAG_OPAQUE))
+				continue;
+			if(!Opaque && !(RenderFlags&LAYERRENDERFLAG_TRANSPARENT))
+				continue;
+			*/
+			vec2 aTexCoords[4];
+			for(int k = 0; k < 4; k++)
+			{
+				aTexCoords[k].x = fx2f(q->m_aTexcoords[k].x);
+				aTexCoords[k].y = fx2f(q->m_aTexcoords[k].y);
+			}
 
-		IGraphics::CFreeformItem Freeform(
-			fx2f(pPoints[0].x)+OffsetX, fx2f(pPoints[0].y)+OffsetY,
-			fx2f(pPoints[1].x)+OffsetX, fx2f(pPoints[1].y)+OffsetY,
-			fx2f(pPoints[2].x)+OffsetX, fx2f(pPoints[2].y)+OffsetY,
-			fx2f(pPoints[3].x)+OffsetX, fx2f(pPoints[3].y)+OffsetY);
-		Graphics()->QuadsDrawFreeform(&Freeform, 1);
+			// Check if we want to repeat the texture
+			// Otherwise clamp to the edge to prevent texture bleeding
+			bool RepeatU = false, RepeatV = false;
+			for(int k = 0; k < 4; k++)
+			{
+				if(aTexCoords[k].x < 0.0f || aTexCoords[k].x > 1.0f)
+					RepeatU = true;
+				if(aTexCoords[k].y < 0.0f || aTexCoords[k].y > 1.0f)
+					RepeatV = true;
+			}
+			Graphics()->WrapMode(
+				RepeatU ? IGraphics::WRAP_REPEAT : IGraphics::WRAP_CLAMP,
+				RepeatV ? IGraphics::WRAP_REPEAT : IGraphics::WRAP_CLAMP);
+
+			Graphics()->QuadsSetSubsetFree(
+				aTexCoords[0].x, aTexCoords[0].y,
+				aTexCoords[1].x, aTexCoords[1].y,
+				aTexCoords[2].x, aTexCoords[2].y,
+				aTexCoords[3].x, aTexCoords[3].y);
+
+			IGraphics::CColorVertex Array[4] = {
+				IGraphics::CColorVertex(0, q->m_aColors[0].r*Conv*r*q->m_aColors[0].a*Conv*a, q->m_aColors[0].g*Conv*g*q->m_aColors[0].a*Conv*a, q->m_aColors[0].b*Conv*b*q->m_aColors[0].a*Conv*a, q->m_aColors[0].a*Conv*a),
+				IGraphics::CColorVertex(1, q->m_aColors[1].r*Conv*r*q->m_aColors[1].a*Conv*a, q->m_aColors[1].g*Conv*g*q->m_aColors[1].a*Conv*a, q->m_aColors[1].b*Conv*b*q->m_aColors[1].a*Conv*a, q->m_aColors[1].a*Conv*a),
+				IGraphics::CColorVertex(2, q->m_aColors[2].r*Conv*r*q->m_aColors[2].a*Conv*a, q->m_aColors[2].g*Conv*g*q->m_aColors[2].a*Conv*a, q->m_aColors[2].b*Conv*b*q->m_aColors[2].a*Conv*a, q->m_aColors[2].a*Conv*a),
+				IGraphics::CColorVertex(3, q->m_aColors[3].r*Conv*r*q->m_aColors[3].a*Conv*a, q->m_aColors[3].g*Conv*g*q->m_aColors[3].a*Conv*a, q->m_aColors[3].b*Conv*b*q->m_aColors[3].a*Conv*a, q->m_aColors[3].a*Conv*a)};
+			Graphics()->SetColorVertex(Array, 4);
+
+			const float *pX = &aX[i*4];
+			const float *pY = &aY[i*4];
+			IGraphics::CFreeformItem Freeform(
+				pX[0], pY[0],
+				pX[1], pY[1],
+				pX[2], pY[2],
+				pX[3], pY[3]);
+			Graphics()->QuadsDrawFreeform(&Freeform, 1);
+		}
 	}
 	Graphics()->QuadsEnd();
 	Graphics()->WrapNormal();
 }
 
+static void SetTileSubset(IGraphics *pGraphics, unsigned char Index, unsigned char Flags)
+{
+	float x0 = 0;
+	float y0 = 0;
+	float x1 = 1;
+	float y1 = 0;
+	float x2 = 1;
+	float y2 = 1;
+	float x3 = 0;
+	float y3 = 1;
+
+	if(Flags&TILEFLAG_VFLIP)
+	{
+		x0 = x2;
+		x1 = x3;
+		x2 = x3;
+		x3 = x0;
+	}
+
+	if(Flags&TILEFLAG_HFLIP)
+	{
+		y0 = y3;
+		y2 = y1;
+		y3 = y1;
+		y1 = y0;
+	}
+
+	if(Flags&TILEFLAG_ROTATE)
+	{
+		float Tmp = x0;
+		x0 = x3;
+		x3 = x2;
+		x2 = x1;
+		x1 = Tmp;
+		Tmp = y0;
+		y0 = y3;
+		y3 = y2;
+		y2 = y1;
+		y1 = Tmp;
+	}
+
+	pGraphics->QuadsSetSubsetFree(x0, y0, x1, y1, x2, y2, x3, y3, Index);
+}
+
 void CRenderTools::RenderTilemap(CTile *pTiles, int w, int h, float Scale, vec4 Color, int RenderFlags,
 									ENVELOPE_EVAL pfnEval, void *pUser, int ColorEnv, int ColorEnvOffset)
 {
@@ -359,6 +458,12 @@ void CRenderTools::RenderTilemap(CTile *pTiles, int w, int h, float Scale, vec4
 	for(int y = StartY; y < EndY; y++)
 		for(int x = StartX; x < EndX; x++)
 		{
+			if(RenderFlags&TILERENDERFLAG_EXTEND_ONLY && x >= 0 && x < w && y >= 0 && y < h)
+			{
+				x = w-1;
+				continue;
+			}
+
 			int mx = x;
 			int my = y;
 
@@ -406,46 +511,7 @@ void CRenderTools::RenderTilemap(CTile *pTiles, int w, int h, float Scale, vec4
 
 				if(Render)
 				{
-					float x0 = 0;
-					float y0 = 0;
-					float x1 = 1;
-					float y1 = 0;
-					float x2 = 1;
-					float y2 = 1;
-					float x3 = 0;
-					float y3 = 1;
-
-					if(Flags&TILEFLAG_VFLIP)
-					{
-						x0 = x2;
-						x1 = x3;
-						x2 = x3;
-						x3 = x0;
-					}
-
-					if(Flags&TILEFLAG_HFLIP)
-					{
-						y0 = y3;
-						y2 = y1;
-						y3 = y1;
-						y1 = y0;
-					}
-
-					if(Flags&TILEFLAG_ROTATE)
-					{
-						float Tmp = x0;
-						x0 = x3;
-						x3 = x2;
-						x2 = x1;
-						x1 = Tmp;
-						Tmp = y0;
-						y0 = y3;
-						y3 = y2;
-						y2 = y1;
-						y1 = Tmp;
-					}
-
-					Graphics()->QuadsSetSubsetFree(x0, y0, x1, y1, x2, y2, x3, y3, Index);
+					SetTileSubset(Graphics(), Index, Flags);
 					IGraphics::CQuadItem QuadItem(x*Scale, y*Scale, Scale, Scale);
 					Graphics()->QuadsDrawTL(&QuadItem, 1);
 				}
@@ -456,3 +522,122 @@ void CRenderTools::RenderTilemap(CTile *pTiles, int w, int h, float Scale, vec4
 	Graphics()->QuadsEnd();
 	Graphics()->MapScreen(ScreenX0, ScreenY0, ScreenX1, ScreenY1);
 }
+
+void CRenderTools::CreateTileLayerBuffer(CTileLayerBuffer *pBuffer, const CTile *pTiles, int w, int h, float Scale)
+{
+	pBuffer->m_Width = w;
+	pBuffer->m_Height = h;
+	pBuffer->m_NumChunksX = (w+CTileLayerBuffer::CHUNK_SIZE-1)/CTileLayerBuffer::CHUNK_SIZE;
+	pBuffer->m_NumChunksY = (h+CTileLayerBuffer::CHUNK_SIZE-1)/CTileLayerBuffer::CHUNK_SIZE;
+	pBuffer->m_pChunks = new CTileLayerBuffer::CChunk[max(pBuffer->m_NumChunksX*pBuffer->m_NumChunksY, 1)];
+
+	int NumQuads = 0;
+	Graphics()->QuadBufferBegin();
+	for(int cy = 0; cy < pBuffer->m_NumChunksY; cy++)
+		for(int cx = 0; cx < pBuffer->m_NumChunksX; cx++)
+		{
+			CTileLayerBuffer::CChunk *pChunk = &pBuffer->m_pChunks[cy*pBuffer->m_NumChunksX+cx];
+			pChunk->m_Offset = NumQuads;
+
+			int StartX = cx*CTileLayerBuffer::CHUNK_SIZE;
+			int StartY = cy*CTileLayerBuffer::CHUNK_SIZE;
+			int EndX = min(StartX+(int)CTileLayerBuffer::CHUNK_SIZE, w);
+			int EndY = min(StartY+(int)CTileLayerBuffer::CHUNK_SIZE, h);
+
+			// opaque tiles first, then the rest
+			for(int Pass = 0; Pass < 2; Pass++)
+			{
+				for(int y = StartY; y < EndY; y++)
+					for(int x = StartX; x < EndX; x++)
+					{
+						const CTile *pTile = &pTiles[y*w+x];
+						if(!pTile->m_Index || ((pTile->m_Flags&TILEFLAG_OPAQUE) != 0) != (Pass == 0))
+							continue;
+
+						SetTileSubset(Graphics(), pTile->m_Index, pTile->m_Flags);
+						IGraphics::CQuadItem QuadItem(x*Scale, y*Scale, Scale, Scale);
+						Graphics()->QuadsDrawTL(&QuadItem, 1);
+						NumQuads++;
+					}
+
+				if(Pass == 0)
+					pChunk->m_NumOpaque = NumQuads-pChunk->m_Offset;
+				else
+					pChunk->m_NumTransparent = NumQuads-pChunk->m_Offset-pChunk->m_NumOpaque;
+			}
+		}
+	pBuffer->m_Buffer = Graphics()->QuadBufferEnd();
+}
+
+void CRenderTools::DestroyTileLayerBuffer(CTileLayerBuffer *pBuffer)
+{
+	Graphics()->QuadBufferDestroy(&pBuffer->m_Buffer);
+	delete[] pBuffer->m_pChunks;
+	pBuffer->m_pChunks = 0;
+	pBuffer->m_NumChunksX = pBuffer->m_NumChunksY = 0;
+}
+
+void CRenderTools::RenderTileLayerBuffer(const CTileLayerBuffer *pBuffer, CTile *pTiles, float Scale, vec4 Color, int RenderFlags,
+									ENVELOPE_EVAL pfnEval, void *pUser, int ColorEnv, int ColorEnvOffset)
+{
+	float ScreenX0, ScreenY0, ScreenX1, ScreenY1;
+	Graphics()->GetScreen(&ScreenX0, &ScreenY0, &ScreenX1, &ScreenY1);
+
+	float r=1, g=1, b=1, a=1;
+	if(ColorEnv >= 0)
+	{
+		float aChannels[4];
+		pfnEval(ColorEnvOffset/1000.0f, ColorEnv, aChannels, pUser);
+		r = aChannels[0];
+		g = aChannels[1];
+		b = aChannels[2];
+		a = aChannels[3];
+	}
+	const float Alpha = Color.a*a;
+	const bool Opaque = Alpha > 254.0f/255.0f;
+
+	int StartY = (int)(ScreenY0/Scale)-1;
+	int StartX = (int)(ScreenX0/Scale)-1;
+	int EndY = (int)(ScreenY1/Scale)+1;
+	int EndX = (int)(ScreenX1/Scale)+1;
+
+	// the visible chunks, neighbouring ranges are merged into one draw
+	int StartChunkX = clamp(StartX, 0, pBuffer->m_Width)/CTileLayerBuffer::CHUNK_SIZE;
+	int StartChunkY = clamp(StartY, 0, pBuffer->m_Height)/CTileLayerBuffer::CHUNK_SIZE;
+	int EndChunkX = (clamp(EndX, 0, pBuffer->m_Width)+CTileLayerBuffer::CHUNK_SIZE-1)/CTileLayerBuffer::CHUNK_SIZE;
+	int EndChunkY = (clamp(EndY, 0, pBuffer->m_Height)+CTileLayerBuffer::CHUNK_SIZE-1)/CTileLayerBuffer::CHUNK_SIZE;
+
+	int Offset = 0;
+	int Num = 0;
+	for(int cy = StartChunkY; cy < EndChunkY; cy++)
+		for(int cx = StartChunkX; cx < EndChunkX; cx++)
+		{
+			const CTileLayerBuffer::CChunk *pChunk = &pBuffer->m_pChunks[cy*pBuffer->m_NumChunksX+cx];
+			int ChunkOffset = pChunk->m_Offset;
+			int ChunkNum = 0;
+			if(Opaque && RenderFlags&LAYERRENDERFLAG_OPAQUE)
+				ChunkNum = pChunk->m_NumOpaque;
+			else if(Opaque && RenderFlags&LAYERRENDERFLAG_TRANSPARENT)
+			{
+				ChunkOffset += pChunk->m_NumOpaque;
+				ChunkNum = pChunk->m_NumTransparent;
+			}
+			else if(!Opaque && RenderFlags&LAYERRENDERFLAG_TRANSPARENT)
+				ChunkNum = pChunk->m_NumOpaque+pChunk->m_NumTransparent;
+
+			if(!ChunkNum)
+				continue;
+			if(Offset+Num != ChunkOffset)
+			{
+				Graphics()->QuadBufferRender(pBuffer->m_Buffer, Offset, Num, Color.r*r*Alpha, Color.g*g*Alpha, Color.b*b*Alpha, Alpha);
+				Offset = ChunkOffset;
+				Num = 0;
+			}
+			Num += ChunkNum;
+		}
+	Graphics()->QuadBufferRender(pBuffer->m_Buffer, Offset, Num, Color.r*r*Alpha, Color.g*g*Alpha, Color.b*b*Alpha, Alpha);
+
+	// the border outside of the layer is not in the buffer
+	if(RenderFlags&TILERENDERFLAG_EXTEND && (StartX < 0 || StartY < 0 || EndX > pBuffer->m_Width || EndY > pBuffer->m_Height))
+		RenderTilemap(pTiles, pBuffer->m_Width, pBuffer->m_Height, Scale, Color, RenderFlags|TILERENDERFLAG_EXTEND_ONLY, pfnEval, pUser, ColorEnv, ColorEnvOffset);
+}
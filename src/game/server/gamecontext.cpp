@@ -48,6 +48,13 @@ void CGameContext::Construct(int Resetting)
 	if(Resetting==NO_RESET)
 	{
 		m_pVoteOptionHeap = new CHeap();
+		m_apVoteOptionBuckets = (CVoteOptionServer **)mem_alloc(sizeof(CVoteOptionServer *)*NUM_VOTE_OPTION_BUCKETS, sizeof(void*));
+		mem_zero(m_apVoteOptionBuckets, sizeof(CVoteOptionServer *)*NUM_VOTE_OPTION_BUCKETS);
+		m_pVoteOptionPackets = 0;
+		m_VoteOptionPacketsSize = 0;
+		m_VoteOptionPacketsCapacity = 0;
+		m_VoteOptionPacketsValid = false;
+		m_VoteOptionGeneration = 0;
 		m_pScore = 0;
 		m_NumMutes = 0;
 		m_NumVoteMutes = 0;
@@ -73,7 +80,11 @@ CGameContext::~CGameContext()
 	for(int i = 0; i < MAX_CLIENTS; i++)
 		delete m_apPlayers[i];
 	if(!m_Resetting)
+	{
 		delete m_pVoteOptionHeap;
+		mem_free(m_apVoteOptionBuckets);
+		mem_free(m_pVoteOptionPackets);
+	}
 
 	if (m_pScore)
 		delete m_pScore;
@@ -84,6 +95,12 @@ void CGameContext::Clear()
 	CHeap *pVoteOptionHeap = m_pVoteOptionHeap;
 	CVoteOptionServer *pVoteOptionFirst = m_pVoteOptionFirst;
 	CVoteOptionServer *pVoteOptionLast = m_pVoteOptionLast;
+	CVoteOptionServer **apVoteOptionBuckets = m_apVoteOptionBuckets;
+	char *pVoteOptionPackets = m_pVoteOptionPackets;
+	int VoteOptionPacketsSize = m_VoteOptionPacketsSize;
+	int VoteOptionPacketsCapacity = m_VoteOptionPacketsCapacity;
+	bool VoteOptionPacketsValid = m_VoteOptionPacketsValid;
+	int VoteOptionGeneration = m_VoteOptionGeneration;
 	int NumVoteOptions = m_NumVoteOptions;
 	CTuningParams Tuning = m_Tuning;
 
@@ -95,10 +112,146 @@ void CGameContext::Clear()
 	m_pVoteOptionHeap = pVoteOptionHeap;
 	m_pVoteOptionFirst = pVoteOptionFirst;
 	m_pVoteOptionLast = pVoteOptionLast;
+	m_apVoteOptionBuckets = apVoteOptionBuckets;
+	m_pVoteOptionPackets = pVoteOptionPackets;
+	m_VoteOptionPacketsSize = VoteOptionPacketsSize;
+	m_VoteOptionPacketsCapacity = VoteOptionPacketsCapacity;
+	m_VoteOptionPacketsValid = VoteOptionPacketsValid;
+	m_VoteOptionGeneration = VoteOptionGeneration;
 	m_NumVoteOptions = NumVoteOptions;
 	m_Tuning = Tuning;
 }
 
+CVoteOptionServer *CGameContext::FindVoteOption(const char *pDescription)
+{
+	for(CVoteOptionServer *pOption = m_apVoteOptionBuckets[str_quickhash_nocase(pDescription)%NUM_VOTE_OPTION_BUCKETS]; pOption; pOption = pOption->m_pNextHash)
+	{
+		if(str_comp_nocase(pDescription, pOption->m_aDescription) == 0)
+			return pOption;
+	}
+	return 0;
+}
+
+void CGameContext::AddVoteOption(const char *pDescription, const char *pCommand)
+{
+	++m_NumVoteOptions;
+	int Len = str_length(pCommand);
+
+	CVoteOptionServer *pOption = (CVoteOptionServer *)m_pVoteOptionHeap->Allocate(sizeof(CVoteOptionServer) + Len);
+	pOption->m_pNext = 0;
+	pOption->m_pPrev = m_pVoteOptionLast;
+	if(pOption->m_pPrev)
+		pOption->m_pPrev->m_pNext = pOption;
+	m_pVoteOptionLast = pOption;
+	if(!m_pVoteOptionFirst)
+		m_pVoteOptionFirst = pOption;
+
+	str_copy(pOption->m_aDescription, pDescription, sizeof(pOption->m_aDescription));
+	mem_copy(pOption->m_aCommand, pCommand, Len+1);
+
+	CVoteOptionServer **ppBucket = &m_apVoteOptionBuckets[str_quickhash_nocase(pOption->m_aDescription)%NUM_VOTE_OPTION_BUCKETS];
+	pOption->m_pNextHash = *ppBucket;
+	*ppBucket = pOption;
+
+	m_VoteOptionPacketsValid = false;
+	m_VoteOptionGeneration++;
+}
+
+void CGameContext::ClearVoteOptions()
+{
+	m_pVoteOptionHeap->Reset();
+	m_pVoteOptionFirst = 0;
+	m_pVoteOptionLast = 0;
+	m_NumVoteOptions = 0;
+	mem_zero(m_apVoteOptionBuckets, sizeof(CVoteOptionServer *)*NUM_VOTE_OPTION_BUCKETS);
+	m_VoteOptionPacketsValid = false;
+	m_VoteOptionGeneration++;
+}
+
+void CGameContext::SendVoteOptions(int ClientID)
+{
+	if(!m_VoteOptionPacketsValid)
+	{
+		// pack the option list once, each packet is stored as its size followed by the payload
+		m_VoteOptionPacketsSize = 0;
+		CVoteOptionServer *pCurrent = m_pVoteOptionFirst;
+		while(pCurrent)
+		{
+			// count options for actual packet
+			int NumOptions = 0;
+			for(CVoteOptionServer *p = pCurrent; p && NumOptions < MAX_VOTE_OPTION_ADD; p = p->m_pNext, ++NumOptions);
+
+			CPacker Packer;
+			Packer.Reset();
+			Packer.AddInt(NumOptions);
+			while(pCurrent && NumOptions--)
+			{
+				Packer.AddString(pCurrent->m_aDescription, VOTE_DESC_LENGTH);
+				pCurrent = pCurrent->m_pNext;
+			}
+
+			int Size = Packer.Size();
+			int Needed = m_VoteOptionPacketsSize+(int)sizeof(int)+Size;
+			if(Needed > m_VoteOptionPacketsCapacity)
+			{
+				m_VoteOptionPacketsCapacity = max(m_VoteOptionPacketsCapacity*2, Needed);
+				char *pNewPackets = (char *)mem_alloc(m_VoteOptionPacketsCapacity, 1);
+				if(m_pVoteOptionPackets)
+				{
+					mem_copy(pNewPackets, m_pVoteOptionPackets, m_VoteOptionPacketsSize);
+					mem_free(m_pVoteOptionPackets);
+				}
+				m_pVoteOptionPackets = pNewPackets;
+			}
+			mem_copy(m_pVoteOptionPackets+m_VoteOptionPacketsSize, &Size, sizeof(int));
+			mem_copy(m_pVoteOptionPackets+m_VoteOptionPacketsSize+sizeof(int), Packer.Data(), Size);
+			m_VoteOptionPacketsSize = Needed;
+		}
+		m_VoteOptionPacketsValid = true;
+	}
+
+	// the rest follows in the next ticks
+	CPlayer *pPlayer = m_apPlayers[ClientID];
+	pPlayer->m_SendVoteOptionOffset = 0;
+	pPlayer->m_SendVoteOptionGeneration = m_VoteOptionGeneration;
+	ContinueVoteOptions(ClientID);
+}
+
+void CGameContext::ContinueVoteOptions(int ClientID)
+{
+	CPlayer *pPlayer = m_apPlayers[ClientID];
+	if(pPlayer->m_SendVoteOptionOffset < 0)
+		return;
+
+	// the list changed while it was sent, the rest of the packets would no longer fit to what
+	// the client has. start over
+	if(pPlayer->m_SendVoteOptionGeneration != m_VoteOptionGeneration)
+	{
+		CNetMsg_Sv_VoteClearOptions ClearMsg;
+		Server()->SendPackMsg(&ClearMsg, MSGFLAG_VITAL, ClientID);
+		SendVoteOptions(ClientID);
+		return;
+	}
+
+	// at least one packet, even if it is larger than the budget
+	int Offset = pPlayer->m_SendVoteOptionOffset;
+	for(int Sent = 0; Offset < m_VoteOptionPacketsSize;)
+	{
+		int Size;
+		mem_copy(&Size, m_pVoteOptionPackets+Offset, sizeof(int));
+		if(Sent && Sent+Size > VOTE_OPTION_BYTES_PER_TICK)
+			break;
+		Offset += sizeof(int);
+
+		CMsgPacker Msg(NETMSGTYPE_SV_VOTEOPTIONLISTADD);
+		Msg.AddRaw(m_pVoteOptionPackets+Offset, Size);
+		Server()->SendMsg(&Msg, MSGFLAG_VITAL, ClientID);
+		Offset += Size;
+		Sent += Size;
+	}
+	pPlayer->m_SendVoteOptionOffset = Offset < m_VoteOptionPacketsSize ? Offset : -1;
+}
+
 
 void CGameContext::TeeHistorianWrite(const void *pData, int DataSize, void *pUser)
 {
@@ -598,6 +751,7 @@ void CGameContext::OnTick()
 		{
 			m_apPlayers[i]->Tick();
 			m_apPlayers[i]->PostTick();
+			ContinueVoteOptions(i);
 		}
 	}
 
@@ -1077,30 +1231,21 @@ void CGameContext::OnMessage(int MsgID, CUnpacker *pUnpacker, int ClientID)
 
 			if(str_comp_nocase(pMsg->m_Type, "option") == 0)
 			{
-				CVoteOptionServer *pOption = m_pVoteOptionFirst;
-				while(pOption)
-				{
-					if(str_comp_nocase(pMsg->m_Value, pOption->m_aDescription) == 0)
-					{
-						str_format(aDesc, sizeof(aDesc), "%s", pOption->m_aDescription);
-						str_format(aCmd, sizeof(aCmd), "%s", pOption->m_aCommand);
-						if(pMsg->m_Force)
-						{
-							Server()->SetRconCID(ClientID);
-							Console()->ExecuteLine(aCmd);
-							Server()->SetRconCID(IServer::RCON_CID_SERV);
-							ForceVote(VOTE_START_OP, aDesc, pReason);
-							return;
-						}
-						m_VoteType = VOTE_START_OP;
-						break;
-					}
-
-					pOption = pOption->m_pNext;
-				}
-
+				CVoteOptionServer *pOption = FindVoteOption(pMsg->m_Value);
 				if(!pOption)
 					return;
+
+				str_format(aDesc, sizeof(aDesc), "%s", pOption->m_aDescription);
+				str_format(aCmd, sizeof(aCmd), "%s", pOption->m_aCommand);
+				if(pMsg->m_Force)
+				{
+					Server()->SetRconCID(ClientID);
+					Console()->ExecuteLine(aCmd);
+					Server()->SetRconCID(IServer::RCON_CID_SERV);
+					ForceVote(VOTE_START_OP, aDesc, pReason);
+					return;
+				}
+				m_VoteType = VOTE_START_OP;
 			}
 			else if(str_comp_nocase(pMsg->m_Type, "kick") == 0)
 			{
@@ -1396,23 +1541,7 @@ void CGameContext::OnMessage(int MsgID, CUnpacker *pUnpacker, int ClientID)
 			CNetMsg_Sv_VoteClearOptions ClearMsg;
 			Server()->SendPackMsg(&ClearMsg, MSGFLAG_VITAL, ClientID);
 
-			CVoteOptionServer *pCurrent = m_pVoteOptionFirst;
-			while(pCurrent)
-			{
-				// count options for actual packet
-				int NumOptions = 0;
-				for(CVoteOptionServer *p = pCurrent; p && NumOptions < MAX_VOTE_OPTION_ADD; p = p->m_pNext, ++NumOptions);
-
-				// pack and send vote list packet
-				CMsgPacker Msg(NETMSGTYPE_SV_VOTEOPTIONLISTADD);
-				Msg.AddInt(NumOptions);
-				while(pCurrent && NumOptions--)
-				{
-					Msg.AddString(pCurrent->m_aDescription, VOTE_DESC_LENGTH);
-					pCurrent = pCurrent->m_pNext;
-				}
-				Server()->SendMsg(&Msg, MSGFLAG_VITAL, ClientID);
-			}
+			SendVoteOptions(ClientID);
 
 			// send tuning parameters to client
 			SendTuningParams(ClientID);
@@ -1691,34 +1820,17 @@ void CGameContext::ConAddVote(IConsole::IResult *pResult, void *pUserData)
 	}
 
 	// check for duplicate entry
-	CVoteOptionServer *pOption = pSelf->m_pVoteOptionFirst;
-	while(pOption)
+	if(pSelf->FindVoteOption(pDescription))
 	{
-		if(str_comp_nocase(pDescription, pOption->m_aDescription) == 0)
-		{
-			char aBuf[256];
-			str_format(aBuf, sizeof(aBuf), "option '%s' already exists", pDescription);
-			pSelf->Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "server", aBuf);
-			return;
-		}
-		pOption = pOption->m_pNext;
+		char aBuf[256];
+		str_format(aBuf, sizeof(aBuf), "option '%s' already exists", pDescription);
+		pSelf->Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "server", aBuf);
+		return;
 	}
 
 	// add the option
-	++pSelf->m_NumVoteOptions;
-	int Len = str_length(pCommand);
-
-	pOption = (CVoteOptionServer *)pSelf->m_pVoteOptionHeap->Allocate(sizeof(CVoteOptionServer) + Len);
-	pOption->m_pNext = 0;
-	pOption->m_pPrev = pSelf->m_pVoteOptionLast;
-	if(pOption->m_pPrev)
-		pOption->m_pPrev->m_pNext = pOption;
-	pSelf->m_pVoteOptionLast = pOption;
-	if(!pSelf->m_pVoteOptionFirst)
-		pSelf->m_pVoteOptionFirst = pOption;
-
-	str_copy(pOption->m_aDescription, pDescription, sizeof(pOption->m_aDescription));
-	mem_copy(pOption->m_aCommand, pCommand, Len+1);
+	pSelf->AddVoteOption(pDescription, pCommand);
+	CVoteOptionServer *pOption = pSelf->m_pVoteOptionLast;
 	char aBuf[256];
 	str_format(aBuf, sizeof(aBuf), "added option '%s' '%s'", pOption->m_aDescription, pOption->m_aCommand);
 	pSelf->Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "server", aBuf);
@@ -1735,13 +1847,7 @@ void CGameContext::ConRemoveVote(IConsole::IResult *pResult, void *pUserData)
 	const char *pDescription = pResult->GetString(0);
 
 	// check for valid option
-	CVoteOptionServer *pOption = pSelf->m_pVoteOptionFirst;
-	while(pOption)
-	{
-		if(str_comp_nocase(pDescription, pOption->m_aDescription) == 0)
-			break;
-		pOption = pOption->m_pNext;
-	}
+	CVoteOptionServer *pOption = pSelf->FindVoteOption(pDescription);
 	if(!pOption)
 	{
 		char aBuf[256];
@@ -1757,41 +1863,23 @@ void CGameContext::ConRemoveVote(IConsole::IResult *pResult, void *pUserData)
 
 	// TODO: improve this
 	// remove the option
-	--pSelf->m_NumVoteOptions;
 	char aBuf[256];
 	str_format(aBuf, sizeof(aBuf), "removed option '%s' '%s'", pOption->m_aDescription, pOption->m_aCommand);
 	pSelf->Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "server", aBuf);
 
-	CHeap *pVoteOptionHeap = new CHeap();
-	CVoteOptionServer *pVoteOptionFirst = 0;
-	CVoteOptionServer *pVoteOptionLast = 0;
-	int NumVoteOptions = pSelf->m_NumVoteOptions;
-	for(CVoteOptionServer *pSrc = pSelf->m_pVoteOptionFirst; pSrc; pSrc = pSrc->m_pNext)
+	// copy the other options to a new heap
+	CHeap *pOldVoteOptionHeap = pSelf->m_pVoteOptionHeap;
+	CVoteOptionServer *pOldVoteOptionFirst = pSelf->m_pVoteOptionFirst;
+	pSelf->m_pVoteOptionHeap = new CHeap();
+	pSelf->ClearVoteOptions();
+	for(CVoteOptionServer *pSrc = pOldVoteOptionFirst; pSrc; pSrc = pSrc->m_pNext)
 	{
-		if(pSrc == pOption)
-			continue;
-
-		// copy option
-		int Len = str_length(pSrc->m_aCommand);
-		CVoteOptionServer *pDst = (CVoteOptionServer *)pVoteOptionHeap->Allocate(sizeof(CVoteOptionServer) + Len);
-		pDst->m_pNext = 0;
-		pDst->m_pPrev = pVoteOptionLast;
-		if(pDst->m_pPrev)
-			pDst->m_pPrev->m_pNext = pDst;
-		pVoteOptionLast = pDst;
-		if(!pVoteOptionFirst)
-			pVoteOptionFirst = pDst;
-
-		str_copy(pDst->m_aDescription, pSrc->m_aDescription, sizeof(pDst->m_aDescription));
-		mem_copy(pDst->m_aCommand, pSrc->m_aCommand, Len+1);
+		if(pSrc != pOption)
+			pSelf->AddVoteOption(pSrc->m_aDescription, pSrc->m_aCommand);
 	}
 
 	// clean up
-	delete pSelf->m_pVoteOptionHeap;
-	pSelf->m_pVoteOptionHeap = pVoteOptionHeap;
-	pSelf->m_pVoteOptionFirst = pVoteOptionFirst;
-	pSelf->m_pVoteOptionLast = pVoteOptionLast;
-	pSelf->m_NumVoteOptions = NumVoteOptions;
+	delete pOldVoteOptionHeap;
 }
 
 void CGameContext::ConClearVotes(IConsole::IResult *pResult, void *pUserData)
@@ -1801,10 +1889,7 @@ void CGameContext::ConClearVotes(IConsole::IResult *pResult, void *pUserData)
 	pSelf->Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "server", "cleared votes");
 	CNetMsg_Sv_VoteClearOptions VoteClearOptionsMsg;
 	pSelf->Server()->SendPackMsg(&VoteClearOptionsMsg, MSGFLAG_VITAL, -1);
-	pSelf->m_pVoteOptionHeap->Reset();
-	pSelf->m_pVoteOptionFirst = 0;
-	pSelf->m_pVoteOptionLast = 0;
-	pSelf->m_NumVoteOptions = 0;
+	pSelf->ClearVoteOptions();
 }
 
 void CGameContext::ConVote(IConsole::IResult *pResult, void *pUserData)
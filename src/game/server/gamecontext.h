@@ -157,10 +157,30 @@ public:
 		VOTE_CANCEL_TIME = 10,
 
 		MIN_SKINCHANGE_CLIENTVERSION = 0x0703,
+
+		NUM_VOTE_OPTION_BUCKETS=1024,
+		// vote option payload sent to a joining client per tick. the packets are vital, a whole
+		// list at once would not fit into the resend buffer of the connection
+		VOTE_OPTION_BYTES_PER_TICK=1024,
 	};
 	class CHeap *m_pVoteOptionHeap;
 	CVoteOptionServer *m_pVoteOptionFirst;
 	CVoteOptionServer *m_pVoteOptionLast;
+	CVoteOptionServer **m_apVoteOptionBuckets; // description hash, NUM_VOTE_OPTION_BUCKETS entries
+
+	// the packed NETMSGTYPE_SV_VOTEOPTIONLISTADD payloads of the option list, rebuilt on
+	// the next join after an option was added or removed
+	char *m_pVoteOptionPackets;
+	int m_VoteOptionPacketsSize;
+	int m_VoteOptionPacketsCapacity;
+	bool m_VoteOptionPacketsValid;
+	int m_VoteOptionGeneration; // changes with the option list, restarts partly sent lists
+
+	CVoteOptionServer *FindVoteOption(const char *pDescription);
+	void AddVoteOption(const char *pDescription, const char *pCommand);
+	void ClearVoteOptions();
+	void SendVoteOptions(int ClientID);
+	void ContinueVoteOptions(int ClientID);
 
 	// helper functions
 	void CreateDamage(vec2 Pos, int Id, vec2 Source, int HealthAmount, int ArmorAmount, bool Self, int64_t Mask = -1LL);
@@ -22,12 +22,14 @@ CPlayer::CPlayer(CGameContext *pGameServer, int ClientID, bool Dummy, bool AsSpe
 	m_Team = AsSpec ? TEAM_SPECTATORS : TEAM_RED;
 	m_Dummy = Dummy;
 	Reset();
+	Server()->ExpireServerInfo();
 }
 
 CPlayer::~CPlayer()
 {
 	delete m_pCharacter;
 	m_pCharacter = 0;
+	Server()->ExpireServerInfo();
 }
 
 void CPlayer::Reset()
@@ -45,6 +47,8 @@ void CPlayer::Reset()
 	m_TeamChangeTick = Server()->Tick();
 	m_IsReadyToPlay = false;
 	m_WeakHookSpawn = false;
+	m_SendVoteOptionOffset = -1;
+	m_SendVoteOptionGeneration = 0;
 
 	// DDrace
 
@@ -514,6 +518,7 @@ void CPlayer::SetTeam(int Team, bool DoChatMsg)
 	KillCharacter();
 
 	m_Team = Team;
+	Server()->ExpireServerInfo();
 	m_LastActionTick = Server()->Tick();
 	m_SpecMode = SPEC_FREEVIEW;
 	m_SpectatorID = -1;
@@ -69,6 +69,9 @@ public:
 	//
 	int m_Vote;
 	int m_VotePos;
+	// offset into the packed vote option list still to send, -1 when done
+	int m_SendVoteOptionOffset;
+	int m_SendVoteOptionGeneration;
 	//
 	int m_LastVoteCall;
 	int m_LastVoteTry;
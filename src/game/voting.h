@@ -9,7 +9,7 @@ enum
 	VOTE_CMD_LENGTH=512,
 	VOTE_REASON_LENGTH=16,
 
-	MAX_VOTE_OPTIONS=128,
+	MAX_VOTE_OPTIONS=8192,
 	MAX_VOTE_OPTION_ADD=21,
 
 	VOTE_COOLDOWN=60,
@@ -26,6 +26,7 @@ struct CVoteOptionServer
 {
 	CVoteOptionServer *m_pNext;
 	CVoteOptionServer *m_pPrev;
+	CVoteOptionServer *m_pNextHash;
 	char m_aDescription[VOTE_DESC_LENGTH];
 	char m_aCommand[1];
 };
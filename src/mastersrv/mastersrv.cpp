@@ -1,6 +1,8 @@
 /* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
 /* If you are missing that file, acquire a complete release at teeworlds.com.                */
+#include <base/math.h>
 #include <base/system.h>
+#include <base/tl/array.h>
 
 #include <engine/config.h>
 #include <engine/console.h>
@@ -12,60 +14,48 @@
 #include <engine/shared/network.h>
 
 #include "mastersrv.h"
+#include "serverlist.h"
 
 
-enum {
-	MTU = 1400,
-	MAX_SERVERS_PER_PACKET=75,
-	MAX_PACKETS=16,
-	MAX_SERVERS=MAX_SERVERS_PER_PACKET*MAX_PACKETS,
-	EXPIRE_TIME = 90
-};
-
-struct CCheckServer
+enum
 {
-	enum ServerType m_Type;
-	NETADDR m_Address;
-	NETADDR m_AltAddress;
-	int m_TryCount;
-	int64 m_TryTime;
-	TOKEN m_Token;
+	PUBLISH_INTERVAL=100, // ms
 };
 
-static CCheckServer m_aCheckServers[MAX_SERVERS];
-static int m_NumCheckServers = 0;
+static CCheckServerList m_CheckServers;
+static CServerList m_Servers;
 
-struct CServerEntry
+
+struct CCountPacketData
 {
-	enum ServerType m_Type;
-	NETADDR m_Address;
-	int64 m_Expire;
+	unsigned char m_Header[sizeof(SERVERBROWSE_COUNT)];
+	unsigned char m_High;
+	unsigned char m_Low;
 };
 
-static CServerEntry m_aServers[MAX_SERVERS];
-static int m_NumServers = 0;
-
-struct CPacketData
+// heartbeats that arrived at a worker, the main thread does the checks
+struct CHeartbeat
 {
-	int m_Size;
-	struct {
-		unsigned char m_aHeader[sizeof(SERVERBROWSE_LIST)];
-		CMastersrvAddr m_aServers[MAX_SERVERS_PER_PACKET];
-	} m_Data;
+	NETADDR m_Address;
+	NETADDR m_AltAddress;
+	TOKEN m_Token;
 };
 
-CPacketData m_aPackets[MAX_PACKETS];
-static int m_NumPackets = 0;
-
-
-struct CCountPacketData
+// answers list requests on its own socket bound to the same port
+struct CWorker
 {
-	unsigned char m_Header[sizeof(SERVERBROWSE_COUNT)];
-	unsigned char m_High;
-	unsigned char m_Low;
+	int m_Index;
+	CNetClient m_Net;
+	void *m_pThread;
+
+	// held while packets are handled, so the main thread can change the bans in between
+	LOCK m_Lock;
+	array<CHeartbeat> m_lHeartbeats;
 };
 
-static CCountPacketData m_CountData;
+static CPublishedServerList m_PublishedList;
+static CWorker *m_pWorkers = 0;
+static int m_NumWorkers = 0;
 
 
 CNetBan m_NetBan;
@@ -75,60 +65,6 @@ static CNetClient m_NetOp; // main
 
 IConsole *m_pConsole;
 
-void BuildPackets()
-{
-	CServerEntry *pCurrent = &m_aServers[0];
-	int ServersLeft = m_NumServers;
-	m_NumPackets = 0;
-	int PacketIndex = 0;
-	while(ServersLeft-- && m_NumPackets < MAX_PACKETS)
-	{
-		if(pCurrent->m_Type == SERVERTYPE_NORMAL)
-		{
-			if(PacketIndex % MAX_SERVERS_PER_PACKET == 0)
-			{
-				PacketIndex = 0;
-				m_NumPackets++;
-			}
-
-			// copy header
-			mem_copy(m_aPackets[m_NumPackets-1].m_Data.m_aHeader, SERVERBROWSE_LIST, sizeof(SERVERBROWSE_LIST));
-
-			// copy server addresses
-			if(pCurrent->m_Address.type == NETTYPE_IPV6)
-			{
-				mem_copy(m_aPackets[m_NumPackets-1].m_Data.m_aServers[PacketIndex].m_aIp, pCurrent->m_Address.ip,
-					sizeof(m_aPackets[m_NumPackets-1].m_Data.m_aServers[PacketIndex].m_aIp));
-			}
-			else
-			{
-				static unsigned char s_aIPV4Mapping[] = {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xFF, 0xFF};
-
-				mem_copy(m_aPackets[m_NumPackets-1].m_Data.m_aServers[PacketIndex].m_aIp, s_aIPV4Mapping, sizeof(s_aIPV4Mapping));
-				m_aPackets[m_NumPackets-1].m_Data.m_aServers[PacketIndex].m_aIp[12] = pCurrent->m_Address.ip[0];
-				m_aPackets[m_NumPackets-1].m_Data.m_aServers[PacketIndex].m_aIp[13] = pCurrent->m_Address.ip[1];
-				m_aPackets[m_NumPackets-1].m_Data.m_aServers[PacketIndex].m_aIp[14] = pCurrent->m_Address.ip[2];
-				m_aPackets[m_NumPackets-1].m_Data.m_aServers[PacketIndex].m_aIp[15] = pCurrent->m_Address.ip[3];
-			}
-
-			m_aPackets[m_NumPackets-1].m_Data.m_aServers[PacketIndex].m_aPort[0] = (pCurrent->m_Address.port>>8)&0xff;
-			m_aPackets[m_NumPackets-1].m_Data.m_aServers[PacketIndex].m_aPort[1] = pCurrent->m_Address.port&0xff;
-
-			PacketIndex++;
-
-			m_aPackets[m_NumPackets-1].m_Size = sizeof(SERVERBROWSE_LIST) + sizeof(CMastersrvAddr)*PacketIndex;
-
-			pCurrent++;
-		}
-		else
-		{
-			*pCurrent = m_aServers[m_NumServers-1];
-			m_NumServers--;
-			dbg_msg("mastersrv", "error: server of invalid type, dropping it");
-		}
-	}
-}
-
 void SendOk(NETADDR *pAddr, TOKEN Token)
 {
 	CNetChunk p;
@@ -167,129 +103,230 @@ void SendCheck(NETADDR *pAddr, TOKEN Token)
 
 void AddCheckserver(NETADDR *pInfo, NETADDR *pAlt, ServerType Type, TOKEN Token)
 {
-	// add server
-	if(m_NumCheckServers == MAX_SERVERS)
-	{
-		dbg_msg("mastersrv", "error: mastersrv is full");
-		return;
-	}
-
 	char aAddrStr[NETADDR_MAXSTRSIZE];
 	net_addr_str(pInfo, aAddrStr, sizeof(aAddrStr), true);
 	char aAltAddrStr[NETADDR_MAXSTRSIZE];
 	net_addr_str(pAlt, aAltAddrStr, sizeof(aAltAddrStr), true);
 	dbg_msg("mastersrv", "checking: %s (%s)", aAddrStr, aAltAddrStr);
-	m_aCheckServers[m_NumCheckServers].m_Address = *pInfo;
-	m_aCheckServers[m_NumCheckServers].m_AltAddress = *pAlt;
-	m_aCheckServers[m_NumCheckServers].m_TryCount = 0;
-	m_aCheckServers[m_NumCheckServers].m_TryTime = 0;
-	m_aCheckServers[m_NumCheckServers].m_Type = Type;
-	m_aCheckServers[m_NumCheckServers].m_Token = Token;
-	m_NumCheckServers++;
-}
 
-void AddServer(NETADDR *pInfo, ServerType Type)
-{
-	// see if server already exists in list
-	for(int i = 0; i < m_NumServers; i++)
+	// the first try goes out right away, the retries are handled by UpdateServers
+	CCheckServerList::CCheckServer *pCheck = m_CheckServers.Add(pInfo, pAlt, Type, Token);
+	if(pCheck->m_TryCount == 0)
 	{
-		if(net_addr_comp(&m_aServers[i].m_Address, pInfo) == 0)
-		{
-			char aAddrStr[NETADDR_MAXSTRSIZE];
-			net_addr_str(pInfo, aAddrStr, sizeof(aAddrStr), true);
-			dbg_msg("mastersrv", "updated: %s", aAddrStr);
-			m_aServers[i].m_Expire = time_get()+time_freq()*EXPIRE_TIME;
-			return;
-		}
+		m_CheckServers.Retry(pCheck, time_get());
+		SendCheck(&pCheck->m_Address, pCheck->m_Token);
 	}
+}
 
-	// add server
-	if(m_NumServers == MAX_SERVERS)
+void AddServer(NETADDR *pInfo, ServerType Type)
+{
+	if(Type != SERVERTYPE_NORMAL)
 	{
-		dbg_msg("mastersrv", "error: mastersrv is full");
+		dbg_msg("mastersrv", "error: server of invalid type, dropping it");
 		return;
 	}
 
 	char aAddrStr[NETADDR_MAXSTRSIZE];
 	net_addr_str(pInfo, aAddrStr, sizeof(aAddrStr), true);
-	dbg_msg("mastersrv", "added: %s", aAddrStr);
-	m_aServers[m_NumServers].m_Address = *pInfo;
-	m_aServers[m_NumServers].m_Expire = time_get()+time_freq()*EXPIRE_TIME;
-	m_aServers[m_NumServers].m_Type = Type;
-	m_NumServers++;
+	if(m_Servers.Add(pInfo, Type, time_get()))
+		dbg_msg("mastersrv", "added: %s", aAddrStr);
+	else
+		dbg_msg("mastersrv", "updated: %s", aAddrStr);
 }
 
 void UpdateServers()
 {
 	int64 Now = time_get();
 	int64 Freq = time_freq();
-	for(int i = 0; i < m_NumCheckServers; i++)
+	CCheckServerList::CCheckServer *pCheck;
+	while((pCheck = m_CheckServers.First()) && Now > pCheck->m_TryTime+Freq)
 	{
-		if(Now > m_aCheckServers[i].m_TryTime+Freq)
+		if(pCheck->m_TryCount == 10)
 		{
-			if(m_aCheckServers[i].m_TryCount == 10)
-			{
-				char aAddrStr[NETADDR_MAXSTRSIZE];
-				net_addr_str(&m_aCheckServers[i].m_Address, aAddrStr, sizeof(aAddrStr), true);
-				char aAltAddrStr[NETADDR_MAXSTRSIZE];
-				net_addr_str(&m_aCheckServers[i].m_AltAddress, aAltAddrStr, sizeof(aAltAddrStr), true);
-				dbg_msg("mastersrv", "check failed: %s (%s)", aAddrStr, aAltAddrStr);
-
-				// FAIL!!
-				SendError(&m_aCheckServers[i].m_Address, m_aCheckServers[i].m_Token);
-				m_aCheckServers[i] = m_aCheckServers[m_NumCheckServers-1];
-				m_NumCheckServers--;
-				i--;
-			}
+			char aAddrStr[NETADDR_MAXSTRSIZE];
+			net_addr_str(&pCheck->m_Address, aAddrStr, sizeof(aAddrStr), true);
+			char aAltAddrStr[NETADDR_MAXSTRSIZE];
+			net_addr_str(&pCheck->m_AltAddress, aAltAddrStr, sizeof(aAltAddrStr), true);
+			dbg_msg("mastersrv", "check failed: %s (%s)", aAddrStr, aAltAddrStr);
+
+			// FAIL!!
+			SendError(&pCheck->m_Address, pCheck->m_Token);
+			m_CheckServers.Remove(pCheck);
+		}
+		else
+		{
+			m_CheckServers.Retry(pCheck, Now);
+			if(pCheck->m_TryCount&1)
+				SendCheck(&pCheck->m_Address, pCheck->m_Token);
 			else
-			{
-				m_aCheckServers[i].m_TryCount++;
-				m_aCheckServers[i].m_TryTime = Now;
-				if(m_aCheckServers[i].m_TryCount&1)
-					SendCheck(&m_aCheckServers[i].m_Address, m_aCheckServers[i].m_Token);
-				else
-					SendCheck(&m_aCheckServers[i].m_AltAddress, m_aCheckServers[i].m_Token);
-			}
+				SendCheck(&pCheck->m_AltAddress, pCheck->m_Token);
 		}
 	}
 }
 
-void PurgeServers()
+void ReloadBans()
 {
-	int64 Now = time_get();
-	int i = 0;
-	while(i < m_NumServers)
+	// the workers check the bans as well
+	for(int i = 0; i < m_NumWorkers; i++)
+		lock_wait(m_pWorkers[i].m_Lock);
+
+	m_NetBan.UnbanAll();
+	m_pConsole->ExecuteFile("master.cfg");
+
+	for(int i = 0; i < m_NumWorkers; i++)
+		lock_unlock(m_pWorkers[i].m_Lock);
+}
+
+void ProcessRequest(CNetClient *pNet, CNetChunk *pPacket, TOKEN Token, int NumServers, int NumPackets, const CServerList::CPacketData *pPackets, CWorker *pWorker)
+{
+	// check if the server is banned
+	if(m_NetBan.IsBanned(&pPacket->m_Address, 0, 0, 0))
+		return;
+
+	if(pPacket->m_DataSize == sizeof(SERVERBROWSE_HEARTBEAT)+2 &&
+		mem_comp(pPacket->m_pData, SERVERBROWSE_HEARTBEAT, sizeof(SERVERBROWSE_HEARTBEAT)) == 0)
 	{
-		if(m_aServers[i].m_Expire < Now)
+		NETADDR Alt;
+		unsigned char *d = (unsigned char *)pPacket->m_pData;
+		Alt = pPacket->m_Address;
+		Alt.port =
+			(d[sizeof(SERVERBROWSE_HEARTBEAT)]<<8) |
+			d[sizeof(SERVERBROWSE_HEARTBEAT)+1];
+
+		// add it
+		if(pWorker)
 		{
-			// remove server
-			char aAddrStr[NETADDR_MAXSTRSIZE];
-			net_addr_str(&m_aServers[i].m_Address, aAddrStr, sizeof(aAddrStr), true);
-			dbg_msg("mastersrv", "expired: %s", aAddrStr);
-			m_aServers[i] = m_aServers[m_NumServers-1];
-			m_NumServers--;
+			CHeartbeat Heartbeat;
+			Heartbeat.m_Address = pPacket->m_Address;
+			Heartbeat.m_AltAddress = Alt;
+			Heartbeat.m_Token = Token;
+			pWorker->m_lHeartbeats.add(Heartbeat);
 		}
 		else
-			i++;
+			AddCheckserver(&pPacket->m_Address, &Alt, SERVERTYPE_NORMAL, Token);
+	}
+	else if(pPacket->m_DataSize == sizeof(SERVERBROWSE_GETCOUNT) &&
+		mem_comp(pPacket->m_pData, SERVERBROWSE_GETCOUNT, sizeof(SERVERBROWSE_GETCOUNT)) == 0)
+	{
+		NumServers = min(NumServers, 0xffff);
+		dbg_msg("mastersrv", "count requested, responding with %d", NumServers);
+
+		CCountPacketData CountData;
+		mem_copy(CountData.m_Header, SERVERBROWSE_COUNT, sizeof(SERVERBROWSE_COUNT));
+		CountData.m_High = (NumServers>>8)&0xff;
+		CountData.m_Low = NumServers&0xff;
+
+		CNetChunk p;
+		p.m_ClientID = -1;
+		p.m_Address = pPacket->m_Address;
+		p.m_Flags = NETSENDFLAG_CONNLESS;
+		p.m_DataSize = sizeof(CountData);
+		p.m_pData = &CountData;
+		pNet->Send(&p, Token);
+	}
+	else if(pPacket->m_DataSize == sizeof(SERVERBROWSE_GETLIST) &&
+		mem_comp(pPacket->m_pData, SERVERBROWSE_GETLIST, sizeof(SERVERBROWSE_GETLIST)) == 0)
+	{
+		// someone requested the list
+		dbg_msg("mastersrv", "requested, responding with %d servers", NumServers);
+
+		CNetChunk p;
+		p.m_ClientID = -1;
+		p.m_Address = pPacket->m_Address;
+		p.m_Flags = NETSENDFLAG_CONNLESS;
+
+		for(int i = 0; i < NumPackets; i++)
+		{
+			p.m_DataSize = pPackets[i].m_Size;
+			p.m_pData = &pPackets[i].m_Data;
+			pNet->Send(&p, Token);
+		}
 	}
 }
 
-void ReloadBans()
+void WorkerThread(void *pUser)
 {
-	m_NetBan.UnbanAll();
-	m_pConsole->ExecuteFile("master.cfg");
+	CWorker *pWorker = (CWorker *)pUser;
+	while(1)
+	{
+		lock_wait(pWorker->m_Lock);
+		pWorker->m_Net.Update();
+
+		const CPublishedServerList::CSnapshot *pList = m_PublishedList.Acquire(pWorker->m_Index);
+		CNetChunk Packet;
+		TOKEN Token;
+		while(pWorker->m_Net.Recv(&Packet, &Token))
+			ProcessRequest(&pWorker->m_Net, &Packet, Token, pList->m_NumServers, pList->m_NumPackets, pList->m_pPackets, pWorker);
+		lock_unlock(pWorker->m_Lock);
+
+		// be nice to the CPU
+		thread_sleep(1);
+	}
+}
+
+void StartWorkers(NETADDR BindAddr)
+{
+	m_NumWorkers = min(g_Config.m_MasterWorkers, (int)CPublishedServerList::MAX_READERS);
+	if(!m_NumWorkers)
+		return;
+
+	m_pWorkers = new CWorker[m_NumWorkers];
+	for(int i = 0; i < m_NumWorkers; i++)
+	{
+		if(!m_pWorkers[i].m_Net.Open(BindAddr, NETCREATE_FLAG_REUSEPORT))
+		{
+			dbg_msg("mastersrv", "couldn't start network (worker %d), continuing with %d", i, i);
+			m_NumWorkers = i;
+			break;
+		}
+	}
+
+	// only the workers that run may hold back the reclaim of old lists
+	m_PublishedList.Init(m_NumWorkers);
+	m_PublishedList.Publish(&m_Servers);
+
+	for(int i = 0; i < m_NumWorkers; i++)
+	{
+		CWorker *pWorker = &m_pWorkers[i];
+		pWorker->m_Index = i;
+		pWorker->m_Lock = lock_create();
+		pWorker->m_pThread = thread_init(WorkerThread, pWorker);
+	}
+	dbg_msg("mastersrv", "answering list requests on %d additional threads", m_NumWorkers);
+}
+
+void CollectHeartbeats()
+{
+	for(int i = 0; i < m_NumWorkers; i++)
+	{
+		CWorker *pWorker = &m_pWorkers[i];
+		array<CHeartbeat> lHeartbeats;
+		lock_wait(pWorker->m_Lock);
+		for(int j = 0; j < pWorker->m_lHeartbeats.size(); j++)
+			lHeartbeats.add(pWorker->m_lHeartbeats[j]);
+		pWorker->m_lHeartbeats.clear();
+		lock_unlock(pWorker->m_Lock);
+
+		for(int j = 0; j < lHeartbeats.size(); j++)
+			AddCheckserver(&lHeartbeats[j].m_Address, &lHeartbeats[j].m_AltAddress, SERVERTYPE_NORMAL, lHeartbeats[j].m_Token);
+	}
 }
 
 int main(int argc, const char **argv) // ignore_convention
 {
-	int64 LastBuild = 0, LastBanReload = 0;
+	int64 LastBanReload = 0;
+	int64 LastPublish = 0;
+	unsigned PublishedVersion = 0;
 	ServerType Type = SERVERTYPE_INVALID;
 	NETADDR BindAddr;
 
 	dbg_logger_stdout();
 	net_init();
-
-	mem_copy(m_CountData.m_Header, SERVERBROWSE_COUNT, sizeof(SERVERBROWSE_COUNT));
+	if(secure_random_init() != 0)
+	{
+		dbg_msg("secure", "could not initialize secure RNG");
+		return -1;
+	}
 
 	int FlagMask = CFGFLAG_MASTER;
 	IKernel *pKernel = IKernel::Create();
@@ -322,11 +359,13 @@ int main(int argc, const char **argv) // ignore_convention
 		BindAddr.port = MASTERSERVER_PORT;
 	}
 
-	if(!m_NetOp.Open(BindAddr, 0))
+	// with workers every thread gets its own socket on the same port
+	if(!m_NetOp.Open(BindAddr, g_Config.m_MasterWorkers ? NETCREATE_FLAG_REUSEPORT : 0))
 	{
 		dbg_msg("mastersrv", "couldn't start network (op)");
 		return -1;
 	}
+	StartWorkers(BindAddr);
 	BindAddr.port = MASTERSERVER_PORT+1;
 	if(!m_NetChecker.Open(BindAddr, 0))
 	{
@@ -349,56 +388,7 @@ int main(int argc, const char **argv) // ignore_convention
 		TOKEN Token;
 		while(m_NetOp.Recv(&Packet, &Token))
 		{
-			// check if the server is banned
-			if(m_NetBan.IsBanned(&Packet.m_Address, 0, 0, 0))
-				continue;
-
-			if(Packet.m_DataSize == sizeof(SERVERBROWSE_HEARTBEAT)+2 &&
-				mem_comp(Packet.m_pData, SERVERBROWSE_HEARTBEAT, sizeof(SERVERBROWSE_HEARTBEAT)) == 0)
-			{
-				NETADDR Alt;
-				unsigned char *d = (unsigned char *)Packet.m_pData;
-				Alt = Packet.m_Address;
-				Alt.port =
-					(d[sizeof(SERVERBROWSE_HEARTBEAT)]<<8) |
-					d[sizeof(SERVERBROWSE_HEARTBEAT)+1];
-
-				// add it
-				AddCheckserver(&Packet.m_Address, &Alt, SERVERTYPE_NORMAL, Token);
-			}
-			else if(Packet.m_DataSize == sizeof(SERVERBROWSE_GETCOUNT) &&
-				mem_comp(Packet.m_pData, SERVERBROWSE_GETCOUNT, sizeof(SERVERBROWSE_GETCOUNT)) == 0)
-			{
-				dbg_msg("mastersrv", "count requested, responding with %d", m_NumServers);
-
-				CNetChunk p;
-				p.m_ClientID = -1;
-				p.m_Address = Packet.m_Address;
-				p.m_Flags = NETSENDFLAG_CONNLESS;
-				p.m_DataSize = sizeof(m_CountData);
-				p.m_pData = &m_CountData;
-				m_CountData.m_High = (m_NumServers>>8)&0xff;
-				m_CountData.m_Low = m_NumServers&0xff;
-				m_NetOp.Send(&p, Token);
-			}
-			else if(Packet.m_DataSize == sizeof(SERVERBROWSE_GETLIST) &&
-				mem_comp(Packet.m_pData, SERVERBROWSE_GETLIST, sizeof(SERVERBROWSE_GETLIST)) == 0)
-			{
-				// someone requested the list
-				dbg_msg("mastersrv", "requested, responding with %d servers", m_NumServers);
-
-				CNetChunk p;
-				p.m_ClientID = -1;
-				p.m_Address = Packet.m_Address;
-				p.m_Flags = NETSENDFLAG_CONNLESS;
-
-				for(int i = 0; i < m_NumPackets; i++)
-				{
-					p.m_DataSize = m_aPackets[i].m_Size;
-					p.m_pData = &m_aPackets[i].m_Data;
-					m_NetOp.Send(&p, Token);
-				}
-			}
+			ProcessRequest(&m_NetOp, &Packet, Token, m_Servers.NumServers(), m_Servers.NumPackets(), m_Servers.Packet(0), 0);
 		}
 
 		// process packets
@@ -411,24 +401,15 @@ int main(int argc, const char **argv) // ignore_convention
 			if(Packet.m_DataSize == sizeof(SERVERBROWSE_FWRESPONSE) &&
 				mem_comp(Packet.m_pData, SERVERBROWSE_FWRESPONSE, sizeof(SERVERBROWSE_FWRESPONSE)) == 0)
 			{
-				Type = SERVERTYPE_INVALID;
-				// remove it from checking
-				for(int i = 0; i < m_NumCheckServers; i++)
-				{
-					if(net_addr_comp(&m_aCheckServers[i].m_Address, &Packet.m_Address) == 0 ||
-						net_addr_comp(&m_aCheckServers[i].m_AltAddress, &Packet.m_Address) == 0)
-					{
-						Type = m_aCheckServers[i].m_Type;
-						m_NumCheckServers--;
-						m_aCheckServers[i] = m_aCheckServers[m_NumCheckServers];
-						break;
-					}
-				}
-
 				// drops servers that were not in the CheckServers list
-				if(Type == SERVERTYPE_INVALID)
+				CCheckServerList::CCheckServer *pCheck = m_CheckServers.Find(&Packet.m_Address);
+				if(!pCheck)
 					continue;
 
+				// remove it from checking
+				Type = pCheck->m_Type;
+				m_CheckServers.Remove(pCheck);
+
 				AddServer(&Packet.m_Address, Type);
 				SendOk(&Packet.m_Address, Token);
 			}
@@ -441,13 +422,22 @@ int main(int argc, const char **argv) // ignore_convention
 			ReloadBans();
 		}
 
-		if(time_get()-LastBuild > time_freq()*5)
-		{
-			LastBuild = time_get();
+		CollectHeartbeats();
 
-			PurgeServers();
-			UpdateServers();
-			BuildPackets();
+		// both only look at what is due
+		m_Servers.Expire(time_get());
+		UpdateServers();
+
+		// the workers get a new copy of the list now and then
+		if(m_NumWorkers)
+		{
+			if(m_Servers.Version() != PublishedVersion && time_get()-LastPublish > time_freq()*PUBLISH_INTERVAL/1000)
+			{
+				LastPublish = time_get();
+				PublishedVersion = m_Servers.Version();
+				m_PublishedList.Publish(&m_Servers);
+			}
+			m_PublishedList.Reclaim();
 		}
 
 		// be nice to the CPU
@@ -0,0 +1,412 @@
+/* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
+/* If you are missing that file, acquire a complete release at teeworlds.com.                */
+#include <base/math.h>
+#include <base/tl/threading.h>
+
+#include "serverlist.h"
+
+unsigned AddrHash(const NETADDR *pAddr)
+{
+	// fnv-1a over the fields, the padding of NETADDR is not guaranteed to be cleared
+	unsigned Hash = 2166136261u;
+	unsigned aFields[2] = { pAddr->type, pAddr->port };
+	const unsigned char *pFields = (const unsigned char *)aFields;
+	for(unsigned i = 0; i < sizeof(aFields); i++)
+		Hash = (Hash^pFields[i])*16777619u;
+	for(int i = 0; i < 16; i++)
+		Hash = (Hash^pAddr->ip[i])*16777619u;
+	return Hash;
+}
+
+template<class T, int KEY>
+CAddrHash<T, KEY>::CAddrHash()
+{
+	m_ppBuckets = 0;
+	m_NumBuckets = 0;
+	m_NumEntries = 0;
+	Resize(MIN_BUCKETS);
+}
+
+template<class T, int KEY>
+CAddrHash<T, KEY>::~CAddrHash()
+{
+	mem_free(m_ppBuckets);
+}
+
+template<class T, int KEY>
+void CAddrHash<T, KEY>::Resize(int NumBuckets)
+{
+	T **ppBuckets = (T **)mem_alloc(NumBuckets*sizeof(T *), 1);
+	mem_zero(ppBuckets, NumBuckets*sizeof(T *));
+	for(int i = 0; i < m_NumBuckets; i++)
+	{
+		T *pEntry = m_ppBuckets[i];
+		while(pEntry)
+		{
+			T *pNext = pEntry->m_apHashNext[KEY];
+			unsigned Bucket = AddrHash(pEntry->Key(KEY))&(NumBuckets-1);
+			pEntry->m_apHashNext[KEY] = ppBuckets[Bucket];
+			ppBuckets[Bucket] = pEntry;
+			pEntry = pNext;
+		}
+	}
+	mem_free(m_ppBuckets);
+	m_ppBuckets = ppBuckets;
+	m_NumBuckets = NumBuckets;
+}
+
+template<class T, int KEY>
+T *CAddrHash<T, KEY>::Find(const NETADDR *pAddr) const
+{
+	for(T *pEntry = m_ppBuckets[AddrHash(pAddr)&(m_NumBuckets-1)]; pEntry; pEntry = pEntry->m_apHashNext[KEY])
+	{
+		if(net_addr_comp(pEntry->Key(KEY), pAddr) == 0)
+			return pEntry;
+	}
+	return 0;
+}
+
+template<class T, int KEY>
+void CAddrHash<T, KEY>::Insert(T *pEntry)
+{
+	if(++m_NumEntries > m_NumBuckets)
+		Resize(m_NumBuckets*2);
+	unsigned Bucket = AddrHash(pEntry->Key(KEY))&(m_NumBuckets-1);
+	pEntry->m_apHashNext[KEY] = m_ppBuckets[Bucket];
+	m_ppBuckets[Bucket] = pEntry;
+}
+
+template<class T, int KEY>
+void CAddrHash<T, KEY>::Remove(T *pEntry)
+{
+	T **ppEntry = &m_ppBuckets[AddrHash(pEntry->Key(KEY))&(m_NumBuckets-1)];
+	while(*ppEntry != pEntry)
+		ppEntry = &(*ppEntry)->m_apHashNext[KEY];
+	*ppEntry = pEntry->m_apHashNext[KEY];
+	m_NumEntries--;
+}
+
+// check servers
+CCheckServerList::CCheckServerList()
+{
+	m_pFirst = 0;
+	m_pLast = 0;
+	m_NumCheckServers = 0;
+}
+
+CCheckServerList::~CCheckServerList()
+{
+	while(m_pFirst)
+		Remove(m_pFirst);
+}
+
+void CCheckServerList::Unlink(CCheckServer *pCheck)
+{
+	if(pCheck->m_pPrev)
+		pCheck->m_pPrev->m_pNext = pCheck->m_pNext;
+	else
+		m_pFirst = pCheck->m_pNext;
+	if(pCheck->m_pNext)
+		pCheck->m_pNext->m_pPrev = pCheck->m_pPrev;
+	else
+		m_pLast = pCheck->m_pPrev;
+}
+
+void CCheckServerList::Append(CCheckServer *pCheck)
+{
+	pCheck->m_pPrev = m_pLast;
+	pCheck->m_pNext = 0;
+	if(m_pLast)
+		m_pLast->m_pNext = pCheck;
+	else
+		m_pFirst = pCheck;
+	m_pLast = pCheck;
+}
+
+CCheckServerList::CCheckServer *CCheckServerList::Add(const NETADDR *pAddr, const NETADDR *pAltAddr, ServerType Type, TOKEN Token)
+{
+	CCheckServer *pCheck = m_AddrHash.Find(pAddr);
+	if(pCheck)
+	{
+		pCheck->m_Token = Token;
+		return pCheck;
+	}
+
+	pCheck = new CCheckServer;
+	pCheck->m_Type = Type;
+	pCheck->m_Address = *pAddr;
+	pCheck->m_AltAddress = *pAltAddr;
+	pCheck->m_TryCount = 0;
+	pCheck->m_TryTime = 0;
+	pCheck->m_Token = Token;
+	m_AddrHash.Insert(pCheck);
+	m_AltAddrHash.Insert(pCheck);
+	Append(pCheck);
+	m_NumCheckServers++;
+	return pCheck;
+}
+
+CCheckServerList::CCheckServer *CCheckServerList::Find(const NETADDR *pAddr) const
+{
+	CCheckServer *pCheck = m_AddrHash.Find(pAddr);
+	return pCheck ? pCheck : m_AltAddrHash.Find(pAddr);
+}
+
+void CCheckServerList::Remove(CCheckServer *pCheck)
+{
+	m_AddrHash.Remove(pCheck);
+	m_AltAddrHash.Remove(pCheck);
+	Unlink(pCheck);
+	m_NumCheckServers--;
+	delete pCheck;
+}
+
+void CCheckServerList::Retry(CCheckServer *pCheck, int64 Now)
+{
+	pCheck->m_TryCount++;
+	pCheck->m_TryTime = Now;
+	Unlink(pCheck);
+	Append(pCheck);
+}
+
+// server list
+CServerList::CServerList()
+{
+	m_pFirst = 0;
+	m_pLast = 0;
+	m_ppServers = 0;
+	m_NumServers = 0;
+	m_ServerCapacity = 0;
+	m_pPackets = 0;
+	m_PacketCapacity = 0;
+	m_Version = 0;
+}
+
+CServerList::~CServerList()
+{
+	for(int i = 0; i < m_NumServers; i++)
+		delete m_ppServers[i];
+	mem_free(m_ppServers);
+	mem_free(m_pPackets);
+}
+
+void CServerList::Unlink(CServerEntry *pEntry)
+{
+	if(pEntry->m_pPrev)
+		pEntry->m_pPrev->m_pNext = pEntry->m_pNext;
+	else
+		m_pFirst = pEntry->m_pNext;
+	if(pEntry->m_pNext)
+		pEntry->m_pNext->m_pPrev = pEntry->m_pPrev;
+	else
+		m_pLast = pEntry->m_pPrev;
+}
+
+void CServerList::Append(CServerEntry *pEntry)
+{
+	pEntry->m_pPrev = m_pLast;
+	pEntry->m_pNext = 0;
+	if(m_pLast)
+		m_pLast->m_pNext = pEntry;
+	else
+		m_pFirst = pEntry;
+	m_pLast = pEntry;
+}
+
+void CServerList::WriteAddr(int Index, const NETADDR *pAddr)
+{
+	CMastersrvAddr *pOut = &m_pPackets[Index/MAX_SERVERS_PER_PACKET].m_Data.m_aServers[Index%MAX_SERVERS_PER_PACKET];
+	if(pAddr->type == NETTYPE_IPV6)
+		mem_copy(pOut->m_aIp, pAddr->ip, sizeof(pOut->m_aIp));
+	else
+	{
+		static unsigned char s_aIPV4Mapping[] = {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xFF, 0xFF};
+
+		mem_copy(pOut->m_aIp, s_aIPV4Mapping, sizeof(s_aIPV4Mapping));
+		pOut->m_aIp[12] = pAddr->ip[0];
+		pOut->m_aIp[13] = pAddr->ip[1];
+		pOut->m_aIp[14] = pAddr->ip[2];
+		pOut->m_aIp[15] = pAddr->ip[3];
+	}
+
+	pOut->m_aPort[0] = (pAddr->port>>8)&0xff;
+	pOut->m_aPort[1] = pAddr->port&0xff;
+}
+
+void CServerList::SetPacketSize(int NumServers)
+{
+	// only the last packet changes
+	if(NumServers == 0)
+		return;
+	int Last = (NumServers-1)/MAX_SERVERS_PER_PACKET;
+	m_pPackets[Last].m_Size = sizeof(SERVERBROWSE_LIST) + sizeof(CMastersrvAddr)*(NumServers-Last*MAX_SERVERS_PER_PACKET);
+}
+
+bool CServerList::Add(const NETADDR *pAddr, ServerType Type, int64 Now)
+{
+	CServerEntry *pEntry = m_Hash.Find(pAddr);
+	if(pEntry)
+	{
+		pEntry->m_Expire = Now+time_freq()*EXPIRE_TIME;
+		Unlink(pEntry);
+		Append(pEntry);
+		return false;
+	}
+
+	if(m_NumServers == m_ServerCapacity)
+	{
+		int Capacity = max(m_ServerCapacity*2, MAX_SERVERS_PER_PACKET*16);
+		CServerEntry **ppServers = (CServerEntry **)mem_alloc(Capacity*sizeof(CServerEntry *), 1);
+		if(m_ppServers)
+		{
+			mem_copy(ppServers, m_ppServers, m_NumServers*sizeof(CServerEntry *));
+			mem_free(m_ppServers);
+		}
+		m_ppServers = ppServers;
+		m_ServerCapacity = Capacity;
+
+		int PacketCapacity = Capacity/MAX_SERVERS_PER_PACKET;
+		CPacketData *pPackets = (CPacketData *)mem_alloc(PacketCapacity*sizeof(CPacketData), 1);
+		if(m_pPackets)
+		{
+			mem_copy(pPackets, m_pPackets, m_PacketCapacity*sizeof(CPacketData));
+			mem_free(m_pPackets);
+		}
+		for(int i = m_PacketCapacity; i < PacketCapacity; i++)
+			mem_copy(pPackets[i].m_Data.m_aHeader, SERVERBROWSE_LIST, sizeof(SERVERBROWSE_LIST));
+		m_pPackets = pPackets;
+		m_PacketCapacity = PacketCapacity;
+	}
+
+	pEntry = new CServerEntry;
+	pEntry->m_Type = Type;
+	pEntry->m_Address = *pAddr;
+	pEntry->m_Expire = Now+time_freq()*EXPIRE_TIME;
+	pEntry->m_Index = m_NumServers;
+	m_Hash.Insert(pEntry);
+	Append(pEntry);
+
+	m_ppServers[m_NumServers++] = pEntry;
+	WriteAddr(pEntry->m_Index, pAddr);
+	SetPacketSize(m_NumServers);
+	m_Version++;
+	return true;
+}
+
+void CServerList::Remove(CServerEntry *pEntry)
+{
+	// fill the gap with the last server
+	CServerEntry *pLast = m_ppServers[--m_NumServers];
+	if(pLast != pEntry)
+	{
+		pLast->m_Index = pEntry->m_Index;
+		m_ppServers[pLast->m_Index] = pLast;
+		WriteAddr(pLast->m_Index, &pLast->m_Address);
+	}
+	SetPacketSize(m_NumServers);
+	m_Version++;
+
+	m_Hash.Remove(pEntry);
+	Unlink(pEntry);
+	delete pEntry;
+}
+
+int CServerList::Expire(int64 Now)
+{
+	int NumExpired = 0;
+	while(m_pFirst && m_pFirst->m_Expire < Now)
+	{
+		char aAddrStr[NETADDR_MAXSTRSIZE];
+		net_addr_str(&m_pFirst->m_Address, aAddrStr, sizeof(aAddrStr), true);
+		dbg_msg("mastersrv", "expired: %s", aAddrStr);
+		Remove(m_pFirst);
+		NumExpired++;
+	}
+	return NumExpired;
+}
+
+// published server list
+CPublishedServerList::CPublishedServerList()
+{
+	m_pCurrent = 0;
+	m_pRetired = 0;
+	m_Generation = 0;
+	m_NumReaders = 0;
+}
+
+CPublishedServerList::~CPublishedServerList()
+{
+	mem_free(m_pCurrent);
+	while(m_pRetired)
+	{
+		CSnapshot *pNext = m_pRetired->m_pNextRetired;
+		mem_free(m_pRetired);
+		m_pRetired = pNext;
+	}
+}
+
+void CPublishedServerList::Init(int NumReaders)
+{
+	m_NumReaders = min(NumReaders, (int)MAX_READERS);
+	for(int i = 0; i < m_NumReaders; i++)
+		m_aReaders[i].m_Generation = 0;
+}
+
+void CPublishedServerList::Publish(const CServerList *pList)
+{
+	int NumPackets = pList->NumPackets();
+	CSnapshot *pSnapshot = (CSnapshot *)mem_alloc(sizeof(CSnapshot)+NumPackets*sizeof(CServerList::CPacketData), 1);
+	pSnapshot->m_Generation = ++m_Generation;
+	pSnapshot->m_NumServers = pList->NumServers();
+	pSnapshot->m_NumPackets = NumPackets;
+	pSnapshot->m_pPackets = (CServerList::CPacketData *)(pSnapshot+1);
+	pSnapshot->m_pNextRetired = 0;
+	if(NumPackets)
+		mem_copy(pSnapshot->m_pPackets, pList->Packet(0), NumPackets*sizeof(CServerList::CPacketData));
+
+	// the copy has to be complete before anyone can see it
+	sync_barrier();
+	CSnapshot *pOld = m_pCurrent;
+	m_pCurrent = pSnapshot;
+	if(pOld)
+	{
+		pOld->m_pNextRetired = m_pRetired;
+		m_pRetired = pOld;
+	}
+}
+
+void CPublishedServerList::Reclaim()
+{
+	if(!m_pRetired)
+		return;
+
+	// a reader that already got generation n can't be looking at anything older
+	sync_barrier();
+	unsigned Oldest = m_Generation;
+	for(int i = 0; i < m_NumReaders; i++)
+		Oldest = min(Oldest, (unsigned)m_aReaders[i].m_Generation);
+
+	CSnapshot **ppSnapshot = &m_pRetired;
+	while(*ppSnapshot)
+	{
+		CSnapshot *pSnapshot = *ppSnapshot;
+		if(pSnapshot->m_Generation < Oldest)
+		{
+			*ppSnapshot = pSnapshot->m_pNextRetired;
+			mem_free(pSnapshot);
+		}
+		else
+			ppSnapshot = &pSnapshot->m_pNextRetired;
+	}
+}
+
+const CPublishedServerList::CSnapshot *CPublishedServerList::Acquire(int Reader)
+{
+	CSnapshot *pSnapshot = m_pCurrent;
+	if(pSnapshot)
+	{
+		m_aReaders[Reader].m_Generation = pSnapshot->m_Generation;
+		sync_barrier();
+	}
+	return pSnapshot;
+}
@@ -0,0 +1,203 @@
+/* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
+/* If you are missing that file, acquire a complete release at teeworlds.com.                */
+#ifndef MASTERSRV_SERVERLIST_H
+#define MASTERSRV_SERVERLIST_H
+
+#include <base/system.h>
+
+#include <engine/shared/network.h>
+
+#include "mastersrv.h"
+
+unsigned AddrHash(const NETADDR *pAddr);
+
+// chained hash table over the addresses of T, T links itself through m_apHashNext[KEY] and
+// returns the address it is filed under from Key(KEY)
+template<class T, int KEY>
+class CAddrHash
+{
+	enum
+	{
+		MIN_BUCKETS=256,
+	};
+
+	T **m_ppBuckets;
+	int m_NumBuckets;
+	int m_NumEntries;
+
+	void Resize(int NumBuckets);
+
+public:
+	CAddrHash();
+	~CAddrHash();
+
+	T *Find(const NETADDR *pAddr) const;
+	void Insert(T *pEntry);
+	void Remove(T *pEntry);
+};
+
+// servers that sent a heartbeat and wait for their firewall check, ordered by the time of their
+// last try so the due ones are always at the front
+class CCheckServerList
+{
+public:
+	struct CCheckServer
+	{
+		ServerType m_Type;
+		NETADDR m_Address;
+		NETADDR m_AltAddress;
+		int m_TryCount;
+		int64 m_TryTime;
+		TOKEN m_Token;
+
+		CCheckServer *m_apHashNext[2];
+		CCheckServer *m_pPrev;
+		CCheckServer *m_pNext;
+
+		const NETADDR *Key(int Index) const { return Index == 0 ? &m_Address : &m_AltAddress; }
+	};
+
+private:
+	CAddrHash<CCheckServer, 0> m_AddrHash;
+	CAddrHash<CCheckServer, 1> m_AltAddrHash;
+	CCheckServer *m_pFirst;
+	CCheckServer *m_pLast;
+	int m_NumCheckServers;
+
+	void Unlink(CCheckServer *pCheck);
+	void Append(CCheckServer *pCheck);
+
+public:
+	CCheckServerList();
+	~CCheckServerList();
+
+	// a server that is already being checked only gets its token refreshed
+	CCheckServer *Add(const NETADDR *pAddr, const NETADDR *pAltAddr, ServerType Type, TOKEN Token);
+	CCheckServer *Find(const NETADDR *pAddr) const;
+	void Remove(CCheckServer *pCheck);
+	void Retry(CCheckServer *pCheck, int64 Now);
+
+	CCheckServer *First() const { return m_pFirst; }
+	int Num() const { return m_NumCheckServers; }
+};
+
+// the registered servers and the list packets that are sent for them. the packets are kept up to
+// date with every change, a server that leaves is replaced by the last one in the list
+class CServerList
+{
+public:
+	enum
+	{
+		MAX_SERVERS_PER_PACKET=75,
+		EXPIRE_TIME=90,
+	};
+
+	struct CPacketData
+	{
+		int m_Size;
+		struct {
+			unsigned char m_aHeader[sizeof(SERVERBROWSE_LIST)];
+			CMastersrvAddr m_aServers[MAX_SERVERS_PER_PACKET];
+		} m_Data;
+	};
+
+	struct CServerEntry
+	{
+		ServerType m_Type;
+		NETADDR m_Address;
+		int64 m_Expire;
+		int m_Index;
+
+		CServerEntry *m_apHashNext[1];
+		CServerEntry *m_pPrev;
+		CServerEntry *m_pNext;
+
+		const NETADDR *Key(int Index) const { return &m_Address; }
+	};
+
+private:
+	CAddrHash<CServerEntry, 0> m_Hash;
+
+	// ordered by expiry, every heartbeat moves a server to the back
+	CServerEntry *m_pFirst;
+	CServerEntry *m_pLast;
+
+	CServerEntry **m_ppServers;
+	int m_NumServers;
+	int m_ServerCapacity;
+
+	CPacketData *m_pPackets;
+	int m_PacketCapacity;
+	unsigned m_Version;
+
+	void Unlink(CServerEntry *pEntry);
+	void Append(CServerEntry *pEntry);
+	void WriteAddr(int Index, const NETADDR *pAddr);
+	void SetPacketSize(int NumServers);
+	void Remove(CServerEntry *pEntry);
+
+public:
+	CServerList();
+	~CServerList();
+
+	// returns false if the server was listed already and only got refreshed
+	bool Add(const NETADDR *pAddr, ServerType Type, int64 Now);
+	// drops the servers that did not send a heartbeat in time, returns how many
+	int Expire(int64 Now);
+
+	int NumServers() const { return m_NumServers; }
+	int NumPackets() const { return (m_NumServers+MAX_SERVERS_PER_PACKET-1)/MAX_SERVERS_PER_PACKET; }
+	const CPacketData *Packet(int Index) const { return &m_pPackets[Index]; }
+	// changes whenever a server is added or removed
+	unsigned Version() const { return m_Version; }
+};
+
+// copies of the list packets for threads that answer list requests while the main thread keeps
+// changing the list. every reader picks up the newest copy once per round, old copies are freed
+// when all readers moved past them
+class CPublishedServerList
+{
+public:
+	enum
+	{
+		MAX_READERS=64,
+	};
+
+	struct CSnapshot
+	{
+		unsigned m_Generation;
+		int m_NumServers;
+		int m_NumPackets;
+		CServerList::CPacketData *m_pPackets;
+		CSnapshot *m_pNextRetired;
+	};
+
+private:
+	// one cache line each, the readers write theirs every round
+	struct CReader
+	{
+		volatile unsigned m_Generation;
+		char m_aPadding[64-sizeof(unsigned)];
+	};
+
+	CSnapshot * volatile m_pCurrent;
+	CSnapshot *m_pRetired;
+	unsigned m_Generation;
+	CReader m_aReaders[MAX_READERS];
+	int m_NumReaders;
+
+public:
+	CPublishedServerList();
+	~CPublishedServerList();
+
+	void Init(int NumReaders);
+
+	// writer side
+	void Publish(const CServerList *pList);
+	void Reclaim();
+
+	// reader side, the returned copy stays valid until the reader acquires the next one
+	const CSnapshot *Acquire(int Reader);
+};
+
+#endif
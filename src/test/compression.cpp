@@ -0,0 +1,298 @@
+#include <gtest/gtest.h>
+
+#include <base/system.h>
+#include <engine/shared/compression.h>
+#include <engine/shared/network.h>
+
+// one int at a time, the way the format is defined
+static long ReferenceCompress(const int *pSrc, int Num, unsigned char *pDst, int DstSize)
+{
+	unsigned char *pOut = pDst;
+	for(int i = 0; i < Num; i++)
+	{
+		if(pDst + DstSize - pOut < 6)
+			return -1;
+		pOut = CVariableInt::Pack(pOut, pSrc[i]);
+	}
+	return (long)(pOut - pDst);
+}
+
+static long ReferenceDecompress(const unsigned char *pSrc, int SrcSize, int *pDst, int DstSize)
+{
+	const unsigned char *pEnd = pSrc + SrcSize;
+	int *pOut = pDst;
+	while(pSrc < pEnd)
+	{
+		if(pOut >= pDst + DstSize/4)
+			return -1;
+		pSrc = CVariableInt::Unpack(pSrc, pOut);
+		pOut++;
+	}
+	return (long)((pOut - pDst)*sizeof(int));
+}
+
+static void ExpectRoundTrip(const int *pValues, int Num)
+{
+	static unsigned char aExpected[1<<18];
+	static unsigned char aPacked[1<<18];
+	static int aUnpacked[1<<16];
+	ASSERT_LE(Num, 1<<16);
+
+	long ExpectedSize = ReferenceCompress(pValues, Num, aExpected, sizeof(aExpected));
+	long Size = CVariableInt::Compress(pValues, Num*sizeof(int), aPacked, sizeof(aPacked));
+	ASSERT_EQ(Size, ExpectedSize);
+	ASSERT_EQ(mem_comp(aPacked, aExpected, Size), 0);
+
+	// pad the input like a buffer that is larger than the data
+	mem_zero(aPacked+Size, 16);
+	long UnpackedSize = CVariableInt::Decompress(aPacked, Size, aUnpacked, sizeof(aUnpacked));
+	ASSERT_EQ(UnpackedSize, (long)(Num*sizeof(int)));
+	ASSERT_EQ(mem_comp(aUnpacked, pValues, UnpackedSize), 0);
+}
+
+TEST(VariableInt, AllSmallValues)
+{
+	// every value that takes up to three bytes, at every position within a block
+	static int aValues[1<<16];
+	for(int Offset = 0; Offset < 17; Offset++)
+	{
+		for(int Start = -(1<<20); Start < (1<<20); Start += (1<<16)-Offset)
+		{
+			for(int i = 0; i < Offset; i++)
+				aValues[i] = i;
+			for(int i = Offset; i < (1<<16); i++)
+				aValues[i] = Start+i-Offset;
+			ExpectRoundTrip(aValues, 1<<16);
+		}
+	}
+}
+
+TEST(VariableInt, LengthBoundaries)
+{
+	static const int s_aBoundaries[] = {0, 1<<6, 1<<13, 1<<20, 1<<27};
+	int aValues[1024];
+	int Num = 0;
+	for(unsigned i = 0; i < sizeof(s_aBoundaries)/sizeof(s_aBoundaries[0]); i++)
+	{
+		for(int d = -3; d <= 3; d++)
+		{
+			aValues[Num++] = s_aBoundaries[i]+d;
+			aValues[Num++] = -s_aBoundaries[i]+d;
+		}
+	}
+	aValues[Num++] = 0x7FFFFFFF;
+	aValues[Num++] = -0x7FFFFFFF-1;
+	ExpectRoundTrip(aValues, Num);
+
+	// each boundary value surrounded by single byte ints
+	for(int k = 0; k < Num; k++)
+	{
+		int aMixed[40];
+		for(int i = 0; i < 40; i++)
+			aMixed[i] = (i*7)%64-32;
+		aMixed[k%40] = aValues[k];
+		ExpectRoundTrip(aMixed, 40);
+	}
+}
+
+TEST(VariableInt, RandomStreams)
+{
+	static int aValues[4096];
+	unsigned Seed = 1234;
+	for(int Round = 0; Round < 500; Round++)
+	{
+		int Num = Round%97 + Round*8;
+		for(int i = 0; i < Num; i++)
+		{
+			Seed = Seed*1103515245+12345;
+			int Kind = (Seed>>16)%8;
+			Seed = Seed*1103515245+12345;
+			int Random = (int)Seed;
+			aValues[i] = Kind < 5 ? Random%64 : Kind < 7 ? Random%100000 : Random;
+		}
+		ExpectRoundTrip(aValues, Num);
+	}
+}
+
+TEST(VariableInt, OutputLimits)
+{
+	int aValues[64];
+	for(int i = 0; i < 64; i++)
+		aValues[i] = i%9 == 0 ? 1000 : i%30;
+
+	for(int DstSize = 0; DstSize < 200; DstSize++)
+	{
+		unsigned char aExpected[256];
+		unsigned char aPacked[256];
+		long ExpectedSize = ReferenceCompress(aValues, 64, aExpected, DstSize);
+		EXPECT_EQ(CVariableInt::Compress(aValues, sizeof(aValues), aPacked, DstSize), ExpectedSize);
+	}
+
+	unsigned char aPacked[256];
+	long Size = CVariableInt::Compress(aValues, sizeof(aValues), aPacked, sizeof(aPacked));
+	for(int DstSize = 0; DstSize < (int)sizeof(aValues)+8; DstSize += 4)
+	{
+		int aExpected[80];
+		int aUnpacked[80];
+		EXPECT_EQ(CVariableInt::Decompress(aPacked, Size, aUnpacked, DstSize), ReferenceDecompress(aPacked, Size, aExpected, DstSize));
+	}
+}
+
+TEST(VariableInt, MalformedInput)
+{
+	// arbitrary bytes decode exactly like with the reference, including overlong ints
+	unsigned char aData[512+16];
+	int aExpected[512];
+	int aUnpacked[512];
+	unsigned Seed = 99;
+	for(int Round = 0; Round < 200; Round++)
+	{
+		int Size = Round*2;
+		for(int i = 0; i < Size+16; i++)
+		{
+			Seed = Seed*1103515245+12345;
+			aData[i] = (Seed>>16)%4 ? (Seed>>20)&0x7F : (Seed>>20)|0x80;
+		}
+		long ExpectedSize = ReferenceDecompress(aData, Size, aExpected, sizeof(aExpected));
+		ASSERT_EQ(CVariableInt::Decompress(aData, Size, aUnpacked, sizeof(aUnpacked)), ExpectedSize);
+		if(ExpectedSize > 0)
+		{
+			ASSERT_EQ(mem_comp(aUnpacked, aExpected, ExpectedSize), 0);
+		}
+	}
+}
+
+// produced by the encoder before the lookup table decoder, with the network frequencies
+static const unsigned char s_aHuffmanText[] = {
+	0x14, 0xba, 0x56, 0x4e, 0x60, 0x0d, 0x67, 0xb6, 0xd4, 0xb5, 0x50, 0x47,
+	0xcd, 0xc5, 0xda, 0x16, 0xc3, 0xc9, 0x16, 0x29, 0x6e, 0x5d, 0x3b, 0x6b,
+	0x3a, 0x6f, 0x8b, 0x5c, 0x1b, 0x6b, 0xcd, 0x6d, 0x4b, 0xe9, 0x48, 0x97,
+	0xd1, 0x29, 0x6b, 0x5b, 0xe4, 0x6b, 0x71, 0x02, 0x9c, 0x58, 0x43, 0x89,
+	0x6b, 0xe5, 0x04, 0xd6, 0xae, 0x04, 0x47, 0x51, 0x07, 0x28, 0x67, 0xcd,
+	0x89, 0xb6, 0x88, 0xce, 0x29, 0x6e, 0x00
+};
+
+static const unsigned char s_aHuffmanZeros[] = {
+	0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+	0xaf, 0xb8, 0x01
+};
+
+static const unsigned char s_aHuffmanEmpty[] = {
+	0x8a, 0x1b
+};
+
+static const unsigned char s_aHuffmanRandom[] = {
+	0x3e, 0xe4, 0x4a, 0xfa, 0xa9, 0xb9, 0x54, 0x73, 0xbc, 0x6b, 0xe6, 0x78,
+	0x0a, 0x39, 0xc6, 0x05, 0xd3, 0xb6, 0x25, 0x0a, 0xa8, 0xd2, 0xd5, 0xa8,
+	0xb2, 0x4f, 0x54, 0xa7, 0x0b, 0x38, 0xb9, 0x83, 0x83, 0xce, 0xd1, 0x79,
+	0x57, 0x4b, 0x55, 0x93, 0x16, 0x1f, 0x2e, 0x55, 0xea, 0xd6, 0x85, 0x2a,
+	0xd7, 0x68, 0x9a, 0xee, 0xd1, 0x90, 0x23, 0x3e, 0x9c, 0x42, 0x56, 0x96,
+	0x29, 0x0e, 0x35, 0x4e, 0xd0, 0x3c, 0xd7, 0x20, 0xa0, 0x9c, 0xa6, 0xe2,
+	0xd3, 0x89, 0x04, 0x5f, 0x8b, 0xbf, 0xe6, 0x34, 0x41, 0xd9, 0x19, 0x73,
+	0x49, 0x2a, 0x7c, 0x8d, 0xe2, 0x06
+};
+
+static void ExpectHuffman(const void *pData, int Size, const unsigned char *pExpected, int ExpectedSize)
+{
+	unsigned char aPacked[1024];
+	unsigned char aUnpacked[1024];
+	ASSERT_EQ(CNetBase::Compress(pData, Size, aPacked, sizeof(aPacked)), ExpectedSize);
+	ASSERT_EQ(mem_comp(aPacked, pExpected, ExpectedSize), 0);
+	ASSERT_EQ(CNetBase::Decompress(pExpected, ExpectedSize, aUnpacked, sizeof(aUnpacked)), Size);
+	ASSERT_EQ(mem_comp(aUnpacked, pData, Size), 0);
+}
+
+// decodes from a buffer of exactly the given size so that reading past it shows up with sanitizers
+static int HuffmanDecompressExact(const unsigned char *pData, int Size, void *pOutput, int OutputSize)
+{
+	unsigned char *pCopy = (unsigned char *)mem_alloc(Size > 0 ? Size : 1, 1);
+	mem_copy(pCopy, pData, Size);
+	int Result = CNetBase::Decompress(pCopy, Size, pOutput, OutputSize);
+	mem_free(pCopy);
+	return Result;
+}
+
+TEST(Huffman, BaselineVectors)
+{
+	CNetBase::Init();
+
+	const char *pText = "The quick brown fox jumps over the lazy dog";
+	ExpectHuffman(pText, str_length(pText), s_aHuffmanText, sizeof(s_aHuffmanText));
+
+	unsigned char aZeros[100] = {0};
+	ExpectHuffman(aZeros, sizeof(aZeros), s_aHuffmanZeros, sizeof(s_aHuffmanZeros));
+	ExpectHuffman(aZeros, 0, s_aHuffmanEmpty, sizeof(s_aHuffmanEmpty));
+
+	unsigned char aRandom[64];
+	unsigned Seed = 1;
+	for(int i = 0; i < 64; i++)
+	{
+		Seed = Seed*1103515245+12345;
+		aRandom[i] = (Seed>>16)&0xFF;
+	}
+	ExpectHuffman(aRandom, sizeof(aRandom), s_aHuffmanRandom, sizeof(s_aHuffmanRandom));
+}
+
+TEST(Huffman, RoundTrip)
+{
+	CNetBase::Init();
+
+	// every length up to a few times the width of a lookup and a refill, then larger packets
+	unsigned char aData[2048];
+	unsigned char aPacked[4096];
+	unsigned char aUnpacked[2048];
+	unsigned Seed = 4321;
+	for(int Round = 0; Round < 400; Round++)
+	{
+		int Size = Round < 200 ? Round%100 : 100+(Round-200)*9;
+		int Kind = Round%4;
+		for(int i = 0; i < Size; i++)
+		{
+			Seed = Seed*1103515245+12345;
+			// uniform bytes, mostly zeros with short and long codes, and text
+			aData[i] = Kind == 0 ? (Seed>>16)&0xFF : Kind == 1 ? ((Seed>>16)%4 ? 0 : (Seed>>20)&0xFF) : 'a'+(Seed>>16)%26;
+		}
+
+		int PackedSize = CNetBase::Compress(aData, Size, aPacked, sizeof(aPacked));
+		ASSERT_GT(PackedSize, 0);
+		ASSERT_EQ(HuffmanDecompressExact(aPacked, PackedSize, aUnpacked, Size), Size);
+		ASSERT_EQ(mem_comp(aUnpacked, aData, Size), 0);
+		if(Size > 0)
+		{
+			ASSERT_EQ(HuffmanDecompressExact(aPacked, PackedSize, aUnpacked, Size-1), -1);
+		}
+	}
+}
+
+TEST(Huffman, BadInput)
+{
+	CNetBase::Init();
+
+	// a packet cut off anywhere before its end
+	const char *pText = "The quick brown fox jumps over the lazy dog";
+	unsigned char aUnpacked[4096];
+	for(int Size = 0; Size < (int)sizeof(s_aHuffmanText); Size++)
+		EXPECT_EQ(HuffmanDecompressExact(s_aHuffmanText, Size, aUnpacked, sizeof(aUnpacked)), -1);
+	EXPECT_EQ(HuffmanDecompressExact(s_aHuffmanText, sizeof(s_aHuffmanText), aUnpacked, sizeof(aUnpacked)), str_length(pText));
+
+	// garbage either fails or stays within the output
+	unsigned char aData[256];
+	unsigned Seed = 7;
+	int Failed = 0;
+	for(int Round = 0; Round < 1000; Round++)
+	{
+		int Size = Round%256;
+		for(int i = 0; i < Size; i++)
+		{
+			Seed = Seed*1103515245+12345;
+			aData[i] = (Seed>>16)&0xFF;
+		}
+		int OutputSize = Round%3 ? 64 : (int)sizeof(aUnpacked);
+		int Result = HuffmanDecompressExact(aData, Size, aUnpacked, OutputSize);
+		ASSERT_GE(Result, -1);
+		ASSERT_LE(Result, OutputSize);
+		if(Result == -1)
+			Failed++;
+	}
+	EXPECT_GT(Failed, 900);
+}
@@ -0,0 +1,79 @@
+#include <gtest/gtest.h>
+
+#include <base/system.h>
+#include <engine/console.h>
+#include <engine/shared/config.h>
+
+static void ExpectSorted(IConsole *pConsole, int ExpectedTemp)
+{
+	int NumTemp = 0;
+	const IConsole::CCommandInfo *pPrev = 0;
+	for(const IConsole::CCommandInfo *pInfo = pConsole->FirstCommandInfo(IConsole::ACCESS_LEVEL_ADMIN, CFGFLAG_SERVER|CFGFLAG_CLIENT); pInfo;
+		pInfo = pInfo->NextCommandInfo(IConsole::ACCESS_LEVEL_ADMIN, CFGFLAG_SERVER|CFGFLAG_CLIENT))
+	{
+		if(pPrev)
+		{
+			ASSERT_LE(str_comp(pPrev->m_pName, pInfo->m_pName), 0) << pPrev->m_pName << " " << pInfo->m_pName;
+		}
+		if(str_comp_num(pInfo->m_pName, "temp_", 5) == 0)
+			NumTemp++;
+		pPrev = pInfo;
+	}
+	EXPECT_EQ(NumTemp, ExpectedTemp);
+}
+
+TEST(Console, Lookup)
+{
+	IConsole *pConsole = CreateConsole(CFGFLAG_SERVER);
+	EXPECT_TRUE(pConsole->GetCommandInfo("echo", CFGFLAG_SERVER, false));
+	EXPECT_TRUE(pConsole->GetCommandInfo("ECHO", CFGFLAG_SERVER, false));
+	EXPECT_FALSE(pConsole->GetCommandInfo("echo", CFGFLAG_SERVER, true));
+	EXPECT_FALSE(pConsole->GetCommandInfo("+toggle", CFGFLAG_SERVER, false));
+	EXPECT_TRUE(pConsole->GetCommandInfo("+toggle", CFGFLAG_CLIENT, false));
+	EXPECT_FALSE(pConsole->GetCommandInfo("ech", CFGFLAG_SERVER, false));
+
+	// a temp command with the name of a local one
+	pConsole->RegisterTemp("echo", "r", CFGFLAG_SERVER, "remote echo");
+	const IConsole::CCommandInfo *pTemp = pConsole->GetCommandInfo("echo", CFGFLAG_SERVER, true);
+	ASSERT_TRUE(pTemp);
+	EXPECT_STREQ(pTemp->m_pHelp, "remote echo");
+	pConsole->DeregisterTemp("echo");
+	EXPECT_FALSE(pConsole->GetCommandInfo("echo", CFGFLAG_SERVER, true));
+	EXPECT_TRUE(pConsole->GetCommandInfo("echo", CFGFLAG_SERVER, false));
+	delete pConsole;
+}
+
+TEST(Console, TempCommandsStaySorted)
+{
+	IConsole *pConsole = CreateConsole(CFGFLAG_SERVER);
+	ExpectSorted(pConsole, 0);
+
+	// names that share prefixes with each other and with the built-in commands
+	char aaNames[500][32];
+	for(int i = 0; i < 500; i++)
+		str_format(aaNames[i], sizeof(aaNames[i]), "temp_%d", (i*173)%500);
+
+	for(int Round = 0; Round < 2; Round++)
+	{
+		for(int i = 0; i < 500; i++)
+			pConsole->RegisterTemp(aaNames[i], "", CFGFLAG_SERVER, "");
+		ExpectSorted(pConsole, 500);
+
+		for(int i = 0; i < 500; i += 3)
+			pConsole->DeregisterTemp(aaNames[i]);
+		ExpectSorted(pConsole, 500-167);
+		EXPECT_FALSE(pConsole->GetCommandInfo(aaNames[0], CFGFLAG_SERVER, true));
+		EXPECT_TRUE(pConsole->GetCommandInfo(aaNames[1], CFGFLAG_SERVER, true));
+
+		// reuses the removed ones
+		for(int i = 0; i < 500; i += 3)
+			pConsole->RegisterTemp(aaNames[i], "", CFGFLAG_SERVER, "");
+		ExpectSorted(pConsole, 500);
+
+		pConsole->DeregisterTempAll();
+		ExpectSorted(pConsole, 0);
+		EXPECT_FALSE(pConsole->GetCommandInfo(aaNames[1], CFGFLAG_SERVER, true));
+	}
+	EXPECT_TRUE(pConsole->GetCommandInfo("exec", CFGFLAG_SERVER, false));
+	delete pConsole;
+}
@@ -0,0 +1,85 @@
+#include "test.h"
+#include <gtest/gtest.h>
+
+#include <base/system.h>
+#include <engine/console.h>
+#include <engine/storage.h>
+#include <engine/shared/config.h>
+#include <engine/shared/demo.h>
+#include <engine/shared/network.h>
+#include <engine/shared/snapshot.h>
+
+class CSnapshotCounter : public CDemoPlayer::IListner
+{
+public:
+	int m_NumSnapshots;
+
+	CSnapshotCounter() : m_NumSnapshots(0) {}
+	virtual void OnDemoPlayerSnapshot(void *pData, int Size) { m_NumSnapshots++; }
+	virtual void OnDemoPlayerMessage(void *pData, int Size) {}
+};
+
+TEST(Demo, PlaybackEndOfFile)
+{
+	CTestInfo Info;
+	char aMapName[128];
+	char aMapFilename[128];
+	str_copy(aMapName, Info.m_aFilename, sizeof(aMapName));
+	str_format(aMapFilename, sizeof(aMapFilename), "maps/%s.map", aMapName);
+
+	CNetBase::Init();
+	IStorage *pStorage = CreateTestStorage();
+	IConsole *pConsole = CreateConsole(CFGFLAG_CLIENT);
+	pStorage->CreateFolder("maps", IStorage::TYPE_SAVE);
+	IOHANDLE File = pStorage->OpenFile(aMapFilename, IOFLAG_WRITE, IStorage::TYPE_SAVE);
+	ASSERT_TRUE(File);
+	io_write(File, "map", 3);
+	io_close(File);
+
+	CSnapshotDelta Delta;
+	CSnapshotBuilder Builder;
+	char aSnapshot[CSnapshot::MAX_SIZE];
+
+	CDemoRecorder Recorder(&Delta);
+	ASSERT_EQ(Recorder.Start(pStorage, pConsole, Info.m_aFilename, "test", aMapName, sha256("map", 3), 0, "client"), 0);
+	const int FirstTick = 100;
+	const int LastTick = 399;
+	for(int Tick = FirstTick; Tick <= LastTick; Tick++)
+	{
+		Builder.Init();
+		int *pData = (int *)Builder.NewItem(1, 0, sizeof(int));
+		*pData = Tick;
+		int Size = Builder.Finish(aSnapshot);
+		Recorder.RecordSnapshot(Tick, aSnapshot, Size);
+	}
+	EXPECT_EQ(Recorder.Stop(), 0);
+
+	CSnapshotCounter Counter;
+	CDemoPlayer Player(&Delta);
+	Player.SetListner(&Counter);
+	ASSERT_FALSE(Player.Load(pStorage, pConsole, Info.m_aFilename, IStorage::TYPE_ALL, "test"));
+	Player.Play();
+	EXPECT_FALSE(Player.EndOfFile());
+
+	// the player pauses on the last tick and keeps the file open
+	int Frames = 0;
+	while(Player.IsPlaying() && !Player.EndOfFile() && Frames++ <= LastTick-FirstTick)
+		Player.NextFrame();
+	EXPECT_TRUE(Player.EndOfFile());
+	EXPECT_TRUE(Player.IsPlaying());
+	EXPECT_TRUE(Player.BaseInfo()->m_Paused);
+	EXPECT_EQ(Player.BaseInfo()->m_CurrentTick, LastTick);
+	EXPECT_EQ(Counter.m_NumSnapshots, LastTick-FirstTick+1);
+
+	// seeking back continues the playback
+	EXPECT_EQ(Player.SetPos(0.5f), 0);
+	EXPECT_FALSE(Player.EndOfFile());
+	EXPECT_LT(Player.BaseInfo()->m_CurrentTick, LastTick);
+
+	Player.Stop();
+	EXPECT_TRUE(pStorage->RemoveFile(Info.m_aFilename, IStorage::TYPE_SAVE));
+	EXPECT_TRUE(pStorage->RemoveFile(aMapFilename, IStorage::TYPE_SAVE));
+	pStorage->RemoveFile("maps", IStorage::TYPE_SAVE);
+	delete pConsole;
+	delete pStorage;
+}
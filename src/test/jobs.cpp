@@ -0,0 +1,115 @@
+#include <gtest/gtest.h>
+
+#include <base/system.h>
+#include <engine/shared/jobs.h>
+
+static int Increment(void *pUser)
+{
+	atomic_inc((volatile unsigned *)pUser);
+	return 1;
+}
+
+struct CStep
+{
+	volatile unsigned *m_pCounter;
+	int m_Seen;
+};
+
+static int RecordStep(void *pUser)
+{
+	CStep *pStep = (CStep *)pUser;
+	pStep->m_Seen = atomic_inc(pStep->m_pCounter);
+	return 0;
+}
+
+TEST(Jobs, Single)
+{
+	CJobPool Pool;
+	Pool.Init(2);
+	volatile unsigned Counter = 0;
+	CJob Job;
+	CJobGroup Group;
+	Pool.Add(&Job, Increment, (void *)&Counter, &Group);
+	Pool.Wait(&Group);
+	EXPECT_EQ(Job.Status(), CJob::STATE_DONE);
+	EXPECT_EQ(Job.Result(), 1);
+	EXPECT_EQ(Counter, 1u);
+}
+
+TEST(Jobs, Group)
+{
+	CJobPool Pool;
+	Pool.Init(4);
+	volatile unsigned Counter = 0;
+	CJob aJobs[500];
+	CJobGroup Group;
+	for(int Round = 0; Round < 3; Round++)
+	{
+		for(int i = 0; i < 500; i++)
+			Pool.Add(&aJobs[i], Increment, (void *)&Counter, &Group);
+		Pool.Wait(&Group);
+		EXPECT_EQ(Counter, 500u*(Round+1));
+	}
+}
+
+TEST(Jobs, NoThreads)
+{
+	// waiting runs the jobs on the calling thread
+	CJobPool Pool;
+	Pool.Init(0);
+	volatile unsigned Counter = 0;
+	CJob aJobs[10];
+	CJobGroup Group;
+	for(int i = 0; i < 10; i++)
+		Pool.Add(&aJobs[i], Increment, (void *)&Counter, &Group);
+	Pool.Wait(&Group);
+	EXPECT_EQ(Counter, 10u);
+}
+
+TEST(Jobs, Dependencies)
+{
+	CJobPool Pool;
+	Pool.Init(4);
+	for(int Round = 0; Round < 100; Round++)
+	{
+		// diamond: A -> B, C -> D
+		volatile unsigned Counter = 0;
+		CStep aSteps[4];
+		CJob aJobs[4];
+		CJobGroup Group;
+		for(int i = 0; i < 4; i++)
+		{
+			aSteps[i].m_pCounter = &Counter;
+			aSteps[i].m_Seen = 0;
+		}
+		CJob *pA = &aJobs[0];
+		CJob *apAB[] = {&aJobs[1], &aJobs[2]};
+		Pool.Add(&aJobs[0], RecordStep, &aSteps[0], &Group);
+		Pool.AddDependent(&aJobs[1], RecordStep, &aSteps[1], &pA, 1, &Group);
+		Pool.AddDependent(&aJobs[2], RecordStep, &aSteps[2], &pA, 1, &Group);
+		Pool.AddDependent(&aJobs[3], RecordStep, &aSteps[3], apAB, 2, &Group);
+		Pool.Wait(&Group);
+
+		EXPECT_EQ(aSteps[0].m_Seen, 1);
+		EXPECT_GE(aSteps[1].m_Seen, 2);
+		EXPECT_GE(aSteps[2].m_Seen, 2);
+		EXPECT_EQ(aSteps[3].m_Seen, 4);
+	}
+}
+
+TEST(Jobs, DependencyDone)
+{
+	CJobPool Pool;
+	Pool.Init(1);
+	volatile unsigned Counter = 0;
+	CJob Job, Unused, Dependent;
+	CJobGroup Group;
+	Pool.Add(&Job, Increment, (void *)&Counter, &Group);
+	Pool.Wait(&Group);
+
+	// depending on finished and never added jobs does not block
+	CJob *apDependencies[] = {&Job, &Unused};
+	Pool.AddDependent(&Dependent, Increment, (void *)&Counter, apDependencies, 2, &Group);
+	Pool.Wait(&Group);
+	EXPECT_EQ(Counter, 2u);
+}
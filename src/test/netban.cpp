@@ -0,0 +1,245 @@
+#include <gtest/gtest.h>
+
+#include <base/system.h>
+#include <engine/console.h>
+#include <engine/shared/config.h>
+#include <engine/shared/netban.h>
+
+class NetBan : public ::testing::Test
+{
+protected:
+	IConsole *m_pConsole;
+	CNetBan m_NetBan;
+	unsigned m_Seed;
+
+	NetBan()
+	{
+		m_pConsole = CreateConsole(CFGFLAG_SERVER);
+		m_NetBan.Init(m_pConsole, 0);
+		m_Seed = 1;
+	}
+
+	~NetBan()
+	{
+		delete m_pConsole;
+	}
+
+	unsigned Random()
+	{
+		m_Seed = m_Seed*1103515245+12345;
+		return m_Seed>>8;
+	}
+
+	void RandomAddr(NETADDR *pAddr, int Type)
+	{
+		mem_zero(pAddr, sizeof(*pAddr));
+		pAddr->type = Type;
+		for(int i = 0; i < (Type == NETTYPE_IPV4 ? 4 : 16); i++)
+			pAddr->ip[i] = Random();
+	}
+
+	bool IsBanned(const NETADDR *pAddr, char *pReason = 0)
+	{
+		char aBuf[256];
+		bool Banned = m_NetBan.IsBanned(pAddr, aBuf, sizeof(aBuf), 0);
+		if(Banned && pReason)
+			str_copy(pReason, str_find(aBuf, "(")+1, str_length(str_find(aBuf, "("))-1);
+		return Banned;
+	}
+
+	static bool Contains(const CNetRange *pRange, const NETADDR *pAddr)
+	{
+		int Length = pAddr->type == NETTYPE_IPV4 ? 4 : 16;
+		return pRange->m_LB.type == pAddr->type && mem_comp(pRange->m_LB.ip, pAddr->ip, Length) <= 0 && mem_comp(pRange->m_UB.ip, pAddr->ip, Length) >= 0;
+	}
+
+	// bans random ranges of all sizes and compares every lookup with a linear search
+	void CheckRanges(int Type, int NumRanges)
+	{
+		int Length = Type == NETTYPE_IPV4 ? 4 : 16;
+		CNetRange *pRanges = new CNetRange[NumRanges];
+		bool *pActive = new bool[NumRanges];
+		for(int i = 0; i < NumRanges; i++)
+		{
+			RandomAddr(&pRanges[i].m_LB, Type);
+			pRanges[i].m_UB = pRanges[i].m_LB;
+			int Fixed = 1+Random()%(Length-1);
+			for(int j = Fixed; j < Length; j++)
+				pRanges[i].m_UB.ip[j] = Random();
+			if(NetComp(&pRanges[i].m_LB, &pRanges[i].m_UB) > 0)
+			{
+				NETADDR Tmp = pRanges[i].m_LB;
+				pRanges[i].m_LB = pRanges[i].m_UB;
+				pRanges[i].m_UB = Tmp;
+			}
+			pActive[i] = pRanges[i].IsValid() && m_NetBan.BanRange(&pRanges[i], 0, "range") == 0;
+		}
+
+		for(int Round = 0; Round < 2; Round++)
+		{
+			for(int i = 0; i < 20000; i++)
+			{
+				NETADDR Addr;
+				const CNetRange *pRange = &pRanges[Random()%NumRanges];
+				if(i%4 == 0)
+					RandomAddr(&Addr, Type);
+				else
+				{
+					// right at or next to the bounds
+					Addr = i%2 ? pRange->m_LB : pRange->m_UB;
+					int Last = Length-1;
+					if(i%4 == 3)
+						Addr.ip[Last] += i%2 ? -1 : 1;
+				}
+
+				bool Expected = false;
+				for(int j = 0; j < NumRanges && !Expected; j++)
+					Expected = pActive[j] && Contains(&pRanges[j], &Addr);
+				ASSERT_EQ(IsBanned(&Addr), Expected) << "round " << Round << " lookup " << i;
+			}
+
+			// unban every other range, the trie has to shrink back correctly
+			for(int i = 0; i < NumRanges; i += 2)
+			{
+				if(pActive[i])
+				{
+					EXPECT_EQ(m_NetBan.UnbanByRange(&pRanges[i]), 0);
+				}
+				pActive[i] = false;
+			}
+		}
+
+		delete[] pActive;
+		delete[] pRanges;
+	}
+};
+
+TEST_F(NetBan, ManyAddresses)
+{
+	NETADDR aAddrs[5000];
+	for(int i = 0; i < 5000; i++)
+	{
+		RandomAddr(&aAddrs[i], i%2 ? NETTYPE_IPV4 : NETTYPE_IPV6);
+		aAddrs[i].port = i;
+		m_NetBan.BanAddr(&aAddrs[i], 0, "addr");
+	}
+	for(int i = 0; i < 5000; i++)
+	{
+		// the port does not matter
+		NETADDR Addr = aAddrs[i];
+		Addr.port = 8303;
+		EXPECT_TRUE(IsBanned(&Addr));
+		Addr.ip[0]++;
+		EXPECT_FALSE(IsBanned(&Addr));
+	}
+	for(int i = 0; i < 5000; i += 2)
+		m_NetBan.UnbanByAddr(&aAddrs[i]);
+	for(int i = 0; i < 5000; i++)
+		EXPECT_EQ(IsBanned(&aAddrs[i]), i%2 == 1);
+	m_NetBan.UnbanAll();
+	EXPECT_FALSE(IsBanned(&aAddrs[1]));
+}
+
+TEST_F(NetBan, RangesIPv4)
+{
+	CheckRanges(NETTYPE_IPV4, 2000);
+}
+
+TEST_F(NetBan, RangesIPv6)
+{
+	CheckRanges(NETTYPE_IPV6, 500);
+}
+
+TEST_F(NetBan, MostSpecificRange)
+{
+	CNetRange Wide, Narrow;
+	net_addr_from_str(&Wide.m_LB, "10.0.0.0");
+	net_addr_from_str(&Wide.m_UB, "10.255.255.255");
+	net_addr_from_str(&Narrow.m_LB, "10.1.2.0");
+	net_addr_from_str(&Narrow.m_UB, "10.1.2.255");
+	EXPECT_EQ(m_NetBan.BanRange(&Wide, 0, "wide"), 0);
+	EXPECT_EQ(m_NetBan.BanRange(&Narrow, 0, "narrow"), 0);
+
+	char aReason[64];
+	NETADDR Addr;
+	net_addr_from_str(&Addr, "10.1.2.3");
+	ASSERT_TRUE(IsBanned(&Addr, aReason));
+	EXPECT_STREQ(aReason, "narrow");
+	net_addr_from_str(&Addr, "10.1.3.3");
+	ASSERT_TRUE(IsBanned(&Addr, aReason));
+	EXPECT_STREQ(aReason, "wide");
+	net_addr_from_str(&Addr, "11.1.2.3");
+	EXPECT_FALSE(IsBanned(&Addr));
+
+	EXPECT_EQ(m_NetBan.UnbanByRange(&Narrow), 0);
+	net_addr_from_str(&Addr, "10.1.2.3");
+	ASSERT_TRUE(IsBanned(&Addr, aReason));
+	EXPECT_STREQ(aReason, "wide");
+}
+
+TEST_F(NetBan, Expiry)
+{
+	enum
+	{
+		NUM_BANS=300,
+	};
+	NETADDR aAddrs[NUM_BANS];
+	CNetRange aRanges[NUM_BANS];
+	int aSeconds[NUM_BANS];
+
+	// the bans are stamped with the current time, so all of them have to get the same second
+	int Start;
+	do
+	{
+		m_NetBan.UnbanAll();
+		Start = time_timestamp();
+		for(int i = 0; i < NUM_BANS; i++)
+		{
+			// seconds, up to a few rounds of the timer slots, and permanent
+			int Kind = i%4;
+			aSeconds[i] = Kind == 0 ? 1+Random()%60 : Kind == 1 ? 1+Random()%4000 : Kind == 2 ? 1+Random()%15000 : 0;
+			char aBuf[32];
+			str_format(aBuf, sizeof(aBuf), "20.%d.%d.1", i/256, i%256);
+			net_addr_from_str(&aAddrs[i], aBuf);
+			str_format(aBuf, sizeof(aBuf), "30.%d.%d.0", i/256, i%256);
+			net_addr_from_str(&aRanges[i].m_LB, aBuf);
+			str_format(aBuf, sizeof(aBuf), "30.%d.%d.255", i/256, i%256);
+			net_addr_from_str(&aRanges[i].m_UB, aBuf);
+			EXPECT_EQ(m_NetBan.BanAddr(&aAddrs[i], aSeconds[i], "addr"), 0);
+			EXPECT_EQ(m_NetBan.BanRange(&aRanges[i], aSeconds[i], "range"), 0);
+		}
+
+		// changing a ban moves it to its new expiry
+		for(int i = 0; i < NUM_BANS; i += 7)
+		{
+			aSeconds[i] = i%2 ? 0 : 1+Random()%5000;
+			EXPECT_EQ(m_NetBan.BanAddr(&aAddrs[i], aSeconds[i], "addr"), 1);
+			EXPECT_EQ(m_NetBan.BanRange(&aRanges[i], aSeconds[i], "range"), 1);
+		}
+	}
+	while(time_timestamp() != Start);
+
+	// a ban is gone as soon as its expiry is over, not earlier, also after the server stalled
+	// for longer than the timer slots reach
+	for(int Now = Start; Now < Start+16000; Now += Random()%30 ? 1+Random()%100 : 5000)
+	{
+		m_NetBan.Update(Now);
+		for(int i = 0; i < NUM_BANS; i++)
+		{
+			bool Expected = aSeconds[i] == 0 || Start+aSeconds[i] >= Now;
+			NETADDR Addr = aRanges[i].m_LB;
+			Addr.ip[3] = Random();
+			ASSERT_EQ(IsBanned(&aAddrs[i]), Expected) << "ban " << i << " after " << Now-Start << " seconds";
+			ASSERT_EQ(IsBanned(&Addr), Expected) << "range " << i << " after " << Now-Start << " seconds";
+		}
+	}
+
+	// permanent bans survive everything
+	m_NetBan.Update(Start+1000000);
+	for(int i = 0; i < NUM_BANS; i++)
+	{
+		EXPECT_EQ(IsBanned(&aAddrs[i]), aSeconds[i] == 0);
+		NETADDR Addr = aRanges[i].m_LB;
+		EXPECT_EQ(IsBanned(&Addr), aSeconds[i] == 0);
+	}
+}
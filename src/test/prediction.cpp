@@ -0,0 +1,358 @@
+#include <gtest/gtest.h>
+
+#include <base/system.h>
+#include <engine/map.h>
+#include <game/client/prediction.h>
+#include <game/collision.h>
+#include <game/layers.h>
+
+#include <vector>
+
+// a map with just a game layer, walls around it and a few platforms, some of them unhookable
+class CTestMap : public IMap
+{
+public:
+	enum
+	{
+		WIDTH=60,
+		HEIGHT=40,
+	};
+
+	CMapItemGroup m_Group;
+	CMapItemLayerTilemap m_Layer;
+	CTile m_aTiles[WIDTH*HEIGHT];
+
+	CTestMap()
+	{
+		mem_zero(&m_Group, sizeof(m_Group));
+		m_Group.m_Version = CMapItemGroup::CURRENT_VERSION;
+		m_Group.m_ParallaxX = 100;
+		m_Group.m_ParallaxY = 100;
+		m_Group.m_StartLayer = 0;
+		m_Group.m_NumLayers = 1;
+
+		mem_zero(&m_Layer, sizeof(m_Layer));
+		m_Layer.m_Layer.m_Type = LAYERTYPE_TILES;
+		m_Layer.m_Version = CMapItemLayerTilemap::CURRENT_VERSION;
+		m_Layer.m_Width = WIDTH;
+		m_Layer.m_Height = HEIGHT;
+		m_Layer.m_Flags = TILESLAYERFLAG_GAME;
+		m_Layer.m_Data = 0;
+
+		mem_zero(m_aTiles, sizeof(m_aTiles));
+		for(int y = 0; y < HEIGHT; y++)
+			for(int x = 0; x < WIDTH; x++)
+			{
+				if(x == 0 || y == 0 || x == WIDTH-1 || y == HEIGHT-1)
+					m_aTiles[y*WIDTH+x].m_Index = TILE_SOLID;
+				else if(y%8 == 0 && (x/5)%3 == 0)
+					m_aTiles[y*WIDTH+x].m_Index = (x/5)%2 ? TILE_SOLID : TILE_NOHOOK;
+			}
+	}
+
+	virtual void *GetData(int Index) { return Index == 0 ? m_aTiles : 0; }
+	virtual int GetDataSize(int Index) { return Index == 0 ? sizeof(m_aTiles) : 0; }
+	virtual void *GetDataSwapped(int Index) { return GetData(Index); }
+	virtual void UnloadData(int Index) {}
+	virtual void *GetItem(int Index, int *pType, int *pID)
+	{
+		if(pType)
+			*pType = Index == 0 ? MAPITEMTYPE_GROUP : MAPITEMTYPE_LAYER;
+		if(pID)
+			*pID = 0;
+		return Index == 0 ? (void *)&m_Group : (void *)&m_Layer;
+	}
+	virtual int GetItemSize(int Index) { return Index == 0 ? sizeof(m_Group) : sizeof(m_Layer); }
+	virtual void GetType(int Type, int *pStart, int *pNum)
+	{
+		*pStart = Type == MAPITEMTYPE_LAYER ? 1 : 0;
+		*pNum = Type == MAPITEMTYPE_GROUP || Type == MAPITEMTYPE_LAYER ? 1 : 0;
+	}
+	virtual void *FindItem(int Type, int ID) { return 0; }
+	virtual int NumItems() { return 2; }
+};
+
+// everything a prediction leaves behind, the characters are kept between the runs like in the client
+struct CPredictionRun
+{
+	CCharacterCore m_aCharacters[MAX_CLIENTS];
+	CCharacterCore m_PrevChar;
+	CCharacterCore m_Char;
+	int m_LastNewTick;
+	std::vector<int> m_aEvents;
+
+	CPredictionRun()
+	{
+		mem_zero(m_aCharacters, sizeof(m_aCharacters));
+		mem_zero(&m_PrevChar, sizeof(m_PrevChar));
+		mem_zero(&m_Char, sizeof(m_Char));
+		m_LastNewTick = -1;
+	}
+
+	void OnEvents(int Tick, int Events, vec2 Pos)
+	{
+		if(Tick <= m_LastNewTick)
+			return;
+		m_LastNewTick = Tick;
+		m_aEvents.push_back(Tick);
+		m_aEvents.push_back(Events);
+		m_aEvents.push_back(round_to_int(Pos.x));
+		m_aEvents.push_back(round_to_int(Pos.y));
+	}
+};
+
+class Prediction : public ::testing::Test
+{
+protected:
+	enum
+	{
+		NUM_CHARACTERS=6,
+		NUM_TICKS=3000,
+		MAX_LAG=60,
+	};
+
+	CTestMap m_Map;
+	CLayers m_Layers;
+	CCollision m_Collision;
+	unsigned m_Seed;
+	CPredictionRun *m_pCachedRun;
+
+	CNetObj_PlayerInput m_aInputs[NUM_TICKS+MAX_LAG];
+	bool m_aHasInput[NUM_TICKS+MAX_LAG];
+
+	Prediction()
+	{
+		m_Layers.Init(0, &m_Map);
+		m_Collision.Init(&m_Layers);
+		m_Seed = 1;
+		m_pCachedRun = 0;
+		mem_zero(m_aInputs, sizeof(m_aInputs));
+		mem_zero(m_aHasInput, sizeof(m_aHasInput));
+	}
+
+	int Random(int Num)
+	{
+		m_Seed = m_Seed*1103515245+12345;
+		return (m_Seed>>8)%Num;
+	}
+
+	static const CNetObj_PlayerInput *Input(int Tick, void *pUser)
+	{
+		Prediction *pSelf = (Prediction *)pUser;
+		return pSelf->m_aHasInput[Tick] ? &pSelf->m_aInputs[Tick] : 0;
+	}
+
+	static void Events(int Tick, int Events, vec2 Pos, void *pUser)
+	{
+		((Prediction *)pUser)->m_pCachedRun->OnEvents(Tick, Events, Pos);
+	}
+
+	// the characters of both runs live in different worlds, everything else has to match
+	bool SameCore(CCharacterCore a, CCharacterCore b)
+	{
+		CCharacterCore *apCores[2] = {&a, &b};
+		for(int i = 0; i < 2; i++)
+		{
+			CCharacterCore *pCore = apCores[i];
+			int Id = pCore->m_Id;
+			bool Hook = pCore->m_Hook;
+			bool Collision = pCore->m_Collision;
+			int JumpedTotal = pCore->m_JumpedTotal;
+			int Jumps = pCore->m_Jumps;
+			pCore->Init(0, &m_Collision, 0);
+			pCore->m_Id = Id;
+			pCore->m_Hook = Hook;
+			pCore->m_Collision = Collision;
+			pCore->m_JumpedTotal = JumpedTotal;
+			pCore->m_Jumps = Jumps;
+		}
+		return mem_comp(&a, &b, sizeof(a)) == 0;
+	}
+
+	// the prediction before the cache, every run simulates all ticks from the snapshot
+	void PredictUncached(CPredictionRun *pRun, const bool *pActive, const CNetObj_CharacterCore *pSnap,
+		const CTuningParams *pTuning, int LocalID, int GameTick, int PredTick)
+	{
+		CWorldCore World;
+		World.m_Tuning = *pTuning;
+		for(int i = 0; i < MAX_CLIENTS; i++)
+		{
+			if(!pActive[i])
+				continue;
+			pRun->m_aCharacters[i].Init(&World, &m_Collision, 0);
+			World.m_apCharacters[i] = &pRun->m_aCharacters[i];
+			pRun->m_aCharacters[i].Read(&pSnap[i]);
+		}
+
+		for(int Tick = GameTick+1; Tick <= PredTick; Tick++)
+		{
+			if(Tick == PredTick)
+				pRun->m_PrevChar = *World.m_apCharacters[LocalID];
+
+			for(int c = 0; c < MAX_CLIENTS; c++)
+			{
+				if(!World.m_apCharacters[c])
+					continue;
+				mem_zero(&World.m_apCharacters[c]->m_Input, sizeof(World.m_apCharacters[c]->m_Input));
+				if(c == LocalID)
+				{
+					if(m_aHasInput[Tick])
+						World.m_apCharacters[c]->m_Input = m_aInputs[Tick];
+					World.m_apCharacters[c]->Tick(true);
+				}
+				else
+					World.m_apCharacters[c]->Tick(false);
+			}
+			for(int c = 0; c < MAX_CLIENTS; c++)
+			{
+				if(!World.m_apCharacters[c])
+					continue;
+				World.m_apCharacters[c]->Move();
+				World.m_apCharacters[c]->Quantize();
+			}
+
+			pRun->OnEvents(Tick, World.m_apCharacters[LocalID]->m_TriggeredEvents, World.m_apCharacters[LocalID]->m_Pos);
+
+			if(Tick == PredTick)
+				pRun->m_Char = *World.m_apCharacters[LocalID];
+		}
+	}
+};
+
+// the predicted characters are without teams, which the core only handles without interactions
+// between the players. the cache has to give the same result as simulating every tick again
+TEST_F(Prediction, CachedMatchesUncached)
+{
+	CTuningParams Tuning;
+	Tuning.m_PlayerCollision = 0;
+	Tuning.m_PlayerHooking = 0;
+
+	CWorldCore TruthWorld;
+	TruthWorld.m_Tuning = Tuning;
+	CCharacterCore aTruth[NUM_CHARACTERS];
+	for(int i = 0; i < NUM_CHARACTERS; i++)
+	{
+		aTruth[i].Init(&TruthWorld, &m_Collision, 0);
+		aTruth[i].Reset();
+		aTruth[i].m_Pos = vec2(200+i*40, 200+(i%3)*40);
+		TruthWorld.m_apCharacters[i] = &aTruth[i];
+	}
+	static CNetObj_CharacterCore s_aaHistory[NUM_TICKS][MAX_CLIENTS];
+	mem_zero(s_aaHistory, sizeof(s_aaHistory));
+
+	CPrediction Cached;
+	CPredictionRun *pCachedRun = new CPredictionRun;
+	CPredictionRun *pUncachedRun = new CPredictionRun;
+	CNetObj_PlayerInput aCurrent[NUM_CHARACTERS];
+	mem_zero(aCurrent, sizeof(aCurrent));
+	bool aActive[MAX_CLIENTS] = {false};
+	for(int i = 0; i < NUM_CHARACTERS; i++)
+		aActive[i] = true;
+	int LocalID = 2;
+	int Lag = 3;
+	int Calls = 0;
+
+	for(int s = 1; s < NUM_TICKS; s++)
+	{
+		// the server side, the local player sends its input for the tick most of the time
+		for(int i = 0; i < NUM_CHARACTERS; i++)
+		{
+			if(Random(8) == 0)
+			{
+				aCurrent[i].m_Direction = Random(3)-1;
+				aCurrent[i].m_TargetX = Random(400)-200;
+				aCurrent[i].m_TargetY = Random(400)-200;
+				aCurrent[i].m_Jump = Random(3) == 0;
+				aCurrent[i].m_Hook = Random(2);
+			}
+		}
+		if(!m_aHasInput[s])
+		{
+			m_aInputs[s] = aCurrent[LocalID];
+			m_aHasInput[s] = Random(20) != 0;
+		}
+		for(int i = 0; i < NUM_CHARACTERS; i++)
+		{
+			mem_zero(&aTruth[i].m_Input, sizeof(aTruth[i].m_Input));
+			if(i != LocalID)
+				aTruth[i].m_Input = aCurrent[i];
+			else if(m_aHasInput[s])
+				aTruth[i].m_Input = m_aInputs[s];
+			aTruth[i].Tick(true);
+		}
+		for(int i = 0; i < NUM_CHARACTERS; i++)
+		{
+			aTruth[i].Move();
+			aTruth[i].Quantize();
+			aTruth[i].Write(&s_aaHistory[s][i]);
+		}
+
+		// the client side with lag that jumps around, players that leave and join, another local
+		// player and changed tuning now and then
+		if(Random(50) == 0)
+			Lag = Random(3) ? 2+Random(4) : 10+Random(6);
+		int GameTick = max(1, s-Lag);
+		if(Random(100) == 0)
+			aActive[Random(NUM_CHARACTERS)] ^= true;
+		if(Random(500) == 0)
+			LocalID = LocalID == 2 ? 3 : 2;
+		aActive[LocalID] = true;
+		if(Random(300) == 0)
+		{
+			Tuning.m_Gravity = Random(2) ? 0.5f : 0.6f;
+			Tuning.m_GroundControlSpeed = Random(2) ? 10.0f : 12.0f;
+			TruthWorld.m_Tuning = Tuning;
+		}
+
+		// a few frames while the predicted tick moves on
+		int PredTick = GameTick+Lag+Random(3);
+		for(int f = 0; f < 3 && PredTick < GameTick+MAX_LAG; f++, PredTick += Random(2))
+		{
+			// the input of a tick that was not sent yet changes now and then
+			if(Random(10) == 0)
+			{
+				int Tick = GameTick+1+Random(PredTick-GameTick);
+				if(Tick > s)
+				{
+					m_aInputs[Tick] = aCurrent[LocalID];
+					m_aInputs[Tick].m_Jump ^= 1;
+					m_aHasInput[Tick] = true;
+				}
+			}
+			if(PredTick > s && !m_aHasInput[PredTick] && Random(2))
+			{
+				m_aInputs[PredTick] = aCurrent[LocalID];
+				m_aHasInput[PredTick] = true;
+			}
+
+			CCharacterCore *apCharacters[MAX_CLIENTS];
+			const CNetObj_CharacterCore *apSnap[MAX_CLIENTS];
+			for(int i = 0; i < MAX_CLIENTS; i++)
+			{
+				apCharacters[i] = aActive[i] ? &pCachedRun->m_aCharacters[i] : 0;
+				apSnap[i] = &s_aaHistory[GameTick][i];
+			}
+
+			m_pCachedRun = pCachedRun;
+			Cached.Predict(apCharacters, apSnap, &m_Collision, &Tuning, LocalID, GameTick, PredTick,
+				Input, Events, this, &pCachedRun->m_PrevChar, &pCachedRun->m_Char);
+			PredictUncached(pUncachedRun, aActive, s_aaHistory[GameTick], &Tuning, LocalID, GameTick, PredTick);
+			Calls++;
+
+			ASSERT_TRUE(SameCore(pCachedRun->m_Char, pUncachedRun->m_Char)) << "tick " << s;
+			ASSERT_TRUE(SameCore(pCachedRun->m_PrevChar, pUncachedRun->m_PrevChar)) << "tick " << s;
+			for(int i = 0; i < NUM_CHARACTERS; i++)
+			{
+				if(aActive[i])
+					ASSERT_TRUE(SameCore(pCachedRun->m_aCharacters[i], pUncachedRun->m_aCharacters[i])) << "tick " << s << " character " << i;
+			}
+			ASSERT_EQ(pCachedRun->m_LastNewTick, pUncachedRun->m_LastNewTick) << "tick " << s;
+			ASSERT_TRUE(pCachedRun->m_aEvents == pUncachedRun->m_aEvents) << "tick " << s;
+		}
+	}
+
+	EXPECT_GT(Calls, NUM_TICKS);
+	EXPECT_FALSE(pCachedRun->m_aEvents.empty());
+	delete pCachedRun;
+	delete pUncachedRun;
+}
@@ -0,0 +1,159 @@
+#include <gtest/gtest.h>
+
+#include <base/system.h>
+#include <engine/friends.h>
+#include <engine/serverbrowser.h>
+#include <engine/shared/config.h>
+#include <engine/client/serverbrowser_entry.h>
+#include <engine/client/serverbrowser_filter.h>
+
+class CTestFriends : public IFriends
+{
+public:
+	virtual void Init() {}
+
+	virtual int NumFriends() const { return 0; }
+	virtual const CFriendInfo *GetFriend(int Index) const { return 0; }
+	virtual int GetFriendState(const char *pName, const char *pClan) const { return str_comp(pName, "friend") == 0 ? FRIEND_PLAYER : FRIEND_NO; }
+	virtual bool IsFriend(const char *pName, const char *pClan, bool PlayersOnly) const { return GetFriendState(pName, pClan) != FRIEND_NO; }
+
+	virtual void AddFriend(const char *pName, const char *pClan) {}
+	virtual void RemoveFriend(const char *pName, const char *pClan) {}
+};
+
+class ServerBrowserFilter : public ::testing::Test
+{
+protected:
+	enum
+	{
+		MAX_SERVERS=400,
+	};
+
+	CTestFriends m_Friends;
+	CServerEntry *m_pEntries;
+	CServerEntry *m_apServerlist[MAX_SERVERS];
+	int m_NumServers;
+	unsigned m_Seed;
+
+	ServerBrowserFilter()
+	{
+		m_pEntries = new CServerEntry[MAX_SERVERS];
+		for(int i = 0; i < MAX_SERVERS; i++)
+		{
+			mem_zero(&m_pEntries[i], sizeof(m_pEntries[i]));
+			m_apServerlist[i] = &m_pEntries[i];
+		}
+		m_NumServers = 0;
+		m_Seed = 1;
+		g_Config.m_BrFilterString[0] = 0;
+	}
+
+	~ServerBrowserFilter()
+	{
+		g_Config.m_BrSort = 0;
+		g_Config.m_BrSortOrder = 0;
+		delete[] m_pEntries;
+	}
+
+	int Random(int Range)
+	{
+		m_Seed = m_Seed*1103515245+12345;
+		return (m_Seed>>8)%Range;
+	}
+
+	// few different values, so that keys and strings are often equal
+	void RandomInfo(CServerEntry *pEntry)
+	{
+		static const char *s_apNames[] = {"Teeworlds server", "teeworlds Server", "Teeworlds server 2", "A", "a", "", "zzz", "Zzz fun"};
+		static const char *s_apMaps[] = {"dm1", "dm2", "ctf5", "ctf5_spikes", "DM1"};
+		static const char *s_apGameTypes[] = {"DM", "TDM", "CTF", "ctf", "mod"};
+		CServerInfo *pInfo = &pEntry->m_Info;
+		pEntry->m_InfoState = Random(8) ? CServerEntry::STATE_READY : CServerEntry::STATE_PENDING;
+		str_copy(pInfo->m_aName, s_apNames[Random(8)], sizeof(pInfo->m_aName));
+		str_copy(pInfo->m_aMap, s_apMaps[Random(5)], sizeof(pInfo->m_aMap));
+		str_copy(pInfo->m_aGameType, s_apGameTypes[Random(5)], sizeof(pInfo->m_aGameType));
+		str_copy(pInfo->m_aVersion, "0.7.5", sizeof(pInfo->m_aVersion));
+		pInfo->m_Latency = Random(4)*50;
+		pInfo->m_Flags = Random(8);
+		pInfo->m_Favorite = Random(4) == 0;
+		pInfo->m_ServerLevel = Random(3);
+		pInfo->m_MaxClients = 16;
+		pInfo->m_MaxPlayers = 8;
+		pInfo->m_NumPlayers = Random(9);
+		pInfo->m_NumClients = pInfo->m_NumPlayers+Random(9);
+		pInfo->m_NumBotPlayers = Random(pInfo->m_NumPlayers+1);
+		pInfo->m_NumBotSpectators = Random(pInfo->m_NumClients-pInfo->m_NumPlayers+1);
+		for(int p = 0; p < pInfo->m_NumClients; p++)
+		{
+			str_copy(pInfo->m_aClients[p].m_aName, Random(20) ? "player" : "friend", sizeof(pInfo->m_aClients[p].m_aName));
+			pInfo->m_aClients[p].m_aClan[0] = 0;
+			pInfo->m_aClients[p].m_Country = Random(3);
+		}
+	}
+
+	void AddFilters(CServerBrowserFilter *pFilter)
+	{
+		static const int s_aFlags[] = {
+			0,
+			IServerBrowser::FILTER_EMPTY|IServerBrowser::FILTER_FULL,
+			IServerBrowser::FILTER_BOTS|IServerBrowser::FILTER_SPECTATORS|IServerBrowser::FILTER_PW,
+			IServerBrowser::FILTER_FAVORITE|IServerBrowser::FILTER_PURE,
+			IServerBrowser::FILTER_FRIENDS,
+		};
+		pFilter->Init(&m_Friends, "0.7");
+		for(unsigned i = 0; i < sizeof(s_aFlags)/sizeof(s_aFlags[0]); i++)
+		{
+			CServerFilterInfo Info;
+			mem_zero(&Info, sizeof(Info));
+			Info.m_SortHash = s_aFlags[i];
+			Info.m_Ping = i == 1 ? 100 : 999;
+			Info.m_ServerLevel = i == 2 ? 1 : 0;
+			if(i == 3)
+				str_copy(Info.m_aGametype[0], "ctf", sizeof(Info.m_aGametype[0]));
+			pFilter->AddFilter(&Info);
+		}
+	}
+};
+
+TEST_F(ServerBrowserFilter, UpdateMatchesSort)
+{
+	for(int Sort = IServerBrowser::SORT_NAME; Sort <= IServerBrowser::SORT_NUMPLAYERS; Sort++)
+	{
+		for(int Order = 0; Order < 2; Order++)
+		{
+			g_Config.m_BrSort = Sort;
+			g_Config.m_BrSortOrder = Order;
+
+			CServerBrowserFilter Filter;
+			CServerBrowserFilter Reference;
+			AddFilters(&Filter);
+			AddFilters(&Reference);
+
+			m_NumServers = 100;
+			for(int i = 0; i < m_NumServers; i++)
+				RandomInfo(m_apServerlist[i]);
+			Filter.Sort(m_apServerlist, m_NumServers, CServerBrowserFilter::RESORT_FLAG_FORCE);
+
+			// servers change one at a time and new ones come in, like while refreshing
+			for(int Round = 0; Round < 600; Round++)
+			{
+				int Index;
+				if(m_NumServers < MAX_SERVERS && Random(4) == 0)
+					Index = m_NumServers++;
+				else
+					Index = Random(m_NumServers);
+				RandomInfo(m_apServerlist[Index]);
+				Filter.Update(m_apServerlist, m_NumServers, Index);
+
+				Reference.Sort(m_apServerlist, m_NumServers, CServerBrowserFilter::RESORT_FLAG_FORCE);
+				for(int f = 0; f < 5; f++)
+				{
+					ASSERT_EQ(Filter.GetNumSortedServers(f), Reference.GetNumSortedServers(f)) << "sort " << Sort << " order " << Order << " round " << Round;
+					ASSERT_EQ(Filter.GetNumSortedPlayers(f), Reference.GetNumSortedPlayers(f)) << "sort " << Sort << " order " << Order << " round " << Round;
+					for(int i = 0; i < Reference.GetNumSortedServers(f); i++)
+						ASSERT_EQ(Filter.GetIndex(f, i), Reference.GetIndex(f, i)) << "sort " << Sort << " order " << Order << " round " << Round << " filter " << f;
+				}
+			}
+		}
+	}
+}
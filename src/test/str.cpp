@@ -61,3 +61,10 @@ TEST(StrFormat, Positional)
 	str_format(aBuf, sizeof(aBuf), "%1$s %1$s %2$d %1$s %2$d", "str", 1);
 	EXPECT_STREQ(aBuf, "str str 1 str 1");
 }
+
+TEST(Str, QuickhashNocase)
+{
+	EXPECT_EQ(str_quickhash_nocase("sv_map"), str_quickhash_nocase("SV_Map"));
+	EXPECT_EQ(str_quickhash_nocase("abc"), str_quickhash("abc"));
+	EXPECT_NE(str_quickhash_nocase("sv_map"), str_quickhash_nocase("sv_maps"));
+}
@@ -0,0 +1,129 @@
+/* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
+/* If you are missing that file, acquire a complete release at teeworlds.com.                */
+#include <base/system.h>
+#include <base/tl/array.h>
+
+#include <engine/console.h>
+#include <engine/kernel.h>
+#include <engine/storage.h>
+#include <engine/shared/config.h>
+
+static const char s_aConfigFile[] = "console_bench.cfg";
+
+enum
+{
+	NUM_CONFIG_LINES=50000,
+	NUM_TEMP_COMMANDS=20000,
+};
+
+static double Milliseconds(int64 Start)
+{
+	return (time_get()-Start)*1000.0/time_freq();
+}
+
+static void CountPossible(const char *pCmd, void *pUser)
+{
+	(*(int *)pUser)++;
+}
+
+// assigns every config variable in turn, like a large autoexec would
+static bool WriteConfig(IStorage *pStorage, IConsole *pConsole)
+{
+	array<const IConsole::CCommandInfo *> lVariables;
+	for(const IConsole::CCommandInfo *pInfo = pConsole->FirstCommandInfo(IConsole::ACCESS_LEVEL_ADMIN, CFGFLAG_SERVER); pInfo;
+		pInfo = pInfo->NextCommandInfo(IConsole::ACCESS_LEVEL_ADMIN, CFGFLAG_SERVER))
+	{
+		if(str_comp(pInfo->m_pParams, "?i") == 0 || str_comp(pInfo->m_pParams, "?r") == 0)
+			lVariables.add(pInfo);
+	}
+	if(!lVariables.size())
+		return false;
+
+	IOHANDLE File = pStorage->OpenFile(s_aConfigFile, IOFLAG_WRITE, IStorage::TYPE_SAVE);
+	if(!File)
+		return false;
+
+	for(int i = 0; i < NUM_CONFIG_LINES; i++)
+	{
+		const IConsole::CCommandInfo *pInfo = lVariables[(i*7919)%lVariables.size()];
+		char aLine[256];
+		if(pInfo->m_pParams[1] == 'i')
+			str_format(aLine, sizeof(aLine), "%s %d", pInfo->m_pName, i%2);
+		else
+			str_format(aLine, sizeof(aLine), "%s \"bench %d\"", pInfo->m_pName, i);
+		io_write(File, aLine, str_length(aLine));
+		io_write_newline(File);
+	}
+	io_close(File);
+	dbg_msg("console_bench", "wrote %d lines assigning %d variables", NUM_CONFIG_LINES, lVariables.size());
+	return true;
+}
+
+int main(int argc, const char **argv) // ignore_convention
+{
+	dbg_logger_stdout();
+
+	IKernel *pKernel = IKernel::Create();
+	IStorage *pStorage = CreateStorage("Teeworlds", IStorage::STORAGETYPE_SERVER, argc, argv);
+	if(!pStorage || !pKernel->RegisterInterface(pStorage))
+		return -1;
+
+	int64 Start = time_get();
+	IConsole *pConsole = CreateConsole(CFGFLAG_SERVER);
+	dbg_msg("console_bench", "registering the built-in commands: %.2f ms", Milliseconds(Start));
+	if(!pKernel->RegisterInterface(pConsole))
+		return -1;
+
+	if(!WriteConfig(pStorage, pConsole))
+	{
+		dbg_msg("console_bench", "failed to write '%s'", s_aConfigFile);
+		return -1;
+	}
+
+	Start = time_get();
+	pConsole->ExecuteFile(s_aConfigFile, -1, true, IStorage::TYPE_SAVE);
+	double ExecTime = Milliseconds(Start);
+	dbg_msg("console_bench", "executing %d lines: %.2f ms (%.0f ns per line)", NUM_CONFIG_LINES, ExecTime, ExecTime*1e6/NUM_CONFIG_LINES);
+	pStorage->RemoveFile(s_aConfigFile, IStorage::TYPE_SAVE);
+
+	// what a client gets from the rcon command list of a large server, in no particular order
+	Start = time_get();
+	for(int i = 0; i < NUM_TEMP_COMMANDS; i++)
+	{
+		char aName[32];
+		str_format(aName, sizeof(aName), "bench_cmd_%05d", (i*7919)%NUM_TEMP_COMMANDS);
+		pConsole->RegisterTemp(aName, "?r", CFGFLAG_SERVER, "benchmark command");
+	}
+	dbg_msg("console_bench", "registering %d temp commands: %.2f ms", NUM_TEMP_COMMANDS, Milliseconds(Start));
+
+	Start = time_get();
+	int Found = 0;
+	for(int i = 0; i < NUM_TEMP_COMMANDS; i++)
+	{
+		char aName[32];
+		str_format(aName, sizeof(aName), "BENCH_CMD_%05d", i);
+		if(pConsole->GetCommandInfo(aName, CFGFLAG_SERVER, true))
+			Found++;
+	}
+	dbg_msg("console_bench", "looking up %d temp commands: %.2f ms (%d found)", NUM_TEMP_COMMANDS, Milliseconds(Start), Found);
+
+	Start = time_get();
+	int Possible = 0;
+	for(int i = 0; i < 100; i++)
+		pConsole->PossibleCommands("cmd_1", CFGFLAG_SERVER, true, CountPossible, &Possible);
+	dbg_msg("console_bench", "completing 100 times: %.2f ms (%d matches each)", Milliseconds(Start), Possible/100);
+
+	Start = time_get();
+	for(int i = 0; i < NUM_TEMP_COMMANDS; i += 2)
+	{
+		char aName[32];
+		str_format(aName, sizeof(aName), "bench_cmd_%05d", i);
+		pConsole->DeregisterTemp(aName);
+	}
+	pConsole->DeregisterTempAll();
+	dbg_msg("console_bench", "removing the temp commands: %.2f ms", Milliseconds(Start));
+
+	delete pConsole;
+	delete pKernel;
+	return Found == NUM_TEMP_COMMANDS ? 0 : -1;
+}
@@ -0,0 +1,112 @@
+/* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
+/* If you are missing that file, acquire a complete release at teeworlds.com.                */
+#include <base/system.h>
+
+#include <engine/console.h>
+#include <engine/storage.h>
+#include <engine/shared/config.h>
+#include <engine/shared/demo.h>
+#include <engine/shared/network.h>
+#include <engine/shared/snapshot.h>
+
+#include <generated/protocol.h>
+
+// plays a demo and records it again with a different keyframe interval,
+// denser keyframes make seeking in long demos faster
+class CRekeyListener : public CDemoPlayer::IListner
+{
+public:
+	CDemoPlayer *m_pPlayer;
+	CDemoRecorder *m_pRecorder;
+	int m_NextMarker;
+
+	virtual void OnDemoPlayerSnapshot(void *pData, int Size)
+	{
+		const CDemoPlayer::CPlaybackInfo *pInfo = m_pPlayer->Info();
+		m_pRecorder->RecordSnapshot(pInfo->m_Info.m_CurrentTick, pData, Size);
+
+		// restore the timeline markers
+		while(m_NextMarker < pInfo->m_Info.m_NumTimelineMarkers && pInfo->m_Info.m_aTimelineMarkers[m_NextMarker] <= pInfo->m_Info.m_CurrentTick)
+		{
+			m_pRecorder->AddDemoMarker();
+			m_NextMarker++;
+		}
+	}
+
+	virtual void OnDemoPlayerMessage(void *pData, int Size)
+	{
+		m_pRecorder->RecordMessage(pData, Size);
+	}
+};
+
+int main(int argc, const char **argv) // ignore_convention
+{
+	dbg_logger_stdout();
+
+	if(argc < 3 || argc > 4)
+	{
+		dbg_msg("usage", "demo_rekey <INPUT DEMO> <OUTPUT DEMO> [KEYFRAME INTERVAL IN TICKS]");
+		return -1;
+	}
+
+	int KeyFrameInterval = argc == 4 ? str_toint(argv[3]) : SERVER_TICK_SPEED;
+	if(KeyFrameInterval < 1)
+	{
+		dbg_msg("demo_rekey", "invalid keyframe interval %d", KeyFrameInterval);
+		return -1;
+	}
+
+	IStorage *pStorage = CreateStorage("Teeworlds", IStorage::STORAGETYPE_CLIENT, argc, argv);
+	IConsole *pConsole = CreateConsole(CFGFLAG_CLIENT);
+	if(!pStorage || !pConsole)
+		return -1;
+
+	CNetBase::Init();
+
+	// the deltas only decode with the static sizes of the net objects
+	CNetObjHandler NetObjHandler;
+	CSnapshotDelta PlayerDelta;
+	CSnapshotDelta RecorderDelta;
+	for(int i = 0; i < NUM_NETOBJTYPES; i++)
+	{
+		PlayerDelta.SetStaticsize(i, NetObjHandler.GetObjSize(i));
+		RecorderDelta.SetStaticsize(i, NetObjHandler.GetObjSize(i));
+	}
+
+	CDemoPlayer Player(&PlayerDelta);
+	CDemoRecorder Recorder(&RecorderDelta);
+
+	CDemoHeader Header;
+	if(!Player.GetDemoInfo(pStorage, argv[1], IStorage::TYPE_ALL, &Header))
+	{
+		dbg_msg("demo_rekey", "failed to read demo header of '%s'", argv[1]);
+		return -1;
+	}
+
+	CRekeyListener Listener;
+	Listener.m_pPlayer = &Player;
+	Listener.m_pRecorder = &Recorder;
+	Listener.m_NextMarker = 0;
+	Player.SetListner(&Listener);
+
+	if(Player.Load(pStorage, pConsole, argv[1], IStorage::TYPE_ALL, Header.m_aNetversion))
+		return -1;
+
+	unsigned Crc = (Header.m_aMapCrc[0]<<24) | (Header.m_aMapCrc[1]<<16) | (Header.m_aMapCrc[2]<<8) | Header.m_aMapCrc[3];
+	Recorder.SetKeyFrameInterval(KeyFrameInterval);
+	if(Recorder.Start(pStorage, pConsole, argv[2], Header.m_aNetversion, Header.m_aMapName, SHA256_ZEROED, Crc, Header.m_aType))
+	{
+		Player.Stop();
+		return -1;
+	}
+
+	Player.Play();
+	while(Player.IsPlaying() && !Player.BaseInfo()->m_Paused)
+		Player.NextFrame();
+
+	Recorder.Stop();
+	Player.Stop();
+
+	dbg_msg("demo_rekey", "wrote '%s' with a keyframe every %d ticks", argv[2], KeyFrameInterval);
+	return 0;
+}
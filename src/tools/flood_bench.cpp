@@ -0,0 +1,193 @@
+/* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
+/* If you are missing that file, acquire a complete release at teeworlds.com.                */
+#include <base/math.h>
+#include <base/system.h>
+
+#include <engine/config.h>
+#include <engine/console.h>
+#include <engine/kernel.h>
+#include <engine/shared/config.h>
+#include <engine/shared/netban.h>
+#include <engine/shared/network.h>
+#include <mastersrv/mastersrv.h>
+
+// floods a server socket with what the connectionless path has to deal with and measures how
+// much of each tick goes into receiving, with and without the flood filter. the sources are
+// spread over 127.0.0.0/8, which needs a system that routes all of it to loopback
+enum
+{
+	NUM_SUBNETS=4,
+	NUM_HOSTS=4,
+	NUM_SOURCES=NUM_SUBNETS*NUM_HOSTS,
+	NUM_PACKET_TYPES=4,
+	TICK_SPEED=50,
+};
+
+static volatile int s_Stop = 0;
+static volatile int64 s_NumSent = 0;
+
+struct CFlooder
+{
+	NETSOCKET m_aSockets[NUM_SOURCES];
+	int m_NumSockets;
+	NETADDR m_Target;
+	unsigned char m_aaPackets[NUM_PACKET_TYPES][NET_MAX_PACKETSIZE];
+	int m_aPacketSizes[NUM_PACKET_TYPES];
+};
+
+static void WriteToken(unsigned char *pBuf, TOKEN Token)
+{
+	pBuf[0] = (Token>>24)&0xff;
+	pBuf[1] = (Token>>16)&0xff;
+	pBuf[2] = (Token>>8)&0xff;
+	pBuf[3] = Token&0xff;
+}
+
+static void BuildPackets(CFlooder *pFlooder)
+{
+	mem_zero(pFlooder->m_aaPackets, sizeof(pFlooder->m_aaPackets));
+
+	// token request, the server answers those
+	unsigned char *pPacket = pFlooder->m_aaPackets[0];
+	pPacket[0] = NET_PACKETFLAG_CONTROL<<2;
+	WriteToken(&pPacket[3], NET_TOKEN_NONE);
+	pPacket[NET_PACKETHEADERSIZE] = NET_CTRLMSG_TOKEN;
+	WriteToken(&pPacket[NET_PACKETHEADERSIZE+1], 0x12345678);
+	pFlooder->m_aPacketSizes[0] = NET_PACKETHEADERSIZE+1+NET_TOKENREQUEST_DATASIZE;
+
+	// info requests with a made up token and without any
+	for(int i = 1; i <= 2; i++)
+	{
+		pPacket = pFlooder->m_aaPackets[i];
+		pPacket[0] = (NET_PACKETFLAG_CONNLESS<<2)|NET_PACKETVERSION;
+		WriteToken(&pPacket[1], i == 1 ? 0x0badf00d : (TOKEN)NET_TOKEN_NONE);
+		WriteToken(&pPacket[5], 0x12345678);
+		mem_copy(&pPacket[NET_PACKETHEADERSIZE_CONNLESS], SERVERBROWSE_GETINFO, sizeof(SERVERBROWSE_GETINFO));
+		pFlooder->m_aPacketSizes[i] = NET_PACKETHEADERSIZE_CONNLESS+sizeof(SERVERBROWSE_GETINFO)+1;
+	}
+
+	// connection packet without a connection
+	pPacket = pFlooder->m_aaPackets[3];
+	WriteToken(&pPacket[3], 0x0badf00d);
+	pFlooder->m_aPacketSizes[3] = NET_PACKETHEADERSIZE+32;
+}
+
+static void FloodThread(void *pUser)
+{
+	CFlooder *pFlooder = (CFlooder *)pUser;
+	int64 NumSent = 0;
+	for(int i = 0; !s_Stop; i++)
+	{
+		int Type = i%NUM_PACKET_TYPES;
+		net_udp_send(pFlooder->m_aSockets[(i/NUM_PACKET_TYPES)%pFlooder->m_NumSockets], &pFlooder->m_Target, pFlooder->m_aaPackets[Type], pFlooder->m_aPacketSizes[Type]);
+		if(++NumSent%1024 == 0)
+			s_NumSent = NumSent;
+	}
+}
+
+static void RunPhase(CNetServer *pNet, const char *pName, int Seconds)
+{
+	CNetFloodStats Start = *pNet->FloodStats();
+	int64 StartSent = s_NumSent;
+	int64 TotalRecv = 0;
+	int64 MaxRecv = 0;
+	int Ticks = 0;
+	int Passed = 0;
+
+	int64 NextTick = time_get();
+	for(; Ticks < Seconds*TICK_SPEED; Ticks++)
+	{
+		NextTick += time_freq()/TICK_SPEED;
+		int64 TickStart = time_get();
+		pNet->Update();
+		CNetChunk Chunk;
+		while(pNet->Recv(&Chunk))
+			Passed++;
+		int64 Elapsed = time_get()-TickStart;
+		TotalRecv += Elapsed;
+		MaxRecv = max(MaxRecv, Elapsed);
+
+		int64 Now = time_get();
+		if(NextTick > Now)
+			thread_sleep((int)((NextTick-Now)*1000/time_freq()));
+	}
+
+	const CNetFloodStats *pEnd = pNet->FloodStats();
+	int64 Received = pEnd->m_Received-Start.m_Received;
+	dbg_msg("flood_bench", "%s: %lld packets sent, %lld received, %.0f ns per packet", pName, s_NumSent-StartSent, Received,
+		TotalRecv*1e9/time_freq()/max(Received, (int64)1));
+	dbg_msg("flood_bench", "%s: receiving took %.2f ms per tick on average, %.2f ms at most", pName,
+		TotalRecv*1000.0/time_freq()/Ticks, MaxRecv*1000.0/time_freq());
+	dbg_msg("flood_bench", "%s: passed=%d rate_limited=%lld subnet_rate_limited=%lld invalid_token=%lld", pName, Passed,
+		pEnd->m_RateLimited-Start.m_RateLimited, pEnd->m_SubnetRateLimited-Start.m_SubnetRateLimited, pEnd->m_InvalidToken-Start.m_InvalidToken);
+}
+
+int main(int argc, const char **argv) // ignore_convention
+{
+	dbg_logger_stdout();
+	if(secure_random_init() != 0)
+		return -1;
+
+	int Port = argc > 1 ? str_toint(argv[1]) : 8399; // ignore_convention
+	int Seconds = argc > 2 ? max(str_toint(argv[2]), 1) : 3; // ignore_convention
+
+	// the limits are the server defaults
+	IKernel *pKernel = IKernel::Create();
+	IConsole *pConsole = CreateConsole(CFGFLAG_SERVER);
+	IConfig *pConfig = CreateConfig();
+	if(!pKernel->RegisterInterface(pConsole) || !pKernel->RegisterInterface(pConfig))
+		return -1;
+	pConfig->Init(CFGFLAG_SERVER);
+
+	CNetBan NetBan;
+	NetBan.Init(pConsole, 0);
+
+	CNetServer *pNet = new CNetServer;
+	NETADDR BindAddr;
+	net_addr_from_str(&BindAddr, "127.0.0.1");
+	BindAddr.port = Port;
+	if(!pNet->Open(BindAddr, &NetBan, 16, 4, 0))
+	{
+		dbg_msg("flood_bench", "couldn't open socket on port %d", Port);
+		return -1;
+	}
+
+	CFlooder *pFlooder = new CFlooder;
+	pFlooder->m_Target = BindAddr;
+	pFlooder->m_NumSockets = 0;
+	BuildPackets(pFlooder);
+	for(int i = 0; i < NUM_SOURCES; i++)
+	{
+		NETADDR SourceAddr;
+		char aAddr[NETADDR_MAXSTRSIZE];
+		str_format(aAddr, sizeof(aAddr), "127.0.%d.%d", 1+i/NUM_HOSTS, 1+i%NUM_HOSTS);
+		net_addr_from_str(&SourceAddr, aAddr);
+		NETSOCKET Socket = net_udp_create(SourceAddr, 1);
+		if(Socket.type)
+			pFlooder->m_aSockets[pFlooder->m_NumSockets++] = Socket;
+	}
+	if(!pFlooder->m_NumSockets)
+	{
+		dbg_msg("flood_bench", "couldn't open any source socket");
+		return -1;
+	}
+	dbg_msg("flood_bench", "flooding from %d addresses in %d subnets", pFlooder->m_NumSockets, (pFlooder->m_NumSockets+NUM_HOSTS-1)/NUM_HOSTS);
+
+	void *pThread = thread_init(FloodThread, pFlooder);
+
+	pNet->SetFloodLimits(0, 1, 0, 1);
+	RunPhase(pNet, "unfiltered", Seconds);
+	pNet->SetFloodLimits(g_Config.m_SvFloodRate, g_Config.m_SvFloodBurst, g_Config.m_SvFloodSubnetRate, g_Config.m_SvFloodSubnetBurst);
+	RunPhase(pNet, "filtered", Seconds);
+
+	s_Stop = 1;
+	thread_wait(pThread);
+	for(int i = 0; i < pFlooder->m_NumSockets; i++)
+		net_udp_close(pFlooder->m_aSockets[i]);
+	delete pFlooder;
+	delete pNet;
+	delete pConfig;
+	delete pConsole;
+	delete pKernel;
+	return 0;
+}
@@ -0,0 +1,213 @@
+/* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
+/* If you are missing that file, acquire a complete release at teeworlds.com.                */
+#include <base/math.h>
+#include <base/system.h>
+#include <base/tl/array.h>
+
+#include <engine/console.h>
+#include <engine/storage.h>
+#include <engine/shared/compression.h>
+#include <engine/shared/config.h>
+#include <engine/shared/demo.h>
+#include <engine/shared/network.h>
+#include <engine/shared/protocol.h>
+#include <engine/shared/snapshot.h>
+
+#include <generated/protocol.h>
+
+class CBufferList
+{
+public:
+	char *m_pData;
+	int m_DataSize;
+	int m_DataCapacity;
+	array<int> m_lSizes;
+
+	CBufferList()
+	{
+		m_pData = 0;
+		m_DataSize = 0;
+		m_DataCapacity = 0;
+	}
+
+	~CBufferList()
+	{
+		mem_free(m_pData);
+	}
+
+	void Add(const void *pData, int Size)
+	{
+		if(m_DataSize+Size > m_DataCapacity)
+		{
+			m_DataCapacity = max(m_DataCapacity*2, m_DataSize+Size);
+			char *pNewData = (char *)mem_alloc(m_DataCapacity, 1);
+			if(m_pData)
+			{
+				mem_copy(pNewData, m_pData, m_DataSize);
+				mem_free(m_pData);
+			}
+			m_pData = pNewData;
+		}
+		mem_copy(m_pData+m_DataSize, pData, Size);
+		m_DataSize += Size;
+		m_lSizes.add(Size);
+	}
+};
+
+// collects what a server would compress for the given demos: the snapshot deltas, which are
+// int packed, and the packet payloads (packed deltas split like NETMSG_SNAP and the game
+// messages), which are huffman compressed
+class CPayloadCollector : public CDemoPlayer::IListner
+{
+public:
+	CSnapshotDelta *m_pDelta;
+	char m_aPrevSnapshot[CSnapshot::MAX_SIZE];
+	bool m_HasPrevSnapshot;
+
+	CBufferList m_Deltas;
+	CBufferList m_Payloads;
+
+	virtual void OnDemoPlayerSnapshot(void *pData, int Size)
+	{
+		CSnapshot EmptySnap;
+		EmptySnap.Clear();
+		CSnapshot *pFrom = m_HasPrevSnapshot ? (CSnapshot *)m_aPrevSnapshot : &EmptySnap;
+
+		char aDeltaData[CSnapshot::MAX_SIZE];
+		char aCompData[CSnapshot::MAX_SIZE];
+		int DeltaSize = m_pDelta->CreateDelta(pFrom, (CSnapshot *)pData, aDeltaData);
+		if(DeltaSize)
+		{
+			m_Deltas.Add(aDeltaData, DeltaSize);
+			int SnapshotSize = CVariableInt::Compress(aDeltaData, DeltaSize, aCompData, sizeof(aCompData));
+			for(int n = 0; n*MAX_SNAPSHOT_PACKSIZE < SnapshotSize; n++)
+				m_Payloads.Add(&aCompData[n*MAX_SNAPSHOT_PACKSIZE], min((int)MAX_SNAPSHOT_PACKSIZE, SnapshotSize-n*MAX_SNAPSHOT_PACKSIZE));
+		}
+
+		mem_copy(m_aPrevSnapshot, pData, Size);
+		m_HasPrevSnapshot = true;
+	}
+
+	virtual void OnDemoPlayerMessage(void *pData, int Size)
+	{
+		m_Payloads.Add(pData, Size);
+	}
+};
+
+typedef long (*FCompressFunc)(const void *pSrc, int SrcSize, void *pDst, int DstSize);
+
+static long HuffmanCompress(const void *pSrc, int SrcSize, void *pDst, int DstSize) { return CNetBase::Compress(pSrc, SrcSize, pDst, DstSize); }
+static long HuffmanDecompress(const void *pSrc, int SrcSize, void *pDst, int DstSize) { return CNetBase::Decompress(pSrc, SrcSize, pDst, DstSize); }
+
+// checks the round trip of every buffer and runs each direction for about a second
+static bool Benchmark(const char *pName, const CBufferList *pList, int MaxSize, FCompressFunc pfnCompress, FCompressFunc pfnDecompress)
+{
+	int NumBuffers = pList->m_lSizes.size();
+	if(!NumBuffers)
+	{
+		dbg_msg("huffman_bench", "%s: nothing to compress", pName);
+		return true;
+	}
+
+	char *pCompressed = (char *)mem_alloc(NumBuffers*MaxSize, 1);
+	char *pBuffer = (char *)mem_alloc(MaxSize, 1);
+	array<int> lCompressedSizes;
+	int TotalCompressed = 0;
+	bool Ok = true;
+	for(int i = 0, Offset = 0; i < NumBuffers; Offset += pList->m_lSizes[i++])
+	{
+		int Size = pfnCompress(pList->m_pData+Offset, pList->m_lSizes[i], pCompressed+i*MaxSize, MaxSize);
+		if(Size < 0 || pfnDecompress(pCompressed+i*MaxSize, Size, pBuffer, MaxSize) != pList->m_lSizes[i] ||
+			mem_comp(pBuffer, pList->m_pData+Offset, pList->m_lSizes[i]) != 0)
+		{
+			dbg_msg("huffman_bench", "%s: round trip failed for buffer %d", pName, i);
+			Ok = false;
+			break;
+		}
+		lCompressedSizes.add(Size);
+		TotalCompressed += Size;
+	}
+
+	if(Ok)
+	{
+		dbg_msg("huffman_bench", "%s: %d buffers, %d bytes, compressed to %d bytes (%.1f%%)", pName, NumBuffers, pList->m_DataSize,
+			TotalCompressed, TotalCompressed*100.0f/pList->m_DataSize);
+
+		for(int Decompress = 0; Decompress < 2; Decompress++)
+		{
+			int64 Start = time_get();
+			int64 Elapsed = 0;
+			int Passes = 0;
+			while(Elapsed < time_freq())
+			{
+				for(int i = 0, Offset = 0; i < NumBuffers; Offset += pList->m_lSizes[i++])
+				{
+					if(Decompress)
+						pfnDecompress(pCompressed+i*MaxSize, lCompressedSizes[i], pBuffer, MaxSize);
+					else
+						pfnCompress(pList->m_pData+Offset, pList->m_lSizes[i], pBuffer, MaxSize);
+				}
+				Passes++;
+				Elapsed = time_get()-Start;
+			}
+
+			double Seconds = Elapsed/(double)time_freq();
+			dbg_msg("huffman_bench", "%s %s: %.1f MB/s (uncompressed), %.0f ns per buffer", pName, Decompress ? "decompress" : "compress",
+				(double)pList->m_DataSize*Passes/Seconds/(1024*1024), Seconds*1e9/((double)NumBuffers*Passes));
+		}
+	}
+
+	mem_free(pBuffer);
+	mem_free(pCompressed);
+	return Ok;
+}
+
+int main(int argc, const char **argv) // ignore_convention
+{
+	dbg_logger_stdout();
+
+	if(argc < 2)
+	{
+		dbg_msg("usage", "huffman_bench <DEMO>...");
+		return -1;
+	}
+
+	IStorage *pStorage = CreateStorage("Teeworlds", IStorage::STORAGETYPE_CLIENT, argc, argv);
+	IConsole *pConsole = CreateConsole(CFGFLAG_CLIENT);
+	if(!pStorage || !pConsole)
+		return -1;
+
+	CNetBase::Init();
+
+	CNetObjHandler NetObjHandler;
+	CSnapshotDelta Delta;
+	for(int i = 0; i < NUM_NETOBJTYPES; i++)
+		Delta.SetStaticsize(i, NetObjHandler.GetObjSize(i));
+
+	CPayloadCollector Collector;
+	Collector.m_pDelta = &Delta;
+
+	for(int i = 1; i < argc; i++)
+	{
+		CDemoPlayer Player(&Delta);
+		CDemoHeader Header;
+		if(!Player.GetDemoInfo(pStorage, argv[i], IStorage::TYPE_ALL, &Header))
+		{
+			dbg_msg("huffman_bench", "failed to read demo header of '%s'", argv[i]);
+			return -1;
+		}
+
+		Collector.m_HasPrevSnapshot = false;
+		Player.SetListner(&Collector);
+		if(Player.Load(pStorage, pConsole, argv[i], IStorage::TYPE_ALL, Header.m_aNetversion))
+			return -1;
+		Player.Play();
+		while(Player.IsPlaying() && !Player.BaseInfo()->m_Paused)
+			Player.NextFrame();
+		Player.Stop();
+	}
+
+	bool Ok = Benchmark("varint", &Collector.m_Deltas, CSnapshot::MAX_SIZE*2, CVariableInt::Compress, CVariableInt::Decompress);
+	Ok = Benchmark("huffman", &Collector.m_Payloads, NET_MAX_PAYLOAD, HuffmanCompress, HuffmanDecompress) && Ok;
+	return Ok ? 0 : -1;
+}
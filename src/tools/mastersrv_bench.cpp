@@ -0,0 +1,271 @@
+/* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
+/* If you are missing that file, acquire a complete release at teeworlds.com.                */
+#include <base/math.h>
+#include <base/system.h>
+
+#include <engine/shared/network.h>
+#include <mastersrv/mastersrv.h>
+
+// registers a lot of fake servers at a master server and then asks it for the list over and over
+// while the servers keep sending heartbeats. every fake server needs its own socket, so the number
+// of servers is bound by the open file limit
+enum
+{
+	MAX_HANDSHAKES=256,
+	NUM_REQUESTERS=8,
+	SERVERS_PER_POLL=512,
+	RESEND_TIME=1,
+};
+
+enum
+{
+	STATE_IDLE=0,
+	STATE_TOKEN,
+	STATE_HEARTBEAT,
+	STATE_REGISTERED,
+};
+
+struct CPeer
+{
+	NETSOCKET m_Socket;
+	int m_State;
+	TOKEN m_Token;
+	TOKEN m_PeerToken;
+	int64 m_SendTime;
+	int m_Received;
+};
+
+static NETADDR s_MasterAddr;
+static int s_NumHandshakes = 0;
+static int s_NumRegistered = 0;
+
+static void SendTokenRequest(CPeer *pPeer, int64 Now)
+{
+	CNetBase::SendControlMsgWithToken(pPeer->m_Socket, &s_MasterAddr, NET_TOKEN_NONE, 0, NET_CTRLMSG_TOKEN, pPeer->m_Token, true);
+	pPeer->m_State = STATE_TOKEN;
+	pPeer->m_SendTime = Now;
+}
+
+static void SendHeartbeat(CPeer *pPeer, int64 Now)
+{
+	// the first check goes to the address the heartbeat came from, the alternative one is not needed
+	unsigned char aData[sizeof(SERVERBROWSE_HEARTBEAT)+2];
+	mem_copy(aData, SERVERBROWSE_HEARTBEAT, sizeof(SERVERBROWSE_HEARTBEAT));
+	aData[sizeof(SERVERBROWSE_HEARTBEAT)] = 8303>>8;
+	aData[sizeof(SERVERBROWSE_HEARTBEAT)+1] = 8303&0xff;
+	CNetBase::SendPacketConnless(pPeer->m_Socket, &s_MasterAddr, pPeer->m_PeerToken, pPeer->m_Token, aData, sizeof(aData));
+	pPeer->m_State = STATE_HEARTBEAT;
+	pPeer->m_SendTime = Now;
+}
+
+static void SendGetList(CPeer *pPeer, int64 Now)
+{
+	CNetBase::SendPacketConnless(pPeer->m_Socket, &s_MasterAddr, pPeer->m_PeerToken, pPeer->m_Token, SERVERBROWSE_GETLIST, sizeof(SERVERBROWSE_GETLIST));
+	pPeer->m_SendTime = Now;
+	pPeer->m_Received = 0;
+}
+
+static bool IsMessage(const CNetPacketConstruct *pPacket, const unsigned char *pMsg, int MsgSize)
+{
+	return (pPacket->m_Flags&NET_PACKETFLAG_CONNLESS) && pPacket->m_DataSize >= MsgSize && mem_comp(pPacket->m_aChunkData, pMsg, MsgSize) == 0;
+}
+
+// returns the number of servers in the list packets that came in
+static int ProcessPeer(CPeer *pPeer, bool Server, int64 Now)
+{
+	int NumListed = 0;
+	unsigned char aBuffer[NET_MAX_PACKETSIZE];
+	CNetPacketConstruct Packet;
+	NETADDR From;
+	int Bytes;
+	while((Bytes = net_udp_recv(pPeer->m_Socket, &From, aBuffer, sizeof(aBuffer))) > 0)
+	{
+		if(CNetBase::UnpackPacket(aBuffer, Bytes, &Packet) != 0 || Packet.m_Token != pPeer->m_Token)
+			continue;
+
+		if(Packet.m_Flags&NET_PACKETFLAG_CONTROL)
+		{
+			if(pPeer->m_State == STATE_TOKEN && Packet.m_aChunkData[0] == NET_CTRLMSG_TOKEN && Packet.m_DataSize >= 5)
+			{
+				pPeer->m_PeerToken = (Packet.m_aChunkData[1]<<24) | (Packet.m_aChunkData[2]<<16) | (Packet.m_aChunkData[3]<<8) | Packet.m_aChunkData[4];
+				if(Server)
+					SendHeartbeat(pPeer, Now);
+				else
+				{
+					pPeer->m_State = STATE_REGISTERED;
+					SendGetList(pPeer, Now);
+				}
+			}
+		}
+		else if(IsMessage(&Packet, SERVERBROWSE_FWCHECK, sizeof(SERVERBROWSE_FWCHECK)))
+			CNetBase::SendPacketConnless(pPeer->m_Socket, &From, Packet.m_ResponseToken, pPeer->m_Token, SERVERBROWSE_FWRESPONSE, sizeof(SERVERBROWSE_FWRESPONSE));
+		else if(IsMessage(&Packet, SERVERBROWSE_FWOK, sizeof(SERVERBROWSE_FWOK)) && pPeer->m_State == STATE_HEARTBEAT)
+		{
+			pPeer->m_State = STATE_REGISTERED;
+			s_NumHandshakes--;
+			s_NumRegistered++;
+		}
+		else if(IsMessage(&Packet, SERVERBROWSE_LIST, sizeof(SERVERBROWSE_LIST)))
+		{
+			int Num = (Packet.m_DataSize-sizeof(SERVERBROWSE_LIST))/sizeof(CMastersrvAddr);
+			pPeer->m_Received += Num;
+			pPeer->m_SendTime = Now;
+			NumListed += Num;
+		}
+	}
+	return NumListed;
+}
+
+static void Resend(CPeer *pPeer, bool Server, int64 Now)
+{
+	if(Now < pPeer->m_SendTime+time_freq()*RESEND_TIME)
+		return;
+	if(pPeer->m_State == STATE_TOKEN)
+		SendTokenRequest(pPeer, Now);
+	else if(pPeer->m_State == STATE_HEARTBEAT)
+		SendHeartbeat(pPeer, Now);
+	else if(pPeer->m_State == STATE_REGISTERED && !Server)
+		SendGetList(pPeer, Now);
+}
+
+static bool OpenPeer(CPeer *pPeer)
+{
+	NETADDR BindAddr;
+	mem_zero(&BindAddr, sizeof(BindAddr));
+	BindAddr.type = s_MasterAddr.type;
+	pPeer->m_Socket = net_udp_create(BindAddr, 1);
+	if(!pPeer->m_Socket.type)
+		return false;
+	pPeer->m_State = STATE_IDLE;
+	secure_random_fill(&pPeer->m_Token, sizeof(pPeer->m_Token));
+	pPeer->m_Token &= NET_TOKEN_MASK;
+	if(pPeer->m_Token == NET_TOKEN_NONE)
+		pPeer->m_Token--;
+	pPeer->m_PeerToken = NET_TOKEN_NONE;
+	pPeer->m_SendTime = 0;
+	pPeer->m_Received = 0;
+	return true;
+}
+
+int main(int argc, const char **argv) // ignore_convention
+{
+	dbg_logger_stdout();
+	if(secure_random_init() != 0)
+		return -1;
+
+	const char *pAddr = argc > 1 ? argv[1] : "localhost"; // ignore_convention
+	int NumServers = argc > 2 ? max(str_toint(argv[2]), 1) : 10000; // ignore_convention
+	int Seconds = argc > 3 ? max(str_toint(argv[3]), 1) : 10; // ignore_convention
+	if(net_host_lookup(pAddr, &s_MasterAddr, NETTYPE_ALL) != 0)
+	{
+		dbg_msg("mastersrv_bench", "couldn't resolve '%s'", pAddr);
+		return -1;
+	}
+	if(!s_MasterAddr.port)
+		s_MasterAddr.port = MASTERSERVER_PORT;
+
+	net_init();
+	CNetBase::Init();
+
+	CPeer *pServers = new CPeer[NumServers];
+	for(int i = 0; i < NumServers; i++)
+	{
+		if(!OpenPeer(&pServers[i]))
+		{
+			dbg_msg("mastersrv_bench", "couldn't open more than %d sockets", i);
+			NumServers = i;
+			break;
+		}
+	}
+	CPeer aRequesters[NUM_REQUESTERS];
+	for(int i = 0; i < NUM_REQUESTERS; i++)
+	{
+		if(!OpenPeer(&aRequesters[i]))
+			return -1;
+	}
+
+	// registration, a few at a time so the socket buffers do not overflow
+	int64 Start = time_get();
+	int64 LastProgress = Start;
+	int NextServer = 0;
+	while(s_NumRegistered < NumServers)
+	{
+		int64 Now = time_get();
+		for(; NextServer < NumServers && s_NumHandshakes < MAX_HANDSHAKES; NextServer++, s_NumHandshakes++)
+			SendTokenRequest(&pServers[NextServer], Now);
+
+		int Registered = s_NumRegistered;
+		for(int i = 0; i < NextServer; i++)
+		{
+			ProcessPeer(&pServers[i], true, Now);
+			Resend(&pServers[i], true, Now);
+		}
+		if(s_NumRegistered != Registered)
+			LastProgress = Now;
+		else if(Now > LastProgress+time_freq()*10)
+		{
+			dbg_msg("mastersrv_bench", "the master stopped answering after %d servers", s_NumRegistered);
+			return -1;
+		}
+		thread_sleep(1);
+	}
+	double Elapsed = (time_get()-Start)/(double)time_freq();
+	dbg_msg("mastersrv_bench", "registered %d servers in %.2f s (%.0f per second)", NumServers, Elapsed, NumServers/Elapsed);
+
+	// list requests while every server sends one more heartbeat
+	s_NumRegistered = 0;
+	int64 NumLists = 0;
+	int64 NumPartialLists = 0;
+	int64 NumListed = 0;
+	int64 NumBeats = 0;
+	Start = time_get();
+	int64 End = Start+time_freq()*Seconds;
+	for(int i = 0; i < NUM_REQUESTERS; i++)
+		SendTokenRequest(&aRequesters[i], Start);
+	int NextPoll = 0;
+	while(time_get() < End)
+	{
+		int64 Now = time_get();
+		int64 Due = (Now-Start)*NumServers/(End-Start);
+		for(; NumBeats < Due; NumBeats++)
+			SendHeartbeat(&pServers[NumBeats], Now);
+
+		// only some of the servers each time, the requesters have to keep up with the lists
+		for(int i = 0; i < min((int)SERVERS_PER_POLL, NumServers); i++)
+		{
+			ProcessPeer(&pServers[NextPoll], true, Now);
+			Resend(&pServers[NextPoll], true, Now);
+			NextPoll = (NextPoll+1)%NumServers;
+		}
+		for(int i = 0; i < NUM_REQUESTERS; i++)
+		{
+			CPeer *pPeer = &aRequesters[i];
+			NumListed += ProcessPeer(pPeer, false, Now);
+			if(pPeer->m_State != STATE_REGISTERED)
+				Resend(pPeer, false, Now);
+			else if(pPeer->m_Received >= NumServers)
+			{
+				NumLists++;
+				SendGetList(pPeer, Now);
+			}
+			else if(Now > pPeer->m_SendTime+time_freq()/10)
+			{
+				// big lists overflow the default receive buffer, ask again once nothing comes anymore
+				NumPartialLists++;
+				SendGetList(pPeer, Now);
+			}
+		}
+	}
+	Elapsed = (time_get()-Start)/(double)time_freq();
+	dbg_msg("mastersrv_bench", "%lld full and %lld partial lists in %.2f s (%.1f full lists per second)", NumLists, NumPartialLists, Elapsed,
+		NumLists/Elapsed);
+	dbg_msg("mastersrv_bench", "%.0f listed servers per second, %.1f lists worth", NumListed/Elapsed, NumListed/Elapsed/NumServers);
+	dbg_msg("mastersrv_bench", "%lld heartbeats sent meanwhile, %d of them confirmed", NumBeats, s_NumRegistered);
+
+	for(int i = 0; i < NumServers; i++)
+		net_udp_close(pServers[i].m_Socket);
+	for(int i = 0; i < NUM_REQUESTERS; i++)
+		net_udp_close(aRequesters[i].m_Socket);
+	delete[] pServers;
+	return 0;
+}
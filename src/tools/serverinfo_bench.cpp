@@ -0,0 +1,115 @@
+/* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
+/* If you are missing that file, acquire a complete release at teeworlds.com.                */
+#include <base/math.h>
+#include <base/system.h>
+
+#include <engine/shared/network.h>
+#include <engine/shared/packer.h>
+#include <mastersrv/mastersrv.h>
+
+// asks a running server for its info as fast as it answers and reports how many requests per
+// second it serves. every source address is rate limited by the server, so run it with
+// sv_flood_rate 0 to measure the info path itself
+enum
+{
+	NUM_CLIENTS=8,
+	MAX_PENDING=32,
+};
+
+int main(int argc, const char **argv) // ignore_convention
+{
+	dbg_logger_stdout();
+	if(secure_random_init() != 0)
+		return -1;
+
+	if(argc < 2)
+	{
+		dbg_msg("usage", "serverinfo_bench <ADDRESS> [SECONDS]");
+		return -1;
+	}
+
+	NETADDR Addr;
+	if(net_host_lookup(argv[1], &Addr, NETTYPE_ALL)) // ignore_convention
+	{
+		dbg_msg("serverinfo_bench", "couldn't resolve '%s'", argv[1]); // ignore_convention
+		return -1;
+	}
+	if(!Addr.port)
+		Addr.port = 8303;
+	int Seconds = argc > 2 ? max(str_toint(argv[2]), 1) : 5; // ignore_convention
+
+	CNetBase::Init();
+
+	CNetClient *pClients = new CNetClient[NUM_CLIENTS];
+	int aPending[NUM_CLIENTS] = {0};
+	for(int i = 0; i < NUM_CLIENTS; i++)
+	{
+		NETADDR BindAddr;
+		mem_zero(&BindAddr, sizeof(BindAddr));
+		BindAddr.type = Addr.type;
+		if(!pClients[i].Open(BindAddr, 0))
+		{
+			dbg_msg("serverinfo_bench", "couldn't open client socket");
+			return -1;
+		}
+	}
+
+	int64 Sent = 0;
+	int64 Answered = 0;
+	int64 AnsweredBytes = 0;
+	int64 Start = time_get();
+	int64 End = Start+time_freq()*Seconds;
+	int64 LastResponse = Start;
+	while(time_get() < End)
+	{
+		for(int i = 0; i < NUM_CLIENTS; i++)
+		{
+			CNetClient *pClient = &pClients[i];
+			for(; aPending[i] < MAX_PENDING; aPending[i]++, Sent++)
+			{
+				CPacker Packer;
+				Packer.Reset();
+				Packer.AddRaw(SERVERBROWSE_GETINFO, sizeof(SERVERBROWSE_GETINFO));
+				Packer.AddInt((int)(Sent&0xff));
+
+				CNetChunk Packet;
+				Packet.m_ClientID = -1;
+				Packet.m_Address = Addr;
+				Packet.m_Flags = NETSENDFLAG_CONNLESS;
+				Packet.m_DataSize = Packer.Size();
+				Packet.m_pData = Packer.Data();
+				pClient->Send(&Packet);
+			}
+
+			pClient->Update();
+			CNetChunk Response;
+			while(pClient->Recv(&Response))
+			{
+				if(Response.m_DataSize >= int(sizeof(SERVERBROWSE_INFO)) &&
+					mem_comp(Response.m_pData, SERVERBROWSE_INFO, sizeof(SERVERBROWSE_INFO)) == 0)
+				{
+					aPending[i] = max(aPending[i]-1, 0);
+					Answered++;
+					AnsweredBytes += Response.m_DataSize;
+					LastResponse = time_get();
+				}
+			}
+		}
+
+		// requests that got dropped on the way are not coming back
+		if(time_get()-LastResponse > time_freq()/2)
+		{
+			mem_zero(aPending, sizeof(aPending));
+			LastResponse = time_get();
+		}
+	}
+	double Elapsed = (time_get()-Start)/(double)time_freq();
+
+	dbg_msg("serverinfo_bench", "%lld requests sent, %lld answered in %.1f s", Sent, Answered, Elapsed);
+	dbg_msg("serverinfo_bench", "%.0f responses per second, %.0f bytes each", Answered/Elapsed, AnsweredBytes/(double)max(Answered, (int64)1));
+
+	for(int i = 0; i < NUM_CLIENTS; i++)
+		pClients[i].Close();
+	delete[] pClients;
+	return Answered ? 0 : -1;
+}
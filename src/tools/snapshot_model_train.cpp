@@ -0,0 +1,180 @@
+/* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
+/* If you are missing that file, acquire a complete release at teeworlds.com.                */
+#include <base/math.h>
+#include <base/system.h>
+
+#include <engine/console.h>
+#include <engine/storage.h>
+#include <engine/shared/compression.h>
+#include <engine/shared/config.h>
+#include <engine/shared/demo.h>
+#include <engine/shared/network.h>
+#include <engine/shared/snapshot.h>
+#include <engine/shared/snapshot_model.h>
+
+#include <generated/protocol.h>
+
+// int packs the snapshot deltas of a demo like the server does and keeps them for training
+class CDeltaCollector : public CDemoPlayer::IListner
+{
+public:
+	CSnapshotDelta *m_pDelta;
+	char m_aPrevSnapshot[CSnapshot::MAX_SIZE];
+	bool m_HasPrevSnapshot;
+
+	unsigned char *m_pData;
+	int m_DataSize;
+	int m_DataCapacity;
+	int m_NumSnapshots;
+	int64 m_aByteCounts[CSnapshotModel::NUM_SYMBOLS];
+
+	CDeltaCollector()
+	{
+		m_pData = 0;
+		m_DataSize = 0;
+		m_DataCapacity = 0;
+		m_NumSnapshots = 0;
+		mem_zero(m_aByteCounts, sizeof(m_aByteCounts));
+	}
+
+	~CDeltaCollector()
+	{
+		mem_free(m_pData);
+	}
+
+	virtual void OnDemoPlayerSnapshot(void *pData, int Size)
+	{
+		CSnapshot EmptySnap;
+		EmptySnap.Clear();
+		CSnapshot *pFrom = m_HasPrevSnapshot ? (CSnapshot *)m_aPrevSnapshot : &EmptySnap;
+
+		char aDeltaData[CSnapshot::MAX_SIZE];
+		unsigned char aCompData[CSnapshot::MAX_SIZE];
+		int DeltaSize = m_pDelta->CreateDelta(pFrom, (CSnapshot *)pData, aDeltaData);
+		if(DeltaSize)
+		{
+			int CompSize = CVariableInt::Compress(aDeltaData, DeltaSize, aCompData, sizeof(aCompData));
+			if(CompSize > 0)
+			{
+				for(int i = 0; i < CompSize; i++)
+					m_aByteCounts[aCompData[i]]++;
+
+				// size prefixed so the evaluation can split them up again
+				if(m_DataSize+CompSize+4 > m_DataCapacity)
+				{
+					m_DataCapacity = max(m_DataCapacity*2, m_DataSize+CompSize+4);
+					unsigned char *pNewData = (unsigned char *)mem_alloc(m_DataCapacity, 1);
+					if(m_pData)
+					{
+						mem_copy(pNewData, m_pData, m_DataSize);
+						mem_free(m_pData);
+					}
+					m_pData = pNewData;
+				}
+				mem_copy(m_pData+m_DataSize, &CompSize, 4);
+				mem_copy(m_pData+m_DataSize+4, aCompData, CompSize);
+				m_DataSize += CompSize+4;
+				m_NumSnapshots++;
+			}
+		}
+
+		mem_copy(m_aPrevSnapshot, pData, Size);
+		m_HasPrevSnapshot = true;
+	}
+
+	virtual void OnDemoPlayerMessage(void *pData, int Size) {}
+};
+
+int main(int argc, const char **argv) // ignore_convention
+{
+	dbg_logger_stdout();
+
+	if(argc < 3)
+	{
+		dbg_msg("usage", "snapshot_model_train <OUTPUT MODEL> <DEMO>...");
+		return -1;
+	}
+
+	IStorage *pStorage = CreateStorage("Teeworlds", IStorage::STORAGETYPE_CLIENT, argc, argv);
+	IConsole *pConsole = CreateConsole(CFGFLAG_CLIENT);
+	if(!pStorage || !pConsole)
+		return -1;
+
+	CNetBase::Init();
+
+	CNetObjHandler NetObjHandler;
+	CSnapshotDelta Delta;
+	for(int i = 0; i < NUM_NETOBJTYPES; i++)
+		Delta.SetStaticsize(i, NetObjHandler.GetObjSize(i));
+
+	CDeltaCollector Collector;
+	Collector.m_pDelta = &Delta;
+
+	for(int i = 2; i < argc; i++)
+	{
+		CDemoPlayer Player(&Delta);
+		CDemoHeader Header;
+		if(!Player.GetDemoInfo(pStorage, argv[i], IStorage::TYPE_ALL, &Header))
+		{
+			dbg_msg("snapshot_model_train", "failed to read demo header of '%s'", argv[i]);
+			return -1;
+		}
+
+		Collector.m_HasPrevSnapshot = false;
+		Player.SetListner(&Collector);
+		if(Player.Load(pStorage, pConsole, argv[i], IStorage::TYPE_ALL, Header.m_aNetversion))
+			return -1;
+		Player.Play();
+		while(Player.IsPlaying() && !Player.BaseInfo()->m_Paused)
+			Player.NextFrame();
+		Player.Stop();
+	}
+
+	if(!Collector.m_NumSnapshots)
+	{
+		dbg_msg("snapshot_model_train", "no snapshots found");
+		return -1;
+	}
+
+	CSnapshotModel Model;
+	Model.Train(Collector.m_aByteCounts);
+	if(!Model.Save(pStorage, argv[1]))
+	{
+		dbg_msg("snapshot_model_train", "failed to save model to '%s'", argv[1]);
+		return -1;
+	}
+
+	// compare against the generic huffman table every packet goes through
+	int64 TotalInt = 0;
+	int64 TotalGeneric = 0;
+	int64 TotalModel = 0;
+	for(int Offset = 0; Offset < Collector.m_DataSize;)
+	{
+		int Size;
+		mem_copy(&Size, Collector.m_pData+Offset, 4);
+		const unsigned char *pData = Collector.m_pData+Offset+4;
+		Offset += Size+4;
+
+		unsigned char aBuffer[CSnapshot::MAX_SIZE];
+		unsigned char aCheck[CSnapshot::MAX_SIZE];
+		int ModelSize = Model.Compress(pData, Size, aBuffer, sizeof(aBuffer));
+		if(ModelSize < 0 || Model.Decompress(aBuffer, ModelSize, aCheck, sizeof(aCheck)) != Size || mem_comp(aCheck, pData, Size) != 0)
+		{
+			dbg_msg("snapshot_model_train", "model round trip failed");
+			return -1;
+		}
+		int GenericSize = CNetBase::Compress(pData, Size, aBuffer, sizeof(aBuffer));
+
+		TotalInt += Size;
+		TotalGeneric += GenericSize < 0 ? Size : min(GenericSize, Size);
+		TotalModel += ModelSize;
+	}
+
+	int Num = Collector.m_NumSnapshots;
+	dbg_msg("snapshot_model_train", "trained on %d snapshots, saved to '%s'", Num, argv[1]);
+	dbg_msg("snapshot_model_train", "int packed: %.1f bytes per snapshot", TotalInt/(double)Num);
+	dbg_msg("snapshot_model_train", "generic huffman: %.1f bytes per snapshot", TotalGeneric/(double)Num);
+	dbg_msg("snapshot_model_train", "snapshot model: %.1f bytes per snapshot (%.1f%% smaller than generic)", TotalModel/(double)Num,
+		100.0-TotalModel*100.0/TotalGeneric);
+	return 0;
+}
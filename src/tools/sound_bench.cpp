@@ -0,0 +1,80 @@
+/* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
+/* If you are missing that file, acquire a complete release at teeworlds.com.                */
+#include <base/math.h>
+#include <base/system.h>
+
+#include <engine/client/mixer.h>
+#include <engine/sound.h>
+
+// mixes looping voices of generated sounds into a buffer like the audio callback does, without
+// an audio device. half of the voices are positioned around the listener. the checksum only
+// depends on the arguments, so it shows whether two builds mix the same
+enum
+{
+	MIX_RATE=48000,
+	BUFFER_FRAMES=512,
+	NUM_SOUNDS=8,
+};
+
+int main(int argc, const char **argv) // ignore_convention
+{
+	dbg_logger_stdout();
+
+	int NumVoices = argc > 1 ? clamp(str_toint(argv[1]), 1, (int)CMixer::NUM_VOICES) : CMixer::NUM_VOICES; // ignore_convention
+	int Seconds = argc > 2 ? max(str_toint(argv[2]), 1) : 60; // ignore_convention
+
+	// noise of different lengths, every other one in mono
+	CSample aSounds[NUM_SOUNDS];
+	unsigned Seed = 1;
+	for(int i = 0; i < NUM_SOUNDS; i++)
+	{
+		CSample *pSound = &aSounds[i];
+		mem_zero(pSound, sizeof(*pSound));
+		pSound->m_Channels = 1+i%2;
+		pSound->m_NumFrames = MIX_RATE/2+i*MIX_RATE/4+i;
+		pSound->m_Rate = MIX_RATE;
+		pSound->m_pData = (short *)mem_alloc(pSound->m_NumFrames*pSound->m_Channels*sizeof(short), 1);
+		for(int f = 0; f < pSound->m_NumFrames*pSound->m_Channels; f++)
+		{
+			Seed = Seed*1103515245+12345;
+			pSound->m_pData[f] = (short)(Seed>>16);
+		}
+	}
+
+	CMixer *pMixer = new CMixer;
+	pMixer->Init(BUFFER_FRAMES);
+	pMixer->SetMaxDistance(1500.0f);
+	for(int i = 0; i < NumVoices; i++)
+	{
+		int Flags = ISound::FLAG_LOOP;
+		if(i%2)
+			Flags |= ISound::FLAG_POS;
+		pMixer->Play(&aSounds[i%NUM_SOUNDS], i%4, Flags, (i*397)%2000-1000, (i*211)%1200-600);
+	}
+
+	short aOut[BUFFER_FRAMES*2];
+	unsigned Checksum = 0;
+	int64 NumBuffers = 0;
+	int64 Start = time_get();
+	while(NumBuffers*BUFFER_FRAMES < (int64)Seconds*MIX_RATE)
+	{
+		// some movement so the gains change like in game
+		pMixer->SetListenerPos((int)(NumBuffers%400)-200, 0);
+		for(int i = 0; i < 16; i++, NumBuffers++)
+		{
+			pMixer->Mix(aOut, BUFFER_FRAMES);
+			for(int f = 0; f < BUFFER_FRAMES*2; f++)
+				Checksum = Checksum*31+(unsigned short)aOut[f];
+		}
+	}
+	double Elapsed = (time_get()-Start)/(double)time_freq();
+	double Mixed = NumBuffers*BUFFER_FRAMES/(double)MIX_RATE;
+
+	dbg_msg("sound_bench", "%d voices, %.1f s of sound mixed in %.2f s (%.0fx real time)", NumVoices, Mixed, Elapsed, Mixed/Elapsed);
+	dbg_msg("sound_bench", "%.2f ns per voice and frame, checksum %08x", Elapsed*1e9/(NumBuffers*BUFFER_FRAMES*(double)NumVoices), Checksum);
+
+	delete pMixer;
+	for(int i = 0; i < NUM_SOUNDS; i++)
+		mem_free(aSounds[i].m_pData);
+	return 0;
+}